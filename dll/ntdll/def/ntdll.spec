@@ -482,7 +482,7 @@
 @ stdcall NtReleaseSemaphore(long long ptr)
 @ stub -version=0x600+ NtReleaseWorkerFactoryWorker
 @ stdcall NtRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stub -version=0x600+ NtRemoveIoCompletionEx
+@ stdcall NtRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall NtRemoveProcessDebug(ptr ptr)
 @ stdcall NtRenameKey(ptr ptr)
 @ stub -version=0x600+ NtRenameTransactionManager
@@ -1640,7 +1640,7 @@
 @ stdcall ZwReleaseSemaphore(long long ptr)
 @ stub -version=0x600+ ZwReleaseWorkerFactoryWorker
 @ stdcall ZwRemoveIoCompletion(ptr ptr ptr ptr ptr)
-@ stub -version=0x600+ ZwRemoveIoCompletionEx
+@ stdcall ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall ZwRemoveProcessDebug(ptr ptr)
 @ stdcall ZwRenameKey(ptr ptr)
 @ stub -version=0x600+ ZwRenameTransactionManager
@@ -20,24 +20,48 @@
 #if (_WIN32_WINNT < 0x0600)
 #define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS 0x1
 #define FILE_SKIP_SET_EVENT_ON_HANDLE        0x2
+#define FileIoCompletionNotificationInformation (FileShortNameInformation + 1)
 #endif
 
+/* GetQueuedCompletionStatusEx hands the caller's array straight to the kernel */
+C_ASSERT(sizeof(OVERLAPPED_ENTRY) == sizeof(FILE_IO_COMPLETION_INFORMATION));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, lpCompletionKey) == FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, KeyContext));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, lpOverlapped) == FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, ApcContext));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, Internal) == FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, IoStatusBlock.Status));
+C_ASSERT(FIELD_OFFSET(OVERLAPPED_ENTRY, dwNumberOfBytesTransferred) == FIELD_OFFSET(FILE_IO_COMPLETION_INFORMATION, IoStatusBlock.Information));
+
 /*
- * @unimplemented
+ * @implemented
  */
 BOOL
 WINAPI
 SetFileCompletionNotificationModes(IN HANDLE FileHandle,
                                    IN UCHAR Flags)
 {
+    NTSTATUS Status;
+    FILE_IO_COMPLETION_NOTIFICATION_INFORMATION NotificationInformation;
+    IO_STATUS_BLOCK IoStatusBlock;
+
     if (Flags & ~(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE))
     {
         SetLastError(ERROR_INVALID_PARAMETER);
         return FALSE;
     }
 
-    UNIMPLEMENTED;
-    return FALSE;
+    /* Let the I/O Manager flag the file object */
+    NotificationInformation.Flags = Flags;
+    Status = NtSetInformationFile(FileHandle,
+                                  &IoStatusBlock,
+                                  &NotificationInformation,
+                                  sizeof(NotificationInformation),
+                                  FileIoCompletionNotificationInformation);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 /*
@@ -167,6 +191,68 @@ GetQueuedCompletionStatus(IN HANDLE CompletionHandle,
     return TRUE;
 }
 
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+GetQueuedCompletionStatusEx(IN HANDLE CompletionPort,
+                            OUT LPOVERLAPPED_ENTRY lpCompletionPortEntries,
+                            IN ULONG ulCount,
+                            OUT PULONG ulNumEntriesRemoved,
+                            IN DWORD dwMilliseconds,
+                            IN BOOL fAlertable)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER Time;
+    PLARGE_INTEGER TimePtr;
+
+    /* The caller must give us room for at least one entry */
+    if (!(lpCompletionPortEntries) || !(ulCount))
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    /*
+     * Convert the timeout and then call the native API. The entries have the
+     * same layout as the native ones, so the kernel fills them in directly.
+     */
+    TimePtr = BaseFormatTimeOut(&Time, dwMilliseconds);
+    Status = NtRemoveIoCompletionEx(CompletionPort,
+                                    (PFILE_IO_COMPLETION_INFORMATION)lpCompletionPortEntries,
+                                    ulCount,
+                                    ulNumEntriesRemoved,
+                                    TimePtr,
+                                    fAlertable ? TRUE : FALSE);
+    if (!(NT_SUCCESS(Status)) || (Status == STATUS_TIMEOUT) ||
+        (Status == STATUS_USER_APC) || (Status == STATUS_ALERTED))
+    {
+        /* Check what kind of error we got */
+        if (Status == STATUS_TIMEOUT)
+        {
+            /* Timeout error is set directly since there's no conversion */
+            SetLastError(WAIT_TIMEOUT);
+        }
+        else if ((Status == STATUS_USER_APC) || (Status == STATUS_ALERTED))
+        {
+            /* The alertable wait was interrupted */
+            SetLastError(WAIT_IO_COMPLETION);
+        }
+        else
+        {
+            /* Any other error gets converted */
+            BaseSetLastNTError(Status);
+        }
+
+        /* This is a failure case */
+        return FALSE;
+    }
+
+    /* Return success, the status of each entry is for the caller to check */
+    return TRUE;
+}
+
 /*
  * @implemented
  */
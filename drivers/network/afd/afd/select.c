@@ -52,6 +52,36 @@ VOID ZeroEvents( PAFD_HANDLE HandleArray,
 }
 
 
+/* Takes the poll off the wait lists of the sockets it was waiting on */
+static VOID UnlinkPollWaitBlocks( PAFD_ACTIVE_POLL Poll,
+                                  UINT HandleCount ) {
+    UINT i;
+
+    for( i = 0; i < HandleCount; i++ ) {
+        if( Poll->WaitBlocks[i].FCB ) {
+            RemoveEntryList( &Poll->WaitBlocks[i].ListEntry );
+            Poll->WaitBlocks[i].FCB = NULL;
+        }
+    }
+}
+
+/*
+ * Returns the entry following the ones of the given poll in a socket wait
+ * list, so that it can be signalled while walking the list. The blocks of a
+ * poll that refers several times to the same socket are always adjacent,
+ * because AfdSelect queues them all at once under the device lock.
+ */
+static PLIST_ENTRY NextPollWaitBlock( PLIST_ENTRY ListEntry,
+                                      PLIST_ENTRY ListHead,
+                                      PAFD_ACTIVE_POLL Poll ) {
+    do {
+        ListEntry = ListEntry->Flink;
+    } while( ListEntry != ListHead &&
+             CONTAINING_RECORD(ListEntry, AFD_POLL_WAIT_BLOCK, ListEntry)->Poll == Poll );
+
+    return ListEntry;
+}
+
 /* you must pass either Poll OR Irp */
 VOID SignalSocket(
    PAFD_ACTIVE_POLL Poll OPTIONAL,
@@ -68,6 +98,7 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        UnlinkPollWaitBlocks( Poll, PollReq->HandleCount );
         ExFreePoolWithTag(Poll, TAG_AFD_ACTIVE_POLL);
     }
 
@@ -127,33 +158,30 @@ VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
 
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
-        ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
+    /* Only the polls waiting on this socket can refer to it */
+    ListEntry = FCB->PollWaitList.Flink;
+    while ( ListEntry != &FCB->PollWaitList ) {
+        WaitBlock = CONTAINING_RECORD(ListEntry, AFD_POLL_WAIT_BLOCK, ListEntry);
+        Poll = WaitBlock->Poll;
 
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
+        if( OnlyExclusive && !Poll->Exclusive ) {
+            ListEntry = ListEntry->Flink;
+            continue;
         }
+
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+        ListEntry = NextPollWaitBlock( ListEntry, &FCB->PollWaitList, Poll );
+        ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+        SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -189,6 +217,21 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return STATUS_NO_MEMORY;
     }
 
+    /* We are going to use their FCB, so they must all be our sockets */
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        if( !FileObject ) continue;
+
+        if( FileObject->DeviceObject != DeviceObject || !FileObject->FsContext ) {
+            AFD_DbgPrint(MIN_TRACE,("Handle %u is not an AFD socket\n", i));
+            UnlockHandles( AFD_HANDLES(PollReq), PollReq->HandleCount );
+            Irp->IoStatus.Status = STATUS_INVALID_HANDLE;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+
     if( Exclusive ) {
         for( i = 0; i < PollReq->HandleCount; i++ ) {
             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
@@ -229,7 +272,8 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
        PAFD_ACTIVE_POLL Poll = NULL;
 
        Poll = ExAllocatePoolWithTag(NonPagedPool,
-                                    sizeof(AFD_ACTIVE_POLL),
+                                    FIELD_OFFSET(AFD_ACTIVE_POLL, WaitBlocks) +
+                                    PollReq->HandleCount * sizeof(AFD_POLL_WAIT_BLOCK),
                                     TAG_AFD_ACTIVE_POLL);
 
        if (Poll){
@@ -243,6 +287,19 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
           InsertTailList( &DeviceExt->Polls, &Poll->ListEntry );
 
+          /* Wait on each socket, so that only its own changes reevaluate us */
+          for( i = 0; i < PollReq->HandleCount; i++ ) {
+             Poll->WaitBlocks[i].Poll = Poll;
+             Poll->WaitBlocks[i].FCB = NULL;
+
+             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
+
+             FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+             Poll->WaitBlocks[i].FCB = FileObject->FsContext;
+             InsertTailList( &Poll->WaitBlocks[i].FCB->PollWaitList,
+                             &Poll->WaitBlocks[i].ListEntry );
+          }
+
           KeSetTimer( &Poll->Timer, PollReq->Timeout, &Poll->TimeoutDpc );
 
           Status = STATUS_PENDING;
@@ -406,10 +463,12 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
 
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
+    PAFD_POLL_WAIT_BLOCK WaitBlock;
     PLIST_ENTRY ThePollEnt = NULL;
     PAFD_FCB FCB;
     KIRQL OldIrql;
     PAFD_POLL_INFO PollReq;
+    UINT Index;
 
     AFD_DbgPrint(MID_TRACE,("Called: DeviceExt %p FileObject %p\n",
                             DeviceExt, FileObject));
@@ -424,16 +483,20 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Now signal the select irps waiting on this socket */
+    ThePollEnt = FCB->PollWaitList.Flink;
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
+    while( ThePollEnt != &FCB->PollWaitList ) {
+        WaitBlock = CONTAINING_RECORD( ThePollEnt, AFD_POLL_WAIT_BLOCK, ListEntry );
+        Poll = WaitBlock->Poll;
         PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+        Index = (UINT)(WaitBlock - Poll->WaitBlocks);
         AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
+        /* Only look at the whole request if this socket satisfies it */
+        if( PollReq->Handles[Index].Events & FCB->PollState ) {
+            ThePollEnt = NextPollWaitBlock( ThePollEnt, &FCB->PollWaitList, Poll );
+            UpdatePollWithFCB( Poll, FileObject );
             AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
             SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
         } else
@@ -113,6 +113,14 @@ typedef struct _AFD_DEVICE_EXTENSION {
     KSPIN_LOCK Lock;
 } AFD_DEVICE_EXTENSION, *PAFD_DEVICE_EXTENSION;
 
+/* Links a pending poll to one of the sockets it waits on.
+ * There is one per handle of the poll request, at the same index */
+typedef struct _AFD_POLL_WAIT_BLOCK {
+    LIST_ENTRY ListEntry;
+    struct _AFD_ACTIVE_POLL *Poll;
+    struct _AFD_FCB *FCB;
+} AFD_POLL_WAIT_BLOCK, *PAFD_POLL_WAIT_BLOCK;
+
 typedef struct _AFD_ACTIVE_POLL {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -121,6 +129,7 @@ typedef struct _AFD_ACTIVE_POLL {
     KTIMER Timer;
     PKEVENT EventObject;
     BOOLEAN Exclusive;
+    AFD_POLL_WAIT_BLOCK WaitBlocks[ANYSIZE_ARRAY];
 } AFD_ACTIVE_POLL, *PAFD_ACTIVE_POLL;
 
 typedef struct _IRP_LIST {
@@ -201,6 +210,7 @@ typedef struct _AFD_FCB {
     LIST_ENTRY PendingIrpList[MAX_FUNCTIONS];
     LIST_ENTRY DatagramList;
     LIST_ENTRY PendingConnections;
+    LIST_ENTRY PollWaitList; /* AFD_POLL_WAIT_BLOCKs, under DeviceExt->Lock */
 } AFD_FCB, *PAFD_FCB;
 
 /* bind.c */
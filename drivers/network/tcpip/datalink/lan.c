@@ -1006,6 +1006,10 @@ VOID LANTransmit(
 
     RtlCopyMemory(Data + Adapter->HeaderSize, OldData, OldSize);
 
+    /* Keep the checksums the adapter has to compute */
+    NDIS_PER_PACKET_INFO_FROM_PACKET(XmitPacket, TcpIpChecksumPacketInfo) =
+        NDIS_PER_PACKET_INFO_FROM_PACKET(NdisPacket, TcpIpChecksumPacketInfo);
+
     (*PC(NdisPacket)->DLComplete)(PC(NdisPacket)->Context, NdisPacket, NDIS_STATUS_SUCCESS);
 
     switch (Adapter->Media) {
@@ -1309,6 +1313,112 @@ VOID GetName( PUNICODE_STRING RegistryKey,
     AppendUnicodeString( OutName, &PartialRegistryKey, FALSE );
 }
 
+static
+VOID
+EnableChecksumOffload(
+    PLAN_ADAPTER Adapter,
+    PIP_INTERFACE Interface)
+/*
+ * FUNCTION: Enables the checksum offload capabilities of an adapter
+ * ARGUMENTS:
+ *     Adapter   = Pointer to LAN_ADAPTER structure
+ *     Interface = Pointer to the IP interface of the adapter
+ * NOTES:
+ *     Only the IPv4 header and UDP checksums are offloaded, the TCP
+ *     checksums are still computed by lwIP
+ */
+{
+    ULONG Buffer[64];
+    PNDIS_TASK_OFFLOAD_HEADER Header = (PNDIS_TASK_OFFLOAD_HEADER)Buffer;
+    PNDIS_TASK_OFFLOAD Task;
+    NDIS_TASK_TCP_IP_CHECKSUM Capabilities, Enabled;
+    NDIS_STATUS NdisStatus;
+    ULONG Offset, Offload;
+
+    if (Adapter->Media != NdisMedium802_3)
+        return;
+
+    RtlZeroMemory(Buffer, sizeof(Buffer));
+    Header->Version = NDIS_TASK_OFFLOAD_VERSION;
+    Header->Size = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+    Header->EncapsulationFormat.Encapsulation = IEEE_802_3_Encapsulation;
+    Header->EncapsulationFormat.Flags.FixedHeaderSize = 1;
+    Header->EncapsulationFormat.EncapsulationHeaderSize = Adapter->HeaderSize;
+
+    NdisStatus = NDISCall(Adapter,
+                          NdisRequestQueryInformation,
+                          OID_TCP_TASK_OFFLOAD,
+                          Buffer,
+                          sizeof(Buffer));
+    if (NdisStatus != NDIS_STATUS_SUCCESS || Header->OffsetFirstTask == 0)
+        return;
+
+    /* Look for the checksum task in the list returned by the miniport */
+    Offset = Header->OffsetFirstTask;
+    for (;;) {
+        if (Offset > sizeof(Buffer) - FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) - sizeof(Capabilities))
+            return;
+
+        Task = (PNDIS_TASK_OFFLOAD)((PUCHAR)Buffer + Offset);
+        if (Task->Task == TcpIpChecksumNdisTask &&
+            Task->TaskBufferLength >= sizeof(Capabilities))
+            break;
+
+        if (Task->OffsetNextTask == 0)
+            return;
+
+        Offset += Task->OffsetNextTask;
+    }
+
+    RtlCopyMemory(&Capabilities, Task->TaskBuffer, sizeof(Capabilities));
+
+    /* Only ask for what we are going to use */
+    RtlZeroMemory(&Enabled, sizeof(Enabled));
+    Enabled.V4Transmit.IpChecksum = Capabilities.V4Transmit.IpChecksum;
+    Enabled.V4Transmit.UdpChecksum = Capabilities.V4Transmit.UdpChecksum;
+    Enabled.V4Receive.IpChecksum = Capabilities.V4Receive.IpChecksum;
+    Enabled.V4Receive.UdpChecksum = Capabilities.V4Receive.UdpChecksum;
+
+    Offload = 0;
+    if (Enabled.V4Transmit.IpChecksum)
+        Offload |= IP_OFFLOAD_IP_TRANSMIT;
+    if (Enabled.V4Transmit.UdpChecksum)
+        Offload |= IP_OFFLOAD_UDP_TRANSMIT;
+    if (Enabled.V4Receive.IpChecksum)
+        Offload |= IP_OFFLOAD_IP_RECEIVE;
+    if (Enabled.V4Receive.UdpChecksum)
+        Offload |= IP_OFFLOAD_UDP_RECEIVE;
+
+    if (Offload == 0)
+        return;
+
+    /* Tell the miniport which task we want, it doesn't do anything before */
+    Header->OffsetFirstTask = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+    Task = (PNDIS_TASK_OFFLOAD)((PUCHAR)Buffer + Header->OffsetFirstTask);
+    Task->Version = NDIS_TASK_OFFLOAD_VERSION;
+    Task->Size = sizeof(NDIS_TASK_OFFLOAD);
+    Task->Task = TcpIpChecksumNdisTask;
+    Task->OffsetNextTask = 0;
+    Task->TaskBufferLength = sizeof(Enabled);
+    RtlCopyMemory(Task->TaskBuffer, &Enabled, sizeof(Enabled));
+
+    NdisStatus = NDISCall(Adapter,
+                          NdisRequestSetInformation,
+                          OID_TCP_TASK_OFFLOAD,
+                          Buffer,
+                          Header->OffsetFirstTask +
+                          FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) +
+                          sizeof(Enabled));
+    if (NdisStatus != NDIS_STATUS_SUCCESS) {
+        TI_DbgPrint(DEBUG_DATALINK, ("Could not enable checksum offload (0x%X).\n", NdisStatus));
+        return;
+    }
+
+    TI_DbgPrint(DEBUG_DATALINK, ("Checksum offload enabled (0x%X).\n", Offload));
+
+    Interface->ChecksumOffload = Offload;
+}
+
 BOOLEAN BindAdapter(
     PLAN_ADAPTER Adapter,
     PNDIS_STRING RegistryPath)
@@ -1410,6 +1520,9 @@ BOOLEAN BindAdapter(
     if (NdisStatus != NDIS_STATUS_SUCCESS)
         return FALSE;
 
+    /* Let the adapter compute the checksums it can */
+    EnableChecksumOffload(Adapter, IF);
+
     /* Register interface with IP layer */
     IPRegisterInterface(IF);
 
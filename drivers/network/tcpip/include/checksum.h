@@ -15,6 +15,17 @@ ULONG ChecksumCompute(
     UINT Count,
     ULONG Seed);
 
+ULONG ChecksumCopy(
+    PVOID Destination,
+    PVOID Source,
+    UINT Count,
+    ULONG Seed);
+
+ULONG ChecksumAddBlock(
+    ULONG Sum,
+    ULONG BlockSum,
+    UINT Offset);
+
 unsigned int
 csum_partial(
   const unsigned char * buff,
@@ -22,10 +33,10 @@ csum_partial(
   unsigned int sum);
 
 ULONG
-UDPv4ChecksumCalculate(
+IPv4PseudoHeaderChecksum(
   PIPv4_HEADER IPHeader,
-  PUCHAR PacketBuffer,
-  ULONG DataLength);
+  UCHAR Protocol,
+  USHORT Length);
 
 #define IPv4Checksum(Data, Count, Seed)(~ChecksumFold(ChecksumCompute(Data, Count, Seed)))
 #define TCPv4Checksum(Data, Count, Seed)(~ChecksumFold(csum_partial(Data, Count, Seed)))
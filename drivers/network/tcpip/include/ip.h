@@ -88,9 +88,14 @@ typedef struct _IP_PACKET {
     PNDIS_PACKET NdisPacket;            /* Pointer to NDIS packet */
     IP_ADDRESS SrcAddr;                 /* Source address */
     IP_ADDRESS DstAddr;                 /* Destination address */
+    ULONG DataChecksum;                 /* Checksum of the data (see IP_PACKET_FLAG_DATA_CHECKSUM) */
 } IP_PACKET, *PIP_PACKET;
 
-#define IP_PACKET_FLAG_RAW      0x01    /* Raw IP packet */
+#define IP_PACKET_FLAG_RAW              0x01    /* Raw IP packet */
+#define IP_PACKET_FLAG_DATA_CHECKSUM    0x02    /* DataChecksum holds the checksum of all the data */
+#define IP_PACKET_FLAG_CHECKSUM_VALID   0x04    /* The adapter verified the transport checksum */
+#define IP_PACKET_FLAG_CHECKSUM_INVALID 0x08    /* The adapter found a bad transport checksum */
+#define IP_PACKET_FLAG_UDP_OFFLOAD      0x10    /* The adapter has to compute the UDP checksum */
 
 
 /* Packet context */
@@ -168,8 +173,15 @@ typedef struct _IP_INTERFACE {
     LL_TRANSMIT_ROUTINE Transmit; /* Pointer to transmit function */
     PVOID TCPContext;             /* TCP Content for this interface */
     SEND_RECV_STATS Stats;        /* Send/Receive statistics */
+    ULONG ChecksumOffload;        /* Checksums computed by the adapter (IP_OFFLOAD_xx) */
 } IP_INTERFACE, *PIP_INTERFACE;
 
+/* Checksum offload capabilities of an interface */
+#define IP_OFFLOAD_IP_TRANSMIT  0x01    /* IPv4 header checksum on transmit */
+#define IP_OFFLOAD_IP_RECEIVE   0x02    /* IPv4 header checksum on receive */
+#define IP_OFFLOAD_UDP_TRANSMIT 0x04    /* UDP checksum on transmit */
+#define IP_OFFLOAD_UDP_RECEIVE  0x08    /* UDP checksum on receive */
+
 typedef struct _IP_SET_ADDRESS {
     ULONG NteIndex;
     IPv4_RAW_ADDRESS Address;
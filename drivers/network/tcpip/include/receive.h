@@ -20,6 +20,7 @@ typedef struct IP_FRAGMENT {
     UINT PacketOffset;    /* Offset into NDIS packet where data is */
     UINT Offset;          /* Offset into datagram where this fragment is */
     UINT Size;            /* Size of this fragment */
+    UCHAR Flags;          /* Checksum flags of the packet (IP_PACKET_FLAG_CHECKSUM_xx) */
 } IP_FRAGMENT, *PIP_FRAGMENT;
 
 /* IP datagram hole descriptor. Used to reassemble IP datagrams */
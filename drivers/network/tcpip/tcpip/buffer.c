@@ -10,6 +10,8 @@
 
 #include "precomp.h"
 
+#include <checksum.h>
+
 static inline
 INT SkipToOffset(
     PNDIS_BUFFER Buffer,
@@ -205,6 +207,82 @@ UINT CopyPacketToBuffer(
 }
 
 
+UINT CopyPacketToBufferChecksum(
+    PCHAR DstData,
+    PNDIS_PACKET SrcPacket,
+    UINT SrcOffset,
+    UINT Length,
+    PULONG Checksum)
+/*
+ * FUNCTION: Copies data from an NDIS packet to a buffer and calculates
+ *           the checksum of the copied data in the same pass
+ * ARGUMENTS:
+ *     DstData   = Pointer to destination buffer
+ *     SrcPacket = Pointer to source NDIS packet
+ *     SrcOffset = Source start offset
+ *     Length    = Number of bytes to copy
+ *     Checksum  = Address of buffer for the checksum of the copied data
+ * RETURNS:
+ *     Number of bytes copied to destination buffer
+ * NOTES:
+ *     The number of bytes copied may be limited by the source
+ *     buffer size
+ */
+{
+    PNDIS_BUFFER SrcBuffer;
+    PVOID Address;
+    PCHAR SrcData;
+    UINT SrcSize, TotalLength;
+    UINT BytesCopied, BytesToCopy;
+    ULONG Sum = 0;
+
+    TI_DbgPrint(DEBUG_PBUFFER, ("DstData (0x%X)  SrcPacket (0x%X)  SrcOffset (0x%X)  Length (%d)\n", DstData, SrcPacket, SrcOffset, Length));
+
+    *Checksum = 0;
+
+    NdisGetFirstBufferFromPacket(SrcPacket,
+                                 &SrcBuffer,
+                                 &Address,
+                                 &SrcSize,
+                                 &TotalLength);
+
+    /* Skip SrcOffset bytes in the source buffer chain */
+    if (SkipToOffset(SrcBuffer, SrcOffset, &SrcData, &SrcSize) == -1)
+        return 0;
+
+    /* Start copying the data */
+    BytesCopied = 0;
+    for (;;) {
+        BytesToCopy = MIN(SrcSize, Length);
+
+        Sum = ChecksumAddBlock(Sum,
+                               ChecksumCopy(DstData, SrcData, BytesToCopy, 0),
+                               BytesCopied);
+        BytesCopied += BytesToCopy;
+        DstData      = (PCHAR)((ULONG_PTR)DstData + BytesToCopy);
+
+        Length -= BytesToCopy;
+        if (Length == 0)
+            break;
+
+        SrcSize -= BytesToCopy;
+        if (SrcSize == 0) {
+            /* No more bytes in source buffer. Proceed to
+               the next buffer in the source buffer chain */
+            NdisGetNextBuffer(SrcBuffer, &SrcBuffer);
+            if (!SrcBuffer)
+                break;
+
+            NdisQueryBuffer(SrcBuffer, (PVOID)&SrcData, &SrcSize);
+        }
+    }
+
+    *Checksum = Sum;
+
+    return BytesCopied;
+}
+
+
 UINT CopyPacketToBufferChain(
     PNDIS_BUFFER DstBuffer,
     UINT DstOffset,
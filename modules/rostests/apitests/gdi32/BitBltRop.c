@@ -0,0 +1,189 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Pixel and throughput test for every ROP3 code on DIB sections
+ */
+
+#include "precomp.h"
+
+#define ROP_WIDTH  256
+#define ROP_HEIGHT 64
+#define ROP_COLOR  RGB(0x12, 0x34, 0x56)
+
+static const WORD RopDepths[] = { 1, 4, 8, 16, 24, 32 };
+
+static ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed >> 16;
+}
+
+static HBITMAP
+CreateDib(HDC hdc, WORD BitCount, PVOID *Bits)
+{
+    struct
+    {
+        BITMAPINFOHEADER bmiHeader;
+        RGBQUAD bmiColors[256];
+    } bmi;
+    ULONG i, Colors;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = ROP_WIDTH;
+    bmi.bmiHeader.biHeight = -ROP_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = BitCount;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    /* Gray ramp for the palettized formats */
+    if (BitCount <= 8)
+    {
+        Colors = 1 << BitCount;
+        for (i = 0; i < Colors; i++)
+        {
+            bmi.bmiColors[i].rgbRed =
+            bmi.bmiColors[i].rgbGreen =
+            bmi.bmiColors[i].rgbBlue = (BYTE)(i * 255 / (Colors - 1));
+        }
+    }
+
+    return CreateDIBSection(hdc, (BITMAPINFO *)&bmi, DIB_RGB_COLORS, Bits, NULL, 0);
+}
+
+/* Apply a ROP3 to each bit of the operands */
+static ULONG
+ReferenceRop(ULONG Rop, ULONG Dst, ULONG Src, ULONG Pat)
+{
+    ULONG Result = 0, Bit, Index;
+
+    for (Bit = 0; Bit < 32; Bit++)
+    {
+        Index = (((Pat >> Bit) & 1) << 2) | (((Src >> Bit) & 1) << 1) | ((Dst >> Bit) & 1);
+        Result |= ((Rop >> Index) & 1) << Bit;
+    }
+
+    return Result;
+}
+
+static void
+TestRopPixels(HDC hdcDst, PULONG DstBits, HDC hdcSrc, PULONG SrcBits)
+{
+    static ULONG Original[ROP_WIDTH * ROP_HEIGHT];
+    ULONG Seed = 0x0BADCAFE, Rop, i, Expected, Mismatches;
+    ULONG Pattern = (GetRValue(ROP_COLOR) << 16) | (GetGValue(ROP_COLOR) << 8) | GetBValue(ROP_COLOR);
+
+    for (Rop = 0; Rop < 256; Rop++)
+    {
+        for (i = 0; i < ROP_WIDTH * ROP_HEIGHT; i++)
+        {
+            SrcBits[i] = (NextRandom(&Seed) | (NextRandom(&Seed) << 16)) & 0xFFFFFF;
+            DstBits[i] = Original[i] = (NextRandom(&Seed) | (NextRandom(&Seed) << 16)) & 0xFFFFFF;
+        }
+
+        GdiFlush();
+        ok(BitBlt(hdcDst, 0, 0, ROP_WIDTH, ROP_HEIGHT, hdcSrc, 0, 0, Rop << 16),
+           "BitBlt failed for rop 0x%02lx\n", Rop);
+        GdiFlush();
+
+        Mismatches = 0;
+        for (i = 0; i < ROP_WIDTH * ROP_HEIGHT; i++)
+        {
+            Expected = ReferenceRop(Rop, Original[i], SrcBits[i], Pattern) & 0xFFFFFF;
+            if ((DstBits[i] & 0xFFFFFF) != Expected && !Mismatches++)
+            {
+                ok(0, "Rop 0x%02lx: pixel %lu is 0x%06lx, expected 0x%06lx\n",
+                   Rop, i, DstBits[i] & 0xFFFFFF, Expected);
+            }
+        }
+        ok(Mismatches == 0, "Rop 0x%02lx: %lu pixels differ\n", Rop, Mismatches);
+    }
+}
+
+static void
+BenchmarkRops(HDC hdcDst, HDC hdcSrc, WORD BitCount)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Rop, i, Iterations = 20;
+    double Seconds, Total = 0.0, Slowest = 0.0;
+    ULONG SlowestRop = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+    for (Rop = 0; Rop < 256; Rop++)
+    {
+        QueryPerformanceCounter(&Start);
+        for (i = 0; i < Iterations; i++)
+        {
+            BitBlt(hdcDst, 0, 0, ROP_WIDTH, ROP_HEIGHT, hdcSrc, 0, 0, Rop << 16);
+        }
+        GdiFlush();
+        QueryPerformanceCounter(&End);
+
+        Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+        trace("%ubpp rop 0x%02lx: %.1f Mpixels/s\n", BitCount, Rop,
+              Seconds ? (double)ROP_WIDTH * ROP_HEIGHT * Iterations / Seconds / 1e6 : 0.0);
+
+        Total += Seconds;
+        if (Seconds > Slowest)
+        {
+            Slowest = Seconds;
+            SlowestRop = Rop;
+        }
+    }
+
+    trace("%ubpp: all rops %.1f ms, slowest rop 0x%02lx %.1f ms\n",
+          BitCount, Total * 1000.0, SlowestRop, Slowest * 1000.0);
+}
+
+START_TEST(BitBltRop)
+{
+    HDC hdcDst, hdcSrc;
+    HBITMAP hbmDst, hbmSrc, hbmOldDst, hbmOldSrc;
+    HBRUSH hbr;
+    PVOID DstBits, SrcBits;
+    ULONG Index;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hdcSrc = CreateCompatibleDC(NULL);
+    hbr = CreateSolidBrush(ROP_COLOR);
+    ok(hdcDst != NULL && hdcSrc != NULL, "CreateCompatibleDC failed\n");
+    ok(hbr != NULL, "CreateSolidBrush failed\n");
+    if (!hdcDst || !hdcSrc || !hbr)
+    {
+        skip("No DCs or brush\n");
+        return;
+    }
+
+    SelectObject(hdcDst, hbr);
+
+    for (Index = 0; Index < sizeof(RopDepths) / sizeof(RopDepths[0]); Index++)
+    {
+        hbmDst = CreateDib(hdcDst, RopDepths[Index], &DstBits);
+        hbmSrc = CreateDib(hdcSrc, RopDepths[Index], &SrcBits);
+        ok(hbmDst != NULL && hbmSrc != NULL, "CreateDIBSection failed for %ubpp\n", RopDepths[Index]);
+        if (!hbmDst || !hbmSrc)
+        {
+            DeleteObject(hbmDst);
+            DeleteObject(hbmSrc);
+            continue;
+        }
+
+        hbmOldDst = SelectObject(hdcDst, hbmDst);
+        hbmOldSrc = SelectObject(hdcSrc, hbmSrc);
+
+        if (RopDepths[Index] == 32)
+            TestRopPixels(hdcDst, DstBits, hdcSrc, SrcBits);
+
+        BenchmarkRops(hdcDst, hdcSrc, RopDepths[Index]);
+
+        SelectObject(hdcDst, hbmOldDst);
+        SelectObject(hdcSrc, hbmOldSrc);
+        DeleteObject(hbmDst);
+        DeleteObject(hbmSrc);
+    }
+
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+    DeleteObject(hbr);
+}
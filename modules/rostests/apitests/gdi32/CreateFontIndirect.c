@@ -762,6 +762,275 @@ Test_FontSelection(void)
 }
 
 
+/* Realizing the same LOGFONT again must give the same font */
+static void
+Test_FontSelectionRepeat(void)
+{
+    static const struct
+    {
+        const WCHAR *FaceName;
+        LONG Weight;
+        BYTE PitchAndFamily;
+        BYTE CharSet;
+    } Requests[] =
+    {
+        { L"Tahoma", FW_NORMAL, DEFAULT_PITCH, DEFAULT_CHARSET },
+        { L"Tahoma", FW_BOLD, DEFAULT_PITCH, ANSI_CHARSET },
+        { L"Courier New", FW_NORMAL, FIXED_PITCH | FF_MODERN, DEFAULT_CHARSET },
+        { L"MS Sans Serif", FW_NORMAL, DEFAULT_PITCH, ANSI_CHARSET },
+        { L"This font does not exist", FW_NORMAL, VARIABLE_PITCH | FF_SWISS, DEFAULT_CHARSET },
+        { L"", FW_DONTCARE, FIXED_PITCH, DEFAULT_CHARSET },
+    };
+    LARGE_INTEGER Frequency, Start, End;
+    WCHAR szFace[2][LF_FACESIZE];
+    TEXTMETRICW tm[2];
+    LOGFONTW lf;
+    HFONT hFont;
+    HGDIOBJ hFontOld;
+    HDC hDC;
+    UINT i, j, Round;
+
+    hDC = CreateCompatibleDC(NULL);
+
+    for (i = 0; i < _countof(Requests); i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            ZeroMemory(&lf, sizeof(lf));
+            lstrcpynW(lf.lfFaceName, Requests[i].FaceName, _countof(lf.lfFaceName));
+            lf.lfHeight = -12;
+            lf.lfWeight = Requests[i].Weight;
+            lf.lfPitchAndFamily = Requests[i].PitchAndFamily;
+            lf.lfCharSet = Requests[i].CharSet;
+
+            hFont = CreateFontIndirectW(&lf);
+            ok(hFont != NULL, "Request #%u: CreateFontIndirectW failed\n", i);
+            hFontOld = SelectObject(hDC, hFont);
+            szFace[j][0] = UNICODE_NULL;
+            GetTextFaceW(hDC, _countof(szFace[j]), szFace[j]);
+            ok(GetTextMetricsW(hDC, &tm[j]), "Request #%u: GetTextMetricsW failed\n", i);
+            SelectObject(hDC, hFontOld);
+            DeleteObject(hFont);
+        }
+
+        ok(lstrcmpW(szFace[0], szFace[1]) == 0,
+           "Request #%u: '%S' then '%S'\n", i, szFace[0], szFace[1]);
+        ok(tm[0].tmHeight == tm[1].tmHeight && tm[0].tmCharSet == tm[1].tmCharSet &&
+           tm[0].tmPitchAndFamily == tm[1].tmPitchAndFamily,
+           "Request #%u: metrics differ\n", i);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (Round = 0; Round < 200; Round++)
+    {
+        for (i = 0; i < _countof(Requests); i++)
+        {
+            ZeroMemory(&lf, sizeof(lf));
+            lstrcpynW(lf.lfFaceName, Requests[i].FaceName, _countof(lf.lfFaceName));
+            lf.lfHeight = -12;
+            lf.lfWeight = Requests[i].Weight;
+            lf.lfPitchAndFamily = Requests[i].PitchAndFamily;
+            lf.lfCharSet = Requests[i].CharSet;
+
+            hFont = CreateFontIndirectW(&lf);
+            hFontOld = SelectObject(hDC, hFont);
+            GetTextMetricsW(hDC, &tm[0]);
+            SelectObject(hDC, hFontOld);
+            DeleteObject(hFont);
+        }
+    }
+    QueryPerformanceCounter(&End);
+    trace("%.1f us per font realization\n",
+          (double)(End.QuadPart - Start.QuadPart) * 1e6 / Frequency.QuadPart /
+          (200 * _countof(Requests)));
+
+    DeleteDC(hDC);
+}
+
+static BOOL
+RealizeFontFace(HDC hDC, const LOGFONTW *plf, LPWSTR pszFace, TEXTMETRICW *ptm)
+{
+    HFONT hFont;
+    HGDIOBJ hFontOld;
+    BOOL Ret;
+
+    hFont = CreateFontIndirectW(plf);
+    if (!hFont)
+        return FALSE;
+
+    hFontOld = SelectObject(hDC, hFont);
+    pszFace[0] = UNICODE_NULL;
+    GetTextFaceW(hDC, LF_FACESIZE, pszFace);
+    Ret = GetTextMetricsW(hDC, ptm);
+    SelectObject(hDC, hFontOld);
+    DeleteObject(hFont);
+    return Ret;
+}
+
+/* Requests whose answer is known, each one realized twice so that the cached match is checked too */
+static void
+Test_FontSelectionExpected(void)
+{
+    static const struct
+    {
+        const WCHAR *FaceName;
+        BYTE PitchAndFamily;
+        BYTE CharSet;
+        const WCHAR *ExpectedFace;      /* NULL if any face will do */
+        const WCHAR *UnexpectedFace;    /* NULL if any face will do */
+        BYTE ExpectedFamily;            /* FF_DONTCARE if any family will do */
+        TRISTATE ExpectedFixedPitch;
+        BYTE ExpectedCharSet;           /* DEFAULT_CHARSET if any charset will do */
+    } Requests[] =
+    {
+        /* Face name only */
+        { L"Times New Roman", DEFAULT_PITCH, DEFAULT_CHARSET, L"Times New Roman", NULL, FF_ROMAN, TS_FALSE, DEFAULT_CHARSET },
+        { L"Tahoma", DEFAULT_PITCH, DEFAULT_CHARSET, L"Tahoma", NULL, FF_SWISS, TS_FALSE, DEFAULT_CHARSET },
+        { L"courier new", DEFAULT_PITCH, DEFAULT_CHARSET, L"Courier New", NULL, FF_MODERN, TS_TRUE, DEFAULT_CHARSET },
+        { L"Marlett", DEFAULT_PITCH, SYMBOL_CHARSET, L"Marlett", NULL, FF_DONTCARE, TS_UNKNOWN, SYMBOL_CHARSET },
+        /* Family only */
+        { L"", VARIABLE_PITCH | FF_ROMAN, DEFAULT_CHARSET, NULL, NULL, FF_ROMAN, TS_FALSE, DEFAULT_CHARSET },
+        { L"", VARIABLE_PITCH | FF_SWISS, DEFAULT_CHARSET, NULL, NULL, FF_SWISS, TS_FALSE, DEFAULT_CHARSET },
+        { L"", FIXED_PITCH | FF_MODERN, DEFAULT_CHARSET, NULL, NULL, FF_MODERN, TS_TRUE, DEFAULT_CHARSET },
+        /* Charset only, and a charset that beats the face name */
+        { L"", DEFAULT_PITCH, SYMBOL_CHARSET, NULL, NULL, FF_DONTCARE, TS_UNKNOWN, SYMBOL_CHARSET },
+        { L"Tahoma", DEFAULT_PITCH, SYMBOL_CHARSET, NULL, L"Tahoma", FF_DONTCARE, TS_UNKNOWN, SYMBOL_CHARSET },
+        /* Mismatched pitch: a fixed pitch beats the face name, a variable pitch does not */
+        { L"Arial", FIXED_PITCH, DEFAULT_CHARSET, NULL, L"Arial", FF_DONTCARE, TS_TRUE, DEFAULT_CHARSET },
+        { L"Courier New", VARIABLE_PITCH, DEFAULT_CHARSET, L"Courier New", NULL, FF_MODERN, TS_TRUE, DEFAULT_CHARSET },
+    };
+    WCHAR szFace[LF_FACESIZE];
+    TEXTMETRICW tm;
+    LOGFONTW lf;
+    HDC hDC;
+    UINT i, j;
+
+    hDC = CreateCompatibleDC(NULL);
+
+    for (i = 0; i < _countof(Requests); i++)
+    {
+        if (!is_charset_font_installed(hDC, Requests[i].CharSet))
+        {
+            skip("Request #%u: charset not available: 0x%x\n", i, Requests[i].CharSet);
+            continue;
+        }
+
+        for (j = 0; j < 2; j++)
+        {
+            ZeroMemory(&lf, sizeof(lf));
+            lstrcpynW(lf.lfFaceName, Requests[i].FaceName, _countof(lf.lfFaceName));
+            lf.lfHeight = -12;
+            lf.lfPitchAndFamily = Requests[i].PitchAndFamily;
+            lf.lfCharSet = Requests[i].CharSet;
+
+            ok(RealizeFontFace(hDC, &lf, szFace, &tm), "Request #%u.%u: realization failed\n", i, j);
+
+            if (Requests[i].ExpectedFace)
+                ok(lstrcmpiW(szFace, Requests[i].ExpectedFace) == 0,
+                   "Request #%u.%u: got '%S', expected '%S'\n", i, j, szFace, Requests[i].ExpectedFace);
+            if (Requests[i].UnexpectedFace)
+                ok(lstrcmpiW(szFace, Requests[i].UnexpectedFace) != 0,
+                   "Request #%u.%u: got '%S'\n", i, j, szFace);
+            if (Requests[i].ExpectedFamily != FF_DONTCARE)
+                ok((tm.tmPitchAndFamily & 0xF0) == Requests[i].ExpectedFamily,
+                   "Request #%u.%u: '%S' has family 0x%x\n", i, j, szFace, tm.tmPitchAndFamily & 0xF0);
+            if (Requests[i].ExpectedFixedPitch == TS_TRUE)
+                ok(!(tm.tmPitchAndFamily & _TMPF_VAR_PITCH), "Request #%u.%u: '%S' is not fixed-pitch\n", i, j, szFace);
+            else if (Requests[i].ExpectedFixedPitch == TS_FALSE)
+                ok((tm.tmPitchAndFamily & _TMPF_VAR_PITCH), "Request #%u.%u: '%S' is fixed-pitch\n", i, j, szFace);
+            if (Requests[i].ExpectedCharSet != DEFAULT_CHARSET)
+                ok(tm.tmCharSet == Requests[i].ExpectedCharSet,
+                   "Request #%u.%u: '%S' has charset %u\n", i, j, szFace, tm.tmCharSet);
+        }
+    }
+
+    DeleteDC(hDC);
+}
+
+/*
+ * A font added after a request was realized must replace the previous answer.
+ * NOTE: RemoveFontResourceExW is not implemented for global fonts (see the
+ * FIXME in win32k's freetype.c), so the added font stays loaded, and its file
+ * stays in the temporary directory, until reboot. Later runs in the same boot
+ * find it installed already and skip this test.
+ */
+static void
+Test_FontSelectionAfterAdd(void)
+{
+    WCHAR szTempPath[MAX_PATH], szPath[MAX_PATH], szFace[LF_FACESIZE];
+    const WCHAR *pszFamily;
+    TEXTMETRICW tm;
+    LOGFONTW lf;
+    HMODULE hMod;
+    HRSRC hRsrc;
+    LPVOID pFont;
+    HANDLE hFile;
+    DWORD Size;
+    HDC hDC;
+
+    if (PRIMARYLANGID(GetSystemDefaultLangID()) == LANG_JAPANESE)
+        pszFamily = L"JapaneseFamilyName";
+    else
+        pszFamily = L"EnglishFamilyName";
+
+    hDC = CreateCompatibleDC(NULL);
+
+    ZeroMemory(&lf, sizeof(lf));
+    lstrcpynW(lf.lfFaceName, pszFamily, _countof(lf.lfFaceName));
+    lf.lfHeight = -12;
+    lf.lfCharSet = DEFAULT_CHARSET;
+
+    /* Not there yet: this realization gets remembered with another face */
+    ok(RealizeFontFace(hDC, &lf, szFace, &tm), "Realization failed\n");
+    if (lstrcmpiW(szFace, pszFamily) == 0)
+    {
+        skip("'%S' is already installed\n", pszFamily);
+        DeleteDC(hDC);
+        return;
+    }
+
+    hMod = GetModuleHandleW(NULL);
+    hRsrc = FindResourceW(hMod, L"ExampleFont.ttf", (LPCWSTR)RT_RCDATA);
+    pFont = LockResource(LoadResource(hMod, hRsrc));
+    Size = SizeofResource(hMod, hRsrc);
+    if (!pFont || !Size)
+    {
+        skip("ExampleFont.ttf resource not found\n");
+        DeleteDC(hDC);
+        return;
+    }
+
+    GetTempPathW(_countof(szTempPath), szTempPath);
+    GetTempFileNameW(szTempPath, L"FNT", 0, szPath);
+    hFile = CreateFileW(szPath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        skip("Could not create '%S'\n", szPath);
+        DeleteDC(hDC);
+        return;
+    }
+    WriteFile(hFile, pFont, Size, &Size, NULL);
+    CloseHandle(hFile);
+
+    if (AddFontResourceExW(szPath, 0, NULL) == 0)
+    {
+        skip("'%S' was not installed\n", szPath);
+    }
+    else
+    {
+        ok(RealizeFontFace(hDC, &lf, szFace, &tm), "Realization failed\n");
+        ok(lstrcmpiW(szFace, pszFamily) == 0, "Got '%S' instead of the added '%S'\n", szFace, pszFamily);
+
+        /* Best effort, see above */
+        RemoveFontResourceExW(szPath, 0, NULL);
+    }
+
+    DeleteDC(hDC);
+    DeleteFileW(szPath);
+}
+
 START_TEST(CreateFontIndirect)
 {
     Test_CreateFontIndirectA();
@@ -770,5 +1039,8 @@ START_TEST(CreateFontIndirect)
     Test_CreateFontIndirectExW();
     Test_FontPresence();
     Test_FontSelection();
+    Test_FontSelectionRepeat();
+    Test_FontSelectionExpected();
+    Test_FontSelectionAfterAdd();
 }
 
@@ -0,0 +1,156 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and text layout benchmark for ExtTextOut
+ */
+
+#include "precomp.h"
+
+#define PAGE_WIDTH      1024
+#define PAGE_HEIGHT     1024
+#define PAGE_COLUMNS    100
+#define PAGE_LINES      100
+#define PAGE_ROUNDS     5
+
+static HDC
+CreatePageDC(PVOID *ppvBits)
+{
+    BITMAPINFO bmi;
+    HBITMAP hbm;
+    HDC hdc;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = PAGE_WIDTH;
+    bmi.bmiHeader.biHeight = -PAGE_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC(NULL);
+    if (!hdc)
+        return NULL;
+
+    hbm = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+    if (!hbm)
+    {
+        DeleteDC(hdc);
+        return NULL;
+    }
+
+    SelectObject(hdc, hbm);
+    return hdc;
+}
+
+static VOID
+DeletePageDC(HDC hdc)
+{
+    HBITMAP hbm = GetCurrentObject(hdc, OBJ_BITMAP);
+
+    DeleteDC(hdc);
+    DeleteObject(hbm);
+}
+
+/* Fills the page with PAGE_LINES lines of PAGE_COLUMNS glyphs */
+static BOOL
+DrawPage(HDC hdc, INT LineHeight)
+{
+    WCHAR szLine[PAGE_COLUMNS];
+    RECT rc = { 0, 0, PAGE_WIDTH, PAGE_HEIGHT };
+    INT i, j;
+
+    ExtTextOutW(hdc, 0, 0, ETO_OPAQUE, &rc, NULL, 0, NULL);
+
+    for (i = 0; i < PAGE_LINES; i++)
+    {
+        for (j = 0; j < PAGE_COLUMNS; j++)
+            szLine[j] = L'!' + (i * 7 + j) % 94;
+
+        if (!ExtTextOutW(hdc, 0, (i * LineHeight) % PAGE_HEIGHT, 0, NULL,
+                         szLine, PAGE_COLUMNS, NULL))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID
+BenchmarkPage(PCWSTR FaceName, INT Height, BOOL Antialiased)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    TEXTMETRICW tm;
+    LOGFONTW lf;
+    HFONT hFont, hFontOld;
+    PVOID pvBits, pvFirst;
+    HDC hdc;
+    INT i;
+    BOOL Ret, Same = TRUE;
+    double Seconds;
+
+    hdc = CreatePageDC(&pvBits);
+    ok(hdc != NULL, "Could not create the page\n");
+    if (!hdc)
+        return;
+
+    ZeroMemory(&lf, sizeof(lf));
+    lf.lfHeight = -Height;
+    lf.lfCharSet = DEFAULT_CHARSET;
+    lf.lfQuality = Antialiased ? ANTIALIASED_QUALITY : NONANTIALIASED_QUALITY;
+    StringCchCopyW(lf.lfFaceName, _countof(lf.lfFaceName), FaceName);
+    hFont = CreateFontIndirectW(&lf);
+    ok(hFont != NULL, "CreateFontIndirectW failed\n");
+    if (!hFont)
+    {
+        DeletePageDC(hdc);
+        return;
+    }
+
+    hFontOld = SelectObject(hdc, hFont);
+    GetTextMetricsW(hdc, &tm);
+
+    /* The first page fills the glyph cache, it must look like the next ones */
+    Ret = DrawPage(hdc, tm.tmHeight);
+    ok(Ret, "DrawPage failed\n");
+    pvFirst = HeapAlloc(GetProcessHeap(), 0, PAGE_WIDTH * PAGE_HEIGHT * 4);
+    if (pvFirst)
+    {
+        GdiFlush();
+        CopyMemory(pvFirst, pvBits, PAGE_WIDTH * PAGE_HEIGHT * 4);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < PAGE_ROUNDS && Ret; i++)
+    {
+        Ret = DrawPage(hdc, tm.tmHeight);
+        GdiFlush();
+        if (pvFirst && memcmp(pvFirst, pvBits, PAGE_WIDTH * PAGE_HEIGHT * 4) != 0)
+            Same = FALSE;
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(Ret, "DrawPage failed\n");
+    ok(Same, "%S %d: cached glyphs render differently\n", FaceName, Height);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("%S %d%s: %.2f ms/page, %.0f glyphs/s\n",
+          FaceName, Height, Antialiased ? " antialiased" : "",
+          Seconds * 1000 / PAGE_ROUNDS,
+          Seconds ? (double)PAGE_ROUNDS * PAGE_LINES * PAGE_COLUMNS / Seconds : 0.0);
+
+    if (pvFirst)
+        HeapFree(GetProcessHeap(), 0, pvFirst);
+    SelectObject(hdc, hFontOld);
+    DeleteObject(hFont);
+    DeletePageDC(hdc);
+}
+
+START_TEST(ExtTextOut)
+{
+    BenchmarkPage(L"Tahoma", 12, FALSE);
+    BenchmarkPage(L"Tahoma", 12, TRUE);
+    BenchmarkPage(L"Tahoma", 32, TRUE);
+    BenchmarkPage(L"Courier New", 16, TRUE);
+}
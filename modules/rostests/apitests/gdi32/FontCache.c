@@ -0,0 +1,154 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test for the registry fonts added from the font metadata cache
+ */
+
+#include "precomp.h"
+
+#define MAX_FAMILIES    256
+
+typedef struct _ENUM_FAMILY
+{
+    LOGFONTW lf;
+    BYTE PitchAndFamily;
+} ENUM_FAMILY, *PENUM_FAMILY;
+
+static ENUM_FAMILY Families[MAX_FAMILIES];
+static UINT FamilyCount;
+
+/*
+ * Selects the font and goes through the text functions that need its face.
+ * On ReactOS, a registry font found unchanged in FNTCACHE.DAT is only opened
+ * when it is first used, so this is where its face is opened.
+ * Returns FALSE if another font was selected.
+ */
+static BOOL
+TestRealizedFont(HDC hDC, const LOGFONTW *plf, BOOL MustExist, BYTE PitchAndFamily)
+{
+    static const MAT2 Identity = { {0, 1}, {0, 0}, {0, 0}, {0, 1} };
+    WCHAR szFace[LF_FACESIZE];
+    TEXTMETRICW tm;
+    GLYPHMETRICS gm;
+    SIZE Size;
+    WORD Glyph;
+    INT Width;
+    ABC abc;
+    HFONT hFont;
+    HGDIOBJ hFontOld;
+
+    hFont = CreateFontIndirectW(plf);
+    ok(hFont != NULL, "%S: CreateFontIndirectW failed\n", plf->lfFaceName);
+    if (!hFont)
+        return FALSE;
+
+    hFontOld = SelectObject(hDC, hFont);
+
+    szFace[0] = UNICODE_NULL;
+    GetTextFaceW(hDC, _countof(szFace), szFace);
+    if (_wcsicmp(szFace, plf->lfFaceName) != 0)
+    {
+        ok(!MustExist, "%S: got %S\n", plf->lfFaceName, szFace);
+        SelectObject(hDC, hFontOld);
+        DeleteObject(hFont);
+        return FALSE;
+    }
+
+    ok(GetTextMetricsW(hDC, &tm), "%S: GetTextMetricsW failed\n", szFace);
+    if (plf->lfCharSet != DEFAULT_CHARSET)
+    {
+        ok(tm.tmCharSet == plf->lfCharSet, "%S: charset %u instead of %u\n",
+           szFace, tm.tmCharSet, plf->lfCharSet);
+    }
+    if (PitchAndFamily)
+    {
+        ok(tm.tmPitchAndFamily == PitchAndFamily, "%S: pitch and family 0x%02x instead of 0x%02x\n",
+           szFace, tm.tmPitchAndFamily, PitchAndFamily);
+    }
+
+    ok(GetTextExtentPoint32W(hDC, L"ReactOS", 7, &Size) && Size.cx > 0,
+       "%S: GetTextExtentPoint32W failed\n", szFace);
+    ok(GetGlyphIndicesW(hDC, L"A", 1, &Glyph, 0) == 1, "%S: GetGlyphIndicesW failed\n", szFace);
+    ok(GetCharWidth32W(hDC, L'A', L'A', &Width), "%S: GetCharWidth32W failed\n", szFace);
+    ok(GetFontUnicodeRanges(hDC, NULL) != 0, "%S: GetFontUnicodeRanges failed\n", szFace);
+    ok(ExtTextOutW(hDC, 0, 0, 0, NULL, L"ReactOS", 7, NULL), "%S: ExtTextOutW failed\n", szFace);
+    GetKerningPairsW(hDC, 0, NULL);
+    GetTextCharsetInfo(hDC, NULL, 0);
+
+    if (tm.tmPitchAndFamily & TMPF_TRUETYPE)
+    {
+        ok(GetCharABCWidthsW(hDC, L'A', L'A', &abc), "%S: GetCharABCWidthsW failed\n", szFace);
+        ok(GetFontData(hDC, 0, 0, NULL, 0) != GDI_ERROR, "%S: GetFontData failed\n", szFace);
+        ok(GetGlyphOutlineW(hDC, L'A', GGO_METRICS, &gm, 0, NULL, &Identity) != GDI_ERROR,
+           "%S: GetGlyphOutlineW failed\n", szFace);
+    }
+
+    SelectObject(hDC, hFontOld);
+    DeleteObject(hFont);
+    return TRUE;
+}
+
+static int CALLBACK
+EnumFamilyProc(const LOGFONTW *elf, const TEXTMETRICW *ntm, DWORD FontType, LPARAM lParam)
+{
+    PENUM_FAMILY Family;
+
+    /* The vertical fonts realize as their horizontal face */
+    if (elf->lfFaceName[0] == L'@')
+        return 1;
+
+    if (FamilyCount >= MAX_FAMILIES)
+        return 0;
+
+    Family = &Families[FamilyCount++];
+    Family->lf = *elf;
+    Family->PitchAndFamily = ntm->tmPitchAndFamily;
+    return 1;
+}
+
+START_TEST(FontCache)
+{
+    static const PCWSTR FaceNames[] =
+    {
+        L"Tahoma", L"Marlett", L"Symbol", L"Courier New", L"Times New Roman", L"Arial",
+    };
+    WCHAR szPath[MAX_PATH];
+    LOGFONTW lf;
+    HDC hDC;
+    UINT i, Found;
+
+    GetSystemDirectoryW(szPath, _countof(szPath));
+    StringCchCatW(szPath, _countof(szPath), L"\\FNTCACHE.DAT");
+    if (GetFileAttributesW(szPath) == INVALID_FILE_ATTRIBUTES)
+        trace("No font cache, the registry fonts were read from their files\n");
+
+    hDC = CreateCompatibleDC(NULL);
+    ok(hDC != NULL, "CreateCompatibleDC failed\n");
+    if (!hDC)
+        return;
+
+    /* First realize some fonts by name, before the enumeration opens every font */
+    Found = 0;
+    for (i = 0; i < _countof(FaceNames); i++)
+    {
+        ZeroMemory(&lf, sizeof(lf));
+        StringCchCopyW(lf.lfFaceName, _countof(lf.lfFaceName), FaceNames[i]);
+        lf.lfHeight = -13;
+        lf.lfCharSet = DEFAULT_CHARSET;
+        if (TestRealizedFont(hDC, &lf, FALSE, 0))
+            Found++;
+    }
+    ok(Found != 0, "None of the usual fonts is installed\n");
+
+    /* Then every family must realize as itself, with the enumerated metrics */
+    FamilyCount = 0;
+    ZeroMemory(&lf, sizeof(lf));
+    lf.lfCharSet = DEFAULT_CHARSET;
+    EnumFontFamiliesExW(hDC, &lf, EnumFamilyProc, 0, 0);
+    ok(FamilyCount != 0, "No font was enumerated\n");
+
+    for (i = 0; i < FamilyCount; i++)
+        TestRealizedFont(hDC, &Families[i].lf, TRUE, Families[i].PitchAndFamily);
+
+    DeleteDC(hDC);
+}
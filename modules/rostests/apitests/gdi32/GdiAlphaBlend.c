@@ -0,0 +1,154 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Pixel and throughput test for GdiAlphaBlend on 32bpp DIB sections
+ */
+
+#include "precomp.h"
+
+#define BLEND_WIDTH  256
+#define BLEND_HEIGHT 256
+
+static ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed >> 16;
+}
+
+static HBITMAP
+CreateDib32(HDC hdc, PULONG *Bits)
+{
+    BITMAPINFO bmi = { { sizeof(BITMAPINFOHEADER), BLEND_WIDTH, -BLEND_HEIGHT, 1, 32, BI_RGB } };
+
+    return CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (PVOID *)Bits, NULL, 0);
+}
+
+/* Straightforward per-channel reference of the AC_SRC_OVER blend */
+static ULONG
+ReferenceBlend(ULONG Dst, ULONG Src, BLENDFUNCTION Blend)
+{
+    ULONG Result = 0, Channel, SrcChannel, DstChannel, Alpha;
+
+    Alpha = (Blend.AlphaFormat & AC_SRC_ALPHA) ?
+            ((Src >> 24) * Blend.SourceConstantAlpha) / 255 :
+            Blend.SourceConstantAlpha;
+
+    for (Channel = 0; Channel < 32; Channel += 8)
+    {
+        SrcChannel = (((Src >> Channel) & 0xFF) * Blend.SourceConstantAlpha) / 255;
+        DstChannel = (((Dst >> Channel) & 0xFF) * (255 - Alpha)) / 255 + SrcChannel;
+        Result |= min(DstChannel, 255) << Channel;
+    }
+
+    return Result;
+}
+
+static BOOL
+ChannelsMatch(ULONG Value, ULONG Expected)
+{
+    ULONG Channel;
+    LONG Difference;
+
+    /* Windows rounds differently, allow an off-by-one per color channel */
+    for (Channel = 0; Channel < 24; Channel += 8)
+    {
+        Difference = (LONG)((Value >> Channel) & 0xFF) - (LONG)((Expected >> Channel) & 0xFF);
+        if (Difference > 1 || Difference < -1)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+TestBlend(HDC hdcDst, PULONG DstBits, HDC hdcSrc, PULONG SrcBits, BYTE ConstAlpha, BYTE AlphaFormat)
+{
+    static ULONG Original[BLEND_WIDTH * BLEND_HEIGHT];
+    BLENDFUNCTION Blend = { AC_SRC_OVER, 0, ConstAlpha, AlphaFormat };
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Seed = 0x600DF00D, i, Mismatches = 0, Alpha, Iterations;
+    double Seconds;
+
+    for (i = 0; i < BLEND_WIDTH * BLEND_HEIGHT; i++)
+    {
+        /* Premultiplied source, with plenty of fully transparent and opaque pixels */
+        Alpha = NextRandom(&Seed) % 4;
+        Alpha = (Alpha == 0) ? 0 : (Alpha == 1) ? 255 : NextRandom(&Seed) & 0xFF;
+        SrcBits[i] = (Alpha << 24) |
+                     (((NextRandom(&Seed) & 0xFF) * Alpha / 255) << 16) |
+                     (((NextRandom(&Seed) & 0xFF) * Alpha / 255) << 8) |
+                     ((NextRandom(&Seed) & 0xFF) * Alpha / 255);
+        DstBits[i] = Original[i] = NextRandom(&Seed) | (NextRandom(&Seed) << 16);
+    }
+
+    GdiFlush();
+    ok(GdiAlphaBlend(hdcDst, 0, 0, BLEND_WIDTH, BLEND_HEIGHT,
+                     hdcSrc, 0, 0, BLEND_WIDTH, BLEND_HEIGHT, Blend),
+       "GdiAlphaBlend failed\n");
+    GdiFlush();
+
+    for (i = 0; i < BLEND_WIDTH * BLEND_HEIGHT; i++)
+    {
+        if (!ChannelsMatch(DstBits[i], ReferenceBlend(Original[i], SrcBits[i], Blend)))
+        {
+            if (!Mismatches++)
+            {
+                ok(0, "Alpha %u format %u: pixel %lu is 0x%08lx, expected 0x%08lx (dst 0x%08lx src 0x%08lx)\n",
+                   ConstAlpha, AlphaFormat, i, DstBits[i],
+                   ReferenceBlend(Original[i], SrcBits[i], Blend), Original[i], SrcBits[i]);
+            }
+        }
+    }
+    ok(Mismatches == 0, "Alpha %u format %u: %lu pixels differ\n", ConstAlpha, AlphaFormat, Mismatches);
+
+    /* Throughput */
+    Iterations = 50;
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Iterations; i++)
+    {
+        GdiAlphaBlend(hdcDst, 0, 0, BLEND_WIDTH, BLEND_HEIGHT,
+                      hdcSrc, 0, 0, BLEND_WIDTH, BLEND_HEIGHT, Blend);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("Alpha %u format %u: %.1f Mpixels/s\n", ConstAlpha, AlphaFormat,
+          Seconds ? (double)BLEND_WIDTH * BLEND_HEIGHT * Iterations / Seconds / 1e6 : 0.0);
+}
+
+START_TEST(GdiAlphaBlend)
+{
+    HDC hdcDst, hdcSrc;
+    HBITMAP hbmDst, hbmSrc;
+    PULONG DstBits, SrcBits;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hdcSrc = CreateCompatibleDC(NULL);
+    ok(hdcDst != NULL && hdcSrc != NULL, "CreateCompatibleDC failed\n");
+
+    hbmDst = CreateDib32(hdcDst, &DstBits);
+    hbmSrc = CreateDib32(hdcSrc, &SrcBits);
+    ok(hbmDst != NULL && hbmSrc != NULL, "CreateDIBSection failed\n");
+    if (!hdcDst || !hdcSrc || !hbmDst || !hbmSrc)
+    {
+        skip("No DCs or DIB sections\n");
+        return;
+    }
+
+    SelectObject(hdcDst, hbmDst);
+    SelectObject(hdcSrc, hbmSrc);
+
+    /* Per-pixel alpha, per-pixel and constant alpha, constant alpha only */
+    TestBlend(hdcDst, DstBits, hdcSrc, SrcBits, 255, AC_SRC_ALPHA);
+    TestBlend(hdcDst, DstBits, hdcSrc, SrcBits, 128, AC_SRC_ALPHA);
+    TestBlend(hdcDst, DstBits, hdcSrc, SrcBits, 77, 0);
+    TestBlend(hdcDst, DstBits, hdcSrc, SrcBits, 255, 0);
+
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+    DeleteObject(hbmDst);
+    DeleteObject(hbmSrc);
+}
@@ -7,6 +7,7 @@ extern void func_AddFontMemResourceEx(void);
 extern void func_AddFontResource(void);
 extern void func_AddFontResourceEx(void);
 extern void func_BeginPath(void);
+extern void func_BitBltRop(void);
 extern void func_CombineRgn(void);
 extern void func_CombineTransform(void);
 extern void func_CreateBitmap(void);
@@ -27,7 +28,10 @@ extern void func_EnumFontFamilies(void);
 extern void func_ExcludeClipRect(void);
 extern void func_ExtCreatePen(void);
 extern void func_ExtCreateRegion(void);
+extern void func_ExtTextOut(void);
+extern void func_FontCache(void);
 extern void func_FrameRgn(void);
+extern void func_GdiAlphaBlend(void);
 extern void func_GdiConvertBitmap(void);
 extern void func_GdiConvertBrush(void);
 extern void func_GdiConvertDC(void);
@@ -84,6 +88,7 @@ const struct test winetest_testlist[] =
     { "AddFontResource", func_AddFontResource },
     { "AddFontResourceEx", func_AddFontResourceEx },
     { "BeginPath", func_BeginPath },
+    { "BitBltRop", func_BitBltRop },
     { "CombineRgn", func_CombineRgn },
     { "CombineTransform", func_CombineTransform },
     { "CreateBitmap", func_CreateBitmap },
@@ -104,7 +109,10 @@ const struct test winetest_testlist[] =
     { "ExcludeClipRect", func_ExcludeClipRect },
     { "ExtCreatePen", func_ExtCreatePen },
     { "ExtCreateRegion", func_ExtCreateRegion },
+    { "ExtTextOut", func_ExtTextOut },
+    { "FontCache", func_FontCache },
     { "FrameRgn", func_FrameRgn },
+    { "GdiAlphaBlend", func_GdiAlphaBlend },
     { "GdiConvertBitmap", func_GdiConvertBitmap },
     { "GdiConvertBrush", func_GdiConvertBrush },
     { "GdiConvertDC", func_GdiConvertDC },
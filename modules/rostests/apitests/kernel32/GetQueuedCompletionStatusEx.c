@@ -0,0 +1,150 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Tests and throughput of GetQueuedCompletionStatusEx
+ */
+
+#include "precomp.h"
+
+#define BENCH_PACKETS 65536
+
+typedef BOOL (WINAPI *PGQCSEX)(HANDLE, LPOVERLAPPED_ENTRY, ULONG, PULONG, DWORD, BOOL);
+
+static PGQCSEX pGetQueuedCompletionStatusEx;
+static ULONG ApcCount;
+
+static VOID CALLBACK
+ApcRoutine(ULONG_PTR Parameter)
+{
+    ApcCount++;
+}
+
+static void
+PostPackets(HANDLE Port, ULONG First, ULONG Count)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        PostQueuedCompletionStatus(Port, (First + i) * 10, First + i,
+                                   (LPOVERLAPPED)(ULONG_PTR)(First + i + 1));
+    }
+}
+
+static void
+TestDequeue(HANDLE Port)
+{
+    OVERLAPPED_ENTRY Entries[16];
+    ULONG Removed, i;
+    BOOL Ret;
+
+    /* Invalid parameters */
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 0, &Removed, 0, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "Error = %lu\n", GetLastError());
+
+    /* Empty port */
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 16, &Removed, 0, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_TIMEOUT, "Error = %lu\n", GetLastError());
+
+    /* All the queued packets come back in order, in a single call */
+    PostPackets(Port, 0, 5);
+    Removed = 0xdeadbeef;
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 16, &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, error %lu\n", Ret, GetLastError());
+    ok(Removed == 5, "Removed = %lu\n", Removed);
+    for (i = 0; i < min(Removed, 5); i++)
+    {
+        ok(Entries[i].lpCompletionKey == i, "Entry %lu: key %Iu\n", i, Entries[i].lpCompletionKey);
+        ok(Entries[i].lpOverlapped == (LPOVERLAPPED)(ULONG_PTR)(i + 1),
+           "Entry %lu: overlapped %p\n", i, Entries[i].lpOverlapped);
+        ok(Entries[i].dwNumberOfBytesTransferred == i * 10,
+           "Entry %lu: bytes %lu\n", i, Entries[i].dwNumberOfBytesTransferred);
+        ok(Entries[i].Internal == STATUS_SUCCESS, "Entry %lu: status 0x%Ix\n", i, Entries[i].Internal);
+    }
+
+    /* No more than what the caller asked for */
+    PostPackets(Port, 5, 5);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 2, &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, error %lu\n", Ret, GetLastError());
+    ok(Removed == 2, "Removed = %lu\n", Removed);
+    ok(Entries[0].lpCompletionKey == 5, "Key %Iu\n", Entries[0].lpCompletionKey);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 16, &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, error %lu\n", Ret, GetLastError());
+    ok(Removed == 3, "Removed = %lu\n", Removed);
+    ok(Entries[0].lpCompletionKey == 7, "Key %Iu\n", Entries[0].lpCompletionKey);
+
+    /* An alertable wait is interrupted by user APCs */
+    ApcCount = 0;
+    ok(QueueUserAPC(ApcRoutine, GetCurrentThread(), 0), "QueueUserAPC failed\n");
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 16, &Removed, INFINITE, TRUE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_IO_COMPLETION, "Error = %lu\n", GetLastError());
+    ok(ApcCount == 1, "ApcCount = %lu\n", ApcCount);
+
+    /* But a non-alertable one isn't */
+    ok(QueueUserAPC(ApcRoutine, GetCurrentThread(), 0), "QueueUserAPC failed\n");
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 16, &Removed, 10, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_TIMEOUT, "Error = %lu\n", GetLastError());
+    ok(ApcCount == 1, "ApcCount = %lu\n", ApcCount);
+    SleepEx(0, TRUE);
+    ok(ApcCount == 2, "ApcCount = %lu\n", ApcCount);
+}
+
+static void
+BenchmarkDequeue(HANDLE Port, ULONG BatchSize)
+{
+    OVERLAPPED_ENTRY Entries[64];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Total, Removed;
+    double Seconds;
+
+    PostPackets(Port, 0, BENCH_PACKETS);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (Total = 0; Total < BENCH_PACKETS; Total += Removed)
+    {
+        if (!pGetQueuedCompletionStatusEx(Port, Entries, BatchSize, &Removed, 0, FALSE))
+            break;
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(Total == BENCH_PACKETS, "Batch %lu: only %lu packets removed\n", BatchSize, Total);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("Batch %lu: %.0f completions/s\n", BatchSize,
+          Seconds ? Total / Seconds : 0.0);
+}
+
+START_TEST(GetQueuedCompletionStatusEx)
+{
+    HANDLE Port;
+
+    pGetQueuedCompletionStatusEx = (PGQCSEX)GetProcAddress(GetModuleHandleW(L"kernel32.dll"),
+                                                           "GetQueuedCompletionStatusEx");
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        skip("GetQueuedCompletionStatusEx is not available\n");
+        return;
+    }
+
+    Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed, error %lu\n", GetLastError());
+    if (!Port)
+        return;
+
+    TestDequeue(Port);
+
+    BenchmarkDequeue(Port, 1);
+    BenchmarkDequeue(Port, 16);
+    BenchmarkDequeue(Port, 64);
+
+    CloseHandle(Port);
+}
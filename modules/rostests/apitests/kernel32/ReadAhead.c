@@ -0,0 +1,178 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Tests for the cache manager read ahead, through cached reads
+ */
+
+#include "precomp.h"
+
+#define RA_FILE_SIZE    (16 * 1024 * 1024)
+#define RA_CHUNK_SIZE   (64 * 1024)
+#define RA_STRIDE       (512 * 1024)
+
+typedef enum _RA_PATTERN
+{
+    RaForward,
+    RaBackward,
+    RaStrided
+} RA_PATTERN;
+
+static const char * const PatternNames[] = { "Forward", "Backward", "Strided" };
+
+static void
+FillChunk(PULONG Buffer, ULONG Tag, ULONG Offset)
+{
+    ULONG i;
+
+    /* Every dword tells which file and offset it belongs to */
+    for (i = 0; i < RA_CHUNK_SIZE / sizeof(ULONG); i++)
+        Buffer[i] = (Tag << 28) ^ (Offset + i * sizeof(ULONG));
+}
+
+static BOOL
+GetReadAheadIos(PULONG Ios)
+{
+    SYSTEM_PERFORMANCE_INFORMATION Spi;
+    NTSTATUS Status;
+
+    Status = NtQuerySystemInformation(SystemPerformanceInformation, &Spi, sizeof(Spi), NULL);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    *Ios = Spi.CcReadAheadIos;
+    return TRUE;
+}
+
+/* Writes the file without the cache, so that nothing of it is cached before it is read */
+static BOOL
+CreateTestFile(LPCWSTR Path, ULONG Tag)
+{
+    PULONG Buffer;
+    HANDLE hFile;
+    ULONG Offset;
+    DWORD Written;
+
+    Buffer = VirtualAlloc(NULL, RA_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    if (!Buffer)
+        return FALSE;
+
+    hFile = CreateFileW(Path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                        FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        VirtualFree(Buffer, 0, MEM_RELEASE);
+        return FALSE;
+    }
+
+    for (Offset = 0; Offset < RA_FILE_SIZE; Offset += RA_CHUNK_SIZE)
+    {
+        FillChunk(Buffer, Tag, Offset);
+        if (!WriteFile(hFile, Buffer, RA_CHUNK_SIZE, &Written, NULL) || Written != RA_CHUNK_SIZE)
+            break;
+    }
+
+    CloseHandle(hFile);
+    VirtualFree(Buffer, 0, MEM_RELEASE);
+    return (Offset == RA_FILE_SIZE);
+}
+
+static void
+TestPattern(LPCWSTR Path, ULONG Tag, RA_PATTERN Pattern)
+{
+    LARGE_INTEGER Frequency, Start, End, Position;
+    PULONG Buffer, Expected;
+    ULONG IosBefore, Ios, Reads, i, Offset;
+    HANDLE hFile;
+    DWORD Read;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, RA_CHUNK_SIZE);
+    Expected = HeapAlloc(GetProcessHeap(), 0, RA_CHUNK_SIZE);
+    hFile = CreateFileW(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "%s: CreateFileW failed, error %lu\n",
+       PatternNames[Pattern], GetLastError());
+    if (!Buffer || !Expected || hFile == INVALID_HANDLE_VALUE)
+        goto Cleanup;
+
+    if (Pattern == RaStrided)
+        Reads = RA_FILE_SIZE / RA_STRIDE;
+    else
+        Reads = RA_FILE_SIZE / RA_CHUNK_SIZE;
+
+    GetReadAheadIos(&IosBefore);
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < Reads; i++)
+    {
+        if (Pattern == RaForward)
+            Offset = i * RA_CHUNK_SIZE;
+        else if (Pattern == RaBackward)
+            Offset = RA_FILE_SIZE - (i + 1) * RA_CHUNK_SIZE;
+        else
+            Offset = i * RA_STRIDE;
+
+        Position.QuadPart = Offset;
+        if (!SetFilePointerEx(hFile, Position, NULL, FILE_BEGIN) ||
+            !ReadFile(hFile, Buffer, RA_CHUNK_SIZE, &Read, NULL) || Read != RA_CHUNK_SIZE)
+        {
+            ok(0, "%s: read failed at 0x%lx, error %lu\n", PatternNames[Pattern], Offset, GetLastError());
+            break;
+        }
+
+        FillChunk(Expected, Tag, Offset);
+        if (memcmp(Buffer, Expected, RA_CHUNK_SIZE))
+        {
+            ok(0, "%s: data mismatch in the chunk at 0x%lx\n", PatternNames[Pattern], Offset);
+            break;
+        }
+    }
+
+    QueryPerformanceCounter(&End);
+    GetReadAheadIos(&Ios);
+
+    /* The reader was predictable, read ahead must have kicked in */
+    ok(Ios != IosBefore, "%s: no read ahead I/O\n", PatternNames[Pattern]);
+    trace("%s: %lu reads, %lu read ahead I/Os, %.1f MB/s\n",
+          PatternNames[Pattern], i, Ios - IosBefore,
+          (double)i * RA_CHUNK_SIZE / (1024 * 1024) /
+          ((double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart));
+
+Cleanup:
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (Buffer)
+        HeapFree(GetProcessHeap(), 0, Buffer);
+}
+
+START_TEST(ReadAhead)
+{
+    WCHAR TempPath[MAX_PATH], Path[MAX_PATH];
+    ULONG Ios;
+    RA_PATTERN Pattern;
+
+    if (!GetReadAheadIos(&Ios))
+    {
+        skip("SystemPerformanceInformation is not available\n");
+        return;
+    }
+
+    GetTempPathW(_countof(TempPath), TempPath);
+
+    /* A new file for each pattern, so that none of them finds the data of another one cached */
+    for (Pattern = RaForward; Pattern <= RaStrided; Pattern++)
+    {
+        GetTempFileNameW(TempPath, L"RA", 0, Path);
+        if (!CreateTestFile(Path, Pattern + 1))
+        {
+            skip("%s: could not create '%S', error %lu\n", PatternNames[Pattern], Path, GetLastError());
+        }
+        else
+        {
+            TestPattern(Path, Pattern + 1, Pattern);
+        }
+        DeleteFileW(Path);
+    }
+}
@@ -0,0 +1,186 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Tests for the lazy writer, through cached writes to several files
+ */
+
+#include "precomp.h"
+
+#define WB_FILES        4
+#define WB_FILE_SIZE    (8 * 1024 * 1024)
+#define WB_CHUNK_SIZE   (64 * 1024)
+#define WB_PAGE_SIZE    4096
+#define WB_TIMEOUT      30000
+
+typedef struct _WB_FILE
+{
+    WCHAR Path[MAX_PATH];
+    ULONG Index;
+    BOOL Written;
+} WB_FILE, *PWB_FILE;
+
+static void
+FillChunk(PULONG Buffer, ULONG Index, ULONG Offset)
+{
+    ULONG i;
+
+    /* Every dword tells which file and offset it belongs to */
+    for (i = 0; i < WB_CHUNK_SIZE / sizeof(ULONG); i++)
+        Buffer[i] = (Index << 28) ^ (Offset + i * sizeof(ULONG));
+}
+
+static BOOL
+GetLazyWriteCounters(PULONG Ios, PULONG Pages)
+{
+    SYSTEM_PERFORMANCE_INFORMATION Spi;
+    NTSTATUS Status;
+
+    Status = NtQuerySystemInformation(SystemPerformanceInformation, &Spi, sizeof(Spi), NULL);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    *Ios = Spi.CcLazyWriteIos;
+    *Pages = Spi.CcLazyWritePages;
+    return TRUE;
+}
+
+static DWORD WINAPI
+WriterThread(LPVOID Parameter)
+{
+    PWB_FILE File = Parameter;
+    PULONG Buffer;
+    HANDLE hFile;
+    ULONG Offset;
+    DWORD Written;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, WB_CHUNK_SIZE);
+    if (!Buffer)
+        return 0;
+
+    /* Cached writes only, the lazy writer is left to write them */
+    hFile = CreateFileW(File->Path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        for (Offset = 0; Offset < WB_FILE_SIZE; Offset += WB_CHUNK_SIZE)
+        {
+            FillChunk(Buffer, File->Index, Offset);
+            if (!WriteFile(hFile, Buffer, WB_CHUNK_SIZE, &Written, NULL) ||
+                Written != WB_CHUNK_SIZE)
+            {
+                break;
+            }
+        }
+        File->Written = (Offset == WB_FILE_SIZE);
+        CloseHandle(hFile);
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    return 0;
+}
+
+static void
+CheckFile(PWB_FILE File)
+{
+    PULONG Buffer, Expected;
+    HANDLE hFile;
+    ULONG Offset;
+    DWORD Read;
+
+    /* Read it back without the cache */
+    Buffer = VirtualAlloc(NULL, WB_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    Expected = HeapAlloc(GetProcessHeap(), 0, WB_CHUNK_SIZE);
+    hFile = CreateFileW(File->Path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "File #%lu: CreateFileW failed, error %lu\n", File->Index, GetLastError());
+    if (!Buffer || !Expected || hFile == INVALID_HANDLE_VALUE)
+        goto Cleanup;
+
+    for (Offset = 0; Offset < WB_FILE_SIZE; Offset += WB_CHUNK_SIZE)
+    {
+        if (!ReadFile(hFile, Buffer, WB_CHUNK_SIZE, &Read, NULL) || Read != WB_CHUNK_SIZE)
+        {
+            ok(0, "File #%lu: read failed at 0x%lx, error %lu\n", File->Index, Offset, GetLastError());
+            break;
+        }
+
+        FillChunk(Expected, File->Index, Offset);
+        if (memcmp(Buffer, Expected, WB_CHUNK_SIZE))
+        {
+            ok(0, "File #%lu: data mismatch in the chunk at 0x%lx\n", File->Index, Offset);
+            break;
+        }
+    }
+
+Cleanup:
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    if (Expected)
+        HeapFree(GetProcessHeap(), 0, Expected);
+    if (Buffer)
+        VirtualFree(Buffer, 0, MEM_RELEASE);
+}
+
+START_TEST(WriteBehind)
+{
+    WB_FILE Files[WB_FILES];
+    HANDLE Threads[WB_FILES];
+    WCHAR TempPath[MAX_PATH];
+    ULONG IosBefore, PagesBefore, Ios, Pages, Written;
+    DWORD Start;
+    ULONG i;
+
+    if (!GetLazyWriteCounters(&IosBefore, &PagesBefore))
+    {
+        skip("SystemPerformanceInformation is not available\n");
+        return;
+    }
+
+    GetTempPathW(_countof(TempPath), TempPath);
+
+    /* Dirty several files at once, so that the lazy writer has them all to write */
+    for (i = 0; i < WB_FILES; i++)
+    {
+        GetTempFileNameW(TempPath, L"WB", 0, Files[i].Path);
+        Files[i].Index = i;
+        Files[i].Written = FALSE;
+        Threads[i] = CreateThread(NULL, 0, WriterThread, &Files[i], 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed, error %lu\n", GetLastError());
+    }
+
+    Written = 0;
+    for (i = 0; i < WB_FILES; i++)
+    {
+        if (Threads[i])
+        {
+            WaitForSingleObject(Threads[i], INFINITE);
+            CloseHandle(Threads[i]);
+        }
+        ok(Files[i].Written, "File #%lu was not written\n", i);
+        if (Files[i].Written)
+            Written += WB_FILE_SIZE / WB_PAGE_SIZE;
+    }
+
+    /* Nothing was flushed explicitly: wait for the lazy writer to write the dirty pages */
+    Start = GetTickCount();
+    do
+    {
+        Sleep(250);
+        GetLazyWriteCounters(&Ios, &Pages);
+    } while (Pages - PagesBefore < Written && GetTickCount() - Start < WB_TIMEOUT);
+
+    ok(Pages - PagesBefore >= Written, "The lazy writer wrote %lu pages out of %lu in %lu ms\n",
+       Pages - PagesBefore, Written, GetTickCount() - Start);
+    trace("%lu pages in %lu writes (%lu pages per write) in %lu ms\n",
+          Pages - PagesBefore, Ios - IosBefore,
+          (Ios != IosBefore) ? (Pages - PagesBefore) / (Ios - IosBefore) : 0,
+          GetTickCount() - Start);
+
+    /* What reached the disk must be what was written */
+    for (i = 0; i < WB_FILES; i++)
+    {
+        if (Files[i].Written)
+            CheckFile(&Files[i]);
+        DeleteFileW(Files[i].Path);
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Round-trip and throughput test for RtlCompressBuffer (LZNT1)
+ */
+
+#include "precomp.h"
+
+#define CORPUS_SIZE (1024 * 1024)
+
+static PUCHAR Corpus;
+static PUCHAR Compressed;
+static PUCHAR Decompressed;
+static ULONG CompressedSize;
+
+static ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed >> 16;
+}
+
+/* Fixed corpus: text, incompressible noise, repeated records and zeroes */
+static VOID
+FillCorpus(VOID)
+{
+    static const PCSTR Words[] =
+    {
+        "the ", "kernel ", "registry ", "ReactOS ", "window ", "message ",
+        "buffer ", "driver ", "\r\n", "of ", "and ", "file "
+    };
+    ULONG Seed = 0x12345678;
+    ULONG Pos = 0, Length, i;
+    PCSTR Word;
+
+    while (Pos < CORPUS_SIZE / 2)
+    {
+        Word = Words[NextRandom(&Seed) % _countof(Words)];
+        Length = min((ULONG)strlen(Word), CORPUS_SIZE / 2 - Pos);
+        RtlCopyMemory(Corpus + Pos, Word, Length);
+        Pos += Length;
+    }
+
+    for (; Pos < CORPUS_SIZE / 2 + CORPUS_SIZE / 8; Pos++)
+        Corpus[Pos] = (UCHAR)NextRandom(&Seed);
+
+    for (i = 0; Pos < CORPUS_SIZE / 2 + CORPUS_SIZE / 4 + CORPUS_SIZE / 8; Pos++, i++)
+        Corpus[Pos] = (UCHAR)((i % 24) < 8 ? i / 24 : (i % 24));
+
+    RtlZeroMemory(Corpus + Pos, CORPUS_SIZE - Pos);
+}
+
+static VOID
+TestEngine(USHORT Engine, PCSTR Name)
+{
+    ULONG WorkSpaceSize, FragmentWorkSpaceSize, FinalSize;
+    LARGE_INTEGER Frequency, Start, End;
+    PVOID WorkSpace;
+    NTSTATUS Status;
+    double Seconds;
+
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1 | Engine,
+                                            &WorkSpaceSize,
+                                            &FragmentWorkSpaceSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    WorkSpace = HeapAlloc(GetProcessHeap(), 0, WorkSpaceSize);
+    if (!WorkSpace)
+    {
+        skip("Failed to allocate %lu bytes of workspace\n", WorkSpaceSize);
+        return;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1 | Engine,
+                               Corpus,
+                               CORPUS_SIZE,
+                               Compressed,
+                               CORPUS_SIZE + CORPUS_SIZE / 8,
+                               4096,
+                               &CompressedSize,
+                               WorkSpace);
+    QueryPerformanceCounter(&End);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(CompressedSize < CORPUS_SIZE / 2, "%s: CompressedSize = %lu\n", Name, CompressedSize);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("%s: %lu -> %lu bytes (ratio %.3f), %.1f MB/s\n",
+          Name, (ULONG)CORPUS_SIZE, CompressedSize,
+          (double)CompressedSize / CORPUS_SIZE,
+          Seconds > 0 ? CORPUS_SIZE / Seconds / (1024 * 1024) : 0.0);
+
+    /* The output must decompress back to the corpus */
+    FinalSize = 0xdeadbeef;
+    RtlFillMemory(Decompressed, CORPUS_SIZE, 0x55);
+    Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1,
+                                 Decompressed,
+                                 CORPUS_SIZE,
+                                 Compressed,
+                                 CompressedSize,
+                                 &FinalSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_long(FinalSize, CORPUS_SIZE);
+    ok(RtlCompareMemory(Decompressed, Corpus, CORPUS_SIZE) == CORPUS_SIZE,
+       "%s: round-trip mismatch\n", Name);
+
+    /* Too small an output buffer must fail instead of overflowing */
+    Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1 | Engine,
+                               Corpus + CORPUS_SIZE / 2,
+                               CORPUS_SIZE / 8,
+                               Compressed,
+                               CORPUS_SIZE / 16,
+                               4096,
+                               &FinalSize,
+                               WorkSpace);
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+
+    HeapFree(GetProcessHeap(), 0, WorkSpace);
+}
+
+START_TEST(RtlCompressBuffer)
+{
+    ULONG StandardSize;
+
+    Corpus = HeapAlloc(GetProcessHeap(), 0, CORPUS_SIZE);
+    Compressed = HeapAlloc(GetProcessHeap(), 0, CORPUS_SIZE + CORPUS_SIZE / 8);
+    Decompressed = HeapAlloc(GetProcessHeap(), 0, CORPUS_SIZE);
+    if (!Corpus || !Compressed || !Decompressed)
+    {
+        skip("Failed to allocate buffers\n");
+        goto Cleanup;
+    }
+
+    FillCorpus();
+
+    TestEngine(COMPRESSION_ENGINE_STANDARD, "Standard");
+    StandardSize = CompressedSize;
+
+    TestEngine(COMPRESSION_ENGINE_MAXIMUM, "Maximum");
+    ok(CompressedSize <= StandardSize,
+       "Maximum engine produced %lu bytes, standard %lu\n", CompressedSize, StandardSize);
+
+Cleanup:
+    HeapFree(GetProcessHeap(), 0, Decompressed);
+    HeapFree(GetProcessHeap(), 0, Compressed);
+    HeapFree(GetProcessHeap(), 0, Corpus);
+}
@@ -265,6 +265,55 @@ MultiHeapFreeTest()
     TEST_FREE(3, -1, 0, HeapHandle, 0, 3, Array);
 }
 
+static void
+MultiHeapBatchTest()
+{
+    INT ret;
+    ULONG i, j;
+    HANDLE HeapHandle;
+    PVOID Array[64];
+    PUCHAR Block;
+    BOOL Zeroed;
+
+    HeapHandle = HeapCreate(0, 0, 0);
+    ok(HeapHandle != NULL, "HeapCreate failed\n");
+    if (!HeapHandle)
+        return;
+
+    // A batch of blocks is handed out as separate, zeroed blocks
+    RtlZeroMemory(Array, sizeof(Array));
+    ret = g_alloc(HeapHandle, HEAP_ZERO_MEMORY, 100, _countof(Array), Array);
+    INT_EXPECTED(ret, (INT)_countof(Array));
+
+    for (i = 0; i < (ULONG)ret; i++)
+    {
+        Block = Array[i];
+        ok(HeapSize(HeapHandle, 0, Block) == 100, "Block %lu has size %Iu\n", i, HeapSize(HeapHandle, 0, Block));
+
+        Zeroed = TRUE;
+        for (j = 0; j < 100; j++)
+            Zeroed = Zeroed && !Block[j];
+        ok(Zeroed, "Block %lu is not zeroed\n", i);
+
+        FillMemory(Block, 100, 0xCC);
+    }
+
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted after the batch allocation\n");
+
+    // Freeing every other block first exercises coalescing of the batch
+    for (i = 0; i < _countof(Array); i += 2)
+    {
+        ok(HeapFree(HeapHandle, 0, Array[i]), "HeapFree failed for block %lu\n", i);
+        Array[i] = NULL;
+    }
+
+    ret = g_free(HeapHandle, 0, _countof(Array), Array);
+    INT_EXPECTED(ret, (INT)_countof(Array));
+
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted after the batch free\n");
+    HeapDestroy(HeapHandle);
+}
+
 START_TEST(RtlMultipleAllocateHeap)
 {
     HINSTANCE ntdll = LoadLibraryA("ntdll");
@@ -280,6 +329,7 @@ START_TEST(RtlMultipleAllocateHeap)
     {
         MultiHeapAllocTest();
         MultiHeapFreeTest();
+        MultiHeapBatchTest();
     }
 
     FreeLibrary(ntdll);
@@ -0,0 +1,206 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test for the low fragmentation heap front end
+ */
+
+#include "precomp.h"
+
+#define BENCH_OPERATIONS    200000
+#define BENCH_WORKING_SET   64
+#define BENCH_MAX_THREADS   4
+
+static HANDLE BenchHeap;
+
+static ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed >> 16;
+}
+
+static
+DWORD
+WINAPI
+BenchThread(PVOID Parameter)
+{
+    PVOID Blocks[BENCH_WORKING_SET] = { NULL };
+    ULONG Seed = PtrToUlong(Parameter);
+    ULONG i, Slot;
+
+    for (i = 0; i < BENCH_OPERATIONS; i++)
+    {
+        Slot = NextRandom(&Seed) % BENCH_WORKING_SET;
+        if (Blocks[Slot])
+        {
+            RtlFreeHeap(BenchHeap, 0, Blocks[Slot]);
+            Blocks[Slot] = NULL;
+        }
+        else
+        {
+            Blocks[Slot] = RtlAllocateHeap(BenchHeap, 0, 16 + NextRandom(&Seed) % 496);
+        }
+    }
+
+    for (Slot = 0; Slot < BENCH_WORKING_SET; Slot++)
+        RtlFreeHeap(BenchHeap, 0, Blocks[Slot]);
+
+    return 0;
+}
+
+static
+VOID
+Benchmark(BOOLEAN EnableLfh, ULONG ThreadCount)
+{
+    HANDLE Threads[BENCH_MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG HeapType = 2;
+    NTSTATUS Status;
+    double Milliseconds;
+    ULONG i;
+
+    BenchHeap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(BenchHeap != NULL, "RtlCreateHeap failed\n");
+    if (!BenchHeap)
+        return;
+
+    if (EnableLfh)
+    {
+        Status = RtlSetHeapInformation(BenchHeap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType));
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, BenchThread, UlongToPtr(0x1234 + i), 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[i])
+        {
+            ThreadCount = i;
+            break;
+        }
+    }
+
+    if (ThreadCount)
+        WaitForMultipleObjects(ThreadCount, Threads, TRUE, INFINITE);
+
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < ThreadCount; i++)
+        CloseHandle(Threads[i]);
+
+    ok(RtlValidateHeap(BenchHeap, 0, NULL), "Heap is corrupted\n");
+    RtlDestroyHeap(BenchHeap);
+
+    Milliseconds = (End.QuadPart - Start.QuadPart) * 1000.0 / Frequency.QuadPart;
+    trace("%s heap, %lu thread(s): %.1f ms, %.0f operations/ms\n",
+          EnableLfh ? "LFH" : "Standard",
+          ThreadCount,
+          Milliseconds,
+          Milliseconds ? (double)BENCH_OPERATIONS * ThreadCount / Milliseconds : 0.0);
+}
+
+static
+VOID
+TestLfh(VOID)
+{
+    HANDLE Heap;
+    ULONG HeapType;
+    NTSTATUS Status;
+    PUCHAR Buffer, Buffer2;
+    ULONG i;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap)
+        return;
+
+    /* Only the LFH can be requested */
+    HeapType = 1;
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType));
+    ok_ntstatus(Status, STATUS_UNSUCCESSFUL);
+
+    HeapType = 2;
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType) - 1);
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType));
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    HeapType = 0xdeadbeef;
+    Status = RtlQueryHeapInformation(Heap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_long(HeapType, 2);
+
+    /* Small blocks keep their exact size */
+    for (i = 1; i <= 1024; i++)
+    {
+        Buffer = RtlAllocateHeap(Heap, HEAP_ZERO_MEMORY, i);
+        ok(Buffer != NULL, "Allocation of %lu bytes failed\n", i);
+        if (!Buffer)
+            break;
+        ok(RtlSizeHeap(Heap, 0, Buffer) == i, "Size is %Iu, expected %lu\n", RtlSizeHeap(Heap, 0, Buffer), i);
+        ok(Buffer[i - 1] == 0, "Block of %lu bytes is not zeroed\n", i);
+        ok(RtlFreeHeap(Heap, 0, Buffer), "Free of %lu bytes failed\n", i);
+    }
+
+    /* Growing a block keeps its contents */
+    Buffer = RtlAllocateHeap(Heap, 0, 24);
+    ok(Buffer != NULL, "Allocation failed\n");
+    if (Buffer)
+    {
+        RtlFillMemory(Buffer, 24, 0x5A);
+
+        Buffer2 = RtlReAllocateHeap(Heap, HEAP_ZERO_MEMORY, Buffer, 20000);
+        ok(Buffer2 != NULL, "Reallocation failed\n");
+        if (Buffer2)
+        {
+            ok(Buffer2[0] == 0x5A && Buffer2[23] == 0x5A, "Contents were lost\n");
+            ok(Buffer2[24] == 0 && Buffer2[19999] == 0, "Tail was not zeroed\n");
+            ok(RtlSizeHeap(Heap, 0, Buffer2) == 20000, "Size is %Iu\n", RtlSizeHeap(Heap, 0, Buffer2));
+            Buffer = Buffer2;
+        }
+
+        ok(RtlValidateHeap(Heap, 0, Buffer), "Block is not valid\n");
+        ok(RtlFreeHeap(Heap, 0, Buffer), "Free failed\n");
+    }
+
+    /* Double frees are caught */
+    Buffer = RtlAllocateHeap(Heap, 0, 32);
+    ok(Buffer != NULL, "Allocation failed\n");
+    if (Buffer)
+    {
+        ok(RtlFreeHeap(Heap, 0, Buffer), "Free failed\n");
+        ok(!RtlFreeHeap(Heap, 0, Buffer), "Double free succeeded\n");
+    }
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+    RtlDestroyHeap(Heap);
+
+    /* The front end needs a serialized heap */
+    Heap = RtlCreateHeap(HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (Heap)
+    {
+        HeapType = 2;
+        Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &HeapType, sizeof(HeapType));
+        ok_ntstatus(Status, STATUS_UNSUCCESSFUL);
+        RtlDestroyHeap(Heap);
+    }
+}
+
+START_TEST(RtlSetHeapInformation)
+{
+    ULONG ThreadCount;
+
+    TestLfh();
+
+    for (ThreadCount = 1; ThreadCount <= BENCH_MAX_THREADS; ThreadCount *= 2)
+    {
+        Benchmark(FALSE, ThreadCount);
+        Benchmark(TRUE, ThreadCount);
+    }
+}
@@ -0,0 +1,188 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and timing for formatting a sparse image file with ufat
+ */
+
+#include "precomp.h"
+
+typedef BOOLEAN
+(NTAPI *PVFAT_FORMAT)(
+    IN PUNICODE_STRING DriveRoot,
+    IN PFMIFSCALLBACK Callback,
+    IN BOOLEAN QuickFormat,
+    IN BOOLEAN BackwardCompatible,
+    IN MEDIA_TYPE MediaType,
+    IN PUNICODE_STRING Label,
+    IN ULONG ClusterSize);
+
+static const struct
+{
+    ULONG SizeMB;
+    BOOLEAN QuickFormat;
+    BOOLEAN Fat32;
+    PCSTR SysType;
+    ULONG HeaderLength;
+    UCHAR Header[12];
+} FormatTests[] =
+{
+    {   2, TRUE,  FALSE, "FAT12   ",  3, { 0xf8, 0xff, 0xff } },
+    {   2, FALSE, FALSE, "FAT12   ",  3, { 0xf8, 0xff, 0xff } },
+    {  64, TRUE,  FALSE, "FAT16   ",  4, { 0xf8, 0xff, 0xff, 0xff } },
+    {  64, FALSE, FALSE, "FAT16   ",  4, { 0xf8, 0xff, 0xff, 0xff } },
+    { 600, TRUE,  TRUE,  "FAT32   ", 12, { 0xf8, 0xff, 0xff, 0x0f, 0xff, 0xff, 0xff, 0x0f, 0xff, 0xff, 0xff, 0x0f } },
+};
+
+static ULONG LastPercent;
+
+static BOOLEAN
+NTAPI
+FormatCallback(
+    IN CALLBACKCOMMAND Command,
+    IN ULONG SubAction,
+    IN PVOID ActionInfo)
+{
+    if (Command == PROGRESS)
+        LastPercent = *(PULONG)ActionInfo;
+    return TRUE;
+}
+
+static BOOL
+CreateImage(PCWSTR FileName, ULONG SizeMB)
+{
+    HANDLE hFile;
+    LARGE_INTEGER Size;
+    DWORD BytesReturned;
+    BOOL Ret;
+
+    hFile = CreateFileW(FileName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    /* This fails on file systems without sparse files, which is fine */
+    DeviceIoControl(hFile, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &BytesReturned, NULL);
+
+    Size.QuadPart = (LONGLONG)SizeMB * 1024 * 1024;
+    Ret = SetFilePointerEx(hFile, Size, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+    CloseHandle(hFile);
+    return Ret;
+}
+
+static BOOL
+ReadSector(HANDLE hFile, ULONG Sector, PUCHAR Buffer)
+{
+    LARGE_INTEGER Offset;
+    DWORD BytesRead;
+
+    Offset.QuadPart = (LONGLONG)Sector * 512;
+    return SetFilePointerEx(hFile, Offset, NULL, FILE_BEGIN) &&
+           ReadFile(hFile, Buffer, 512, &BytesRead, NULL) &&
+           BytesRead == 512;
+}
+
+static void
+CheckImage(PCWSTR FileName, ULONG Index)
+{
+    HANDLE hFile;
+    UCHAR BootSector[512], Sector[512];
+    ULONG FirstFatSector, FatSectors, FatCount, Copy, i;
+
+    hFile = CreateFileW(FileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "Test %lu: cannot open the image\n", Index);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+
+    ok(ReadSector(hFile, 0, BootSector), "Test %lu: cannot read the boot sector\n", Index);
+    ok(BootSector[510] == 0x55 && BootSector[511] == 0xaa,
+       "Test %lu: boot sector signature is %02x%02x\n", Index, BootSector[510], BootSector[511]);
+    ok(memcmp(&BootSector[FormatTests[Index].Fat32 ? 82 : 54], FormatTests[Index].SysType, 8) == 0,
+       "Test %lu: wrong file system type '%.8s'\n", Index,
+       &BootSector[FormatTests[Index].Fat32 ? 82 : 54]);
+
+    FirstFatSector = *(PUSHORT)&BootSector[14];
+    FatCount = BootSector[16];
+    FatSectors = FormatTests[Index].Fat32 ? *(PULONG)&BootSector[36] : *(PUSHORT)&BootSector[22];
+    ok(FatCount == 2, "Test %lu: FatCount is %lu\n", Index, FatCount);
+    ok(FatSectors != 0, "Test %lu: FatSectors is 0\n", Index);
+
+    /* Each copy of the FAT only has its first entries set */
+    for (Copy = 0; Copy < FatCount; Copy++)
+    {
+        ok(ReadSector(hFile, FirstFatSector + Copy * FatSectors, Sector),
+           "Test %lu: cannot read FAT %lu\n", Index, Copy);
+        ok(memcmp(Sector, FormatTests[Index].Header, FormatTests[Index].HeaderLength) == 0,
+           "Test %lu: FAT %lu starts with %02x %02x %02x\n", Index, Copy, Sector[0], Sector[1], Sector[2]);
+        for (i = FormatTests[Index].HeaderLength; i < sizeof(Sector) && !Sector[i]; i++);
+        ok(i == sizeof(Sector), "Test %lu: FAT %lu has data at %lu\n", Index, Copy, i);
+
+        ok(ReadSector(hFile, FirstFatSector + (Copy + 1) * FatSectors - 1, Sector),
+           "Test %lu: cannot read the end of FAT %lu\n", Index, Copy);
+        for (i = 0; i < sizeof(Sector) && !Sector[i]; i++);
+        ok(i == sizeof(Sector), "Test %lu: FAT %lu has data at the end\n", Index, Copy);
+    }
+
+    CloseHandle(hFile);
+}
+
+START_TEST(Format)
+{
+    HMODULE hUfat;
+    PVFAT_FORMAT pFormat;
+    WCHAR TempPath[MAX_PATH], FileName[MAX_PATH], NtName[MAX_PATH + 4];
+    UNICODE_STRING DriveRoot;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG Index;
+    BOOLEAN Ret;
+
+    hUfat = LoadLibraryW(L"ufat.dll");
+    if (!hUfat)
+    {
+        skip("ufat.dll not available\n");
+        return;
+    }
+
+    pFormat = (PVFAT_FORMAT)GetProcAddress(hUfat, "Format");
+    ok(pFormat != NULL, "Format export not found\n");
+    if (!pFormat)
+    {
+        FreeLibrary(hUfat);
+        return;
+    }
+
+    GetTempPathW(_countof(TempPath), TempPath);
+    StringCchPrintfW(FileName, _countof(FileName), L"%sufat_format.img", TempPath);
+    StringCchPrintfW(NtName, _countof(NtName), L"\\??\\%s", FileName);
+    RtlInitUnicodeString(&DriveRoot, NtName);
+
+    QueryPerformanceFrequency(&Frequency);
+
+    for (Index = 0; Index < _countof(FormatTests); Index++)
+    {
+        if (!CreateImage(FileName, FormatTests[Index].SizeMB))
+        {
+            skip("Cannot create a %lu MB image\n", FormatTests[Index].SizeMB);
+            continue;
+        }
+
+        LastPercent = 0;
+        QueryPerformanceCounter(&Start);
+        Ret = pFormat(&DriveRoot, FormatCallback, FormatTests[Index].QuickFormat,
+                      FALSE, FixedMedia, NULL, 0);
+        QueryPerformanceCounter(&End);
+
+        ok(Ret == TRUE, "Test %lu: Format failed\n", Index);
+        ok(LastPercent >= 100, "Test %lu: progress stopped at %lu%%\n", Index, LastPercent);
+        trace("%s format of a %lu MB image: %.1f ms\n",
+              FormatTests[Index].QuickFormat ? "Quick" : "Full",
+              FormatTests[Index].SizeMB,
+              (double)(End.QuadPart - Start.QuadPart) * 1000.0 / Frequency.QuadPart);
+
+        if (Ret)
+            CheckImage(FileName, Index);
+    }
+
+    DeleteFileW(FileName);
+    FreeLibrary(hUfat);
+}
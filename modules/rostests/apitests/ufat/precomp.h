@@ -0,0 +1,12 @@
+#ifndef _UFAT_APITEST_PRECOMP_H_
+#define _UFAT_APITEST_PRECOMP_H_
+
+#define WIN32_NO_STATUS
+
+#include <apitest.h>
+#include <strsafe.h>
+#include <winioctl.h>
+#include <ndk/rtlfuncs.h>
+#include <fmifs/fmifs.h>
+
+#endif /* _UFAT_APITEST_PRECOMP_H_ */
@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_Format(void);
+
+const struct test winetest_testlist[] =
+{
+    { "Format", func_Format },
+    { 0, 0 }
+};
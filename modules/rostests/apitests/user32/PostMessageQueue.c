@@ -0,0 +1,225 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and benchmark for filtered PeekMessage on a long posted queue
+ */
+
+#include "precomp.h"
+
+#define WINDOW_COUNT    8
+#define BATCH_SIZE      5000    /* Stay below the posted message quota of Windows */
+#define BENCH_MESSAGES  100000
+
+static HWND hWindows[WINDOW_COUNT];
+
+static void
+FlushQueue(void)
+{
+    MSG msg;
+
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+        ;
+}
+
+/* Posts Count messages round-robin to the windows, wParam is the posting order */
+static BOOL
+PostBatch(ULONG Count)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (!PostMessageW(hWindows[i % WINDOW_COUNT], WM_APP + i % WINDOW_COUNT, i, 0))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+TestOrder(void)
+{
+    MSG msg;
+    ULONG i, Count;
+    WPARAM Last;
+    BOOL Ordered;
+
+    FlushQueue();
+
+    /* Each window gets its own messages, in posting order */
+    ok(PostBatch(WINDOW_COUNT * 10), "PostMessageW failed\n");
+    for (i = WINDOW_COUNT; i-- > 0;)
+    {
+        Count = 0;
+        Ordered = TRUE;
+        Last = 0;
+        while (PeekMessageW(&msg, hWindows[i], 0, 0, PM_REMOVE))
+        {
+            if (msg.hwnd != hWindows[i] || msg.message != WM_APP + i ||
+                (Count && msg.wParam <= Last))
+            {
+                Ordered = FALSE;
+            }
+            Last = msg.wParam;
+            Count++;
+        }
+        ok(Count == 10, "Window %lu: %lu messages\n", i, Count);
+        ok(Ordered, "Window %lu: wrong message or order\n", i);
+    }
+
+    /* Thread messages are only found with a NULL hwnd filter */
+    ok(PostThreadMessageW(GetCurrentThreadId(), WM_APP, 1, 0), "PostThreadMessageW failed\n");
+    ok(PostBatch(WINDOW_COUNT), "PostMessageW failed\n");
+    ok(PostThreadMessageW(GetCurrentThreadId(), WM_APP, 2, 0), "PostThreadMessageW failed\n");
+    ok(PeekMessageW(&msg, (HWND)-1, 0, 0, PM_REMOVE) && msg.hwnd == NULL && msg.wParam == 1,
+       "Got %p %Iu\n", msg.hwnd, msg.wParam);
+    ok(PeekMessageW(&msg, (HWND)-1, 0, 0, PM_REMOVE) && msg.hwnd == NULL && msg.wParam == 2,
+       "Got %p %Iu\n", msg.hwnd, msg.wParam);
+    ok(!PeekMessageW(&msg, (HWND)-1, 0, 0, PM_NOREMOVE), "Got %p %Iu\n", msg.hwnd, msg.wParam);
+
+    /* A range filter skips the others */
+    ok(PeekMessageW(&msg, NULL, WM_APP + 3, WM_APP + 3, PM_REMOVE) && msg.hwnd == hWindows[3],
+       "Got %p %u\n", msg.hwnd, msg.message);
+
+    /* Without filter, the messages come in posting order whatever their window */
+    Count = 0;
+    Ordered = TRUE;
+    Last = 0;
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+    {
+        if (Count && msg.wParam <= Last)
+            Ordered = FALSE;
+        Last = msg.wParam;
+        Count++;
+    }
+    ok(Count == WINDOW_COUNT - 1, "%lu messages\n", Count);
+    ok(Ordered, "Wrong order\n");
+}
+
+/* The PM_QS_* flags filter posted messages the same way with or without hwnd */
+static void
+TestQueueStatusFilter(void)
+{
+    MSG msg;
+    HWND hWnd;
+    ULONG i;
+
+    FlushQueue();
+
+    for (i = 0; i < 2; i++)
+    {
+        hWnd = i ? hWindows[0] : NULL;
+
+        ok(PostMessageW(hWindows[0], WM_NULL, 1, 0), "PostMessageW failed\n");
+        ok(PostMessageW(hWindows[0], WM_APP, 2, 0), "PostMessageW failed\n");
+
+        ok(!PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE | PM_QS_INPUT),
+           "%p: PM_QS_INPUT got %u\n", hWnd, msg.message);
+        ok(!PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE | PM_QS_SENDMESSAGE),
+           "%p: PM_QS_SENDMESSAGE got %u\n", hWnd, msg.message);
+
+        ok(PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE | PM_QS_POSTMESSAGE) &&
+           msg.message == WM_NULL && msg.wParam == 1,
+           "%p: got %u %Iu\n", hWnd, msg.message, msg.wParam);
+        ok(PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE | PM_QS_POSTMESSAGE) &&
+           msg.message == WM_APP && msg.wParam == 2,
+           "%p: got %u %Iu\n", hWnd, msg.message, msg.wParam);
+        ok(!PeekMessageW(&msg, hWnd, 0, 0, PM_NOREMOVE), "%p: got %u\n", hWnd, msg.message);
+    }
+}
+
+typedef enum _DRAIN_MODE
+{
+    DrainByWindow,
+    DrainByRange,
+    DrainAny
+} DRAIN_MODE;
+
+static ULONG
+DrainBatch(DRAIN_MODE Mode)
+{
+    MSG msg;
+    ULONG i, Count = 0;
+
+    /* Start with the messages posted last, the worst case of a linear scan */
+    for (i = WINDOW_COUNT; i-- > 0;)
+    {
+        switch (Mode)
+        {
+            case DrainByWindow:
+                while (PeekMessageW(&msg, hWindows[i], 0, 0, PM_REMOVE))
+                    Count++;
+                break;
+
+            case DrainByRange:
+                while (PeekMessageW(&msg, NULL, WM_APP + i, WM_APP + i, PM_REMOVE))
+                    Count++;
+                break;
+
+            case DrainAny:
+                while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+                    Count++;
+                break;
+        }
+    }
+
+    return Count;
+}
+
+static void
+Benchmark(DRAIN_MODE Mode, PCSTR Name)
+{
+    LARGE_INTEGER Frequency, Start, End, Total;
+    ULONG Posted, Drained = 0;
+    double Seconds;
+
+    FlushQueue();
+    Total.QuadPart = 0;
+    QueryPerformanceFrequency(&Frequency);
+
+    for (Posted = 0; Posted < BENCH_MESSAGES; Posted += BATCH_SIZE)
+    {
+        if (!PostBatch(BATCH_SIZE))
+            break;
+
+        QueryPerformanceCounter(&Start);
+        Drained += DrainBatch(Mode);
+        QueryPerformanceCounter(&End);
+        Total.QuadPart += End.QuadPart - Start.QuadPart;
+    }
+
+    ok(Posted == BENCH_MESSAGES, "%s: only %lu messages posted\n", Name, Posted);
+    ok(Drained == Posted, "%s: %lu messages drained out of %lu\n", Name, Drained, Posted);
+
+    Seconds = (double)Total.QuadPart / Frequency.QuadPart;
+    trace("%s: %lu messages in %.3f s, %.0f messages/s\n",
+          Name, Drained, Seconds, Seconds ? Drained / Seconds : 0.0);
+}
+
+START_TEST(PostMessageQueue)
+{
+    ULONG i;
+
+    for (i = 0; i < WINDOW_COUNT; i++)
+    {
+        hWindows[i] = CreateWindowExW(0, L"STATIC", L"PostMessageQueue", 0, 0, 0, 0, 0,
+                                      HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+        ok(hWindows[i] != NULL, "CreateWindowExW failed, error %lu\n", GetLastError());
+        if (!hWindows[i])
+            goto Cleanup;
+    }
+
+    TestOrder();
+    TestQueueStatusFilter();
+
+    Benchmark(DrainByWindow, "By window");
+    Benchmark(DrainByRange, "By range");
+    Benchmark(DrainAny, "No filter");
+
+Cleanup:
+    for (i = 0; i < WINDOW_COUNT; i++)
+    {
+        if (hWindows[i])
+            DestroyWindow(hWindows[i]);
+    }
+}
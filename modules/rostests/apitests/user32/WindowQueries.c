@@ -0,0 +1,217 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and multi-threaded benchmark for read-only window queries
+ */
+
+#include "precomp.h"
+
+#define MAX_THREADS     8
+#define QUERY_ROUNDS    20000
+
+static const WCHAR ClassName[] = L"WindowQueriesClass";
+static const WCHAR WindowText[] = L"Window queries";
+
+static HWND hwndOwner, hwndPopup, hwndChild;
+
+typedef struct _QUERY_THREAD
+{
+    HANDLE hThread;
+    HANDLE hStart;
+    ULONG Failures;
+} QUERY_THREAD, *PQUERY_THREAD;
+
+/* One round of queries, returns the number of unexpected results */
+static ULONG
+QueryRound(void)
+{
+    WNDCLASSEXW wcx;
+    WCHAR szText[64];
+    ULONG Failures = 0;
+
+    if (GetAncestor(hwndChild, GA_PARENT) != hwndPopup)
+        Failures++;
+    if (GetAncestor(hwndChild, GA_ROOT) != hwndPopup)
+        Failures++;
+    if (GetAncestor(hwndChild, GA_ROOTOWNER) != hwndOwner)
+        Failures++;
+    if (!IsWindowVisible(hwndChild))
+        Failures++;
+    if (GetWindowLongPtrW(hwndChild, GWLP_ID) != 1)
+        Failures++;
+    if (InternalGetWindowText(hwndChild, szText, _countof(szText)) != _countof(WindowText) - 1)
+        Failures++;
+    if (GetWindowThreadProcessId(hwndChild, NULL) == 0)
+        Failures++;
+
+    wcx.cbSize = sizeof(wcx);
+    if (!GetClassInfoExW(GetModuleHandleW(NULL), ClassName, &wcx))
+        Failures++;
+
+    return Failures;
+}
+
+static DWORD WINAPI
+QueryThread(LPVOID Parameter)
+{
+    PQUERY_THREAD Thread = Parameter;
+    ULONG i;
+
+    WaitForSingleObject(Thread->hStart, INFINITE);
+
+    for (i = 0; i < QUERY_ROUNDS; i++)
+        Thread->Failures += QueryRound();
+
+    return 0;
+}
+
+static void
+TestQueries(void)
+{
+    WNDCLASSEXW wcxW;
+    WNDCLASSEXA wcxA;
+    WCHAR szText[64];
+    HWND hwndMessage, hwndMessageRoot;
+    ATOM AtomW, AtomA;
+    INT Length;
+
+    ok(GetAncestor(hwndChild, GA_PARENT) == hwndPopup, "GA_PARENT: %p\n", GetAncestor(hwndChild, GA_PARENT));
+    ok(GetAncestor(hwndChild, GA_ROOT) == hwndPopup, "GA_ROOT: %p\n", GetAncestor(hwndChild, GA_ROOT));
+    ok(GetAncestor(hwndChild, GA_ROOTOWNER) == hwndOwner, "GA_ROOTOWNER: %p\n", GetAncestor(hwndChild, GA_ROOTOWNER));
+    ok(GetAncestor(hwndPopup, GA_ROOT) == hwndPopup, "GA_ROOT: %p\n", GetAncestor(hwndPopup, GA_ROOT));
+    ok(GetAncestor(hwndOwner, GA_ROOTOWNER) == hwndOwner, "GA_ROOTOWNER: %p\n", GetAncestor(hwndOwner, GA_ROOTOWNER));
+    ok(GetAncestor(GetDesktopWindow(), GA_ROOT) == NULL, "Desktop GA_ROOT: %p\n", GetAncestor(GetDesktopWindow(), GA_ROOT));
+    ok(GetAncestor(GetDesktopWindow(), GA_ROOTOWNER) == NULL, "Desktop GA_ROOTOWNER: %p\n", GetAncestor(GetDesktopWindow(), GA_ROOTOWNER));
+    ok(GetAncestor(hwndChild, 0) == NULL, "Invalid flag: %p\n", GetAncestor(hwndChild, 0));
+
+    /* The message-only root window has no parent either, but is not the desktop */
+    hwndMessage = CreateWindowExW(0, ClassName, NULL, 0, 0, 0, 0, 0,
+                                  HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    ok(hwndMessage != NULL, "CreateWindowExW failed, error %lu\n", GetLastError());
+    if (hwndMessage)
+    {
+        hwndMessageRoot = GetAncestor(hwndMessage, GA_PARENT);
+        ok(hwndMessageRoot != NULL && hwndMessageRoot != GetDesktopWindow(),
+           "Message GA_PARENT: %p\n", hwndMessageRoot);
+        ok(GetAncestor(hwndMessage, GA_ROOT) == hwndMessage,
+           "Message GA_ROOT: %p\n", GetAncestor(hwndMessage, GA_ROOT));
+        ok(GetAncestor(hwndMessage, GA_ROOTOWNER) == hwndMessage,
+           "Message GA_ROOTOWNER: %p\n", GetAncestor(hwndMessage, GA_ROOTOWNER));
+        ok(GetAncestor(hwndMessageRoot, GA_ROOT) == hwndMessageRoot,
+           "Message root GA_ROOT: %p\n", GetAncestor(hwndMessageRoot, GA_ROOT));
+        ok(GetAncestor(hwndMessageRoot, GA_ROOTOWNER) == hwndMessageRoot,
+           "Message root GA_ROOTOWNER: %p\n", GetAncestor(hwndMessageRoot, GA_ROOTOWNER));
+        DestroyWindow(hwndMessage);
+    }
+
+    /* Querying the Unicode class as ANSI has to wrap its wndproc */
+    wcxW.cbSize = sizeof(wcxW);
+    AtomW = (ATOM)GetClassInfoExW(GetModuleHandleW(NULL), ClassName, &wcxW);
+    ok(AtomW != 0, "GetClassInfoExW failed, error %lu\n", GetLastError());
+    ZeroMemory(&wcxA, sizeof(wcxA));
+    wcxA.cbSize = sizeof(wcxA);
+    AtomA = (ATOM)GetClassInfoExA(GetModuleHandleW(NULL), "WindowQueriesClass", &wcxA);
+    ok(AtomA == AtomW, "GetClassInfoExA returned %u instead of %u\n", AtomA, AtomW);
+    ok(wcxA.lpfnWndProc != NULL, "No ANSI wndproc\n");
+
+    Length = InternalGetWindowText(hwndChild, szText, _countof(szText));
+    ok(Length == _countof(WindowText) - 1, "Length = %d\n", Length);
+    ok(!wcscmp(szText, WindowText), "Text = %S\n", szText);
+
+    Length = InternalGetWindowText(hwndChild, szText, 7);
+    ok(Length == 6, "Length = %d\n", Length);
+    ok(!wcscmp(szText, L"Window"), "Text = %S\n", szText);
+
+    szText[0] = L'X';
+    Length = InternalGetWindowText(hwndOwner, szText, _countof(szText));
+    ok(Length == 0, "Length = %d\n", Length);
+    ok(szText[0] == UNICODE_NULL, "Text = %S\n", szText);
+
+    ok(QueryRound() == 0, "Unexpected query results\n");
+}
+
+static void
+Benchmark(ULONG ThreadCount)
+{
+    QUERY_THREAD Threads[MAX_THREADS];
+    HANDLE hStart, hThreads[MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG i, Failures = 0;
+    double Seconds;
+
+    hStart = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(hStart != NULL, "CreateEventW failed, error %lu\n", GetLastError());
+    if (!hStart)
+        return;
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Threads[i].hStart = hStart;
+        Threads[i].Failures = 0;
+        Threads[i].hThread = CreateThread(NULL, 0, QueryThread, &Threads[i], 0, NULL);
+        ok(Threads[i].hThread != NULL, "CreateThread failed, error %lu\n", GetLastError());
+        if (!Threads[i].hThread)
+        {
+            ThreadCount = i;
+            break;
+        }
+        hThreads[i] = Threads[i].hThread;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(hStart);
+    WaitForMultipleObjects(ThreadCount, hThreads, TRUE, INFINITE);
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Failures += Threads[i].Failures;
+        CloseHandle(Threads[i].hThread);
+    }
+    CloseHandle(hStart);
+
+    ok(Failures == 0, "%lu threads: %lu unexpected query results\n", ThreadCount, Failures);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("%lu threads: %.3f s, %.0f query rounds/s\n", ThreadCount, Seconds,
+          Seconds ? ThreadCount * QUERY_ROUNDS / Seconds : 0.0);
+}
+
+START_TEST(WindowQueries)
+{
+    WNDCLASSEXW wcx = { sizeof(wcx) };
+    SYSTEM_INFO SystemInfo;
+    ULONG ThreadCount;
+
+    wcx.lpfnWndProc = DefWindowProcW;
+    wcx.hInstance = GetModuleHandleW(NULL);
+    wcx.lpszClassName = ClassName;
+    ok(RegisterClassExW(&wcx) != 0, "RegisterClassExW failed, error %lu\n", GetLastError());
+
+    hwndOwner = CreateWindowExW(0, ClassName, NULL, WS_OVERLAPPEDWINDOW,
+                                0, 0, 100, 100, NULL, NULL, wcx.hInstance, NULL);
+    hwndPopup = CreateWindowExW(0, ClassName, NULL, WS_POPUP | WS_VISIBLE,
+                                0, 0, 100, 100, hwndOwner, NULL, wcx.hInstance, NULL);
+    hwndChild = CreateWindowExW(0, ClassName, WindowText, WS_CHILD | WS_VISIBLE,
+                                0, 0, 50, 50, hwndPopup, (HMENU)1, wcx.hInstance, NULL);
+    ok(hwndOwner && hwndPopup && hwndChild, "CreateWindowExW failed, error %lu\n", GetLastError());
+    if (!hwndOwner || !hwndPopup || !hwndChild)
+        goto Cleanup;
+
+    TestQueries();
+
+    /* Every thread runs the same queries, more threads should give more rounds per second */
+    GetSystemInfo(&SystemInfo);
+    for (ThreadCount = 1; ThreadCount <= MAX_THREADS; ThreadCount *= 2)
+    {
+        Benchmark(ThreadCount);
+        if (ThreadCount >= SystemInfo.dwNumberOfProcessors)
+            break;
+    }
+
+Cleanup:
+    if (hwndOwner)
+        DestroyWindow(hwndOwner);
+    UnregisterClassW(ClassName, wcx.hInstance);
+}
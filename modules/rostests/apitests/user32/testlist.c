@@ -29,6 +29,7 @@ extern void func_LoadImage(void);
 extern void func_LookupIconIdFromDirectoryEx(void);
 extern void func_MessageStateAnalyzer(void);
 extern void func_NextDlgItem(void);
+extern void func_PostMessageQueue(void);
 extern void func_PrivateExtractIcons(void);
 extern void func_RealGetWindowClass(void);
 extern void func_RedrawWindow(void);
@@ -47,6 +48,7 @@ extern void func_SetScrollRange(void);
 extern void func_SwitchToThisWindow(void);
 extern void func_SystemParametersInfo(void);
 extern void func_TrackMouseEvent(void);
+extern void func_WindowQueries(void);
 extern void func_WndProc(void);
 extern void func_wsprintf(void);
 
@@ -78,6 +80,7 @@ const struct test winetest_testlist[] =
     { "LookupIconIdFromDirectoryEx", func_LookupIconIdFromDirectoryEx },
     { "MessageStateAnalyzer", func_MessageStateAnalyzer },
     { "NextDlgItem", func_NextDlgItem },
+    { "PostMessageQueue", func_PostMessageQueue },
     { "PrivateExtractIcons", func_PrivateExtractIcons },
     { "RealGetWindowClass", func_RealGetWindowClass },
     { "RedrawWindow", func_RedrawWindow },
@@ -96,6 +99,7 @@ const struct test winetest_testlist[] =
     { "SwitchToThisWindow", func_SwitchToThisWindow },
     { "SystemParametersInfo", func_SystemParametersInfo },
     { "TrackMouseEvent", func_TrackMouseEvent },
+    { "WindowQueries", func_WindowQueries },
     { "WndProc", func_WndProc },
     { "wsprintfApi", func_wsprintf },
     { 0, 0 }
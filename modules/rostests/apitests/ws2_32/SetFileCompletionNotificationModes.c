@@ -0,0 +1,342 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test for SetFileCompletionNotificationModes on sockets
+ */
+
+#include "ws2_32.h"
+
+#ifndef FILE_SKIP_COMPLETION_PORT_ON_SUCCESS
+#define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS 0x1
+#define FILE_SKIP_SET_EVENT_ON_HANDLE        0x2
+#endif
+
+#define ECHO_MESSAGE_SIZE   64
+#define ECHO_ROUNDS         4096
+
+typedef BOOL (WINAPI *PSFCNM)(HANDLE, UCHAR);
+
+static PSFCNM pSetFileCompletionNotificationModes;
+
+typedef struct _ECHO_STATS
+{
+    ULONG Operations;
+    ULONG Pending;
+    ULONG Dequeued;
+} ECHO_STATS, *PECHO_STATS;
+
+static DWORD WINAPI
+EchoThread(LPVOID Parameter)
+{
+    SOCKET Socket = (SOCKET)Parameter;
+    char Buffer[ECHO_MESSAGE_SIZE];
+    int Received, Sent, Length;
+
+    for (;;)
+    {
+        Received = recv(Socket, Buffer, sizeof(Buffer), 0);
+        if (Received <= 0)
+            break;
+
+        for (Sent = 0; Sent < Received; Sent += Length)
+        {
+            Length = send(Socket, Buffer + Sent, Received - Sent, 0);
+            if (Length <= 0)
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+static BOOL
+CreateLoopbackPair(SOCKET *Client, SOCKET *Server)
+{
+    SOCKET Listener;
+    struct sockaddr_in Address;
+    int Length = sizeof(Address);
+
+    *Client = *Server = INVALID_SOCKET;
+
+    Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (Listener == INVALID_SOCKET)
+        return FALSE;
+
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(Listener, (struct sockaddr *)&Address, sizeof(Address)) ||
+        getsockname(Listener, (struct sockaddr *)&Address, &Length) ||
+        listen(Listener, 1))
+    {
+        closesocket(Listener);
+        return FALSE;
+    }
+
+    *Client = WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    if (*Client != INVALID_SOCKET &&
+        !connect(*Client, (struct sockaddr *)&Address, sizeof(Address)))
+    {
+        *Server = accept(Listener, NULL, NULL);
+    }
+
+    closesocket(Listener);
+
+    if (*Server == INVALID_SOCKET)
+    {
+        if (*Client != INVALID_SOCKET)
+            closesocket(*Client);
+        *Client = INVALID_SOCKET;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Waits for the operation if it pended, and eats its packet if there is one to eat */
+static BOOL
+CompleteOperation(HANDLE Port, int Result, BOOL Skip, LPOVERLAPPED Overlapped, PECHO_STATS Stats)
+{
+    DWORD Bytes;
+    ULONG_PTR Key;
+    LPOVERLAPPED Completed;
+
+    Stats->Operations++;
+
+    if (Result == SOCKET_ERROR)
+    {
+        if (WSAGetLastError() != WSA_IO_PENDING)
+            return FALSE;
+        Stats->Pending++;
+    }
+    else if (Skip)
+    {
+        /* Completed inline, nothing was queued */
+        return TRUE;
+    }
+
+    if (!GetQueuedCompletionStatus(Port, &Bytes, &Key, &Completed, 5000))
+        return FALSE;
+
+    Stats->Dequeued++;
+    return (Completed == Overlapped);
+}
+
+static BOOL
+RunEcho(SOCKET Client, HANDLE Port, BOOL Skip, PECHO_STATS Stats)
+{
+    char Message[ECHO_MESSAGE_SIZE], Reply[ECHO_MESSAGE_SIZE];
+    WSAOVERLAPPED Overlapped;
+    WSABUF Buffer;
+    DWORD Bytes, Flags;
+    ULONG Round, Received;
+    int Result;
+
+    memset(Stats, 0, sizeof(*Stats));
+    memset(Message, 'R', sizeof(Message));
+
+    for (Round = 0; Round < ECHO_ROUNDS; Round++)
+    {
+        memset(&Overlapped, 0, sizeof(Overlapped));
+        Buffer.buf = Message;
+        Buffer.len = sizeof(Message);
+        Result = WSASend(Client, &Buffer, 1, &Bytes, 0, &Overlapped, NULL);
+        if (!CompleteOperation(Port, Result, Skip, &Overlapped, Stats))
+            return FALSE;
+
+        for (Received = 0; Received < sizeof(Reply); Received += (ULONG)Overlapped.InternalHigh)
+        {
+            memset(&Overlapped, 0, sizeof(Overlapped));
+            Buffer.buf = Reply + Received;
+            Buffer.len = sizeof(Reply) - Received;
+            Flags = 0;
+            Result = WSARecv(Client, &Buffer, 1, &Bytes, &Flags, &Overlapped, NULL);
+            if (!CompleteOperation(Port, Result, Skip, &Overlapped, Stats))
+                return FALSE;
+            if (Overlapped.InternalHigh == 0)
+                return FALSE;
+        }
+
+        if (memcmp(Message, Reply, sizeof(Message)))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+BenchmarkEcho(SOCKET Client, HANDLE Port, BOOL Skip)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ECHO_STATS Stats;
+    DWORD Bytes;
+    ULONG_PTR Key;
+    LPOVERLAPPED Completed;
+    double Seconds;
+    BOOL Ret;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    Ret = RunEcho(Client, Port, Skip, &Stats);
+    QueryPerformanceCounter(&End);
+    ok(Ret, "Echo failed after %lu operations, error %d\n", Stats.Operations, WSAGetLastError());
+
+    /* Only the operations that pended may have queued a packet */
+    if (Skip)
+        ok(Stats.Dequeued == Stats.Pending, "%lu packets for %lu pending operations\n", Stats.Dequeued, Stats.Pending);
+    else
+        ok(Stats.Dequeued == Stats.Operations, "%lu packets for %lu operations\n", Stats.Dequeued, Stats.Operations);
+
+    /* And nothing must be left behind */
+    Completed = NULL;
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Completed, 0);
+    ok(Ret == FALSE && Completed == NULL, "Unexpected packet %p\n", Completed);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("%s: %lu operations, %lu pended, %lu packets (%lu saved), %.0f round trips/s\n",
+          Skip ? "Skip on success" : "Default", Stats.Operations, Stats.Pending,
+          Stats.Dequeued, Stats.Operations - Stats.Dequeued,
+          Seconds ? ECHO_ROUNDS / Seconds : 0.0);
+}
+
+/* Checks that the handle is not signaled by inline or pending I/O once asked not to be */
+static void
+TestSkipSetEvent(void)
+{
+    char Message[ECHO_MESSAGE_SIZE], Reply[ECHO_MESSAGE_SIZE];
+    SOCKET Client, Server;
+    WSAOVERLAPPED Overlapped;
+    LPOVERLAPPED Completed;
+    WSABUF Buffer;
+    DWORD Bytes, Flags, Wait;
+    ULONG_PTR Key;
+    HANDLE Port;
+    int Result;
+    BOOL Ret;
+
+    if (!CreateLoopbackPair(&Client, &Server))
+    {
+        skip("Could not create a loopback connection, error %d\n", WSAGetLastError());
+        return;
+    }
+
+    /* The packets let us wait for the operations without an event in the OVERLAPPED */
+    Port = CreateIoCompletionPort((HANDLE)Client, NULL, 0x5678, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed, error %lu\n", GetLastError());
+    if (!Port)
+        goto Cleanup;
+
+    memset(Message, 'E', sizeof(Message));
+
+    /* By default, an inline send signals the handle */
+    memset(&Overlapped, 0, sizeof(Overlapped));
+    Buffer.buf = Message;
+    Buffer.len = sizeof(Message);
+    Result = WSASend(Client, &Buffer, 1, &Bytes, 0, &Overlapped, NULL);
+    ok(Result == 0, "WSASend returned %d, error %d\n", Result, WSAGetLastError());
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Completed, 5000);
+    ok(Ret && Completed == &Overlapped, "Ret = %d, Completed = %p\n", Ret, Completed);
+    Wait = WaitForSingleObject((HANDLE)Client, 0);
+    ok(Wait == WAIT_OBJECT_0, "Wait = %lu\n", Wait);
+    ok(recv(Server, Reply, sizeof(Reply), 0) == sizeof(Reply), "recv failed, error %d\n", WSAGetLastError());
+
+    Ret = pSetFileCompletionNotificationModes((HANDLE)Client, FILE_SKIP_SET_EVENT_ON_HANDLE);
+    ok(Ret == TRUE, "SetFileCompletionNotificationModes failed, error %lu\n", GetLastError());
+    if (!Ret)
+        goto Cleanup;
+
+    /* An inline send must leave the handle alone */
+    memset(&Overlapped, 0, sizeof(Overlapped));
+    Buffer.buf = Message;
+    Buffer.len = sizeof(Message);
+    Result = WSASend(Client, &Buffer, 1, &Bytes, 0, &Overlapped, NULL);
+    ok(Result == 0, "WSASend returned %d, error %d\n", Result, WSAGetLastError());
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Completed, 5000);
+    ok(Ret && Completed == &Overlapped, "Ret = %d, Completed = %p\n", Ret, Completed);
+    Wait = WaitForSingleObject((HANDLE)Client, 0);
+    ok(Wait == WAIT_TIMEOUT, "Wait = %lu\n", Wait);
+    ok(recv(Server, Reply, sizeof(Reply), 0) == sizeof(Reply), "recv failed, error %d\n", WSAGetLastError());
+
+    /* And so must a receive that pends until the peer sends */
+    memset(&Overlapped, 0, sizeof(Overlapped));
+    Buffer.buf = Reply;
+    Buffer.len = sizeof(Reply);
+    Flags = 0;
+    Result = WSARecv(Client, &Buffer, 1, &Bytes, &Flags, &Overlapped, NULL);
+    ok(Result == SOCKET_ERROR && WSAGetLastError() == WSA_IO_PENDING,
+       "WSARecv returned %d, error %d\n", Result, WSAGetLastError());
+    ok(send(Server, Message, sizeof(Message), 0) == sizeof(Message), "send failed, error %d\n", WSAGetLastError());
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Completed, 5000);
+    ok(Ret && Completed == &Overlapped, "Ret = %d, Completed = %p\n", Ret, Completed);
+    ok(Bytes != 0, "Nothing received\n");
+    Wait = WaitForSingleObject((HANDLE)Client, 0);
+    ok(Wait == WAIT_TIMEOUT, "Wait = %lu\n", Wait);
+
+Cleanup:
+    closesocket(Client);
+    closesocket(Server);
+    if (Port)
+        CloseHandle(Port);
+}
+
+START_TEST(SetFileCompletionNotificationModes)
+{
+    WSADATA WsaData;
+    SOCKET Client, Server;
+    HANDLE Port, Thread;
+    BOOL Ret;
+
+    pSetFileCompletionNotificationModes = (PSFCNM)GetProcAddress(GetModuleHandleW(L"kernel32.dll"),
+                                                                 "SetFileCompletionNotificationModes");
+    if (!pSetFileCompletionNotificationModes)
+    {
+        skip("SetFileCompletionNotificationModes is not available\n");
+        return;
+    }
+
+    ok(WSAStartup(MAKEWORD(2, 2), &WsaData) == 0, "WSAStartup failed\n");
+
+    TestSkipSetEvent();
+
+    if (!CreateLoopbackPair(&Client, &Server))
+    {
+        skip("Could not create a loopback connection, error %d\n", WSAGetLastError());
+        WSACleanup();
+        return;
+    }
+
+    /* Invalid flags */
+    SetLastError(0xdeadbeef);
+    Ret = pSetFileCompletionNotificationModes((HANDLE)Client, 0x80);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "Error = %lu\n", GetLastError());
+
+    Port = CreateIoCompletionPort((HANDLE)Client, NULL, 0x1234, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed, error %lu\n", GetLastError());
+    Thread = CreateThread(NULL, 0, EchoThread, (LPVOID)Server, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed, error %lu\n", GetLastError());
+    if (!Port || !Thread)
+        goto Cleanup;
+
+    /* Every operation completes to the port by default */
+    BenchmarkEcho(Client, Port, FALSE);
+
+    Ret = pSetFileCompletionNotificationModes((HANDLE)Client,
+                                              FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                              FILE_SKIP_SET_EVENT_ON_HANDLE);
+    ok(Ret == TRUE, "SetFileCompletionNotificationModes failed, error %lu\n", GetLastError());
+    if (Ret)
+        BenchmarkEcho(Client, Port, TRUE);
+
+Cleanup:
+    closesocket(Client);
+    if (Thread)
+    {
+        WaitForSingleObject(Thread, 5000);
+        CloseHandle(Thread);
+    }
+    closesocket(Server);
+    if (Port)
+        CloseHandle(Port);
+    WSACleanup();
+}
@@ -16,6 +16,7 @@ extern void func_nostartup(void);
 extern void func_open_osfhandle(void);
 extern void func_recv(void);
 extern void func_send(void);
+extern void func_SetFileCompletionNotificationModes(void);
 extern void func_WSAAsync(void);
 extern void func_WSAIoctl(void);
 extern void func_WSARecv(void);
@@ -36,6 +37,7 @@ const struct test winetest_testlist[] =
     { "open_osfhandle", func_open_osfhandle },
     { "recv", func_recv },
     { "send", func_send },
+    { "SetFileCompletionNotificationModes", func_SetFileCompletionNotificationModes },
     { "WSAAsync", func_WSAAsync },
     { "WSAIoctl", func_WSAIoctl },
     { "WSARecv", func_WSARecv },
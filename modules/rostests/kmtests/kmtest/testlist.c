@@ -36,6 +36,7 @@ KMT_TESTFUNC Test_RtlUnicodeString;
 KMT_TESTFUNC Test_TcpIpIoctl;
 KMT_TESTFUNC Test_TcpIpTdi;
 KMT_TESTFUNC Test_TcpIpConnect;
+KMT_TESTFUNC Test_TcpIpChecksum;
 
 /* tests with a leading '-' will not be listed */
 const KMT_TEST TestList[] =
@@ -69,5 +70,6 @@ const KMT_TEST TestList[] =
     { "RtlUnicodeString",             Test_RtlUnicodeString },
     { "TcpIpTdi",                     Test_TcpIpTdi },
     { "TcpIpConnect",                 Test_TcpIpConnect },
+    { "TcpIpChecksum",                Test_TcpIpChecksum },
     { NULL,                           NULL },
 };
@@ -261,6 +261,75 @@ MapInAnotherThread(IN PVOID Context)
     return;
 }
 
+/* Time CcMapData on views which are already cached, as the file gets more of them */
+static
+VOID
+PerformLookupBenchmark(VOID)
+{
+    static const ULONG ViewCounts[] = { 16, 64, 256 };
+    CC_FILE_SIZES Sizes;
+    LARGE_INTEGER Offset, Start, End, Frequency;
+    ULONG i, View, Views, Iteration;
+    ULONG Seed = 0x1234;
+    ULONG Mapped;
+    PULONG Buffer;
+    PVOID Bcb;
+
+    for (i = 0; i < RTL_NUMBER_OF(ViewCounts); ++i)
+    {
+        Views = ViewCounts[i];
+
+        /* All the views have to fit in memory to stay cached */
+        if ((ULONGLONG)Views * VACB_MAPPING_GRANULARITY / 1024 / 1024 > Memory / 4)
+        {
+            skip(FALSE, "Not enough memory for %lu views\n", Views);
+            break;
+        }
+
+        Sizes.AllocationSize.QuadPart = (LONGLONG)Views * VACB_MAPPING_GRANULARITY;
+        Sizes.FileSize = Sizes.AllocationSize;
+        Sizes.ValidDataLength = Sizes.AllocationSize;
+        CcSetFileSizes(TestFileObject, &Sizes);
+
+        Mapped = 0;
+        KmtStartSeh();
+        for (View = 0; View < Views; ++View)
+        {
+            Offset.QuadPart = (LONGLONG)View * VACB_MAPPING_GRANULARITY;
+            if (!CcMapData(TestFileObject, &Offset, PAGE_SIZE, MAP_WAIT, &Bcb, (PVOID *)&Buffer))
+                break;
+
+            CcUnpinData(Bcb);
+            ++Mapped;
+        }
+        KmtEndSeh(STATUS_SUCCESS);
+        ok_eq_ulong(Mapped, Views);
+        if (Mapped != Views)
+            break;
+
+        Mapped = 0;
+        Start = KeQueryPerformanceCounter(&Frequency);
+        KmtStartSeh();
+        for (Iteration = 0; Iteration < 10000; ++Iteration)
+        {
+            View = RtlRandomEx(&Seed) % Views;
+            Offset.QuadPart = (LONGLONG)View * VACB_MAPPING_GRANULARITY;
+            if (!CcMapData(TestFileObject, &Offset, PAGE_SIZE, MAP_WAIT, &Bcb, (PVOID *)&Buffer))
+                break;
+
+            CcUnpinData(Bcb);
+            ++Mapped;
+        }
+        KmtEndSeh(STATUS_SUCCESS);
+        End = KeQueryPerformanceCounter(NULL);
+        ok_eq_ulong(Mapped, 10000);
+
+        trace("%lu views (%lu MB): %I64u ns per CcMapData\n",
+              Views, Views * (VACB_MAPPING_GRANULARITY / 1024) / 1024,
+              (End.QuadPart - Start.QuadPart) * 1000000000 / Frequency.QuadPart / 10000);
+    }
+}
+
 static
 VOID
 PerformTest(
@@ -443,6 +512,10 @@ PerformTest(
                         CcUnpinData(Bcb);
                     }
                 }
+                else if (TestId == 5)
+                {
+                    PerformLookupBenchmark();
+                }
             }
         }
     }
@@ -21,8 +21,9 @@ START_TEST(CcMapData)
     /* 3 tests for offset
      * 1 test for BCB
      * 1 test for length/offset
+     * 1 benchmark for the lookup of cached views
      */
-    for (TestId = 0; TestId < 5; ++TestId)
+    for (TestId = 0; TestId < 6; ++TestId)
     {
         Ret = KmtSendUlongToDriver(IOCTL_START_TEST, TestId);
         ok(Ret == ERROR_SUCCESS, "KmtSendUlongToDriver failed: %lx\n", Ret);
@@ -110,3 +110,15 @@ START_TEST(TcpIpConnect)
 
     WSACleanup();
 }
+
+START_TEST(TcpIpChecksum)
+{
+    DWORD Error;
+
+    LoadTcpIpTestDriver();
+
+    Error = KmtSendToDriver(IOCTL_TEST_CHECKSUM);
+    ok_eq_ulong(Error, ERROR_SUCCESS);
+
+    UnloadTcpIpTestDriver();
+}
@@ -0,0 +1,220 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:         Kernel-Mode Test Suite for the tcpip checksum routines
+ */
+
+#include <kmt_test.h>
+
+/* From the IP library */
+ULONG ChecksumFold(ULONG Sum);
+ULONG ChecksumCompute(PVOID Data, UINT Count, ULONG Seed);
+ULONG ChecksumCopy(PVOID Destination, PVOID Source, UINT Count, ULONG Seed);
+ULONG ChecksumAddBlock(ULONG Sum, ULONG BlockSum, UINT Offset);
+
+#define TEST_BUFFER_SIZE    2048
+#define BENCH_PACKET_SIZE   1500
+#define BENCH_ITERATIONS    20000
+
+/* Straight RFC 1071 sum of little-endian words, one byte at a time */
+static
+ULONG
+ReferenceChecksum(
+    _In_reads_bytes_(Count) PUCHAR Data,
+    _In_ ULONG Count)
+{
+    ULONG Sum = 0;
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+        Sum += (i & 1) ? (Data[i] << 8) : Data[i];
+
+    return ChecksumFold(Sum);
+}
+
+static
+VOID
+TestCompute(
+    _In_ PUCHAR Source)
+{
+    ULONG Offset, Length, Split, Expected, Sum;
+    BOOLEAN Passed = TRUE;
+
+    /* Every alignment, every tail length */
+    for (Offset = 0; Offset < 8 && Passed; Offset++)
+    {
+        for (Length = 0; Length < 300 && Passed; Length++)
+        {
+            Expected = ReferenceChecksum(Source + Offset, Length);
+            Sum = ChecksumFold(ChecksumCompute(Source + Offset, Length, 0));
+            ok(Sum == Expected, "Offset %lu, length %lu: 0x%lx, expected 0x%lx\n",
+               Offset, Length, Sum, Expected);
+            Passed = (Sum == Expected);
+        }
+    }
+
+    /* Large buffers */
+    Length = TEST_BUFFER_SIZE - 8;
+    Expected = ReferenceChecksum(Source + 3, Length);
+    ok_eq_ulong(ChecksumFold(ChecksumCompute(Source + 3, Length, 0)), Expected);
+
+    /* Chaining at even offsets through the seed, at any offset by blocks */
+    Expected = ReferenceChecksum(Source + 1, 1000);
+    for (Split = 0; Split <= 1000; Split++)
+    {
+        if (!(Split & 1))
+        {
+            Sum = ChecksumCompute(Source + 1, Split, 0);
+            Sum = ChecksumCompute(Source + 1 + Split, 1000 - Split, Sum);
+            ok(ChecksumFold(Sum) == Expected, "Seed split %lu: 0x%lx, expected 0x%lx\n",
+               Split, ChecksumFold(Sum), Expected);
+        }
+
+        Sum = ChecksumAddBlock(ChecksumCompute(Source + 1, Split, 0),
+                               ChecksumCompute(Source + 1 + Split, 1000 - Split, 0),
+                               Split);
+        ok(ChecksumFold(Sum) == Expected, "Block split %lu: 0x%lx, expected 0x%lx\n",
+           Split, ChecksumFold(Sum), Expected);
+        if (ChecksumFold(Sum) != Expected)
+            break;
+    }
+
+    /* All ones and all zeroes */
+    RtlFillMemory(Source, TEST_BUFFER_SIZE, 0xFF);
+    ok_eq_ulong(ChecksumFold(ChecksumCompute(Source, TEST_BUFFER_SIZE, 0)), 0xFFFFUL);
+    RtlZeroMemory(Source, TEST_BUFFER_SIZE);
+    ok_eq_ulong(ChecksumFold(ChecksumCompute(Source, TEST_BUFFER_SIZE, 0)), 0UL);
+}
+
+static
+VOID
+TestCopy(
+    _In_ PUCHAR Source,
+    _In_ PUCHAR Destination)
+{
+    ULONG SourceOffset, DestinationOffset, Length, Expected, Sum;
+    BOOLEAN Passed = TRUE;
+
+    /* Same and different alignments of both buffers */
+    for (SourceOffset = 0; SourceOffset < 4 && Passed; SourceOffset++)
+    {
+        for (DestinationOffset = 0; DestinationOffset < 4 && Passed; DestinationOffset++)
+        {
+            for (Length = 0; Length < 200 && Passed; Length++)
+            {
+                RtlFillMemory(Destination, TEST_BUFFER_SIZE, 0xCC);
+                Expected = ReferenceChecksum(Source + SourceOffset, Length);
+                Sum = ChecksumFold(ChecksumCopy(Destination + 8 + DestinationOffset,
+                                                Source + SourceOffset,
+                                                Length,
+                                                0));
+                ok(Sum == Expected, "Offsets %lu/%lu, length %lu: 0x%lx, expected 0x%lx\n",
+                   SourceOffset, DestinationOffset, Length, Sum, Expected);
+                ok(RtlCompareMemory(Destination + 8 + DestinationOffset,
+                                    Source + SourceOffset,
+                                    Length) == Length,
+                   "Offsets %lu/%lu, length %lu: bad copy\n",
+                   SourceOffset, DestinationOffset, Length);
+                ok(Destination[7 + DestinationOffset] == 0xCC &&
+                   Destination[8 + DestinationOffset + Length] == 0xCC,
+                   "Offsets %lu/%lu, length %lu: copied out of bounds\n",
+                   SourceOffset, DestinationOffset, Length);
+                Passed = (Sum == Expected);
+            }
+        }
+    }
+}
+
+static
+ULONGLONG
+MegabytesPerSecond(
+    _In_ LARGE_INTEGER Start,
+    _In_ LARGE_INTEGER End,
+    _In_ LARGE_INTEGER Frequency)
+{
+    ULONGLONG Bytes = (ULONGLONG)BENCH_PACKET_SIZE * BENCH_ITERATIONS;
+    ULONGLONG Ticks = End.QuadPart - Start.QuadPart;
+
+    if (Ticks == 0)
+        return 0;
+
+    return Bytes * Frequency.QuadPart / Ticks / (1024 * 1024);
+}
+
+static
+VOID
+BenchmarkChecksum(
+    _In_ PUCHAR Source,
+    _In_ PUCHAR Destination)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    volatile ULONG Sink = 0;
+    ULONG i;
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+        Sink += ReferenceChecksum(Source, BENCH_PACKET_SIZE);
+    End = KeQueryPerformanceCounter(NULL);
+    trace("Byte by byte:           %I64u MB/s\n", MegabytesPerSecond(Start, End, Frequency));
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+        Sink += ChecksumCompute(Source, BENCH_PACKET_SIZE, 0);
+    End = KeQueryPerformanceCounter(NULL);
+    trace("ChecksumCompute:        %I64u MB/s\n", MegabytesPerSecond(Start, End, Frequency));
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        RtlCopyMemory(Destination, Source, BENCH_PACKET_SIZE);
+        Sink += ChecksumCompute(Destination, BENCH_PACKET_SIZE, 0);
+    }
+    End = KeQueryPerformanceCounter(NULL);
+    trace("Copy, then checksum:    %I64u MB/s\n", MegabytesPerSecond(Start, End, Frequency));
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+        Sink += ChecksumCopy(Destination, Source, BENCH_PACKET_SIZE, 0);
+    End = KeQueryPerformanceCounter(NULL);
+    trace("ChecksumCopy:           %I64u MB/s\n", MegabytesPerSecond(Start, End, Frequency));
+}
+
+KMT_MESSAGE_HANDLER TestChecksum;
+NTSTATUS
+TestChecksum(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ ULONG ControlCode,
+    _In_opt_ PVOID Buffer,
+    _In_ SIZE_T InLength,
+    _Inout_ PSIZE_T OutLength)
+{
+    PUCHAR Source, Destination;
+    ULONG Seed = 0x5EED;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(ControlCode);
+    UNREFERENCED_PARAMETER(Buffer);
+    UNREFERENCED_PARAMETER(InLength);
+    UNREFERENCED_PARAMETER(OutLength);
+
+    Source = ExAllocatePoolWithTag(NonPagedPool, TEST_BUFFER_SIZE, 'sCmK');
+    Destination = ExAllocatePoolWithTag(NonPagedPool, TEST_BUFFER_SIZE, 'sCmK');
+    if (skip(Source != NULL && Destination != NULL, "Out of memory\n"))
+        goto Cleanup;
+
+    for (i = 0; i < TEST_BUFFER_SIZE; i++)
+        Source[i] = (UCHAR)RtlRandomEx(&Seed);
+
+    BenchmarkChecksum(Source, Destination);
+    TestCopy(Source, Destination);
+    TestCompute(Source);
+
+Cleanup:
+    if (Source)
+        ExFreePoolWithTag(Source, 'sCmK');
+    if (Destination)
+        ExFreePoolWithTag(Destination, 'sCmK');
+
+    return STATUS_SUCCESS;
+}
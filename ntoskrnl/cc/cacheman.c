@@ -151,7 +151,7 @@ CcRemapBcb (
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
@@ -162,98 +162,140 @@ CcScheduleReadAhead (
 	)
 {
     KIRQL OldIrql;
-    LARGE_INTEGER NewOffset;
+    LONGLONG NewOffset, Stride, Ahead;
+    LONGLONG ReadOffset, ReadStride;
+    ULONG ReadLength, ReadCount, Strides;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
+    PROS_PRIVATE_CACHE_MAP RosPrivateCacheMap;
+    PWORK_QUEUE_ENTRY WorkItem;
 
     SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
     PrivateCacheMap = FileObject->PrivateCacheMap;
 
     /* If file isn't cached, or if read ahead is disabled, this is no op */
-    if (SharedCacheMap == NULL || PrivateCacheMap == NULL ||
+    if (SharedCacheMap == NULL || PrivateCacheMap == NULL || Length == 0 ||
         BooleanFlagOn(SharedCacheMap->Flags, READAHEAD_DISABLED))
     {
         return;
     }
 
+    RosPrivateCacheMap = CONTAINING_RECORD(PrivateCacheMap, ROS_PRIVATE_CACHE_MAP, Map);
+
     /* Round read length with read ahead mask */
     Length = ROUND_UP(Length, PrivateCacheMap->ReadAheadMask + 1);
     /* Compute the offset we'll reach */
-    NewOffset.QuadPart = FileOffset->QuadPart + Length;
+    NewOffset = FileOffset->QuadPart + Length;
 
     /* Lock read ahead spin lock */
     KeAcquireSpinLock(&PrivateCacheMap->ReadAheadSpinLock, &OldIrql);
-    /* Easy case: the file is sequentially read */
-    if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY))
+
+    /* The read history still describes the previous read */
+    Stride = FileOffset->QuadPart - PrivateCacheMap->FileOffset2.QuadPart;
+
+    if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY) ||
+        (FileOffset->QuadPart >= PrivateCacheMap->FileOffset2.QuadPart &&
+         FileOffset->QuadPart <= PrivateCacheMap->BeyondLastByte2.QuadPart))
     {
-        /* If we went backward, this is no go! */
-        if (NewOffset.QuadPart < PrivateCacheMap->ReadAheadOffset[1].QuadPart)
+        /* Sequential read: keep a window of data ahead of the reader,
+         * and only refill it once half of it was consumed
+         */
+        if (RosPrivateCacheMap->ReadAheadEnd < NewOffset)
+        {
+            RosPrivateCacheMap->ReadAheadEnd = NewOffset;
+        }
+
+        if (RosPrivateCacheMap->ReadAheadEnd - NewOffset > RosPrivateCacheMap->ReadAheadWindow / 2)
         {
             KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
             return;
         }
 
-        /* FIXME: hackish, but will do the job for now */
-        PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-        PrivateCacheMap->ReadAheadLength[1] = Length;
+        ReadOffset = RosPrivateCacheMap->ReadAheadEnd;
+        ReadLength = (ULONG)(NewOffset + RosPrivateCacheMap->ReadAheadWindow - ReadOffset);
+        ReadStride = 0;
+        ReadCount = 1;
     }
-    /* Other cases: try to find some logic in that mess... */
-    else
+    else if (Stride != 0 && Stride == RosPrivateCacheMap->ReadAheadStride)
     {
-        /* Let's check if we always read the same way (like going down in the file)
-         * and pretend it's enough for now
+        /* Strided read, forward or backward: read the next blocks the
+         * reader will ask for, as many as fit in the window
          */
-        if (PrivateCacheMap->FileOffset2.QuadPart >= PrivateCacheMap->FileOffset1.QuadPart &&
-            FileOffset->QuadPart >= PrivateCacheMap->FileOffset2.QuadPart)
+        Strides = max(1, min(RosPrivateCacheMap->ReadAheadWindow / Length, 16));
+
+        Ahead = RosPrivateCacheMap->ReadAheadEnd - FileOffset->QuadPart;
+        if (Ahead % Stride != 0 || Ahead / Stride < 1)
         {
-            /* FIXME: hackish, but will do the job for now */
-            PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-            PrivateCacheMap->ReadAheadLength[1] = Length;
+            RosPrivateCacheMap->ReadAheadEnd = FileOffset->QuadPart + Stride;
+            Ahead = Stride;
         }
-        else
+
+        /* Blocks which were already scheduled, not counting the one at ReadAheadEnd */
+        Ahead = Ahead / Stride - 1;
+        if (Ahead > Strides / 2)
         {
-            /* FIXME: handle the other cases */
             KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
-            UNIMPLEMENTED_ONCE;
             return;
         }
-    }
 
-    /* If read ahead isn't active yet */
-    if (!PrivateCacheMap->Flags.ReadAheadActive)
+        ReadOffset = RosPrivateCacheMap->ReadAheadEnd;
+        ReadLength = Length;
+        ReadStride = Stride;
+        ReadCount = Strides - (ULONG)Ahead;
+    }
+    else
     {
-        PWORK_QUEUE_ENTRY WorkItem;
-
-        /* It's active now!
-         * Be careful with the mask, you don't want to mess with node code
-         */
-        InterlockedOr((volatile long *)&PrivateCacheMap->UlongFlags, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        /* No pattern (yet), start over */
+        RosPrivateCacheMap->ReadAheadStride = Stride;
+        RosPrivateCacheMap->ReadAheadEnd = 0;
+        RosPrivateCacheMap->ReadAheadWindow = CC_READ_AHEAD_MIN_WINDOW;
         KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+        return;
+    }
 
-        /* Get a work item */
-        WorkItem = ExAllocateFromNPagedLookasideList(&CcTwilightLookasideList);
-        if (WorkItem != NULL)
-        {
-            /* Reference our FO so that it doesn't go in between */
-            ObReferenceObject(FileObject);
-
-            /* We want to do read ahead! */
-            WorkItem->Function = ReadAhead;
-            WorkItem->Parameters.Read.FileObject = FileObject;
-
-            /* Queue in the read ahead dedicated queue */
-            CcPostWorkQueue(WorkItem, &CcExpressWorkQueue);
+    RosPrivateCacheMap->ReadAheadStride = Stride;
 
-            return;
-        }
+    /* Don't queue more, the reader will try again on its next read */
+    if (RosPrivateCacheMap->ReadAheadsInFlight >= CC_READ_AHEAD_MAX_IN_FLIGHT)
+    {
+        KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+        return;
+    }
 
-        /* Fail path: lock again, and revert read ahead active */
-        KeAcquireSpinLock(&PrivateCacheMap->ReadAheadSpinLock, &OldIrql);
-        InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+    /* Get a work item */
+    WorkItem = ExAllocateFromNPagedLookasideList(&CcTwilightLookasideList);
+    if (WorkItem == NULL)
+    {
+        KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+        return;
     }
 
-    /* Done (fail) */
+    /* The next window starts after this one, and is larger */
+    RosPrivateCacheMap->ReadAheadEnd = ReadOffset + (LONGLONG)ReadCount * (ReadStride != 0 ? ReadStride : ReadLength);
+    RosPrivateCacheMap->ReadAheadWindow = min(RosPrivateCacheMap->ReadAheadWindow * 2, CC_READ_AHEAD_MAX_WINDOW);
+    PrivateCacheMap->ReadAheadOffset[1].QuadPart = ReadOffset;
+    PrivateCacheMap->ReadAheadLength[1] = ReadLength;
+
+    /* It's active now!
+     * Be careful with the mask, you don't want to mess with node code
+     */
+    RosPrivateCacheMap->ReadAheadsInFlight++;
+    InterlockedOr((volatile long *)&PrivateCacheMap->UlongFlags, PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
     KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+
+    /* Reference our FO so that it doesn't go in between */
+    ObReferenceObject(FileObject);
+
+    /* We want to do read ahead! */
+    WorkItem->Function = ReadAhead;
+    WorkItem->Parameters.Read.FileObject = FileObject;
+    WorkItem->Parameters.Read.FileOffset = ReadOffset;
+    WorkItem->Parameters.Read.Stride = ReadStride;
+    WorkItem->Parameters.Read.Length = ReadLength;
+    WorkItem->Parameters.Read.Count = ReadCount;
+
+    /* Queue in the read ahead dedicated queue */
+    CcPostWorkQueue(WorkItem, &CcExpressWorkQueue);
 }
 
 /*
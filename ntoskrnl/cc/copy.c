@@ -27,6 +27,20 @@ typedef enum _CC_COPY_OPERATION
     CcOperationZero
 } CC_COPY_OPERATION;
 
+/* A VACB read in progress */
+typedef struct _CC_VACB_READ
+{
+    PROS_VACB Vacb;
+    PMDL Mdl;
+    ULONG Size;
+    NTSTATUS Status;
+    KEVENT Event;
+    IO_STATUS_BLOCK IoStatus;
+} CC_VACB_READ, *PCC_VACB_READ;
+
+/* How many VACB reads a read ahead keeps in flight */
+#define CC_READ_AHEAD_MAX_READS 8
+
 typedef enum _CC_CAN_WRITE_RETRY
 {
     FirstTry = 0,
@@ -50,6 +64,18 @@ ULONG CcFastReadResourceMiss;
 ULONG CcDataPages = 0;
 ULONG CcDataFlushes = 0;
 
+/* Counters:
+ * - Number of VACBs read by read ahead
+ * - Number of VACBs read by read ahead which were then copied from
+ * - Number of VACBs which had to be read by a copy read
+ */
+ULONG CcReadAheadIos = 0;
+ULONG CcReadAheadHits = 0;
+ULONG CcReadAheadMisses = 0;
+
+/* Number of writes which covered several VACBs */
+ULONG CcClusteredWrites = 0;
+
 /* FUNCTIONS *****************************************************************/
 
 VOID
@@ -76,16 +102,16 @@ CcInitCacheZeroPage (
     MiZeroPhysicalPage(CcZeroPage);
 }
 
+/* Starts reading the data of a VACB, finish it with CcEndReadVirtualAddress */
+static
 NTSTATUS
-NTAPI
-CcReadVirtualAddress (
-    PROS_VACB Vacb)
+CcBeginReadVirtualAddress (
+    PROS_VACB Vacb,
+    PCC_VACB_READ Read)
 {
     ULONG Size;
     PMDL Mdl;
     NTSTATUS Status;
-    IO_STATUS_BLOCK IoStatus;
-    KEVENT Event;
     ULARGE_INTEGER LargeSize;
 
     LargeSize.QuadPart = Vacb->SharedCacheMap->SectionSize.QuadPart - Vacb->FileOffset.QuadPart;
@@ -117,21 +143,33 @@ CcReadVirtualAddress (
         KeBugCheck(CACHE_MANAGER);
     } _SEH2_END;
 
-    if (NT_SUCCESS(Status))
-    {
-        Mdl->MdlFlags |= MDL_IO_PAGE_READ;
-        KeInitializeEvent(&Event, NotificationEvent, FALSE);
-        Status = IoPageRead(Vacb->SharedCacheMap->FileObject, Mdl, &Vacb->FileOffset, &Event, &IoStatus);
-        if (Status == STATUS_PENDING)
-        {
-            KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
-            Status = IoStatus.Status;
-        }
+    Read->Vacb = Vacb;
+    Read->Mdl = Mdl;
+    Read->Size = Size;
+
+    Mdl->MdlFlags |= MDL_IO_PAGE_READ;
+    KeInitializeEvent(&Read->Event, NotificationEvent, FALSE);
+    Read->Status = IoPageRead(Vacb->SharedCacheMap->FileObject, Mdl, &Vacb->FileOffset, &Read->Event, &Read->IoStatus);
 
-        MmUnlockPages(Mdl);
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+CcEndReadVirtualAddress (
+    PCC_VACB_READ Read)
+{
+    NTSTATUS Status;
+
+    Status = Read->Status;
+    if (Status == STATUS_PENDING)
+    {
+        KeWaitForSingleObject(&Read->Event, Executive, KernelMode, FALSE, NULL);
+        Status = Read->IoStatus.Status;
     }
 
-    IoFreeMdl(Mdl);
+    MmUnlockPages(Read->Mdl);
+    IoFreeMdl(Read->Mdl);
 
     if (!NT_SUCCESS(Status) && (Status != STATUS_END_OF_FILE))
     {
@@ -139,10 +177,10 @@ CcReadVirtualAddress (
         return Status;
     }
 
-    if (Size < VACB_MAPPING_GRANULARITY)
+    if (Read->Size < VACB_MAPPING_GRANULARITY)
     {
-        RtlZeroMemory((char*)Vacb->BaseAddress + Size,
-                      VACB_MAPPING_GRANULARITY - Size);
+        RtlZeroMemory((char*)Read->Vacb->BaseAddress + Read->Size,
+                      VACB_MAPPING_GRANULARITY - Read->Size);
     }
 
     return STATUS_SUCCESS;
@@ -150,77 +188,172 @@ CcReadVirtualAddress (
 
 NTSTATUS
 NTAPI
-CcWriteVirtualAddress (
+CcReadVirtualAddress (
     PROS_VACB Vacb)
 {
-    ULONG Size;
+    CC_VACB_READ Read;
+    NTSTATUS Status;
+
+    Status = CcBeginReadVirtualAddress(Vacb, &Read);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    return CcEndReadVirtualAddress(&Read);
+}
+
+/* Writes the data of adjacent VACBs, in file offset order, with a single write */
+NTSTATUS
+NTAPI
+CcWriteVirtualAddresses (
+    PROS_VACB *Vacbs,
+    ULONG Count)
+{
+    ULONG Size, TotalSize;
+    PMDL Mdls[CC_WRITE_CLUSTER_VACBS];
     PMDL Mdl;
     NTSTATUS Status;
     IO_STATUS_BLOCK IoStatus;
     KEVENT Event;
     ULARGE_INTEGER LargeSize;
+    PPFN_NUMBER Pfns;
+    ULONG Locked, i;
 
-    LargeSize.QuadPart = Vacb->SharedCacheMap->SectionSize.QuadPart - Vacb->FileOffset.QuadPart;
-    if (LargeSize.QuadPart > VACB_MAPPING_GRANULARITY)
-    {
-        LargeSize.QuadPart = VACB_MAPPING_GRANULARITY;
-    }
-    Size = LargeSize.LowPart;
-    //
-    // Nonpaged pool PDEs in ReactOS must actually be synchronized between the
-    // MmGlobalPageDirectory and the real system PDE directory. What a mess...
-    //
+    ASSERT(Count > 0 && Count <= CC_WRITE_CLUSTER_VACBS);
+
+    TotalSize = 0;
+    Status = STATUS_SUCCESS;
+    for (Locked = 0; Locked < Count; Locked++)
     {
-        ULONG i = 0;
-        do
+        PROS_VACB Vacb = Vacbs[Locked];
+
+        LargeSize.QuadPart = Vacb->SharedCacheMap->SectionSize.QuadPart - Vacb->FileOffset.QuadPart;
+        if (LargeSize.QuadPart > VACB_MAPPING_GRANULARITY)
         {
-            MmGetPfnForProcess(NULL, (PVOID)((ULONG_PTR)Vacb->BaseAddress + (i << PAGE_SHIFT)));
-        } while (++i < (Size >> PAGE_SHIFT));
-    }
+            LargeSize.QuadPart = VACB_MAPPING_GRANULARITY;
+        }
+        Size = LargeSize.LowPart;
+        //
+        // Nonpaged pool PDEs in ReactOS must actually be synchronized between the
+        // MmGlobalPageDirectory and the real system PDE directory. What a mess...
+        //
+        {
+            ULONG j = 0;
+            do
+            {
+                MmGetPfnForProcess(NULL, (PVOID)((ULONG_PTR)Vacb->BaseAddress + (j << PAGE_SHIFT)));
+            } while (++j < (Size >> PAGE_SHIFT));
+        }
 
-    ASSERT(Size <= VACB_MAPPING_GRANULARITY);
-    ASSERT(Size > 0);
+        ASSERT(Size <= VACB_MAPPING_GRANULARITY);
+        ASSERT(Size > 0);
+        /* Only the last VACB of a cluster may be partial */
+        ASSERT(Locked == Count - 1 || Size == VACB_MAPPING_GRANULARITY);
+        ASSERT(Locked == 0 ||
+               Vacb->FileOffset.QuadPart == Vacbs[0]->FileOffset.QuadPart + TotalSize);
 
-    Mdl = IoAllocateMdl(Vacb->BaseAddress, Size, FALSE, FALSE, NULL);
-    if (!Mdl)
-    {
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
+        Mdls[Locked] = IoAllocateMdl(Vacb->BaseAddress, Size, FALSE, FALSE, NULL);
+        if (!Mdls[Locked])
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            break;
+        }
 
-    Status = STATUS_SUCCESS;
-    _SEH2_TRY
-    {
-        MmProbeAndLockPages(Mdl, KernelMode, IoReadAccess);
+        _SEH2_TRY
+        {
+            MmProbeAndLockPages(Mdls[Locked], KernelMode, IoReadAccess);
+        }
+        _SEH2_EXCEPT (EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+            DPRINT1("MmProbeAndLockPages failed with: %lx for %p (%p, %p)\n", Status, Mdls[Locked], Vacb, Vacb->BaseAddress);
+            KeBugCheck(CACHE_MANAGER);
+        } _SEH2_END;
+
+        TotalSize += Size;
     }
-    _SEH2_EXCEPT (EXCEPTION_EXECUTE_HANDLER)
-    {
-        Status = _SEH2_GetExceptionCode();
-        DPRINT1("MmProbeAndLockPages failed with: %lx for %p (%p, %p)\n", Status, Mdl, Vacb, Vacb->BaseAddress);
-        KeBugCheck(CACHE_MANAGER);
-    } _SEH2_END;
 
     if (NT_SUCCESS(Status))
     {
-        KeInitializeEvent(&Event, NotificationEvent, FALSE);
-        Status = IoSynchronousPageWrite(Vacb->SharedCacheMap->FileObject, Mdl, &Vacb->FileOffset, &Event, &IoStatus);
-        if (Status == STATUS_PENDING)
+        if (Count == 1)
         {
-            KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
-            Status = IoStatus.Status;
+            Mdl = Mdls[0];
+        }
+        else
+        {
+            /* The VACBs aren't mapped next to each other, so describe the
+             * whole range with the physical pages the VACB MDLs locked
+             */
+            Mdl = IoAllocateMdl(Vacbs[0]->BaseAddress, TotalSize, FALSE, FALSE, NULL);
+            if (Mdl != NULL)
+            {
+                Pfns = MmGetMdlPfnArray(Mdl);
+                for (i = 0; i < Count; i++)
+                {
+                    Size = BYTES_TO_PAGES(Mdls[i]->ByteCount);
+                    RtlCopyMemory(Pfns, MmGetMdlPfnArray(Mdls[i]), Size * sizeof(PFN_NUMBER));
+                    Pfns += Size;
+                }
+                Mdl->MdlFlags |= MDL_PAGES_LOCKED;
+            }
         }
 
-        MmUnlockPages(Mdl);
+        if (Mdl == NULL)
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+        else
+        {
+            KeInitializeEvent(&Event, NotificationEvent, FALSE);
+            Status = IoSynchronousPageWrite(Vacbs[0]->SharedCacheMap->FileObject, Mdl, &Vacbs[0]->FileOffset, &Event, &IoStatus);
+            if (Status == STATUS_PENDING)
+            {
+                KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
+                Status = IoStatus.Status;
+            }
+
+            /* The cluster MDL doesn't own its pages, the VACB MDLs do */
+            if (Mdl != Mdls[0])
+            {
+                if (Mdl->MdlFlags & MDL_MAPPED_TO_SYSTEM_VA)
+                {
+                    MmUnmapLockedPages(Mdl->MappedSystemVa, Mdl);
+                }
+                Mdl->MdlFlags &= ~MDL_PAGES_LOCKED;
+                IoFreeMdl(Mdl);
+            }
+        }
+    }
+
+    for (i = 0; i < Locked; i++)
+    {
+        MmUnlockPages(Mdls[i]);
+        IoFreeMdl(Mdls[i]);
     }
-    IoFreeMdl(Mdl);
+
     if (!NT_SUCCESS(Status) && (Status != STATUS_END_OF_FILE))
     {
         DPRINT1("IoPageWrite failed, Status %x\n", Status);
         return Status;
     }
 
+    if (Count > 1)
+    {
+        ++CcClusteredWrites;
+    }
+
     return STATUS_SUCCESS;
 }
 
+NTSTATUS
+NTAPI
+CcWriteVirtualAddress (
+    PROS_VACB Vacb)
+{
+    return CcWriteVirtualAddresses(&Vacb, 1);
+}
+
 NTSTATUS
 ReadWriteOrZero(
     _Inout_ PVOID BaseAddress,
@@ -253,6 +386,24 @@ ReadWriteOrZero(
     return Status;
 }
 
+/* Accounts for whether read ahead brought the data in before a copy read needed it */
+static
+VOID
+CcUpdateReadAheadCounters (
+    PROS_VACB Vacb,
+    BOOLEAN Valid)
+{
+    if (!Valid)
+    {
+        ++CcReadAheadMisses;
+    }
+    else if (Vacb->ReadAhead)
+    {
+        Vacb->ReadAhead = FALSE;
+        ++CcReadAheadHits;
+    }
+}
+
 BOOLEAN
 CcCopyData (
     _In_ PFILE_OBJECT FileObject,
@@ -268,7 +419,7 @@ CcCopyData (
     ULONG BytesCopied;
     KIRQL OldIrql;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
-    PLIST_ENTRY ListEntry;
+    LONGLONG ViewOffset;
     PROS_VACB Vacb;
     ULONG PartialLength;
     PVOID BaseAddress;
@@ -285,25 +436,18 @@ CcCopyData (
         /* test if the requested data is available */
         KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &OldIrql);
         /* FIXME: this loop doesn't take into account areas that don't have
-         * a VACB in the list yet */
-        ListEntry = SharedCacheMap->CacheMapVacbListHead.Flink;
-        while (ListEntry != &SharedCacheMap->CacheMapVacbListHead)
+         * a VACB yet */
+        for (ViewOffset = ROUND_DOWN(CurrentOffset, VACB_MAPPING_GRANULARITY);
+             ViewOffset < CurrentOffset + Length;
+             ViewOffset += VACB_MAPPING_GRANULARITY)
         {
-            Vacb = CONTAINING_RECORD(ListEntry,
-                                     ROS_VACB,
-                                     CacheMapVacbListEntry);
-            ListEntry = ListEntry->Flink;
-            if (!Vacb->Valid &&
-                DoRangesIntersect(Vacb->FileOffset.QuadPart,
-                                  VACB_MAPPING_GRANULARITY,
-                                  CurrentOffset, Length))
+            Vacb = CcRosFindVacbInIndex(SharedCacheMap, ViewOffset);
+            if (Vacb != NULL && !Vacb->Valid)
             {
                 KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, OldIrql);
                 /* data not available */
                 return FALSE;
             }
-            if (Vacb->FileOffset.QuadPart >= CurrentOffset + Length)
-                break;
         }
         KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, OldIrql);
     }
@@ -320,6 +464,8 @@ CcCopyData (
                                   &Vacb);
         if (!NT_SUCCESS(Status))
             ExRaiseStatus(Status);
+        if (Operation == CcOperationRead)
+            CcUpdateReadAheadCounters(Vacb, Valid);
         if (!Valid)
         {
             Status = CcReadVirtualAddress(Vacb);
@@ -358,6 +504,8 @@ CcCopyData (
                                   &Vacb);
         if (!NT_SUCCESS(Status))
             ExRaiseStatus(Status);
+        if (Operation == CcOperationRead)
+            CcUpdateReadAheadCounters(Vacb, Valid);
         if (!Valid &&
             (Operation == CcOperationRead ||
              PartialLength < VACB_MAPPING_GRANULARITY))
@@ -387,11 +535,10 @@ CcCopyData (
     /* If that was a successful sync read operation, let's handle read ahead */
     if (Operation == CcOperationRead && Length == 0 && Wait)
     {
-        /* If file isn't random access and next read may get us cross VACB boundary,
-         * schedule next read
+        /* If file isn't random access, let read ahead look at the access pattern
+         * and keep data ahead of the reader
          */
-        if (!BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS) &&
-            (CurrentOffset - 1) / VACB_MAPPING_GRANULARITY != (CurrentOffset + BytesCopied - 1) / VACB_MAPPING_GRANULARITY)
+        if (!BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS))
         {
             CcScheduleReadAhead(FileObject, (PLARGE_INTEGER)&FileOffset, BytesCopied);
         }
@@ -482,23 +629,58 @@ CcPostDeferredWrites(VOID)
     }
 }
 
+/* Waits for the pending VACB reads of a read ahead, and releases their VACB */
+static
+VOID
+CcFinishReadAheadReads(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    PCC_VACB_READ Reads,
+    PULONG ReadCount)
+{
+    NTSTATUS Status;
+    ULONG i;
+
+    for (i = 0; i < *ReadCount; i++)
+    {
+        Status = CcEndReadVirtualAddress(&Reads[i]);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to read data: %lx!\n", Status);
+            CcRosReleaseVacb(SharedCacheMap, Reads[i].Vacb, FALSE, FALSE, FALSE);
+            continue;
+        }
+
+        Reads[i].Vacb->ReadAhead = TRUE;
+        CcRosReleaseVacb(SharedCacheMap, Reads[i].Vacb, TRUE, FALSE, FALSE);
+    }
+
+    *ReadCount = 0;
+}
+
 VOID
 CcPerformReadAhead(
-    IN PFILE_OBJECT FileObject)
+    IN PFILE_OBJECT FileObject,
+    IN LONGLONG FileOffset,
+    IN ULONG Length,
+    IN LONGLONG Stride,
+    IN ULONG Count)
 {
     NTSTATUS Status;
-    LONGLONG CurrentOffset;
+    LONGLONG CurrentOffset, EndOffset;
     KIRQL OldIrql;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
     PROS_VACB Vacb;
-    ULONG PartialLength;
     PVOID BaseAddress;
     BOOLEAN Valid;
-    ULONG Length;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
+    PROS_PRIVATE_CACHE_MAP RosPrivateCacheMap;
     BOOLEAN Locked;
+    CC_VACB_READ Reads[CC_READ_AHEAD_MAX_READS];
+    ULONG ReadCount;
+    ULONG i;
 
     SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
+    ReadCount = 0;
 
     /* Critical:
      * PrivateCacheMap might disappear in-between if the handle
@@ -508,22 +690,14 @@ CcPerformReadAhead(
      */
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     PrivateCacheMap = FileObject->PrivateCacheMap;
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
     /* If the handle was closed since the read ahead was scheduled, just quit */
     if (PrivateCacheMap == NULL)
     {
-        KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
         ObDereferenceObject(FileObject);
         return;
     }
-    /* Otherwise, extract read offset and length and release private map */
-    else
-    {
-        KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
-        CurrentOffset = PrivateCacheMap->ReadAheadOffset[1].QuadPart;
-        Length = PrivateCacheMap->ReadAheadLength[1];
-        KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
-    }
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
     /* Time to go! */
     DPRINT("Doing ReadAhead for %p\n", FileObject);
@@ -537,94 +711,82 @@ CcPerformReadAhead(
     /* Remember it's locked */
     Locked = TRUE;
 
-    /* Don't read past the end of the file */
-    if (CurrentOffset >= SharedCacheMap->FileSize.QuadPart)
-    {
-        goto Clear;
-    }
-    if (CurrentOffset + Length > SharedCacheMap->FileSize.QuadPart)
-    {
-        Length = SharedCacheMap->FileSize.QuadPart - CurrentOffset;
-    }
-
-    /* Next of the algorithm will lock like CcCopyData with the slight
-     * difference that we don't copy data back to an user-backed buffer
-     * We just bring data into Cc
+    /* Bring in each block, the VACB reads are all started before
+     * waiting for any of them, up to CC_READ_AHEAD_MAX_READS at a time.
+     * We just bring data into Cc, there's nothing to copy.
      */
-    PartialLength = CurrentOffset % VACB_MAPPING_GRANULARITY;
-    if (PartialLength != 0)
+    for (i = 0; i < Count; i++)
     {
-        PartialLength = min(Length, VACB_MAPPING_GRANULARITY - PartialLength);
-        Status = CcRosRequestVacb(SharedCacheMap,
-                                  ROUND_DOWN(CurrentOffset,
-                                             VACB_MAPPING_GRANULARITY),
-                                  &BaseAddress,
-                                  &Valid,
-                                  &Vacb);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT1("Failed to request VACB: %lx!\n", Status);
-            goto Clear;
-        }
+        CurrentOffset = FileOffset + i * Stride;
+        EndOffset = CurrentOffset + Length;
 
-        if (!Valid)
+        /* Don't read past the end of the file */
+        if (CurrentOffset < 0 || CurrentOffset >= SharedCacheMap->FileSize.QuadPart)
         {
-            Status = CcReadVirtualAddress(Vacb);
-            if (!NT_SUCCESS(Status))
-            {
-                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
-                DPRINT1("Failed to read data: %lx!\n", Status);
-                goto Clear;
-            }
+            continue;
         }
-
-        CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
-
-        Length -= PartialLength;
-        CurrentOffset += PartialLength;
-    }
-
-    while (Length > 0)
-    {
-        ASSERT(CurrentOffset % VACB_MAPPING_GRANULARITY == 0);
-        PartialLength = min(VACB_MAPPING_GRANULARITY, Length);
-        Status = CcRosRequestVacb(SharedCacheMap,
-                                  CurrentOffset,
-                                  &BaseAddress,
-                                  &Valid,
-                                  &Vacb);
-        if (!NT_SUCCESS(Status))
+        if (EndOffset > SharedCacheMap->FileSize.QuadPart)
         {
-            DPRINT1("Failed to request VACB: %lx!\n", Status);
-            goto Clear;
+            EndOffset = SharedCacheMap->FileSize.QuadPart;
         }
 
-        if (!Valid)
+        CurrentOffset = ROUND_DOWN(CurrentOffset, VACB_MAPPING_GRANULARITY);
+        while (CurrentOffset < EndOffset)
         {
-            Status = CcReadVirtualAddress(Vacb);
+            Status = CcRosRequestVacb(SharedCacheMap,
+                                      CurrentOffset,
+                                      &BaseAddress,
+                                      &Valid,
+                                      &Vacb);
             if (!NT_SUCCESS(Status))
             {
-                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
-                DPRINT1("Failed to read data: %lx!\n", Status);
+                DPRINT1("Failed to request VACB: %lx!\n", Status);
                 goto Clear;
             }
-        }
 
-        CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
+            if (Valid)
+            {
+                CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, FALSE);
+            }
+            else
+            {
+                Status = CcBeginReadVirtualAddress(Vacb, &Reads[ReadCount]);
+                if (!NT_SUCCESS(Status))
+                {
+                    CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
+                    DPRINT1("Failed to read data: %lx!\n", Status);
+                    goto Clear;
+                }
 
-        Length -= PartialLength;
-        CurrentOffset += PartialLength;
+                ++CcReadAheadIos;
+                if (++ReadCount == CC_READ_AHEAD_MAX_READS)
+                {
+                    CcFinishReadAheadReads(SharedCacheMap, Reads, &ReadCount);
+                }
+            }
+
+            CurrentOffset += VACB_MAPPING_GRANULARITY;
+        }
     }
 
 Clear:
+    /* Wait for the reads which are still in flight */
+    CcFinishReadAheadReads(SharedCacheMap, Reads, &ReadCount);
+
     /* See previous comment about private cache map */
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     PrivateCacheMap = FileObject->PrivateCacheMap;
     if (PrivateCacheMap != NULL)
     {
-        /* Mark read ahead as unactive */
+        RosPrivateCacheMap = CONTAINING_RECORD(PrivateCacheMap, ROS_PRIVATE_CACHE_MAP, Map);
+
+        /* Mark read ahead as unactive if we were the last one */
         KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
-        InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        if (RosPrivateCacheMap->ReadAheadsInFlight > 0 &&
+            --RosPrivateCacheMap->ReadAheadsInFlight == 0)
+        {
+            InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        }
         KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
     }
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
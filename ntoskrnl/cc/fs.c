@@ -211,7 +211,8 @@ CcPurgeCacheSection (
         Vacb = CONTAINING_RECORD(ListEntry, ROS_VACB, CacheMapVacbListEntry);
         ListEntry = ListEntry->Flink;
 
-        /* Skip VACBs outside the range, or only partially in range */
+        /* Skip VACBs outside the range, or only partially in range.
+         * The list is not sorted, so all of them have to be checked. */
         if (Vacb->FileOffset.QuadPart < StartOffset)
         {
             continue;
@@ -220,7 +221,7 @@ CcPurgeCacheSection (
                       SharedCacheMap->SectionSize.QuadPart);
         if (ViewEnd >= EndOffset)
         {
-            break;
+            continue;
         }
 
         /* Still in use, it cannot be purged, fail
@@ -242,6 +243,7 @@ CcPurgeCacheSection (
         {
             CcRosUnmarkDirtyVacb(Vacb, FALSE);
         }
+        CcRosRemoveVacbFromIndex(SharedCacheMap, Vacb);
         RemoveEntryList(&Vacb->CacheMapVacbListEntry);
         InsertHeadList(&FreeList, &Vacb->CacheMapVacbListEntry);
     }
@@ -31,6 +31,7 @@ ULONG CcLazyWriteIos = 0;
  * - Number of ongoing workers
  * - Three seconds delay for lazy writer 
  * - One second delay for lazy writer
+ * - Quarter of a second delay for lazy writer, when writers are throttled
  * - Zero delay for lazy writer
  * - Number of worker threads
  */
@@ -44,6 +45,7 @@ BOOLEAN CcQueueThrottle = FALSE;
 ULONG CcNumberActiveWorkerThreads = 0;
 LARGE_INTEGER CcFirstDelay = RTL_CONSTANT_LARGE_INTEGER((LONGLONG)-1*3000*1000*10);
 LARGE_INTEGER CcIdleDelay = RTL_CONSTANT_LARGE_INTEGER((LONGLONG)-1*1000*1000*10);
+LARGE_INTEGER CcPressureDelay = RTL_CONSTANT_LARGE_INTEGER((LONGLONG)-1*250*1000*10);
 LARGE_INTEGER CcNoDelay = RTL_CONSTANT_LARGE_INTEGER((LONGLONG)0);
 ULONG CcNumberWorkerThreads;
 
@@ -113,29 +115,146 @@ CcScanDpc(
     CcPostWorkQueue(WorkItem, &CcRegularWorkQueue);
 }
 
+/* Whether writers are throttled by CcCanIWrite, or are about to be */
+static
+BOOLEAN
+CcIsUnderWritePressure(VOID)
+{
+    return !IsListEmpty(&CcDeferredWrites) ||
+           CcTotalDirtyPages >= CcDirtyPageThreshold / 2;
+}
+
+static
+ULONG
+CcGetWriteBehindTarget(VOID)
+{
+    ULONG Target;
+
+    /* Our target is one-eighth of the dirty pages */
+    Target = CcTotalDirtyPages / 8;
+
+    /* Under pressure, go back down to a quarter of the threshold,
+     * and write at least half of the dirty pages if writers are waiting
+     */
+    if (CcIsUnderWritePressure())
+    {
+        Target = max(Target, CcTotalDirtyPages - min(CcTotalDirtyPages, CcDirtyPageThreshold / 4));
+        if (!IsListEmpty(&CcDeferredWrites))
+        {
+            Target = max(Target, CcTotalDirtyPages / 2);
+        }
+    }
+
+    return Target;
+}
+
+VOID
+CcWriteBehindFile(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN ULONG Target)
+{
+    KIRQL OldIrql;
+    ULONG Count;
+
+    /* Flush! */
+    DPRINT("Lazy writer starting on %p (%d)\n", SharedCacheMap, Target);
+    KeEnterCriticalRegion();
+    CcRosFlushFileDirtyPages(SharedCacheMap, Target, &Count, FALSE);
+    KeLeaveCriticalRegion();
+
+    /* And update stats */
+    InterlockedExchangeAdd((volatile long *)&CcLazyWritePages, Count);
+    DPRINT("Lazy writer done on %p (%d)\n", SharedCacheMap, Count);
+
+    /* The file can be written again */
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+    ClearFlag(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE);
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+    /* And drop our reference (See: CcWriteBehind) */
+    CcRosDereferenceCache(SharedCacheMap->FileObject);
+}
+
 VOID
 CcWriteBehind(VOID)
 {
-    ULONG Target, Count;
+    ULONG Target, Remaining, FileTarget;
+    KIRQL OldIrql;
+    PLIST_ENTRY ListEntry;
+    LIST_ENTRY ToPost;
+    PWORK_QUEUE_ENTRY WorkItem;
+    PROS_SHARED_CACHE_MAP SharedCacheMap;
 
-    Target = CcTotalDirtyPages / 8;
-    if (Target != 0)
+    Target = CcGetWriteBehindTarget();
+    if (Target == 0)
+    {
+        return;
+    }
+
+    /* Split the target between the files with dirty pages, and give each of
+     * them its own work item, so that the worker threads write them in parallel
+     */
+    InitializeListHead(&ToPost);
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+
+    Remaining = 0;
+    for (ListEntry = CcCleanSharedCacheMapList.Flink;
+         ListEntry != &CcCleanSharedCacheMapList;
+         ListEntry = ListEntry->Flink)
+    {
+        Remaining++;
+    }
+
+    while (Remaining-- > 0 && CcTotalDirtyPages != 0)
     {
-        /* Flush! */
-        DPRINT("Lazy writer starting (%d)\n", Target);
-        CcRosFlushDirtyPages(Target, &Count, FALSE, TRUE);
-
-        /* And update stats */
-        CcLazyWritePages += Count;
-        ++CcLazyWriteIos;
-        DPRINT("Lazy writer done (%d)\n", Count);
+        /* Round robin, so that the same files don't always go first */
+        ListEntry = RemoveHeadList(&CcCleanSharedCacheMapList);
+        InsertTailList(&CcCleanSharedCacheMapList, ListEntry);
+        SharedCacheMap = CONTAINING_RECORD(ListEntry, ROS_SHARED_CACHE_MAP, SharedCacheMapLinks);
+
+        if (!CcRosCanFlushFile(SharedCacheMap, TRUE))
+        {
+            continue;
+        }
+
+        FileTarget = (ULONG)(((ULONGLONG)Target * SharedCacheMap->DirtyPages) / CcTotalDirtyPages);
+        if (FileTarget == 0)
+        {
+            FileTarget = 1;
+        }
+
+        WorkItem = ExAllocateFromNPagedLookasideList(&CcTwilightLookasideList);
+        if (WorkItem == NULL)
+        {
+            break;
+        }
+
+        /* Keep the shared cache map till the work item is done */
+        SharedCacheMap->OpenCount++;
+        SetFlag(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE);
+
+        WorkItem->Function = WriteBehindFile;
+        WorkItem->Parameters.Write.SharedCacheMap = SharedCacheMap;
+        WorkItem->Parameters.Write.Target = FileTarget;
+        InsertTailList(&ToPost, &WorkItem->WorkQueueLinks);
     }
+
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+    while (!IsListEmpty(&ToPost))
+    {
+        ListEntry = RemoveHeadList(&ToPost);
+        WorkItem = CONTAINING_RECORD(ListEntry, WORK_QUEUE_ENTRY, WorkQueueLinks);
+        CcPostWorkQueue(WorkItem, &CcRegularWorkQueue);
+    }
+
+    /* And update stats */
+    ++CcLazyWriteIos;
 }
 
 VOID
 CcLazyWriteScan(VOID)
 {
-    ULONG Target;
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
     LIST_ENTRY ToPost;
@@ -156,20 +275,12 @@ CcLazyWriteScan(VOID)
     }
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
-    /* Our target is one-eighth of the dirty pages */
-    Target = CcTotalDirtyPages / 8;
-    if (Target != 0)
-    {
-        /* There is stuff to flush, schedule a write-behind operation */
-
-        /* Allocate a work item */
-        WorkItem = ExAllocateFromNPagedLookasideList(&CcTwilightLookasideList);
-        if (WorkItem != NULL)
-        {
-            WorkItem->Function = WriteBehind;
-            CcPostWorkQueue(WorkItem, &CcRegularWorkQueue);
-        }
-    }
+    /* There is stuff to flush, queue the per-file write-behind operations.
+     * This is done from here rather than from a work item of its own, so
+     * that they are all in the queue before the items due for end of run:
+     * a SetDone item only runs once the work queued before it is over.
+     */
+    CcWriteBehind();
 
     /* Post items that were due for end of run */
     while (!IsListEmpty(&ToPost))
@@ -214,10 +325,14 @@ VOID CcScheduleLazyWriteScan(
         LazyWriter.ScanActive = TRUE;
         KeSetTimer(&LazyWriter.ScanTimer, CcFirstDelay, &LazyWriter.ScanDpc);
     }
-    /* Finally, already running, so queue for the next second */
+    /* Finally, already running, so queue for the next second,
+     * or sooner if writers are being throttled
+     */
     else
     {
-        KeSetTimer(&LazyWriter.ScanTimer, CcIdleDelay, &LazyWriter.ScanDpc);
+        KeSetTimer(&LazyWriter.ScanTimer,
+                   CcIsUnderWritePressure() ? CcPressureDelay : CcIdleDelay,
+                   &LazyWriter.ScanDpc);
     }
 }
 
@@ -303,12 +418,17 @@ CcWorkerThread(
         switch (WorkItem->Function)
         {
             case ReadAhead:
-                CcPerformReadAhead(WorkItem->Parameters.Read.FileObject);
+                CcPerformReadAhead(WorkItem->Parameters.Read.FileObject,
+                                   WorkItem->Parameters.Read.FileOffset,
+                                   WorkItem->Parameters.Read.Length,
+                                   WorkItem->Parameters.Read.Stride,
+                                   WorkItem->Parameters.Read.Count);
                 break;
 
-            case WriteBehind:
+            case WriteBehindFile:
                 PsGetCurrentThread()->MemoryMaker = 1;
-                CcWriteBehind();
+                CcWriteBehindFile(WorkItem->Parameters.Write.SharedCacheMap,
+                                  WorkItem->Parameters.Write.Target);
                 PsGetCurrentThread()->MemoryMaker = 0;
                 WritePerformed = TRUE;
                 break;
@@ -45,6 +45,10 @@ NPAGED_LOOKASIDE_LIST iBcbLookasideList;
 static NPAGED_LOOKASIDE_LIST SharedCacheMapLookasideList;
 static NPAGED_LOOKASIDE_LIST VacbLookasideList;
 
+/* Enough levels to index any 64-bit file offset */
+#define VACB_INDEX_MAX_DEPTH 7
+C_ASSERT((1ULL << (VACB_INDEX_MAX_DEPTH * VACB_LEVEL_SHIFT)) > (MAXULONGLONG / VACB_MAPPING_GRANULARITY));
+
 /* Internal vars (MS):
  * - Threshold above which lazy writer will start action
  * - Amount of dirty pages
@@ -156,19 +160,28 @@ CcRosTraceCacheMap (
 #endif
 }
 
+/* Writes adjacent dirty VACBs of a file, in file offset order */
 NTSTATUS
 NTAPI
-CcRosFlushVacb (
-    PROS_VACB Vacb)
+CcRosFlushVacbs (
+    PROS_VACB *Vacbs,
+    ULONG Count)
 {
     NTSTATUS Status;
+    ULONG i;
 
-    CcRosUnmarkDirtyVacb(Vacb, TRUE);
+    for (i = 0; i < Count; i++)
+    {
+        CcRosUnmarkDirtyVacb(Vacbs[i], TRUE);
+    }
 
-    Status = CcWriteVirtualAddress(Vacb);
+    Status = CcWriteVirtualAddresses(Vacbs, Count);
     if (!NT_SUCCESS(Status))
     {
-        CcRosMarkDirtyVacb(Vacb);
+        for (i = 0; i < Count; i++)
+        {
+            CcRosMarkDirtyVacb(Vacbs[i]);
+        }
     }
 
     return Status;
@@ -176,107 +189,231 @@ CcRosFlushVacb (
 
 NTSTATUS
 NTAPI
-CcRosFlushDirtyPages (
+CcRosFlushVacb (
+    PROS_VACB Vacb)
+{
+    return CcRosFlushVacbs(&Vacb, 1);
+}
+
+/*
+ * Writes up to Target dirty pages of a file. The dirty VACBs are written in
+ * increasing file offset order, and adjacent ones are written together.
+ * The caller must have set WRITEBEHIND_ACTIVE on the shared cache map.
+ */
+NTSTATUS
+NTAPI
+CcRosFlushFileDirtyPages (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
     ULONG Target,
     PULONG Count,
-    BOOLEAN Wait,
-    BOOLEAN CalledFromLazy)
+    BOOLEAN Wait)
 {
+    PROS_VACB Batch[CC_WRITE_BEHIND_BATCH];
     PLIST_ENTRY current_entry;
     PROS_VACB current;
-    BOOLEAN Locked;
+    LONGLONG NextOffset;
+    ULONG Found, Cluster, PagesFreed, i, j;
     NTSTATUS Status;
     KIRQL OldIrql;
 
-    DPRINT("CcRosFlushDirtyPages(Target %lu)\n", Target);
+    ASSERT(BooleanFlagOn(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE));
 
     (*Count) = 0;
 
-    KeEnterCriticalRegion();
-    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-
-    current_entry = DirtyVacbListHead.Flink;
-    if (current_entry == &DirtyVacbListHead)
+    if (!SharedCacheMap->Callbacks->AcquireForLazyWrite(SharedCacheMap->LazyWriteContext, Wait))
     {
-        DPRINT("No Dirty pages\n");
+        return STATUS_FILE_LOCK_CONFLICT;
     }
 
-    while ((current_entry != &DirtyVacbListHead) && (Target > 0))
+    NextOffset = 0;
+    while (Target > 0)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    DirtyVacbListEntry);
-        current_entry = current_entry->Flink;
+        /* Get the dirty VACBs with the lowest offsets we didn't write yet */
+        Found = 0;
+        OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+        KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
+        for (current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
+             current_entry != &SharedCacheMap->CacheMapVacbListHead;
+             current_entry = current_entry->Flink)
+        {
+            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+            if (!current->Dirty || current->FileOffset.QuadPart < NextOffset)
+            {
+                continue;
+            }
 
-        CcRosVacbIncRefCount(current);
+            /* Insert it sorted, dropping the highest one if we're full */
+            if (Found < CC_WRITE_BEHIND_BATCH)
+            {
+                i = Found++;
+            }
+            else if (current->FileOffset.QuadPart < Batch[Found - 1]->FileOffset.QuadPart)
+            {
+                i = Found - 1;
+            }
+            else
+            {
+                continue;
+            }
 
-        /* When performing lazy write, don't handle temporary files */
-        if (CalledFromLazy &&
-            BooleanFlagOn(current->SharedCacheMap->FileObject->Flags, FO_TEMPORARY_FILE))
-        {
-            CcRosVacbDecRefCount(current);
-            continue;
+            for (; i > 0 && Batch[i - 1]->FileOffset.QuadPart > current->FileOffset.QuadPart; i--)
+            {
+                Batch[i] = Batch[i - 1];
+            }
+            Batch[i] = current;
         }
 
-        /* Don't attempt to lazy write the files that asked not to */
-        if (CalledFromLazy &&
-            BooleanFlagOn(current->SharedCacheMap->Flags, WRITEBEHIND_DISABLED))
+        for (i = 0; i < Found; i++)
         {
-            CcRosVacbDecRefCount(current);
-            continue;
+            CcRosVacbIncRefCount(Batch[i]);
         }
-
-        ASSERT(current->Dirty);
-
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
         KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
-        Locked = current->SharedCacheMap->Callbacks->AcquireForLazyWrite(
-                     current->SharedCacheMap->LazyWriteContext, Wait);
-        if (!Locked)
+        if (Found == 0)
         {
-            OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-            CcRosVacbDecRefCount(current);
-            continue;
+            break;
         }
 
-        Status = CcRosFlushVacb(current);
-
-        current->SharedCacheMap->Callbacks->ReleaseFromLazyWrite(
-            current->SharedCacheMap->LazyWriteContext);
+        NextOffset = Batch[Found - 1]->FileOffset.QuadPart + VACB_MAPPING_GRANULARITY;
 
-        /* We release the VACB before acquiring the lock again, because
-         * CcRosVacbDecRefCount might free the VACB, as CcRosFlushVacb dropped a
-         * Refcount. Freeing must be done outside of the lock.
-         * The refcount is decremented atomically. So this is OK. */
-        CcRosVacbDecRefCount(current);
-        OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-
-        if (!NT_SUCCESS(Status) && (Status != STATUS_END_OF_FILE) &&
-            (Status != STATUS_MEDIA_WRITE_PROTECTED))
-        {
-            DPRINT1("CC: Failed to flush VACB.\n");
-        }
-        else
+        for (i = 0; i < Found; i += Cluster)
         {
-            ULONG PagesFreed;
-
-            /* How many pages did we free? */
-            PagesFreed = VACB_MAPPING_GRANULARITY / PAGE_SIZE;
-            (*Count) += PagesFreed;
+            /* Gather the VACBs following this one. Only the last VACB of a
+             * cluster may end before the end of its view.
+             */
+            for (Cluster = 1; i + Cluster < Found && Cluster < CC_WRITE_CLUSTER_VACBS; Cluster++)
+            {
+                current = Batch[i + Cluster - 1];
+                if (Batch[i + Cluster]->FileOffset.QuadPart != current->FileOffset.QuadPart + VACB_MAPPING_GRANULARITY ||
+                    current->FileOffset.QuadPart + VACB_MAPPING_GRANULARITY > SharedCacheMap->SectionSize.QuadPart)
+                {
+                    break;
+                }
+            }
 
-            /* Make sure we don't overflow target! */
-            if (Target < PagesFreed)
+            if (Target > 0)
             {
-                /* If we would have, jump to zero directly */
-                Target = 0;
+                Status = CcRosFlushVacbs(&Batch[i], Cluster);
+                if (!NT_SUCCESS(Status) && (Status != STATUS_END_OF_FILE) &&
+                    (Status != STATUS_MEDIA_WRITE_PROTECTED))
+                {
+                    DPRINT1("CC: Failed to flush VACBs.\n");
+                }
+                else
+                {
+                    /* How many pages did we free? */
+                    PagesFreed = Cluster * (VACB_MAPPING_GRANULARITY / PAGE_SIZE);
+                    (*Count) += PagesFreed;
+
+                    /* Make sure we don't overflow target! */
+                    Target -= min(Target, PagesFreed);
+                }
             }
-            else
+
+            /* We release the VACBs without the lock, because
+             * CcRosVacbDecRefCount might free them, as CcRosFlushVacbs dropped a
+             * Refcount. Freeing must be done outside of the lock.
+             * The refcount is decremented atomically. So this is OK. */
+            for (j = 0; j < Cluster; j++)
             {
-                Target -= PagesFreed;
+                CcRosVacbDecRefCount(Batch[i + j]);
             }
         }
+    }
+
+    SharedCacheMap->Callbacks->ReleaseFromLazyWrite(SharedCacheMap->LazyWriteContext);
+
+    return STATUS_SUCCESS;
+}
+
+/* Whether the dirty pages of a file can be written now. Called with the master lock held. */
+BOOLEAN
+CcRosCanFlushFile (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    BOOLEAN CalledFromLazy)
+{
+    /* Don't touch files being torn down, nor files someone else is writing */
+    if (SharedCacheMap->DirtyPages == 0 ||
+        SharedCacheMap->OpenCount == 0 ||
+        BooleanFlagOn(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE))
+    {
+        return FALSE;
+    }
+
+    /* When performing lazy write, don't handle temporary files */
+    if (CalledFromLazy &&
+        BooleanFlagOn(SharedCacheMap->FileObject->Flags, FO_TEMPORARY_FILE))
+    {
+        return FALSE;
+    }
+
+    /* Don't attempt to lazy write the files that asked not to */
+    if (CalledFromLazy &&
+        BooleanFlagOn(SharedCacheMap->Flags, WRITEBEHIND_DISABLED))
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+NTSTATUS
+NTAPI
+CcRosFlushDirtyPages (
+    ULONG Target,
+    PULONG Count,
+    BOOLEAN Wait,
+    BOOLEAN CalledFromLazy)
+{
+    PLIST_ENTRY current_entry;
+    PROS_SHARED_CACHE_MAP SharedCacheMap;
+    ULONG Remaining, PagesFreed;
+    KIRQL OldIrql;
+
+    DPRINT("CcRosFlushDirtyPages(Target %lu)\n", Target);
+
+    (*Count) = 0;
+
+    KeEnterCriticalRegion();
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+
+    /* Go once through the files, round robin, so that the same ones don't always go first */
+    Remaining = 0;
+    for (current_entry = CcCleanSharedCacheMapList.Flink;
+         current_entry != &CcCleanSharedCacheMapList;
+         current_entry = current_entry->Flink)
+    {
+        Remaining++;
+    }
+
+    while (Remaining-- > 0 && Target > 0)
+    {
+        current_entry = RemoveHeadList(&CcCleanSharedCacheMapList);
+        InsertTailList(&CcCleanSharedCacheMapList, current_entry);
+        SharedCacheMap = CONTAINING_RECORD(current_entry, ROS_SHARED_CACHE_MAP, SharedCacheMapLinks);
+
+        if (!CcRosCanFlushFile(SharedCacheMap, CalledFromLazy))
+        {
+            continue;
+        }
+
+        /* Keep the shared cache map while we write it */
+        SharedCacheMap->OpenCount++;
+        SetFlag(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+        CcRosFlushFileDirtyPages(SharedCacheMap, Target, &PagesFreed, Wait);
+        (*Count) += PagesFreed;
+        Target -= min(Target, PagesFreed);
+
+        OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+        ClearFlag(SharedCacheMap->Flags, WRITEBEHIND_ACTIVE);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+        CcRosDereferenceCache(SharedCacheMap->FileObject);
 
-        current_entry = DirtyVacbListHead.Flink;
+        OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     }
 
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
@@ -363,6 +500,7 @@ retry:
             ASSERT(!current->MappedCount);
             ASSERT(Refs == 1);
 
+            CcRosRemoveVacbFromIndex(current->SharedCacheMap, current);
             RemoveEntryList(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -452,14 +590,200 @@ CcRosReleaseVacb (
     return STATUS_SUCCESS;
 }
 
-/* Returns with VACB Lock Held! */
+static
+PVACB_LEVEL
+CcRosAllocateVacbLevel(VOID)
+{
+    PVACB_LEVEL Level;
+
+    Level = ExAllocatePoolWithTag(NonPagedPool, sizeof(VACB_LEVEL), TAG_VACB_INDEX);
+    if (Level != NULL)
+    {
+        RtlZeroMemory(Level, sizeof(VACB_LEVEL));
+    }
+
+    return Level;
+}
+
+/* Frees the empty levels on the path to Index, from the bottom up */
+static
+VOID
+CcRosPruneVacbIndex(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    ULONGLONG Index)
+{
+    PVACB_LEVEL Path[VACB_INDEX_MAX_DEPTH];
+    PVACB_LEVEL Level;
+    ULONG Depth, i;
+
+    Level = SharedCacheMap->VacbIndex;
+    Depth = SharedCacheMap->VacbIndexDepth;
+
+    for (i = 0; i < Depth && Level != NULL; i++)
+    {
+        Path[i] = Level;
+        if (i + 1 < Depth)
+        {
+            Level = Level->Entries[(Index >> ((Depth - 1 - i) * VACB_LEVEL_SHIFT)) & VACB_LEVEL_MASK];
+        }
+    }
+
+    while (i-- > 0)
+    {
+        if (Path[i]->ActiveEntries != 0)
+            break;
+
+        ExFreePoolWithTag(Path[i], TAG_VACB_INDEX);
+
+        if (i == 0)
+        {
+            SharedCacheMap->VacbIndex = NULL;
+            SharedCacheMap->VacbIndexDepth = 0;
+        }
+        else
+        {
+            Path[i - 1]->Entries[(Index >> ((Depth - i) * VACB_LEVEL_SHIFT)) & VACB_LEVEL_MASK] = NULL;
+            Path[i - 1]->ActiveEntries--;
+        }
+    }
+}
+
+/* Must be called with the CacheMapLock held */
+static
+NTSTATUS
+CcRosInsertVacbInIndex(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    PROS_VACB Vacb)
+{
+    ULONGLONG Index;
+    PVACB_LEVEL Level, NewLevel;
+    PVOID *Slot;
+    ULONG Depth;
+
+    Index = (ULONGLONG)Vacb->FileOffset.QuadPart / VACB_MAPPING_GRANULARITY;
+
+    if (SharedCacheMap->VacbIndex == NULL)
+    {
+        NewLevel = CcRosAllocateVacbLevel();
+        if (NewLevel == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        for (Depth = 1; (Index >> (Depth * VACB_LEVEL_SHIFT)) != 0; Depth++);
+
+        SharedCacheMap->VacbIndex = NewLevel;
+        SharedCacheMap->VacbIndexDepth = Depth;
+    }
+
+    /* Grow the tree until it covers the index, the old root becomes the first entry of the new one */
+    while ((Index >> (SharedCacheMap->VacbIndexDepth * VACB_LEVEL_SHIFT)) != 0)
+    {
+        ASSERT(SharedCacheMap->VacbIndexDepth < VACB_INDEX_MAX_DEPTH);
+
+        NewLevel = CcRosAllocateVacbLevel();
+        if (NewLevel == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        NewLevel->Entries[0] = SharedCacheMap->VacbIndex;
+        NewLevel->ActiveEntries = 1;
+        SharedCacheMap->VacbIndex = NewLevel;
+        SharedCacheMap->VacbIndexDepth++;
+    }
+
+    Level = SharedCacheMap->VacbIndex;
+    for (Depth = SharedCacheMap->VacbIndexDepth - 1; Depth > 0; Depth--)
+    {
+        Slot = &Level->Entries[(Index >> (Depth * VACB_LEVEL_SHIFT)) & VACB_LEVEL_MASK];
+        if (*Slot == NULL)
+        {
+            NewLevel = CcRosAllocateVacbLevel();
+            if (NewLevel == NULL)
+            {
+                CcRosPruneVacbIndex(SharedCacheMap, Index);
+                return STATUS_INSUFFICIENT_RESOURCES;
+            }
+
+            *Slot = NewLevel;
+            Level->ActiveEntries++;
+        }
+        Level = *Slot;
+    }
+
+    ASSERT(Level->Entries[Index & VACB_LEVEL_MASK] == NULL);
+    Level->Entries[Index & VACB_LEVEL_MASK] = Vacb;
+    Level->ActiveEntries++;
+
+    return STATUS_SUCCESS;
+}
+
+/* Must be called with the CacheMapLock held, the VACB is not referenced */
+PROS_VACB
+CcRosFindVacbInIndex(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN LONGLONG FileOffset)
+{
+    ULONGLONG Index;
+    PVACB_LEVEL Level;
+    ULONG Depth;
+
+    Index = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+    Level = SharedCacheMap->VacbIndex;
+    Depth = SharedCacheMap->VacbIndexDepth;
+
+    if (Level == NULL || (Index >> (Depth * VACB_LEVEL_SHIFT)) != 0)
+    {
+        return NULL;
+    }
+
+    while (--Depth > 0)
+    {
+        Level = Level->Entries[(Index >> (Depth * VACB_LEVEL_SHIFT)) & VACB_LEVEL_MASK];
+        if (Level == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    return Level->Entries[Index & VACB_LEVEL_MASK];
+}
+
+/* Must be called with the CacheMapLock held */
+VOID
+CcRosRemoveVacbFromIndex(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN PROS_VACB Vacb)
+{
+    ULONGLONG Index;
+    PVACB_LEVEL Level;
+    ULONG Depth;
+
+    ASSERT(CcRosFindVacbInIndex(SharedCacheMap, Vacb->FileOffset.QuadPart) == Vacb);
+
+    Index = (ULONGLONG)Vacb->FileOffset.QuadPart / VACB_MAPPING_GRANULARITY;
+    Level = SharedCacheMap->VacbIndex;
+    Depth = SharedCacheMap->VacbIndexDepth;
+
+    while (--Depth > 0)
+    {
+        Level = Level->Entries[(Index >> (Depth * VACB_LEVEL_SHIFT)) & VACB_LEVEL_MASK];
+    }
+
+    Level->Entries[Index & VACB_LEVEL_MASK] = NULL;
+    Level->ActiveEntries--;
+
+    CcRosPruneVacbIndex(SharedCacheMap, Index);
+}
+
+/* Returns the referenced VACB mapping FileOffset, or NULL */
 PROS_VACB
 NTAPI
 CcRosLookupVacb (
     PROS_SHARED_CACHE_MAP SharedCacheMap,
     LONGLONG FileOffset)
 {
-    PLIST_ENTRY current_entry;
     PROS_VACB current;
     KIRQL oldIrql;
 
@@ -468,33 +792,19 @@ CcRosLookupVacb (
     DPRINT("CcRosLookupVacb(SharedCacheMap 0x%p, FileOffset %I64u)\n",
            SharedCacheMap, FileOffset);
 
-    oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-    KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
+    /* The index is only modified with the CacheMapLock held, and so are
+     * the checks on the reference count before a VACB gets freed. */
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
 
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    current = CcRosFindVacbInIndex(SharedCacheMap, FileOffset);
+    if (current != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-            return current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        CcRosVacbIncRefCount(current);
     }
 
-    KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
 
-    return NULL;
+    return current;
 }
 
 VOID
@@ -733,6 +1043,7 @@ CcRosFreeUnusedVacb (
             ASSERT(Refs == 1);
 
             /* Reset and move to free list */
+            CcRosRemoveVacbFromIndex(current->SharedCacheMap, current);
             RemoveEntryList(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -783,8 +1094,6 @@ CcRosCreateVacb (
     PROS_VACB *Vacb)
 {
     PROS_VACB current;
-    PROS_VACB previous;
-    PLIST_ENTRY current_entry;
     NTSTATUS Status;
     KIRQL oldIrql;
     ULONG Refs;
@@ -805,6 +1114,7 @@ CcRosCreateVacb (
     current->Valid = FALSE;
     current->Dirty = FALSE;
     current->PageOut = FALSE;
+    current->ReadAhead = FALSE;
     current->FileOffset.QuadPart = ROUND_DOWN(FileOffset, VACB_MAPPING_GRANULARITY);
     current->SharedCacheMap = SharedCacheMap;
 #if DBG
@@ -853,56 +1163,43 @@ Retry:
      * our newly created VACB and return the existing one.
      */
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    previous = NULL;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    current = CcRosFindVacbInIndex(SharedCacheMap, FileOffset);
+    if (current != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+        CcRosVacbIncRefCount(current);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 #if DBG
-            if (SharedCacheMap->Trace)
-            {
-                DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
-                        SharedCacheMap,
-                        (*Vacb),
-                        current);
-            }
+        if (SharedCacheMap->Trace)
+        {
+            DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
+                    SharedCacheMap,
+                    (*Vacb),
+                    current);
+        }
 #endif
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
 
-            Refs = CcRosVacbDecRefCount(*Vacb);
-            ASSERT(Refs == 0);
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
 
-            *Vacb = current;
-            return STATUS_SUCCESS;
-        }
-        if (current->FileOffset.QuadPart < FileOffset)
-        {
-            ASSERT(previous == NULL ||
-                   previous->FileOffset.QuadPart < current->FileOffset.QuadPart);
-            previous = current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        *Vacb = current;
+        return STATUS_SUCCESS;
     }
     /* There was no existing VACB. */
     current = *Vacb;
-    if (previous)
-    {
-        InsertHeadList(&previous->CacheMapVacbListEntry, &current->CacheMapVacbListEntry);
-    }
-    else
+    Status = CcRosInsertVacbInIndex(SharedCacheMap, current);
+    if (!NT_SUCCESS(Status))
     {
-        InsertHeadList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+
+        *Vacb = NULL;
+        Refs = CcRosVacbDecRefCount(current);
+        ASSERT(Refs == 0);
+        return Status;
     }
+    /* The index keeps the VACBs sorted, the list doesn't need to be */
+    InsertTailList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     InsertTailList(&VacbLruListHead, &current->VacbLruListEntry);
     KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
@@ -1095,6 +1392,8 @@ CcFlushCache (
     LARGE_INTEGER Offset;
     LONGLONG RemainingLength;
     PROS_VACB current;
+    PROS_VACB Run[CC_WRITE_CLUSTER_VACBS];
+    ULONG RunLength, i;
     NTSTATUS Status;
 
     CCTRACE(CC_API_DEBUG, "SectionObjectPointers=%p FileOffset=%p Length=%lu\n",
@@ -1124,25 +1423,42 @@ CcFlushCache (
             IoStatus->Information = 0;
         }
 
+        /* Adjacent dirty VACBs are written together */
+        RunLength = 0;
         while (RemainingLength > 0)
         {
             current = CcRosLookupVacb(SharedCacheMap, Offset.QuadPart);
-            if (current != NULL)
+            if (current != NULL && !current->Dirty)
             {
-                if (current->Dirty)
-                {
-                    Status = CcRosFlushVacb(current);
-                    if (!NT_SUCCESS(Status) && IoStatus != NULL)
-                    {
-                        IoStatus->Status = Status;
-                    }
-                }
-
                 CcRosReleaseVacb(SharedCacheMap, current, current->Valid, FALSE, FALSE);
+                current = NULL;
+            }
+
+            if (current != NULL)
+            {
+                Run[RunLength++] = current;
             }
 
             Offset.QuadPart += VACB_MAPPING_GRANULARITY;
             RemainingLength -= min(RemainingLength, VACB_MAPPING_GRANULARITY);
+
+            /* Write the run once it can't grow anymore */
+            if (RunLength != 0 &&
+                (current == NULL || RunLength == CC_WRITE_CLUSTER_VACBS || RemainingLength == 0 ||
+                 current->FileOffset.QuadPart + VACB_MAPPING_GRANULARITY > SharedCacheMap->SectionSize.QuadPart))
+            {
+                Status = CcRosFlushVacbs(Run, RunLength);
+                if (!NT_SUCCESS(Status) && IoStatus != NULL)
+                {
+                    IoStatus->Status = Status;
+                }
+
+                for (i = 0; i < RunLength; i++)
+                {
+                    CcRosReleaseVacb(SharedCacheMap, Run[i], Run[i]->Valid, FALSE, FALSE);
+                }
+                RunLength = 0;
+            }
         }
     }
     else
@@ -1189,9 +1505,10 @@ CcRosDeleteFileCache (
         while (!IsListEmpty(&SharedCacheMap->CacheMapVacbListHead))
         {
             current_entry = RemoveTailList(&SharedCacheMap->CacheMapVacbListHead);
+            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+            CcRosRemoveVacbFromIndex(SharedCacheMap, current);
             KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 
-            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             if (current->Dirty)
@@ -1211,6 +1528,7 @@ CcRosDeleteFileCache (
 
             KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
         }
+        ASSERT(SharedCacheMap->VacbIndex == NULL);
 #if DBG
         SharedCacheMap->Trace = FALSE;
 #endif
@@ -1364,7 +1682,7 @@ CcRosReleaseFileCache (
             KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 
             /* And free it. */
-            if (PrivateMap != &SharedCacheMap->PrivateCacheMap)
+            if (PrivateMap != &SharedCacheMap->PrivateCacheMap.Map)
             {
                 ExFreePoolWithTag(PrivateMap, TAG_PRIVATE_CACHE_MAP);
             }
@@ -1460,19 +1778,20 @@ CcRosInitializeFileCache (
     }
     if (FileObject->PrivateCacheMap == NULL)
     {
+        PROS_PRIVATE_CACHE_MAP RosPrivateMap;
         PPRIVATE_CACHE_MAP PrivateMap;
 
         /* Allocate the private cache map for this handle */
-        if (SharedCacheMap->PrivateCacheMap.NodeTypeCode != 0)
+        if (SharedCacheMap->PrivateCacheMap.Map.NodeTypeCode != 0)
         {
-            PrivateMap = ExAllocatePoolWithTag(NonPagedPool, sizeof(PRIVATE_CACHE_MAP), TAG_PRIVATE_CACHE_MAP);
+            RosPrivateMap = ExAllocatePoolWithTag(NonPagedPool, sizeof(ROS_PRIVATE_CACHE_MAP), TAG_PRIVATE_CACHE_MAP);
         }
         else
         {
-            PrivateMap = &SharedCacheMap->PrivateCacheMap;
+            RosPrivateMap = &SharedCacheMap->PrivateCacheMap;
         }
 
-        if (PrivateMap == NULL)
+        if (RosPrivateMap == NULL)
         {
             /* If we also allocated the shared cache map for this file, kill it */
             if (Allocated)
@@ -1489,7 +1808,9 @@ CcRosInitializeFileCache (
         }
 
         /* Initialize it */
-        RtlZeroMemory(PrivateMap, sizeof(PRIVATE_CACHE_MAP));
+        RtlZeroMemory(RosPrivateMap, sizeof(ROS_PRIVATE_CACHE_MAP));
+        RosPrivateMap->ReadAheadWindow = CC_READ_AHEAD_MIN_WINDOW;
+        PrivateMap = &RosPrivateMap->Map;
         PrivateMap->NodeTypeCode = NODE_TYPE_PRIVATE_MAP;
         PrivateMap->ReadAheadMask = PAGE_SIZE - 1;
         PrivateMap->FileObject = FileObject;
@@ -1632,6 +1953,9 @@ ExpKdbgExtFileCache(ULONG Argc, PCHAR Argv[])
         KdbpPrint("%p\t%d\t%d\t%wZ%S\n", SharedCacheMap, Valid, Dirty, FileName, Extra);
     }
 
+    KdbpPrint("Read ahead: %lu reads, %lu hits, %lu misses\n",
+              CcReadAheadIos, CcReadAheadHits, CcReadAheadMisses);
+
     return TRUE;
 }
 
@@ -1664,6 +1988,9 @@ ExpKdbgExtDefWrites(ULONG Argc, PCHAR Argv[])
         KdbpPrint("CcTotalDirtyPages below the threshold, writes should not be throttled\n");
     }
 
+    KdbpPrint("Lazy writer: %lu runs, %lu pages, %lu clustered writes\n",
+              CcLazyWriteIos, CcLazyWritePages, CcClusteredWrites);
+
     return TRUE;
 }
 #endif
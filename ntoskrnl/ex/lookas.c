@@ -23,6 +23,12 @@ LIST_ENTRY ExPoolLookasideListHead;
 GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[MAXIMUM_PROCESSORS];
 GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[MAXIMUM_PROCESSORS];
 
+/* Depth below which the lists are never shrunk */
+#define MINIMUM_LOOKASIDE_DEPTH 4
+
+/* A list allocating less than this between two scans is considered idle */
+#define MINIMUM_ALLOCATION_THRESHOLD 25
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 CODE_SEG("INIT")
@@ -119,6 +125,83 @@ ExpInitLookasideLists(VOID)
     }
 }
 
+static
+VOID
+ExpComputeLookasideDepth(IN PGENERAL_LOOKASIDE Lookaside,
+                         IN BOOLEAN ListUsesMisses)
+{
+    ULONG Allocates, Misses, MissRatio, Target;
+
+    /* Get what happened since the last scan */
+    Allocates = Lookaside->TotalAllocates - Lookaside->LastTotalAllocates;
+    Lookaside->LastTotalAllocates = Lookaside->TotalAllocates;
+    Misses = Lookaside->AllocateMisses - Lookaside->LastAllocateMisses;
+    Lookaside->LastAllocateMisses = Lookaside->AllocateMisses;
+
+    /* Some lists count hits instead (the union makes the fields the same) */
+    if (!ListUsesMisses)
+    {
+        Misses = (Misses <= Allocates) ? (Allocates - Misses) : 0;
+    }
+
+    /* Compute the miss ratio, in tenths of percent */
+    MissRatio = (Allocates >= MINIMUM_ALLOCATION_THRESHOLD) ?
+                (ULONG)(((ULONGLONG)Misses * 1000) / Allocates) : 0;
+
+    /* If the list is idle or almost always hits, slowly give back memory */
+    if (MissRatio < 5)
+    {
+        if (Lookaside->Depth > MINIMUM_LOOKASIDE_DEPTH) Lookaside->Depth--;
+        return;
+    }
+
+    /* Otherwise, grow it by a part of what's left, proportional to the miss ratio */
+    Target = Lookaside->Depth +
+             ((Lookaside->MaximumDepth - Lookaside->Depth) * MissRatio) / (1000 * 2) + 5;
+    Lookaside->Depth = (USHORT)min(Target, Lookaside->MaximumDepth);
+}
+
+static
+VOID
+ExpScanLookasideListHead(IN PLIST_ENTRY ListHead,
+                         IN BOOLEAN ListUsesMisses)
+{
+    PLIST_ENTRY ListEntry;
+    PGENERAL_LOOKASIDE Lookaside;
+
+    for (ListEntry = ListHead->Flink;
+         ListEntry != ListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Lookaside = CONTAINING_RECORD(ListEntry, GENERAL_LOOKASIDE, ListEntry);
+        ExpComputeLookasideDepth(Lookaside, ListUsesMisses);
+    }
+}
+
+/*
+ * Called every second by the balance set manager, to fit the depth of the
+ * lookaside lists to how much they are used. This covers the per-processor
+ * lists too, as they are all on the system and pool lists.
+ */
+VOID
+NTAPI
+ExAdjustLookasideDepth(VOID)
+{
+    KIRQL OldIrql;
+
+    /* The pool lists count hits, the other ones count misses */
+    ExpScanLookasideListHead(&ExPoolLookasideListHead, FALSE);
+    ExpScanLookasideListHead(&ExSystemLookasideListHead, TRUE);
+
+    KeAcquireSpinLock(&ExpNonPagedLookasideListLock, &OldIrql);
+    ExpScanLookasideListHead(&ExpNonPagedLookasideListHead, TRUE);
+    KeReleaseSpinLock(&ExpNonPagedLookasideListLock, OldIrql);
+
+    KeAcquireSpinLock(&ExpPagedLookasideListLock, &OldIrql);
+    ExpScanLookasideListHead(&ExpPagedLookasideListHead, TRUE);
+    KeReleaseSpinLock(&ExpPagedLookasideListLock, OldIrql);
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
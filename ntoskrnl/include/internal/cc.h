@@ -44,6 +44,7 @@ extern LIST_ENTRY DirtyVacbListHead;
 extern ULONG CcDirtyPageThreshold;
 extern ULONG CcTotalDirtyPages;
 extern LIST_ENTRY CcDeferredWrites;
+extern LIST_ENTRY CcCleanSharedCacheMapList;
 extern KSPIN_LOCK CcDeferredWriteSpinLock;
 extern ULONG CcNumberWorkerThreads;
 extern LIST_ENTRY CcIdleWorkerThreadList;
@@ -65,6 +66,10 @@ extern ULONG CcPinReadNoWait;
 extern ULONG CcPinMappedDataCount;
 extern ULONG CcDataPages;
 extern ULONG CcDataFlushes;
+extern ULONG CcReadAheadIos;
+extern ULONG CcReadAheadHits;
+extern ULONG CcReadAheadMisses;
+extern ULONG CcClusteredWrites;
 
 typedef struct _PF_SCENARIO_ID
 {
@@ -167,6 +172,42 @@ typedef struct _PFSN_PREFETCHER_GLOBALS
     LONG ActivePrefetches;
 } PFSN_PREFETCHER_GLOBALS, *PPFSN_PREFETCHER_GLOBALS;
 
+/*
+ * The VACBs of a shared cache map are indexed by FileOffset / VACB_MAPPING_GRANULARITY
+ * in a sparse radix tree of VACB_LEVEL_ENTRIES wide levels. The tree gets taller as
+ * views are created further in the file, and levels are freed once they are empty.
+ * It is protected by the CacheMapLock of the shared cache map.
+ */
+#define VACB_LEVEL_SHIFT    7
+#define VACB_LEVEL_ENTRIES  (1 << VACB_LEVEL_SHIFT)
+#define VACB_LEVEL_MASK     (VACB_LEVEL_ENTRIES - 1)
+
+typedef struct _VACB_LEVEL
+{
+    ULONG ActiveEntries;
+    PVOID Entries[VACB_LEVEL_ENTRIES];
+} VACB_LEVEL, *PVACB_LEVEL;
+
+/*
+ * Read ahead keeps a window of data ahead of sequential and strided readers.
+ * The window doubles each time it gets refilled, up to the maximum, and
+ * starts over whenever the access pattern is lost.
+ */
+#define CC_READ_AHEAD_MIN_WINDOW        VACB_MAPPING_GRANULARITY
+#define CC_READ_AHEAD_MAX_WINDOW        (8 * VACB_MAPPING_GRANULARITY)
+#define CC_READ_AHEAD_MAX_IN_FLIGHT     4
+
+typedef struct _ROS_PRIVATE_CACHE_MAP
+{
+    PRIVATE_CACHE_MAP Map;
+
+    /* ROS specific, protected by the ReadAheadSpinLock */
+    LONGLONG ReadAheadStride;   /* Distance between the last two reads */
+    LONGLONG ReadAheadEnd;      /* Where the next read ahead will start */
+    ULONG ReadAheadWindow;      /* Size of the next read ahead */
+    ULONG ReadAheadsInFlight;   /* Read ahead work items queued or running */
+} ROS_PRIVATE_CACHE_MAP, *PROS_PRIVATE_CACHE_MAP;
+
 typedef struct _ROS_SHARED_CACHE_MAP
 {
     CSHORT NodeTypeCode;
@@ -184,10 +225,12 @@ typedef struct _ROS_SHARED_CACHE_MAP
     LIST_ENTRY PrivateList;
     ULONG DirtyPageThreshold;
     KSPIN_LOCK BcbSpinLock;
-    PRIVATE_CACHE_MAP PrivateCacheMap;
+    ROS_PRIVATE_CACHE_MAP PrivateCacheMap;
 
     /* ROS specific */
     LIST_ENTRY CacheMapVacbListHead;
+    PVACB_LEVEL VacbIndex;
+    ULONG VacbIndexDepth;
     BOOLEAN PinAccess;
     KSPIN_LOCK CacheMapLock;
 #if DBG
@@ -197,6 +240,14 @@ typedef struct _ROS_SHARED_CACHE_MAP
 
 #define READAHEAD_DISABLED 0x1
 #define WRITEBEHIND_DISABLED 0x2
+#define WRITEBEHIND_ACTIVE 0x4
+
+/*
+ * Write behind writes the dirty VACBs of a file in file offset order, by
+ * batches, and writes up to CC_WRITE_CLUSTER_VACBS adjacent ones at once.
+ */
+#define CC_WRITE_CLUSTER_VACBS  8
+#define CC_WRITE_BEHIND_BATCH   64
 
 typedef struct _ROS_VACB
 {
@@ -210,6 +261,8 @@ typedef struct _ROS_VACB
     BOOLEAN Dirty;
     /* Page out in progress */
     BOOLEAN PageOut;
+    /* Was read by read ahead, and not copied from yet. */
+    BOOLEAN ReadAhead;
     ULONG MappedCount;
     /* Entry in the list of VACBs for this shared cache map. */
     LIST_ENTRY CacheMapVacbListEntry;
@@ -255,10 +308,15 @@ typedef struct _WORK_QUEUE_ENTRY
         struct
         {
             FILE_OBJECT *FileObject;
+            LONGLONG FileOffset;
+            LONGLONG Stride;
+            ULONG Length;
+            ULONG Count;
         } Read;
         struct
         {
-            SHARED_CACHE_MAP *SharedCacheMap;
+            struct _ROS_SHARED_CACHE_MAP *SharedCacheMap;
+            ULONG Target;
         } Write;
         struct
         {
@@ -275,9 +333,9 @@ typedef struct _WORK_QUEUE_ENTRY
 typedef enum _WORK_QUEUE_FUNCTIONS
 {
     ReadAhead = 1,
-    WriteBehind = 2,
     LazyScan = 3,
     SetDone = 4,
+    WriteBehindFile = 5,
 } WORK_QUEUE_FUNCTIONS, *PWORK_QUEUE_FUNCTIONS;
 
 extern LAZY_WRITER LazyWriter;
@@ -311,6 +369,25 @@ NTSTATUS
 NTAPI
 CcRosFlushVacb(PROS_VACB Vacb);
 
+NTSTATUS
+NTAPI
+CcRosFlushVacbs(
+    PROS_VACB *Vacbs,
+    ULONG Count);
+
+NTSTATUS
+NTAPI
+CcRosFlushFileDirtyPages(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    ULONG Target,
+    PULONG Count,
+    BOOLEAN Wait);
+
+BOOLEAN
+CcRosCanFlushFile(
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    BOOLEAN CalledFromLazy);
+
 NTSTATUS
 NTAPI
 CcRosGetVacb(
@@ -338,6 +415,12 @@ NTSTATUS
 NTAPI
 CcWriteVirtualAddress(PROS_VACB Vacb);
 
+NTSTATUS
+NTAPI
+CcWriteVirtualAddresses(
+    PROS_VACB *Vacbs,
+    ULONG Count);
+
 BOOLEAN
 NTAPI
 CcInitializeCacheManager(VOID);
@@ -357,6 +440,16 @@ CcRosLookupVacb(
     LONGLONG FileOffset
 );
 
+PROS_VACB
+CcRosFindVacbInIndex(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN LONGLONG FileOffset);
+
+VOID
+CcRosRemoveVacbFromIndex(
+    IN PROS_SHARED_CACHE_MAP SharedCacheMap,
+    IN PROS_VACB Vacb);
+
 VOID
 NTAPI
 CcInitCacheZeroPage(VOID);
@@ -465,7 +558,11 @@ CcPostWorkQueue(
 
 VOID
 CcPerformReadAhead(
-    IN PFILE_OBJECT FileObject);
+    IN PFILE_OBJECT FileObject,
+    IN LONGLONG FileOffset,
+    IN ULONG Length,
+    IN LONGLONG Stride,
+    IN ULONG Count);
 
 NTSTATUS
 CcRosInternalFreeVacb(
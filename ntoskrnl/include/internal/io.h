@@ -86,6 +86,27 @@
 //
 #define IOP_MAX_REPARSE_TRAVERSAL 0x20
 
+//
+// FileIoCompletionNotificationInformation appeared with Windows 2003 SP2,
+// but our headers only define it for Vista and later
+//
+#if (NTDDI_VERSION < NTDDI_VISTA)
+#define FileIoCompletionNotificationInformation (FileShortNameInformation + 1)
+#endif
+
+//
+// Upper bound of the file information classes the I/O Manager knows about
+//
+#define IOP_MAXIMUM_FILE_INFORMATION (FileIoCompletionNotificationInformation + 1)
+
+//
+// Completion notification modes accepted for a file object
+//
+#define IOP_VALID_COMPLETION_NOTIFICATION_FLAGS     \
+    (FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |         \
+     FILE_SKIP_SET_EVENT_ON_HANDLE |                \
+     FILE_SKIP_SET_USER_EVENT_ON_FAST_IO)
+
 //
 // Private flags for IoCreateFile / IoParseDevice
 //
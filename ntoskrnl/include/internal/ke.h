@@ -712,6 +712,17 @@ VOID
 FASTCALL
 KiActivateWaiterQueue(IN PKQUEUE Queue);
 
+ULONG
+NTAPI
+KeRemoveQueueEx(
+    IN PKQUEUE Queue,
+    IN KPROCESSOR_MODE WaitMode,
+    IN BOOLEAN Alertable,
+    IN PLARGE_INTEGER Timeout OPTIONAL,
+    OUT PLIST_ENTRY *EntryArray,
+    IN ULONG Count
+);
+
 ULONG
 NTAPI
 KeQueryRuntimeProcess(IN PKPROCESS Process,
@@ -811,6 +822,11 @@ FASTCALL
 KeZeroPages(IN PVOID Address,
             IN ULONG Size);
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size);
+
 BOOLEAN
 FASTCALL
 KeInvalidAccessAllowed(IN PVOID TrapInformation OPTIONAL);
@@ -1014,6 +1014,16 @@ NTAPI
 MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
                       IN PFN_NUMBER NumberOfPages);
 
+PMMPTE
+NTAPI
+MiReserveZeroingPtes(VOID);
+
+PVOID
+NTAPI
+MiMapPagesInZeroingPtes(IN PMMPTE ZeroingPtes,
+                        IN PMMPFN Pfn1,
+                        IN PFN_NUMBER NumberOfPages);
+
 VOID
 NTAPI
 MiUnmapPagesInZeroSpace(IN PVOID VirtualAddress,
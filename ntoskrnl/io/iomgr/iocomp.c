@@ -25,6 +25,9 @@ GENERIC_MAPPING IopCompletionMapping =
     IO_COMPLETION_ALL_ACCESS
 };
 
+/* Maximum number of packets NtRemoveIoCompletionEx removes in a single call */
+#define IOP_MAX_REMOVE_COMPLETION_ENTRIES 64
+
 static const INFORMATION_CLASS_INFO IoCompletionInfoClass[] =
 {
      /* IoCompletionBasicInformation */
@@ -95,6 +98,48 @@ IopFreeMiniPacket(PIOP_MINI_COMPLETION_PACKET Packet)
     InterlockedPushEntrySList(&List->L.ListHead, (PSLIST_ENTRY)Packet);
 }
 
+static
+VOID
+IopGetCompletionPacket(IN PLIST_ENTRY ListEntry,
+                       OUT PFILE_IO_COMPLETION_INFORMATION Information)
+{
+    PIOP_MINI_COMPLETION_PACKET Packet;
+    PIRP Irp;
+
+    /* Get the Packet Data */
+    Packet = CONTAINING_RECORD(ListEntry,
+                               IOP_MINI_COMPLETION_PACKET,
+                               ListEntry);
+
+    /* Check if this is piggybacked on an IRP */
+    if (Packet->PacketType == IopCompletionPacketIrp)
+    {
+        /* Get the IRP */
+        Irp = CONTAINING_RECORD(ListEntry,
+                                IRP,
+                                Tail.Overlay.ListEntry);
+
+        /* Save values */
+        Information->KeyContext = Irp->Tail.CompletionKey;
+        Information->ApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
+        Information->IoStatusBlock = Irp->IoStatus;
+
+        /* Free the IRP */
+        IoFreeIrp(Irp);
+    }
+    else
+    {
+        /* Save values */
+        Information->KeyContext = Packet->KeyContext;
+        Information->ApcContext = Packet->ApcContext;
+        Information->IoStatusBlock.Status = Packet->IoStatus;
+        Information->IoStatusBlock.Information = Packet->IoStatusInformation;
+
+        /* Free the packet */
+        IopFreeMiniPacket(Packet);
+    }
+}
+
 VOID
 NTAPI
 IopDeleteIoCompletion(PVOID ObjectBody)
@@ -449,13 +494,10 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
 {
     LARGE_INTEGER SafeTimeout;
     PKQUEUE Queue;
-    PIOP_MINI_COMPLETION_PACKET Packet;
     PLIST_ENTRY ListEntry;
     KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
     NTSTATUS Status;
-    PIRP Irp;
-    PVOID Apc, Key;
-    IO_STATUS_BLOCK IoStatus;
+    FILE_IO_COMPLETION_INFORMATION Information;
     PAGED_CODE();
 
     /* Check if the call was from user mode */
@@ -506,46 +548,16 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
         }
         else
         {
-            /* Get the Packet Data */
-            Packet = CONTAINING_RECORD(ListEntry,
-                                       IOP_MINI_COMPLETION_PACKET,
-                                       ListEntry);
-
-            /* Check if this is piggybacked on an IRP */
-            if (Packet->PacketType == IopCompletionPacketIrp)
-            {
-                /* Get the IRP */
-                Irp = CONTAINING_RECORD(ListEntry,
-                                        IRP,
-                                        Tail.Overlay.ListEntry);
-
-                /* Save values */
-                Key = Irp->Tail.CompletionKey;
-                Apc = Irp->Overlay.AsynchronousParameters.UserApcContext;
-                IoStatus = Irp->IoStatus;
-
-                /* Free the IRP */
-                IoFreeIrp(Irp);
-            }
-            else
-            {
-                /* Save values */
-                Key = Packet->KeyContext;
-                Apc = Packet->ApcContext;
-                IoStatus.Status = Packet->IoStatus;
-                IoStatus.Information = Packet->IoStatusInformation;
-
-                /* Free the packet */
-                IopFreeMiniPacket(Packet);
-            }
+            /* Get the packet data, and free it */
+            IopGetCompletionPacket(ListEntry, &Information);
 
             /* Enter SEH to write back the values */
             _SEH2_TRY
             {
                 /* Write the values to caller */
-                *ApcContext = Apc;
-                *KeyContext = Key;
-                *IoStatusBlock = IoStatus;
+                *ApcContext = Information.ApcContext;
+                *KeyContext = Information.KeyContext;
+                *IoStatusBlock = Information.IoStatusBlock;
             }
             _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
@@ -563,6 +575,126 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
     return Status;
 }
 
+NTSTATUS
+NTAPI
+NtRemoveIoCompletionEx(IN HANDLE IoCompletionHandle,
+                       OUT PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                       IN ULONG Count,
+                       OUT PULONG NumEntriesRemoved,
+                       IN PLARGE_INTEGER Timeout OPTIONAL,
+                       IN BOOLEAN Alertable)
+{
+    LARGE_INTEGER SafeTimeout;
+    PKQUEUE Queue;
+    PLIST_ENTRY EntryArray[IOP_MAX_REMOVE_COMPLETION_ENTRIES];
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    NTSTATUS Status;
+    FILE_IO_COMPLETION_INFORMATION Information;
+    ULONG Entries, i;
+    PAGED_CODE();
+
+    /* The caller must want at least one entry */
+    if (!Count) return STATUS_INVALID_PARAMETER;
+
+    /* We can't remove more entries than we have room for on the stack */
+    Count = min(Count, IOP_MAX_REMOVE_COMPLETION_ENTRIES);
+
+    /* Check if the call was from user mode */
+    if (PreviousMode != KernelMode)
+    {
+        /* Protect probes in SEH */
+        _SEH2_TRY
+        {
+            /* Probe the entry array and the count */
+            ProbeForWrite(IoCompletionInformation,
+                          Count * sizeof(FILE_IO_COMPLETION_INFORMATION),
+                          sizeof(PVOID));
+            ProbeForWriteUlong(NumEntriesRemoved);
+            if (Timeout)
+            {
+                /* Probe and capture the timeout */
+                SafeTimeout = ProbeForReadLargeInteger(Timeout);
+                Timeout = &SafeTimeout;
+            }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Return the exception code */
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* Open the Object */
+    Status = ObReferenceObjectByHandle(IoCompletionHandle,
+                                       IO_COMPLETION_MODIFY_STATE,
+                                       IoCompletionType,
+                                       PreviousMode,
+                                       (PVOID*)&Queue,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Remove as many entries as are available, with a single wait */
+    Entries = KeRemoveQueueEx(Queue,
+                              PreviousMode,
+                              Alertable,
+                              Timeout,
+                              EntryArray,
+                              Count);
+
+    /* If we got a timeout, an alert or user_apc back, return the status */
+    if ((Entries == 1) &&
+        (((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_TIMEOUT) ||
+         ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_USER_APC) ||
+         ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_ALERTED)))
+    {
+        /* Set this as the status, nothing was removed */
+        Status = (NTSTATUS)(ULONG_PTR)EntryArray[0];
+        Entries = 0;
+    }
+
+    /* Loop every packet we removed */
+    for (i = 0; i < Entries; i++)
+    {
+        /* Get the packet data, and free it */
+        IopGetCompletionPacket(EntryArray[i], &Information);
+
+        /* Don't bother writing it if the caller's buffer already faulted */
+        if (!NT_SUCCESS(Status)) continue;
+
+        /* Enter SEH to write back the values */
+        _SEH2_TRY
+        {
+            IoCompletionInformation[i] = Information;
+        }
+        _SEH2_EXCEPT(ExSystemExceptionFilter())
+        {
+            /* Get the exception code */
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+    }
+
+    /* Return the number of entries we removed */
+    if (NT_SUCCESS(Status))
+    {
+        _SEH2_TRY
+        {
+            *NumEntriesRemoved = Entries;
+        }
+        _SEH2_EXCEPT(ExSystemExceptionFilter())
+        {
+            /* Get the exception code */
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+    }
+
+    /* Dereference the Object and return status */
+    ObDereferenceObject(Queue);
+    return Status;
+}
+
 NTSTATUS
 NTAPI
 NtSetIoCompletion(IN HANDLE IoCompletionPortHandle,
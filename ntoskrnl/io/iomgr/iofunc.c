@@ -431,10 +431,13 @@ IopDeviceFsIoControl(IN HANDLE DeviceHandle,
                     CompletionInfo = *(FileObject->CompletionContext);
                 }
 
-                /* If we had an event, signal it */
+                /* If we had an event, signal it unless asked not to */
                 if (Event)
                 {
-                    KeSetEvent(EventObject, IO_NO_INCREMENT, FALSE);
+                    if (!(FileObject->Flags & FO_SKIP_SET_FAST_IO))
+                    {
+                        KeSetEvent(EventObject, IO_NO_INCREMENT, FALSE);
+                    }
                     ObDereferenceObject(EventObject);
                 }
 
@@ -445,7 +448,9 @@ IopDeviceFsIoControl(IN HANDLE DeviceHandle,
                 }
 
                 /* Set completion if required */
-                if (CompletionInfo.Port != NULL && UserApcContext != NULL)
+                if (CompletionInfo.Port != NULL && UserApcContext != NULL &&
+                    !((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&
+                      NT_SUCCESS(KernelIosb.Status)))
                 {
                     if (!NT_SUCCESS(IoSetIoCompletion(CompletionInfo.Port,
                                                       CompletionInfo.Key,
@@ -1026,6 +1031,81 @@ IopGetFileMode(IN PFILE_OBJECT FileObject)
     return Mode;
 }
 
+static
+ULONG
+IopGetCompletionNotificationModes(IN PFILE_OBJECT FileObject)
+{
+    ULONG Modes = 0;
+
+    if (FileObject->Flags & FO_SKIP_COMPLETION_PORT)
+        Modes |= FILE_SKIP_COMPLETION_PORT_ON_SUCCESS;
+
+    if (FileObject->Flags & FO_SKIP_SET_EVENT)
+        Modes |= FILE_SKIP_SET_EVENT_ON_HANDLE;
+
+    if (FileObject->Flags & FO_SKIP_SET_FAST_IO)
+        Modes |= FILE_SKIP_SET_USER_EVENT_ON_FAST_IO;
+
+    return Modes;
+}
+
+static
+NTSTATUS
+IopSetCompletionNotificationModes(IN PFILE_OBJECT FileObject,
+                                  IN PFILE_IO_COMPLETION_NOTIFICATION_INFORMATION Information,
+                                  OUT PIO_STATUS_BLOCK IoStatusBlock)
+{
+    ULONG Modes, Flags = 0;
+    NTSTATUS Status;
+
+    /* Capture the new modes */
+    _SEH2_TRY
+    {
+        Modes = Information->Flags;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    /*
+     * Synchronous file objects never complete to a port nor signal
+     * the file object for the caller, so there's nothing to skip.
+     */
+    if ((Modes & ~IOP_VALID_COMPLETION_NOTIFICATION_FLAGS) ||
+        (FileObject->Flags & FO_SYNCHRONOUS_IO))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Modes & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)
+        Flags |= FO_SKIP_COMPLETION_PORT;
+
+    if (Modes & FILE_SKIP_SET_EVENT_ON_HANDLE)
+        Flags |= FO_SKIP_SET_EVENT;
+
+    if (Modes & FILE_SKIP_SET_USER_EVENT_ON_FAST_IO)
+        Flags |= FO_SKIP_SET_FAST_IO;
+
+    /* The modes can only be turned on, never back off */
+    InterlockedOr((PLONG)&FileObject->Flags, Flags);
+
+    /* Fill out the I/O Status Block */
+    _SEH2_TRY
+    {
+        IoStatusBlock->Information = 0;
+        Status = IoStatusBlock->Status = STATUS_SUCCESS;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    return Status;
+}
+
 static
 BOOLEAN
 IopGetMountFlag(IN PDEVICE_OBJECT DeviceObject)
@@ -1868,15 +1948,20 @@ NtLockFile(IN HANDLE FileHandle,
             }
             _SEH2_END;
 
-            /* If we had an event, signal it */
+            /* If we had an event, signal it unless asked not to */
             if (EventHandle)
             {
-                KeSetEvent(Event, IO_NO_INCREMENT, FALSE);
+                if (!(FileObject->Flags & FO_SKIP_SET_FAST_IO))
+                {
+                    KeSetEvent(Event, IO_NO_INCREMENT, FALSE);
+                }
                 ObDereferenceObject(Event);
             }
 
             /* Set completion if required */
-            if (FileObject->CompletionContext != NULL && ApcContext != NULL)
+            if (FileObject->CompletionContext != NULL && ApcContext != NULL &&
+                !((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&
+                  NT_SUCCESS(KernelIosb.Status)))
             {
                 if (!NT_SUCCESS(IoSetIoCompletion(FileObject->CompletionContext->Port,
                                                   FileObject->CompletionContext->Key,
@@ -2287,7 +2372,7 @@ NtQueryInformationFile(IN HANDLE FileHandle,
     {
         /* Validate the information class */
         if ((FileInformationClass < 0) ||
-            (FileInformationClass >= FileMaximumInformation) ||
+            (FileInformationClass >= IOP_MAXIMUM_FILE_INFORMATION) ||
             !(IopQueryOperationLength[FileInformationClass]))
         {
             /* Invalid class */
@@ -2322,7 +2407,7 @@ NtQueryInformationFile(IN HANDLE FileHandle,
     {
         /* Validate the information class */
         if ((FileInformationClass < 0) ||
-            (FileInformationClass >= FileMaximumInformation) ||
+            (FileInformationClass >= IOP_MAXIMUM_FILE_INFORMATION) ||
             !(IopQueryOperationLength[FileInformationClass]))
         {
             /* Invalid class */
@@ -2348,6 +2433,32 @@ NtQueryInformationFile(IN HANDLE FileHandle,
                                        &HandleInformation);
     if (!NT_SUCCESS(Status)) return Status;
 
+    /* The completion notification modes live in the file object itself */
+    if (FileInformationClass == FileIoCompletionNotificationInformation)
+    {
+        /* Protect write in SEH */
+        _SEH2_TRY
+        {
+            /* Translate the file object flags */
+            ((PFILE_IO_COMPLETION_NOTIFICATION_INFORMATION)FileInformation)->
+                Flags = IopGetCompletionNotificationModes(FileObject);
+
+            /* Fill out the I/O Status Block */
+            IoStatusBlock->Information = sizeof(FILE_IO_COMPLETION_NOTIFICATION_INFORMATION);
+            Status = IoStatusBlock->Status = STATUS_SUCCESS;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Get the exception code */
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+
+        /* Dereference the file and return */
+        ObDereferenceObject(FileObject);
+        return Status;
+    }
+
     /* Check if this is a direct open or not */
     if (FileObject->Flags & FO_DIRECT_DEVICE_OPEN)
     {
@@ -3098,7 +3209,7 @@ NtSetInformationFile(IN HANDLE FileHandle,
     {
         /* Validate the information class */
         if ((FileInformationClass < 0) ||
-            (FileInformationClass >= FileMaximumInformation) ||
+            (FileInformationClass >= IOP_MAXIMUM_FILE_INFORMATION) ||
             !(IopSetOperationLength[FileInformationClass]))
         {
             /* Invalid class */
@@ -3135,7 +3246,7 @@ NtSetInformationFile(IN HANDLE FileHandle,
     {
         /* Validate the information class */
         if ((FileInformationClass < 0) ||
-            (FileInformationClass >= FileMaximumInformation) ||
+            (FileInformationClass >= IOP_MAXIMUM_FILE_INFORMATION) ||
             !(IopSetOperationLength[FileInformationClass]))
         {
             /* Invalid class */
@@ -3160,6 +3271,16 @@ NtSetInformationFile(IN HANDLE FileHandle,
                                        NULL);
     if (!NT_SUCCESS(Status)) return Status;
 
+    /* The completion notification modes are handled without the driver */
+    if (FileInformationClass == FileIoCompletionNotificationInformation)
+    {
+        Status = IopSetCompletionNotificationModes(FileObject,
+                                                   FileInformation,
+                                                   IoStatusBlock);
+        ObDereferenceObject(FileObject);
+        return Status;
+    }
+
     /* Check if this is a direct open or not */
     if (FileObject->Flags & FO_DIRECT_DEVICE_OPEN)
     {
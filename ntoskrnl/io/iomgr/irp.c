@@ -246,6 +246,7 @@ IopCompleteRequest(IN PKAPC Apc,
     PMDL Mdl, NextMdl;
     PVOID Port = NULL, Key = NULL;
     BOOLEAN SignaledCreateRequest = FALSE;
+    BOOLEAN CompletedInline;
 
     /* Get data from the APC */
     FileObject = (PFILE_OBJECT)*SystemArgument1;
@@ -332,8 +333,18 @@ IopCompleteRequest(IN PKAPC Apc,
         (Irp->PendingReturned &&
          !IsIrpSynchronous(Irp, FileObject)))
     {
+        /*
+         * If the request succeeded without ever pending, the caller already
+         * got its result from the system call. The file object may have been
+         * told not to queue a completion packet in that case.
+         */
+        CompletedInline = (FileObject) &&
+                          !(Irp->PendingReturned) &&
+                          NT_SUCCESS(Irp->IoStatus.Status);
+
         /* Get any information we need from the FO before we kill it */
-        if ((FileObject) && (FileObject->CompletionContext))
+        if ((FileObject) && (FileObject->CompletionContext) &&
+            !((CompletedInline) && (FileObject->Flags & FO_SKIP_COMPLETION_PORT)))
         {
             /* Save Completion Data */
             Port = FileObject->CompletionContext->Port;
@@ -399,8 +410,15 @@ IopCompleteRequest(IN PKAPC Apc,
         }
         else if (FileObject)
         {
-            /* Signal the file object and set the status */
-            KeSetEvent(&FileObject->Event, 0, FALSE);
+            /*
+             * Signal the file object and set the status. The caller may have
+             * asked for the event to be left alone, whether the request
+             * completed inline or pended.
+             */
+            if (!(FileObject->Flags & FO_SKIP_SET_EVENT))
+            {
+                KeSetEvent(&FileObject->Event, 0, FALSE);
+            }
             FileObject->FinalStatus = Irp->IoStatus.Status;
 
             /*
@@ -95,6 +95,37 @@ KeZeroPages(IN PVOID Address,
     RtlZeroMemory(Address, Size);
 }
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size)
+{
+    PULONG64 Current, End;
+
+    /* Bypass the caches, the pages are usually not used right away */
+    ASSERT((Size % (4 * sizeof(ULONG64))) == 0);
+    Current = Address;
+    End = (PULONG64)((ULONG_PTR)Address + Size);
+    while (Current < End)
+    {
+#ifdef __GNUC__
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[0]) : "r"(0ULL));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[1]) : "r"(0ULL));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[2]) : "r"(0ULL));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[3]) : "r"(0ULL));
+#else
+        _mm_stream_si64x((__int64*)&Current[0], 0);
+        _mm_stream_si64x((__int64*)&Current[1], 0);
+        _mm_stream_si64x((__int64*)&Current[2], 0);
+        _mm_stream_si64x((__int64*)&Current[3], 0);
+#endif
+        Current += 4;
+    }
+
+    /* Make the stores visible before the pages get used */
+    _mm_sfence();
+}
+
 PVOID
 KiSwitchKernelStackHelper(
     LONG_PTR StackOffset,
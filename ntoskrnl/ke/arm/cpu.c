@@ -60,6 +60,15 @@ KeZeroPages(IN PVOID Address,
     RtlZeroMemory(Address, Size);
 }
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size)
+{
+    /* No non-temporal stores here */
+    RtlZeroMemory(Address, Size);
+}
+
 VOID
 NTAPI
 KiSaveProcessorControlState(OUT PKPROCESSOR_STATE ProcessorState)
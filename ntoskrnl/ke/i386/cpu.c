@@ -1138,6 +1138,44 @@ KeZeroPages(IN PVOID Address,
     RtlZeroMemory(Address, Size);
 }
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size)
+{
+    PULONG Current, End;
+
+    /* Without SSE2, there are no non-temporal stores */
+    if (!(KeFeatureBits & KF_XMMI64))
+    {
+        RtlZeroMemory(Address, Size);
+        return;
+    }
+
+    /* Bypass the caches, the pages are usually not used right away */
+    ASSERT((Size % (4 * sizeof(ULONG))) == 0);
+    Current = Address;
+    End = (PULONG)((ULONG_PTR)Address + Size);
+    while (Current < End)
+    {
+#ifdef __GNUC__
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[0]) : "r"(0));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[1]) : "r"(0));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[2]) : "r"(0));
+        __asm__ __volatile__("movnti %1, %0" : "=m"(Current[3]) : "r"(0));
+#else
+        _mm_stream_si32((int*)&Current[0], 0);
+        _mm_stream_si32((int*)&Current[1], 0);
+        _mm_stream_si32((int*)&Current[2], 0);
+        _mm_stream_si32((int*)&Current[3], 0);
+#endif
+        Current += 4;
+    }
+
+    /* Make the stores visible before the pages get used */
+    _mm_sfence();
+}
+
 VOID
 NTAPI
 KiSaveProcessorState(IN PKTRAP_FRAME TrapFrame,
@@ -16,6 +16,37 @@
 
 /* PRIVATE FUNCTIONS *********************************************************/
 
+/*
+ * Removes the first entry of a queue which is known not to be empty.
+ * Must be called with the dispatcher lock held.
+ */
+FORCEINLINE
+PLIST_ENTRY
+KiRemoveFirstQueueEntry(IN PKQUEUE Queue)
+{
+    PLIST_ENTRY QueueEntry = Queue->EntryListHead.Flink;
+
+    /* Decrease the number of entries */
+    Queue->Header.SignalState--;
+
+    /* Check if the entry is valid. If not, bugcheck */
+    if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+    {
+        /* Invalid item */
+        KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
+                     (ULONG_PTR)QueueEntry,
+                     (ULONG_PTR)Queue,
+                     (ULONG_PTR)NULL,
+                     (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
+                                 WorkerRoutine);
+    }
+
+    /* Remove the Entry */
+    RemoveEntryList(QueueEntry);
+    QueueEntry->Flink = NULL;
+    return QueueEntry;
+}
+
 /*
  * Called when a thread which has a queue entry is entering a wait state
  */
@@ -233,14 +264,20 @@ KeReadStateQueue(IN PKQUEUE Queue)
 /*
  * @implemented
  */
-PLIST_ENTRY
+ULONG
 NTAPI
-KeRemoveQueue(IN PKQUEUE Queue,
-              IN KPROCESSOR_MODE WaitMode,
-              IN PLARGE_INTEGER Timeout OPTIONAL)
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
 {
-    PLIST_ENTRY QueueEntry;
+    PLIST_ENTRY QueueEntry = NULL;
+    ULONG Entries = 0;
     LONG_PTR Status;
+    NTSTATUS WaitStatus;
+    KIRQL OldIrql;
     PKTHREAD Thread = KeGetCurrentThread();
     PKQUEUE PreviousQueue;
     PKWAIT_BLOCK WaitBlock = &Thread->WaitBlock[0];
@@ -252,6 +289,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
     ULONG Hand = 0;
     ASSERT_QUEUE(Queue);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+    ASSERT(Count != 0);
 
     /* Check if the Lock is already held */
     if (Thread->WaitNext)
@@ -306,27 +344,14 @@ KeRemoveQueue(IN PKQUEUE Queue,
         if ((Queue->CurrentCount < Queue->MaximumCount) &&
             (QueueEntry != &Queue->EntryListHead))
         {
-            /* Decrease the number of entries */
-            Queue->Header.SignalState--;
-
             /* Increase numbef of running threads */
             Queue->CurrentCount++;
 
-            /* Check if the entry is valid. If not, bugcheck */
-            if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+            /* Remove as many entries as the caller can take */
+            do
             {
-                /* Invalid item */
-                KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
-                             (ULONG_PTR)QueueEntry,
-                             (ULONG_PTR)Queue,
-                             (ULONG_PTR)NULL,
-                             (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
-                                         WorkerRoutine);
-            }
-
-            /* Remove the Entry */
-            RemoveEntryList(QueueEntry);
-            QueueEntry->Flink = NULL;
+                EntryArray[Entries++] = KiRemoveFirstQueueEntry(Queue);
+            } while ((Entries < Count) && !IsListEmpty(&Queue->EntryListHead));
 
             /* Nothing to wait on */
             break;
@@ -344,12 +369,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if we were alerted, or if there's a User APC Pending */
+                WaitStatus = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (WaitStatus != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    QueueEntry = (PLIST_ENTRY)(ULONG_PTR)WaitStatus;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -404,7 +429,29 @@ KeRemoveQueue(IN PKQUEUE Queue,
                 Thread->WaitReason = 0;
 
                 /* Check if we were executing an APC */
-                if (Status != STATUS_KERNEL_APC) return (PLIST_ENTRY)Status;
+                if (Status != STATUS_KERNEL_APC)
+                {
+                    /* We weren't, so this is either an entry or a status */
+                    EntryArray[0] = (PLIST_ENTRY)Status;
+                    Entries = 1;
+
+                    /* If we got an entry, also take the ones queued since */
+                    if ((Count > 1) &&
+                        (Status != STATUS_TIMEOUT) &&
+                        (Status != STATUS_USER_APC) &&
+                        (Status != STATUS_ALERTED))
+                    {
+                        OldIrql = KiAcquireDispatcherLock();
+                        while ((Entries < Count) &&
+                               !IsListEmpty(&Queue->EntryListHead))
+                        {
+                            EntryArray[Entries++] = KiRemoveFirstQueueEntry(Queue);
+                        }
+                        KiReleaseDispatcherLock(OldIrql);
+                    }
+
+                    return Entries;
+                }
 
                 /* Check if we had a timeout */
                 if (Timeout)
@@ -424,9 +471,28 @@ KeRemoveQueue(IN PKQUEUE Queue,
         }
     }
 
+    /* If we didn't get any entry, return the status in the first one */
+    if (!Entries) EntryArray[Entries++] = QueueEntry;
+
     /* Unlock Database and return */
     KiReleaseDispatcherLockFromSynchLevel();
     KiExitDispatcher(Thread->WaitIrql);
+    return Entries;
+}
+
+/*
+ * @implemented
+ */
+PLIST_ENTRY
+NTAPI
+KeRemoveQueue(IN PKQUEUE Queue,
+              IN KPROCESSOR_MODE WaitMode,
+              IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    PLIST_ENTRY QueueEntry;
+
+    /* Do a single entry, non-alertable removal */
+    KeRemoveQueueEx(Queue, WaitMode, FALSE, Timeout, &QueueEntry, 1);
     return QueueEntry;
 }
 
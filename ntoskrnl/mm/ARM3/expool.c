@@ -31,7 +31,9 @@ typedef struct _POOL_DPC_CONTEXT
 } POOL_DPC_CONTEXT, *PPOOL_DPC_CONTEXT;
 
 ULONG ExpNumberOfPagedPools;
+ULONG ExpNumberOfNonPagedPools;
 POOL_DESCRIPTOR NonPagedPoolDescriptor;
+PPOOL_DESCRIPTOR ExpNonPagedPoolDescriptor[MAXIMUM_PROCESSORS];
 PPOOL_DESCRIPTOR ExpPagedPoolDescriptor[16 + 1];
 PPOOL_DESCRIPTOR PoolVector[2];
 PKGUARDED_MUTEX ExpPagedPoolMutex;
@@ -39,6 +41,7 @@ SIZE_T PoolTrackTableSize, PoolTrackTableMask;
 SIZE_T PoolBigPageTableSize, PoolBigPageTableHash;
 ULONG ExpBigTableExpansionFailed;
 PPOOL_TRACKER_TABLE PoolTrackTable;
+PPOOL_TRACKER_TABLE ExPoolTagTables[MAXIMUM_PROCESSORS];
 PPOOL_TRACKER_BIG_PAGES PoolBigPageTable;
 KSPIN_LOCK ExpTaggedPoolLock;
 ULONG PoolHitTag;
@@ -462,6 +465,69 @@ ExpComputePartialHashForAddress(IN PVOID BaseAddress)
     return (Result >> 24) ^ (Result >> 16) ^ (Result >> 8) ^ Result;
 }
 
+//
+// Every processor gets its own copy of the tracker table, so that the counters
+// of the most used tags don't keep bouncing between the caches of all the
+// processors allocating with them. The keys are only ever created in the
+// global table (whose counters are the ones of the boot processor), and the
+// other tables pick them up, in the same bucket, the first time they need them.
+// The counters are folded back together when they are queried.
+//
+FORCEINLINE
+PPOOL_TRACKER_TABLE
+ExpGetPoolTagTable(VOID)
+{
+    PPOOL_TRACKER_TABLE Table;
+
+    //
+    // Until the processor tables exist, everyone uses the global one
+    //
+    Table = ExPoolTagTables[KeGetCurrentProcessorNumber()];
+    return Table ? Table : PoolTrackTable;
+}
+
+FORCEINLINE
+VOID
+ExpCapturePoolTagKey(IN PPOOL_TRACKER_TABLE TableEntry,
+                     IN ULONG Hash)
+{
+    //
+    // A bucket that is still empty in this table may already belong to a tag
+    // in the global one
+    //
+    if (!TableEntry->Key) TableEntry->Key = PoolTrackTable[Hash].Key;
+}
+
+VOID
+NTAPI
+ExpFoldPoolTrackerEntry(IN SIZE_T Index,
+                        OUT PPOOL_TRACKER_TABLE Entry)
+{
+    PPOOL_TRACKER_TABLE Table;
+    ULONG i;
+
+    //
+    // The global table owns the key, and holds the boot processor counters
+    //
+    *Entry = PoolTrackTable[Index];
+
+    //
+    // Add the counters of all the other processors
+    //
+    for (i = 1; i < MAXIMUM_PROCESSORS; i++)
+    {
+        Table = ExPoolTagTables[i];
+        if (!Table) continue;
+
+        Entry->NonPagedAllocs += Table[Index].NonPagedAllocs;
+        Entry->NonPagedFrees += Table[Index].NonPagedFrees;
+        Entry->NonPagedBytes += Table[Index].NonPagedBytes;
+        Entry->PagedAllocs += Table[Index].PagedAllocs;
+        Entry->PagedFrees += Table[Index].PagedFrees;
+        Entry->PagedBytes += Table[Index].PagedBytes;
+    }
+}
+
 #if DBG
 /*
  * FORCEINLINE
@@ -526,9 +592,11 @@ MiDumpPoolConsumers(BOOLEAN CalledFromDbg, ULONG Tag, ULONG Mask, ULONG Flags)
     //
     for (i = 0; i < PoolTrackTableSize; ++i)
     {
+        POOL_TRACKER_TABLE FoldedEntry;
         PPOOL_TRACKER_TABLE TableEntry;
 
-        TableEntry = &PoolTrackTable[i];
+        ExpFoldPoolTrackerEntry(i, &FoldedEntry);
+        TableEntry = &FoldedEntry;
 
         //
         // We only care about tags which have allocated memory
@@ -772,7 +840,7 @@ ExpRemovePoolTracker(IN ULONG Key,
     // way so that the day we DO support session pool, it won't require that
     // many changes
     //
-    Table = PoolTrackTable;
+    Table = ExpGetPoolTagTable();
     TableMask = PoolTrackTableMask;
     TableSize = PoolTrackTableSize;
     DBG_UNREFERENCED_LOCAL_VARIABLE(TableSize);
@@ -788,6 +856,7 @@ ExpRemovePoolTracker(IN ULONG Key,
         // Have we found the entry for this tag? */
         //
         TableEntry = &Table[Hash];
+        ExpCapturePoolTagKey(TableEntry, Hash);
         if (TableEntry->Key == Key)
         {
             //
@@ -865,7 +934,6 @@ ExpInsertPoolTracker(IN ULONG Key,
     // ASSERT on ReactOS features not yet supported
     //
     ASSERT(!(PoolType & SESSION_POOL_MASK));
-    ASSERT(KeGetCurrentProcessorNumber() == 0);
 
     //
     // Why the double indirection? Because normally this function is also used
@@ -875,7 +943,7 @@ ExpInsertPoolTracker(IN ULONG Key,
     // way so that the day we DO support session pool, it won't require that
     // many changes
     //
-    Table = PoolTrackTable;
+    Table = ExpGetPoolTagTable();
     TableMask = PoolTrackTableMask;
     TableSize = PoolTrackTableSize;
     DBG_UNREFERENCED_LOCAL_VARIABLE(TableSize);
@@ -891,6 +959,7 @@ ExpInsertPoolTracker(IN ULONG Key,
         // Do we already have an entry for this tag? */
         //
         TableEntry = &Table[Hash];
+        ExpCapturePoolTagKey(TableEntry, Hash);
         if (TableEntry->Key == Key)
         {
             //
@@ -915,7 +984,8 @@ ExpInsertPoolTracker(IN ULONG Key,
         {
             //
             // We need to hold the lock while creating a new entry, since other
-            // processors might be in this code path as well
+            // processors might be in this code path as well. The entry is only
+            // created in the global table, we'll pick it up from there.
             //
             ExAcquireSpinLock(&ExpTaggedPoolLock, &OldIrql);
             if (!PoolTrackTable[Hash].Key)
@@ -925,7 +995,6 @@ ExpInsertPoolTracker(IN ULONG Key,
                 //
                 ASSERT(Table[Hash].Key == 0);
                 PoolTrackTable[Hash].Key = Key;
-                TableEntry->Key = Key;
             }
             ExReleaseSpinLock(&ExpTaggedPoolLock, OldIrql);
 
@@ -1203,6 +1272,8 @@ InitializePool(IN POOL_TYPE PoolType,
         // Initialize the nonpaged pool descriptor
         //
         PoolVector[NonPagedPool] = &NonPagedPoolDescriptor;
+        ExpNonPagedPoolDescriptor[0] = &NonPagedPoolDescriptor;
+        ExpNumberOfNonPagedPools = 1;
         ExInitializePoolDescriptor(PoolVector[NonPagedPool],
                                    NonPagedPool,
                                    0,
@@ -1257,6 +1328,69 @@ InitializePool(IN POOL_TYPE PoolType,
     }
 }
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExpInitializeProcessorPools(VOID)
+{
+    PPOOL_DESCRIPTOR Descriptor;
+    PPOOL_TRACKER_TABLE Table;
+    SIZE_T TableSize;
+    ULONG i;
+
+    //
+    // This is called once all the processors have been started. On a single
+    // processor system, we'll keep using the global descriptor and table.
+    //
+    TableSize = PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE);
+    for (i = 1; i < (ULONG)KeNumberProcessors; i++)
+    {
+        //
+        // Allocate the descriptor along with its spin lock, and a tracker
+        // table of the same size as the global one
+        //
+        Descriptor = ExAllocatePoolWithTag(NonPagedPool,
+                                           sizeof(POOL_DESCRIPTOR) +
+                                           sizeof(KSPIN_LOCK),
+                                           'looP');
+        Table = MiAllocatePoolPages(NonPagedPool, TableSize);
+        if (!(Descriptor) || !(Table))
+        {
+            //
+            // This isn't fatal, the remaining processors will simply keep
+            // sharing the global descriptor and table
+            //
+            DPRINT1("EXPOOL: Out of memory for the pool of processor %lu\n", i);
+            if (Descriptor) ExFreePoolWithTag(Descriptor, 'looP');
+            if (Table) MiFreePoolPages(Table);
+            break;
+        }
+
+        //
+        // Setup the descriptor and its lock
+        //
+        KeInitializeSpinLock((PKSPIN_LOCK)(Descriptor + 1));
+        ExInitializePoolDescriptor(Descriptor,
+                                   NonPagedPool,
+                                   i,
+                                   NonPagedPoolDescriptor.Threshold,
+                                   Descriptor + 1);
+
+        //
+        // Zero the table, and track it like the global one
+        //
+        RtlZeroMemory(Table, TableSize);
+        ExpInsertPoolTracker('looP', ROUND_TO_PAGES(TableSize), NonPagedPool);
+
+        //
+        // The processor can now start using them
+        //
+        InterlockedExchangePointer((PVOID*)&ExPoolTagTables[i], Table);
+        InterlockedExchangePointer((PVOID*)&ExpNonPagedPoolDescriptor[i], Descriptor);
+        ExpNumberOfNonPagedPools = i + 1;
+    }
+}
+
 FORCEINLINE
 KIRQL
 ExLockPool(IN PPOOL_DESCRIPTOR Descriptor)
@@ -1266,6 +1400,17 @@ ExLockPool(IN PPOOL_DESCRIPTOR Descriptor)
     //
     if ((Descriptor->PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
     {
+        //
+        // The processor descriptors have their own spin lock
+        //
+        if (Descriptor->LockAddress)
+        {
+            KIRQL OldIrql;
+
+            KeAcquireSpinLock(Descriptor->LockAddress, &OldIrql);
+            return OldIrql;
+        }
+
         //
         // Use the queued spin lock
         //
@@ -1291,6 +1436,15 @@ ExUnlockPool(IN PPOOL_DESCRIPTOR Descriptor,
     //
     if ((Descriptor->PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
     {
+        //
+        // The processor descriptors have their own spin lock
+        //
+        if (Descriptor->LockAddress)
+        {
+            KeReleaseSpinLock(Descriptor->LockAddress, OldIrql);
+            return;
+        }
+
         //
         // Use the queued spin lock
         //
@@ -1313,6 +1467,7 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
                         IN PVOID SystemArgument2)
 {
     PPOOL_DPC_CONTEXT Context = DeferredContext;
+    SIZE_T i;
     UNREFERENCED_PARAMETER(Dpc);
     ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
 
@@ -1321,9 +1476,14 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
     //
     if (KeSignalCallDpcSynchronize(SystemArgument2))
     {
-        RtlCopyMemory(Context->PoolTrackTable,
-                      PoolTrackTable,
-                      Context->PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
+        //
+        // Every processor is now spinning in here, so the processor tables
+        // can be folded together without any of them changing under us
+        //
+        for (i = 0; i < Context->PoolTrackTableSize; i++)
+        {
+            ExpFoldPoolTrackerEntry(i, &Context->PoolTrackTable[i]);
+        }
 
         //
         // This is here because ReactOS does not yet support expansion
@@ -1753,10 +1913,9 @@ ExQueryPoolUsage(OUT PULONG PagedPoolPages,
     // If the system has more than one non-paged pool, copy the other descriptor
     // totals as well
     //
-#if 0
     if (ExpNumberOfNonPagedPools > 1)
     {
-        for (i = 0; i < ExpNumberOfNonPagedPools; i++)
+        for (i = 1; i < ExpNumberOfNonPagedPools; i++)
         {
             PoolDesc = ExpNonPagedPoolDescriptor[i];
             *NonPagedPoolPages += PoolDesc->TotalPages + PoolDesc->TotalBigPages;
@@ -1764,7 +1923,6 @@ ExQueryPoolUsage(OUT PULONG PagedPoolPages,
             *NonPagedPoolFrees += PoolDesc->RunningDeAllocs;
         }
     }
-#endif
 
     //
     // Get the amount of hits in the system lookaside lists
@@ -2012,6 +2170,18 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     //
     if (!NumberOfBytes) NumberOfBytes = 1;
 
+    //
+    // Small nonpaged pool blocks come from this processor's own descriptor, if
+    // it has one, so that processors don't all contend on the same lock. Big
+    // pages are always accounted in the global descriptor, since there is no
+    // header to remember where they came from.
+    //
+    if ((PoolType == NonPagedPool) &&
+        (ExpNonPagedPoolDescriptor[Prcb->Number]))
+    {
+        PoolDesc = ExpNonPagedPoolDescriptor[Prcb->Number];
+    }
+
     //
     // A pool allocation is defined by its data, a linked list to connect it to
     // the free list (if necessary), and a pool header to store accounting info.
@@ -2211,6 +2381,8 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
                 // was, and the actual size the caller needs/requested.
                 //
                 FragmentEntry->PoolType = 0;
+                FragmentEntry->PoolIndex = PoolDesc->PoolIndex;
+                Entry->PoolIndex = PoolDesc->PoolIndex;
                 BlockSize = FragmentEntry->BlockSize;
 
                 //
@@ -2332,6 +2504,7 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     // Setup the entry data
     //
     Entry->Ulong1 = 0;
+    Entry->PoolIndex = PoolDesc->PoolIndex;
     Entry->BlockSize = i;
     Entry->PoolType = OriginalType + 1;
 
@@ -2344,6 +2517,7 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     BlockSize = (PAGE_SIZE / POOL_BLOCK_SIZE) - i;
     FragmentEntry = POOL_BLOCK(Entry, i);
     FragmentEntry->Ulong1 = 0;
+    FragmentEntry->PoolIndex = PoolDesc->PoolIndex;
     FragmentEntry->BlockSize = BlockSize;
     FragmentEntry->PreviousSize = i;
 
@@ -2611,11 +2785,20 @@ ExFreePoolWithTag(IN PVOID P,
 
     //
     // Get the size of the entry, and it's pool type, then load the descriptor
-    // for this pool type
+    // for this pool type. Nonpaged pool blocks go back to the descriptor of the
+    // processor they were carved from.
     //
     BlockSize = Entry->BlockSize;
     PoolType = (Entry->PoolType - 1) & BASE_POOL_TYPE_MASK;
-    PoolDesc = PoolVector[PoolType];
+    if (PoolType == NonPagedPool)
+    {
+        ASSERT(ExpNonPagedPoolDescriptor[Entry->PoolIndex] != NULL);
+        PoolDesc = ExpNonPagedPoolDescriptor[Entry->PoolIndex];
+    }
+    else
+    {
+        PoolDesc = PoolVector[PoolType];
+    }
 
     //
     // Make sure that the IRQL makes sense
@@ -108,10 +108,39 @@ MiUnmapPageInHyperSpace(IN PEPROCESS Process,
     KeReleaseSpinLock(&Process->HyperSpaceLock, OldIrql);
 }
 
+PMMPTE
+NTAPI
+MiReserveZeroingPtes(VOID)
+{
+    PMMPTE ZeroingPtes;
+
+    //
+    // Reserve system PTEs for zeroing PTEs and clear them
+    //
+    ZeroingPtes = MiReserveSystemPtes(MI_ZERO_PTES + 1, SystemPteSpace);
+    if (!ZeroingPtes) return NULL;
+    RtlZeroMemory(ZeroingPtes, (MI_ZERO_PTES + 1) * sizeof(MMPTE));
+
+    //
+    // The first PTE is the counter of the free ones, set it to maximum
+    //
+    ZeroingPtes->u.Hard.PageFrameNumber = MI_ZERO_PTES;
+    return ZeroingPtes;
+}
+
 PVOID
 NTAPI
 MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
                       IN PFN_NUMBER NumberOfPages)
+{
+    return MiMapPagesInZeroingPtes(MiFirstReservedZeroingPte, Pfn1, NumberOfPages);
+}
+
+PVOID
+NTAPI
+MiMapPagesInZeroingPtes(IN PMMPTE ZeroingPtes,
+                        IN PMMPFN Pfn1,
+                        IN PFN_NUMBER NumberOfPages)
 {
     MMPTE TempPte;
     PMMPTE PointerPte;
@@ -127,7 +156,7 @@ MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
     //
     // Pick the first zeroing PTE
     //
-    PointerPte = MiFirstReservedZeroingPte;
+    PointerPte = ZeroingPtes;
 
     //
     // Now get the first free PTE
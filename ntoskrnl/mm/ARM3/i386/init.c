@@ -522,16 +522,9 @@ MiInitMachineDependent(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
     MmWorkingSetList = (PVOID)MI_WORKING_SET_LIST;
 
     //
-    // Reserve system PTEs for zeroing PTEs and clear them
+    // Reserve system PTEs for zeroing PTEs
     //
-    MiFirstReservedZeroingPte = MiReserveSystemPtes(MI_ZERO_PTES + 1,
-                                                    SystemPteSpace);
-    RtlZeroMemory(MiFirstReservedZeroingPte, (MI_ZERO_PTES + 1) * sizeof(MMPTE));
-
-    //
-    // Set the counter to maximum to boot with
-    //
-    MiFirstReservedZeroingPte->u.Hard.PageFrameNumber = MI_ZERO_PTES;
+    MiFirstReservedZeroingPte = MiReserveZeroingPtes();
 
     /* Lock PFN database */
     OldIrql = MiAcquirePfnLock();
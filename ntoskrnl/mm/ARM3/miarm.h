@@ -390,9 +390,12 @@ typedef struct _POOL_TRACKER_BIG_PAGES
 } POOL_TRACKER_BIG_PAGES, *PPOOL_TRACKER_BIG_PAGES;
 
 extern ULONG ExpNumberOfPagedPools;
+extern ULONG ExpNumberOfNonPagedPools;
 extern POOL_DESCRIPTOR NonPagedPoolDescriptor;
+extern PPOOL_DESCRIPTOR ExpNonPagedPoolDescriptor[MAXIMUM_PROCESSORS];
 extern PPOOL_DESCRIPTOR ExpPagedPoolDescriptor[16 + 1];
 extern PPOOL_TRACKER_TABLE PoolTrackTable;
+extern PPOOL_TRACKER_TABLE ExPoolTagTables[MAXIMUM_PROCESSORS];
 
 //
 // END FIXFIX
@@ -1839,6 +1842,12 @@ InitializePool(           //
     IN ULONG Threshold    //
 );                        //
 
+VOID
+NTAPI
+ExpInitializeProcessorPools(
+    VOID
+);
+
 // FIXFIX: THIS ONE TOO
 VOID
 NTAPI
@@ -1978,6 +1987,13 @@ MiRemoveAnyPage(
     IN ULONG Color
 );
 
+PFN_NUMBER
+NTAPI
+MiRemovePageByColor(
+    IN PFN_NUMBER PageIndex,
+    IN ULONG Color
+);
+
 PFN_NUMBER
 NTAPI
 MiRemoveZeroPage(
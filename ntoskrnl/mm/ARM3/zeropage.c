@@ -17,7 +17,24 @@
 
 /* GLOBALS ********************************************************************/
 
+/* How many pages are zeroed at once */
+#define MI_ZERO_PAGE_BATCH              16
+C_ASSERT(MI_ZERO_PAGE_BATCH <= MI_ZERO_PTES);
+
+/* How often, in ms, an idle zeroing thread looks for leftover free pages */
+#define MI_ZERO_PAGE_IDLE_PERIOD        1000
+
+typedef struct _MI_ZERO_PAGE_WORKER
+{
+    PMMPTE ZeroingPtes;
+    ULONG Processor;
+    ULONG FirstColor;
+    ULONG ColorStep;
+    ULONG NextColor;
+} MI_ZERO_PAGE_WORKER, *PMI_ZERO_PAGE_WORKER;
+
 KEVENT MmZeroingPageEvent;
+static MI_ZERO_PAGE_WORKER MiZeroPageWorkers[MAXIMUM_PROCESSORS];
 
 /* PRIVATE FUNCTIONS **********************************************************/
 
@@ -31,34 +48,63 @@ NTAPI
 MiFreeInitializationCode(IN PVOID StartVa,
 IN PVOID EndVa);
 
+static
+PFN_NUMBER
+MiRemovePageToZero(IN PMI_ZERO_PAGE_WORKER Worker)
+{
+    PFN_NUMBER PageIndex;
+    ULONG i, Color;
+
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Look at our own colours first, so that the workers don't step on each other */
+    for (i = Worker->FirstColor; i < MmSecondaryColors; i += Worker->ColorStep)
+    {
+        Color = Worker->NextColor;
+        Worker->NextColor += Worker->ColorStep;
+        if (Worker->NextColor >= MmSecondaryColors) Worker->NextColor = Worker->FirstColor;
+
+        PageIndex = MmFreePagesByColor[FreePageList][Color].Flink;
+        if (PageIndex != LIST_HEAD) return MiRemovePageByColor(PageIndex, Color);
+    }
+
+    /* Then help with the other ones */
+    PageIndex = MmFreePageListHead.Flink;
+    if (PageIndex == LIST_HEAD) return LIST_HEAD;
+
+    return MiRemovePageByColor(PageIndex, MI_GET_PAGE_COLOR(PageIndex));
+}
+
+static
 VOID
-NTAPI
-MmZeroPageThread(VOID)
+MiZeroFreePages(IN PMI_ZERO_PAGE_WORKER Worker)
 {
     PKTHREAD Thread = KeGetCurrentThread();
-    PVOID StartAddress, EndAddress;
     PVOID WaitObjects[2];
+    KTIMER IdleTimer;
+    LARGE_INTEGER DueTime;
     KIRQL OldIrql;
     PVOID ZeroAddress;
-    PFN_NUMBER PageIndex, FreePage;
-    PMMPFN Pfn1;
-
-    /* Get the discardable sections to free them */
-    MiFindInitializationCode(&StartAddress, &EndAddress);
-    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
-    DPRINT("Free non-cache pages: %lx\n", MmAvailablePages + MiMemoryConsumers[MC_CACHE].PagesUsed);
+    PFN_NUMBER PageIndex, PageCount;
+    PMMPFN Pfn1, FirstPfn;
 
-    /* Set our priority to 0 */
+    /* Stay on our processor, and set our priority to 0 */
+    KeSetSystemAffinityThread((KAFFINITY)1 << Worker->Processor);
     Thread->BasePriority = 0;
     KeSetPriorityThread(Thread, 0);
 
+    /* Being at priority 0, the timer only gets us to run when the processor is idle */
+    KeInitializeTimerEx(&IdleTimer, SynchronizationTimer);
+    DueTime.QuadPart = -(LONGLONG)MI_ZERO_PAGE_IDLE_PERIOD * 10000;
+    KeSetTimerEx(&IdleTimer, DueTime, MI_ZERO_PAGE_IDLE_PERIOD, NULL);
+
     /* Setup the wait objects */
     WaitObjects[0] = &MmZeroingPageEvent;
-//    WaitObjects[1] = &PoSystemIdleTimer; FIXME: Implement idle timer
+    WaitObjects[1] = &IdleTimer;
 
     while (TRUE)
     {
-        KeWaitForMultipleObjects(1, // 2
+        KeWaitForMultipleObjects(2,
                                  WaitObjects,
                                  WaitAny,
                                  WrFreePage,
@@ -70,43 +116,108 @@ MmZeroPageThread(VOID)
 
         while (TRUE)
         {
-            if (!MmFreePageListHead.Total)
+            /* Take a batch of free pages, chained through their Flink */
+            FirstPfn = (PMMPFN)LIST_HEAD;
+            for (PageCount = 0; PageCount < MI_ZERO_PAGE_BATCH; PageCount++)
             {
+                MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
+                MI_SET_PROCESS2("Kernel 0 Loop");
+                PageIndex = MiRemovePageToZero(Worker);
+                if (PageIndex == LIST_HEAD) break;
+
+                Pfn1 = MiGetPfnEntry(PageIndex);
+                Pfn1->u1.Flink = (PFN_NUMBER)FirstPfn;
+                FirstPfn = Pfn1;
+            }
+
+            if (!PageCount)
+            {
+                ASSERT(!MmFreePageListHead.Total);
                 KeClearEvent(&MmZeroingPageEvent);
                 MiReleasePfnLock(OldIrql);
                 break;
             }
 
-            PageIndex = MmFreePageListHead.Flink;
-            ASSERT(PageIndex != LIST_HEAD);
-            Pfn1 = MiGetPfnEntry(PageIndex);
-            MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
-            MI_SET_PROCESS2("Kernel 0 Loop");
-            FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
+            MiReleasePfnLock(OldIrql);
+
+            /* Map them together and zero them without going through the caches */
+            ZeroAddress = MiMapPagesInZeroingPtes(Worker->ZeroingPtes, FirstPfn, PageCount);
+            ASSERT(ZeroAddress);
+            KeZeroPagesFromIdleThread(ZeroAddress, PageCount * PAGE_SIZE);
+            MiUnmapPagesInZeroSpace(ZeroAddress, PageCount);
+
+            OldIrql = MiAcquirePfnLock();
 
-            /* The first global free page should also be the first on its own list */
-            if (FreePage != PageIndex)
+            /* And put all of them on the zeroed list */
+            while (FirstPfn != (PMMPFN)LIST_HEAD)
             {
-                KeBugCheckEx(PFN_LIST_CORRUPT,
-                             0x8F,
-                             FreePage,
-                             PageIndex,
-                             0);
+                Pfn1 = FirstPfn;
+                FirstPfn = (PMMPFN)Pfn1->u1.Flink;
+                MiInsertPageInList(&MmZeroedPageListHead, MiGetPfnEntryIndex(Pfn1));
             }
+        }
+    }
+}
 
-            Pfn1->u1.Flink = LIST_HEAD;
-            MiReleasePfnLock(OldIrql);
+static
+VOID
+NTAPI
+MiZeroPageWorkerThread(IN PVOID Context)
+{
+    MiZeroFreePages(Context);
+}
 
-            ZeroAddress = MiMapPagesInZeroSpace(Pfn1, 1);
-            ASSERT(ZeroAddress);
-            RtlZeroMemory(ZeroAddress, PAGE_SIZE);
-            MiUnmapPagesInZeroSpace(ZeroAddress, 1);
+VOID
+NTAPI
+MmZeroPageThread(VOID)
+{
+    PVOID StartAddress, EndAddress;
+    ULONG WorkerCount, i;
+    PMI_ZERO_PAGE_WORKER Worker;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
 
-            OldIrql = MiAcquirePfnLock();
+    /* Get the discardable sections to free them */
+    MiFindInitializationCode(&StartAddress, &EndAddress);
+    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
+    DPRINT("Free non-cache pages: %lx\n", MmAvailablePages + MiMemoryConsumers[MC_CACHE].PagesUsed);
 
-            MiInsertPageInList(&MmZeroedPageListHead, PageIndex);
+    /* One worker per processor, each one owning a range of colours */
+    WorkerCount = min((ULONG)KeNumberProcessors, MmSecondaryColors);
+    for (i = 0; i < WorkerCount; i++)
+    {
+        Worker = &MiZeroPageWorkers[i];
+        Worker->Processor = i;
+        Worker->FirstColor = i;
+        Worker->NextColor = i;
+        Worker->ColorStep = WorkerCount;
+
+        /* We run the first worker, which uses the boot zeroing PTEs */
+        if (i == 0)
+        {
+            Worker->ZeroingPtes = MiFirstReservedZeroingPte;
+            continue;
         }
+
+        Worker->ZeroingPtes = MiReserveZeroingPtes();
+        if (!Worker->ZeroingPtes) break;
+
+        Status = PsCreateSystemThread(&ThreadHandle,
+                                      THREAD_ALL_ACCESS,
+                                      NULL,
+                                      NULL,
+                                      NULL,
+                                      MiZeroPageWorkerThread,
+                                      Worker);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to create zero page thread %lu: %lx\n", i, Status);
+            break;
+        }
+        ObCloseHandle(ThreadHandle, KernelMode);
     }
+
+    MiZeroFreePages(&MiZeroPageWorkers[0]);
 }
 
 /* EOF */
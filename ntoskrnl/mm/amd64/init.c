@@ -395,13 +395,8 @@ MiBuildSystemPteSpace(VOID)
     PointerPte = MiAddressToPte(MiSystemPteSpaceStart);
     MiInitializeSystemPtes(PointerPte, MmNumberOfSystemPtes, SystemPteSpace);
 
-    /* Reserve system PTEs for zeroing PTEs and clear them */
-    MiFirstReservedZeroingPte = MiReserveSystemPtes(MI_ZERO_PTES + 1,
-                                                    SystemPteSpace);
-    RtlZeroMemory(MiFirstReservedZeroingPte, (MI_ZERO_PTES + 1) * sizeof(MMPTE));
-
-    /* Set the counter to maximum */
-    MiFirstReservedZeroingPte->u.Hard.PageFrameNumber = MI_ZERO_PTES;
+    /* Reserve system PTEs for zeroing PTEs */
+    MiFirstReservedZeroingPte = MiReserveZeroingPtes();
 }
 
 static
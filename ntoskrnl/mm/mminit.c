@@ -223,6 +223,9 @@ MmInitSystem(IN ULONG Phase,
 
     MmKernelAddressSpace = &PsIdleProcess->Vm;
 
+    /* All the processors are started now, give them their own nonpaged pool */
+    ExpInitializeProcessorPools();
+
     /* Intialize system memory areas */
     MiInitSystemMemoryAreas();
 
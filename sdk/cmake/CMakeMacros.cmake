@@ -380,7 +380,7 @@ function(create_iso_lists)
 
     add_custom_command(
         OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/reactos.cab
-        COMMAND native-cabman -C ${REACTOS_BINARY_DIR}/boot/bootdata/packages/reactos.dff -RC ${CMAKE_CURRENT_BINARY_DIR}/reactos.inf -N -P ${REACTOS_SOURCE_DIR}
+        COMMAND native-cabman -j 0 -C ${REACTOS_BINARY_DIR}/boot/bootdata/packages/reactos.dff -RC ${CMAKE_CURRENT_BINARY_DIR}/reactos.inf -N -P ${REACTOS_SOURCE_DIR}
         DEPENDS ${CMAKE_CURRENT_BINARY_DIR}/reactos.inf native-cabman ${_filelist})
 
     add_custom_target(reactos_cab DEPENDS ${CMAKE_CURRENT_BINARY_DIR}/reactos.cab)
@@ -762,14 +762,19 @@ function(create_registry_hives)
                 NO_CAB
                 FOR bootcd regtest)
 
+    # With -i, mkhive leaves the hives that are up to date untouched, so the
+    # commands below output a stamp and declare the hives as byproducts.
+
     # BootCD setup system hive
     add_custom_command(
-        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/SETUPREG.HIV
-        COMMAND native-mkhive -h:SETUPREG -u -d:${CMAKE_BINARY_DIR}/boot/bootdata ${CMAKE_BINARY_DIR}/boot/bootdata/hivesys_utf16.inf ${CMAKE_SOURCE_DIR}/boot/bootdata/setupreg.inf
+        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/bootcd_hives.stamp
+        BYPRODUCTS ${CMAKE_BINARY_DIR}/boot/bootdata/SETUPREG.HIV
+        COMMAND native-mkhive -h:SETUPREG -u -i -j:0 -d:${CMAKE_BINARY_DIR}/boot/bootdata ${CMAKE_BINARY_DIR}/boot/bootdata/hivesys_utf16.inf ${CMAKE_SOURCE_DIR}/boot/bootdata/setupreg.inf
+        COMMAND ${CMAKE_COMMAND} -E touch ${CMAKE_BINARY_DIR}/boot/bootdata/bootcd_hives.stamp
         DEPENDS native-mkhive ${CMAKE_BINARY_DIR}/boot/bootdata/hivesys_utf16.inf)
 
     add_custom_target(bootcd_hives
-        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/SETUPREG.HIV)
+        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/bootcd_hives.stamp)
 
     add_cd_file(
         FILE ${CMAKE_BINARY_DIR}/boot/bootdata/SETUPREG.HIV
@@ -794,20 +799,18 @@ function(create_registry_hives)
     endif()
 
     add_custom_command(
-        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/system
-               ${CMAKE_BINARY_DIR}/boot/bootdata/software
-               ${CMAKE_BINARY_DIR}/boot/bootdata/default
-               ${CMAKE_BINARY_DIR}/boot/bootdata/sam
-               ${CMAKE_BINARY_DIR}/boot/bootdata/security
-        COMMAND native-mkhive -h:SYSTEM,SOFTWARE,DEFAULT,SAM,SECURITY -d:${CMAKE_BINARY_DIR}/boot/bootdata ${_livecd_inf_files}
+        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/livecd_hives.stamp
+        BYPRODUCTS ${CMAKE_BINARY_DIR}/boot/bootdata/system
+                   ${CMAKE_BINARY_DIR}/boot/bootdata/software
+                   ${CMAKE_BINARY_DIR}/boot/bootdata/default
+                   ${CMAKE_BINARY_DIR}/boot/bootdata/sam
+                   ${CMAKE_BINARY_DIR}/boot/bootdata/security
+        COMMAND native-mkhive -h:SYSTEM,SOFTWARE,DEFAULT,SAM,SECURITY -i -j:0 -d:${CMAKE_BINARY_DIR}/boot/bootdata ${_livecd_inf_files}
+        COMMAND ${CMAKE_COMMAND} -E touch ${CMAKE_BINARY_DIR}/boot/bootdata/livecd_hives.stamp
         DEPENDS native-mkhive ${_livecd_inf_files})
 
     add_custom_target(livecd_hives
-        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/system
-                ${CMAKE_BINARY_DIR}/boot/bootdata/software
-                ${CMAKE_BINARY_DIR}/boot/bootdata/default
-                ${CMAKE_BINARY_DIR}/boot/bootdata/sam
-                ${CMAKE_BINARY_DIR}/boot/bootdata/security)
+        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/livecd_hives.stamp)
 
     add_cd_file(
         FILE ${CMAKE_BINARY_DIR}/boot/bootdata/system
@@ -821,12 +824,14 @@ function(create_registry_hives)
 
     # BCD Hive
     add_custom_command(
-        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/BCD
-        COMMAND native-mkhive -h:BCD -u -d:${CMAKE_BINARY_DIR}/boot/bootdata ${CMAKE_BINARY_DIR}/boot/bootdata/hivebcd_utf16.inf
+        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/bcd_hive.stamp
+        BYPRODUCTS ${CMAKE_BINARY_DIR}/boot/bootdata/BCD
+        COMMAND native-mkhive -h:BCD -u -i -j:0 -d:${CMAKE_BINARY_DIR}/boot/bootdata ${CMAKE_BINARY_DIR}/boot/bootdata/hivebcd_utf16.inf
+        COMMAND ${CMAKE_COMMAND} -E touch ${CMAKE_BINARY_DIR}/boot/bootdata/bcd_hive.stamp
         DEPENDS native-mkhive ${CMAKE_BINARY_DIR}/boot/bootdata/hivebcd_utf16.inf)
 
     add_custom_target(bcd_hive
-        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/BCD)
+        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/bcd_hive.stamp)
 
     add_cd_file(
         FILE ${CMAKE_BINARY_DIR}/boot/bootdata/BCD
@@ -24,6 +24,11 @@
     ((HBLOCK_SIZE - (sizeof(HBIN) + sizeof(HCELL) +     \
                      FIELD_OFFSET(CM_KEY_INDEX, List))) / sizeof(HCELL_INDEX) - 1)
 
+/* Fast and hash leaves use twice as much space per entry as index leaves */
+#define CmpMaxEntriesPerLeaf(Leaf)                      \
+    (((Leaf)->Signature == CM_KEY_INDEX_LEAF) ?         \
+     CmpMaxIndexPerHblock : CmpMaxFastIndexPerHblock)
+
 /* FUNCTIONS *****************************************************************/
 
 LONG
@@ -353,6 +358,46 @@ Return:
     return ReturnIndex;
 }
 
+static ULONG
+NTAPI
+CmpFindSubKeyInHashLeaf(IN PHHIVE Hive,
+                        IN PCM_KEY_FAST_INDEX FastIndex,
+                        IN PCUNICODE_STRING SearchName,
+                        OUT PHCELL_INDEX SubKey)
+{
+    ULONG HashKey, i;
+    PCM_INDEX FastEntry;
+
+    /* Make sure it's really a hash */
+    ASSERT(FastIndex->Signature == CM_KEY_HASH_LEAF);
+
+    /* Compute the hash key for the name */
+    HashKey = CmpComputeHashKey(0, SearchName, FALSE);
+
+    /* Loop all the entries */
+    for (i = 0; i < FastIndex->Count; i++)
+    {
+        /* Get the entry */
+        FastEntry = &FastIndex->List[i];
+
+        /* Compare the hash first, and only touch the key node if it matches */
+        if (FastEntry->HashKey == HashKey)
+        {
+            /* Go ahead for a full compare */
+            if (!(CmpDoCompareKeyName(Hive, SearchName, FastEntry->Cell)))
+            {
+                /* It matched, return the cell and its position */
+                *SubKey = FastEntry->Cell;
+                return i;
+            }
+        }
+    }
+
+    /* If we got here then we failed */
+    *SubKey = HCELL_NIL;
+    return FastIndex->Count;
+}
+
 ULONG
 NTAPI
 CmpFindSubKeyInLeaf(IN PHHIVE Hive,
@@ -455,6 +500,33 @@ CmpFindSubKeyInLeaf(IN PHHIVE Hive,
     return High;
 }
 
+/*
+ * Same as CmpFindSubKeyInLeaf, for a key that is expected to be present.
+ * Hash leaves are searched by hash first, which only reads the key nodes
+ * whose hash matches, instead of all the ones on the binary search path.
+ */
+static ULONG
+NTAPI
+CmpFindExistingSubKeyInLeaf(IN PHHIVE Hive,
+                            IN PCM_KEY_INDEX Index,
+                            IN PCUNICODE_STRING SearchName,
+                            OUT PHCELL_INDEX SubKey)
+{
+    ULONG i;
+
+    if (Index->Signature == CM_KEY_HASH_LEAF)
+    {
+        i = CmpFindSubKeyInHashLeaf(Hive,
+                                    (PCM_KEY_FAST_INDEX)Index,
+                                    SearchName,
+                                    SubKey);
+        if (i < Index->Count) return i;
+    }
+
+    /* Not found by hash, so do the regular search */
+    return CmpFindSubKeyInLeaf(Hive, Index, SearchName, SubKey);
+}
+
 ULONG
 NTAPI
 CmpComputeHashKey(IN ULONG Hash,
@@ -647,35 +719,11 @@ CmpFindSubKeyByHash(IN PHHIVE Hive,
                     IN PCM_KEY_FAST_INDEX FastIndex,
                     IN PCUNICODE_STRING SearchName)
 {
-    ULONG HashKey, i;
-    PCM_INDEX FastEntry;
-
-    /* Make sure it's really a hash */
-    ASSERT(FastIndex->Signature == CM_KEY_HASH_LEAF);
-
-    /* Compute the hash key for the name */
-    HashKey = CmpComputeHashKey(0, SearchName, FALSE);
-
-    /* Loop all the entries */
-    for (i = 0; i < FastIndex->Count; i++)
-    {
-        /* Get the entry */
-        FastEntry = &FastIndex->List[i];
-
-        /* Compare the hash first */
-        if (FastEntry->HashKey == HashKey)
-        {
-            /* Go ahead for a full compare */
-            if (!(CmpDoCompareKeyName(Hive, SearchName, FastEntry->Cell)))
-            {
-                /* It matched, return the cell */
-                return FastEntry->Cell;
-            }
-        }
-    }
+    HCELL_INDEX SubKey;
 
-    /* If we got here then we failed */
-    return HCELL_NIL;
+    /* Scan the hashes of the leaf, the position doesn't matter here */
+    CmpFindSubKeyInHashLeaf(Hive, FastIndex, SearchName, &SubKey);
+    return SubKey;
 }
 
 HCELL_INDEX
@@ -884,7 +932,7 @@ CmpMarkIndexDirty(IN PHHIVE Hive,
                    (Index->Signature == CM_KEY_HASH_LEAF));
 
             /* Find the child in the leaf */
-            Result = CmpFindSubKeyInLeaf(Hive, Index, &SearchName, &Child);
+            Result = CmpFindExistingSubKeyInLeaf(Hive, Index, &SearchName, &Child);
             if (Result & INVALID_INDEX) goto Quickie;
             if (Child != HCELL_NIL)
             {
@@ -1131,13 +1179,11 @@ CmpSplitLeaf(IN PHHIVE Hive,
     FirstHalf = (LeafKey->Count / 2);
     LastHalf = LeafKey->Count - FirstHalf;
 
-    /* Now check what kind of hive we're dealing with,
-     * and compute entry size
-     */
-    if (Hive->Version >= 5)
+    /* The new leaf has the same kind as the one we split, compute entry size */
+    if ((LeafKey->Signature == CM_KEY_FAST_LEAF) ||
+        (LeafKey->Signature == CM_KEY_HASH_LEAF))
     {
-        /* XP Hive: Use hash leaf */
-        ASSERT(LeafKey->Signature == CM_KEY_HASH_LEAF);
+        /* Fast or hash leaf */
         EntrySize = sizeof(CM_INDEX);
     }
     else
@@ -1173,17 +1219,8 @@ CmpSplitLeaf(IN PHHIVE Hive,
     /* Release the newly created cell */
     HvReleaseCell(Hive, NewCell);
 
-    /* Set its signature according to the version of the hive */
-    if (Hive->Version >= 5)
-    {
-        /* XP Hive: Use hash leaf signature */
-        NewKey->Signature = CM_KEY_HASH_LEAF;
-    }
-    else
-    {
-        /* Use index leaf signature */
-        NewKey->Signature = CM_KEY_INDEX_LEAF;
-    }
+    /* Set its signature */
+    NewKey->Signature = LeafKey->Signature;
 
     /* Calculate the size of the free entries in the root key */
     TotalSize = HvGetCellSize(Hive, IndexKey) -
@@ -1216,9 +1253,9 @@ CmpSplitLeaf(IN PHHIVE Hive,
     }
 
     /* Splitting is done, now we need to copy the contents,
-     * according to the hive version
+     * according to the leaf type
      */
-    if (Hive->Version >= 5)
+    if (EntrySize == sizeof(CM_INDEX))
     {
         /* Copy the fast indexes */
         FastLeaf = (PCM_KEY_FAST_INDEX)LeafKey;
@@ -1310,7 +1347,7 @@ CmpSelectLeaf(IN PHHIVE Hive,
             if (!LeafKey) return HCELL_NIL;
 
             /* Check if it fits into this leaf and break */
-            if (LeafKey->Count < CmpMaxIndexPerHblock)
+            if (LeafKey->Count < CmpMaxEntriesPerLeaf(LeafKey))
             {
                 /* Fill in the result and return it */
                 *RootCell = &IndexKey->List[SubKeyIndex];
@@ -1362,7 +1399,7 @@ CmpSelectLeaf(IN PHHIVE Hive,
                 if (!LeafKey) return HCELL_NIL;
 
                 /* Check if it fits into this leaf */
-                if (LeafKey->Count < CmpMaxIndexPerHblock)
+                if (LeafKey->Count < CmpMaxEntriesPerLeaf(LeafKey))
                 {
                     /* Fill in the result and return the cell */
                     *RootCell = &IndexKey->List[SubKeyIndex];
@@ -1380,7 +1417,7 @@ CmpSelectLeaf(IN PHHIVE Hive,
                     if (!LeafKey) return HCELL_NIL;
 
                     /* Check if it fits and break */
-                    if (LeafKey->Count < CmpMaxIndexPerHblock)
+                    if (LeafKey->Count < CmpMaxEntriesPerLeaf(LeafKey))
                     {
                         /* Fill in the result and return the cell */
                         *RootCell = &IndexKey->List[SubKeyIndex + 1];
@@ -1403,7 +1440,7 @@ CmpSelectLeaf(IN PHHIVE Hive,
                     if (!LeafKey) return HCELL_NIL;
 
                     /* Check if it fits and break */
-                    if (LeafKey->Count < CmpMaxIndexPerHblock)
+                    if (LeafKey->Count < CmpMaxEntriesPerLeaf(LeafKey))
                     {
                         /* Fill in the result and return the cell */
                         *RootCell = &IndexKey->List[SubKeyIndex - 1];
@@ -1420,7 +1457,7 @@ CmpSelectLeaf(IN PHHIVE Hive,
                     if (!LeafKey) return HCELL_NIL;
 
                     /* Check if it fits and break */
-                    if (LeafKey->Count < CmpMaxIndexPerHblock)
+                    if (LeafKey->Count < CmpMaxEntriesPerLeaf(LeafKey))
                     {
                         /* Fill in the result and return the cell */
                         *RootCell = &IndexKey->List[0];
@@ -1554,14 +1591,14 @@ CmpAddSubKey(IN PHHIVE Hive,
         }
 
         /* Now check what kind of hive we're dealing with */
-        if (Hive->Version >= 5)
+        if (Hive->Version >= HSYS_WHISTLER)
         {
             /* XP Hive: Use hash leaf */
             Index->Signature = CM_KEY_HASH_LEAF;
         }
-        else if (Hive->Version >= 3)
+        else if (Hive->Version >= HSYS_MINOR)
         {
-            /* Windows 2000 and ReactOS: Use fast leaf */
+            /* Windows 2000 and ReactOS: Use fast leaf, older loaders don't know hash leaves */
             Index->Signature = CM_KEY_FAST_LEAF;
         }
         else
@@ -1609,7 +1646,7 @@ CmpAddSubKey(IN PHHIVE Hive,
         }
         else if (((Index->Signature == CM_KEY_INDEX_LEAF) ||
                   (Index->Signature == CM_KEY_HASH_LEAF)) &&
-                  (Index->Count >= CmpMaxIndexPerHblock))
+                  (Index->Count >= CmpMaxEntriesPerLeaf(Index)))
         {
             /* This is an old/hashed leaf that's gotten too large, root it */
             IndexCell = HvAllocateCell(Hive,
@@ -1805,7 +1842,7 @@ CmpRemoveSubKey(IN PHHIVE Hive,
            (Leaf->Signature == CM_KEY_HASH_LEAF));
 
     /* Now get the child in the leaf */
-    LeafIndex = CmpFindSubKeyInLeaf(Hive, Leaf, &SearchName, &ChildCell);
+    LeafIndex = CmpFindExistingSubKeyInLeaf(Hive, Leaf, &SearchName, &ChildCell);
     if (LeafIndex & INVALID_INDEX) goto Exit;
     ASSERT(ChildCell != HCELL_NIL);
 
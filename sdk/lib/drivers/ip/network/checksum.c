@@ -11,6 +11,31 @@
 
 #include "precomp.h"
 
+/*
+ * The one's complement sum doesn't depend on the width of the words it is
+ * computed with, as long as the carries are added back in the end. The data
+ * is summed as 32-bit words in a 64-bit accumulator, which can't overflow
+ * for any buffer we can be given, and is folded down once at the end.
+ *
+ * Words are always read at aligned addresses. If the buffer starts at an odd
+ * address, the bytes are paired the other way round, which gives the sum
+ * with its two bytes swapped (RFC 1071, 2.(B)), so the result is swapped back.
+ *
+ * We don't use SSE here: it would force us to save the FPU state for every
+ * packet, which costs more than what it would save on Ethernet sized frames.
+ */
+
+#define CHECKSUM_SWAP(Sum) ((((Sum) & 0xFF) << 8) | ((Sum) >> 8))
+
+static __inline ULONG ChecksumFold64(
+  ULONGLONG Sum)
+{
+  /* Fold 64-bit sum to 32 bits */
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+
+  return (ULONG)Sum;
+}
 
 ULONG ChecksumFold(
   ULONG Sum)
@@ -24,6 +49,164 @@ ULONG ChecksumFold(
   return Sum;
 }
 
+static ULONGLONG ChecksumWords(
+  PULONG Data,
+  UINT Words,
+  ULONGLONG Sum)
+{
+  while (Words >= 4)
+    {
+      Sum += Data[0];
+      Sum += Data[1];
+      Sum += Data[2];
+      Sum += Data[3];
+      Data += 4;
+      Words -= 4;
+    }
+
+  while (Words > 0)
+    {
+      Sum += *Data++;
+      Words--;
+    }
+
+  return Sum;
+}
+
+static ULONGLONG ChecksumCopyWords(
+  PULONG Destination,
+  PULONG Source,
+  UINT Words,
+  ULONGLONG Sum)
+{
+  ULONG Word0, Word1, Word2, Word3;
+
+  while (Words >= 4)
+    {
+      Word0 = Source[0];
+      Word1 = Source[1];
+      Word2 = Source[2];
+      Word3 = Source[3];
+      Destination[0] = Word0;
+      Destination[1] = Word1;
+      Destination[2] = Word2;
+      Destination[3] = Word3;
+      Sum += Word0;
+      Sum += Word1;
+      Sum += Word2;
+      Sum += Word3;
+      Source += 4;
+      Destination += 4;
+      Words -= 4;
+    }
+
+  while (Words > 0)
+    {
+      Word0 = *Source++;
+      *Destination++ = Word0;
+      Sum += Word0;
+      Words--;
+    }
+
+  return Sum;
+}
+
+static ULONG ChecksumPartial(
+  PUCHAR Destination,
+  PUCHAR Source,
+  UINT Count,
+  ULONG Seed)
+/*
+ * FUNCTION: Calculates the checksum of a buffer, and copies it if asked to
+ * ARGUMENTS:
+ *     Destination = Pointer to destination buffer, with the same alignment
+ *                   as the source buffer, or NULL to only compute the sum
+ *     Source      = Pointer to buffer with data
+ *     Count       = Number of bytes in buffer
+ *     Seed        = Previously calculated checksum (if any)
+ * RETURNS:
+ *     Checksum of buffer
+ */
+{
+  ULONGLONG Sum = 0;
+  BOOLEAN Odd;
+  USHORT Word;
+  UINT Words;
+  ULONG Result;
+
+  if (Count == 0)
+    return Seed;
+
+  /* The first byte is the second half of a word */
+  Odd = ((ULONG_PTR)Source & 1) != 0;
+  if (Odd)
+    {
+      Word = 0;
+      ((PUCHAR)&Word)[1] = *Source;
+      if (Destination)
+        *Destination++ = *Source;
+      Sum += Word;
+      Source++;
+      Count--;
+    }
+
+  /* Align on a 32-bit boundary */
+  if (((ULONG_PTR)Source & 2) && Count >= sizeof(USHORT))
+    {
+      Word = *(PUSHORT)Source;
+      if (Destination)
+        {
+          *(PUSHORT)Destination = Word;
+          Destination += sizeof(USHORT);
+        }
+      Sum += Word;
+      Source += sizeof(USHORT);
+      Count -= sizeof(USHORT);
+    }
+
+  Words = Count / sizeof(ULONG);
+  if (Destination)
+    {
+      Sum = ChecksumCopyWords((PULONG)Destination, (PULONG)Source, Words, Sum);
+      Destination += Words * sizeof(ULONG);
+    }
+  else
+    {
+      Sum = ChecksumWords((PULONG)Source, Words, Sum);
+    }
+  Source += Words * sizeof(ULONG);
+  Count -= Words * sizeof(ULONG);
+
+  if (Count >= sizeof(USHORT))
+    {
+      Word = *(PUSHORT)Source;
+      if (Destination)
+        {
+          *(PUSHORT)Destination = Word;
+          Destination += sizeof(USHORT);
+        }
+      Sum += Word;
+      Source += sizeof(USHORT);
+      Count -= sizeof(USHORT);
+    }
+
+  /* Add left-over byte, if any */
+  if (Count > 0)
+    {
+      Word = 0;
+      ((PUCHAR)&Word)[0] = *Source;
+      if (Destination)
+        *Destination = *Source;
+      Sum += Word;
+    }
+
+  Result = ChecksumFold(ChecksumFold64(Sum));
+  if (Odd)
+    Result = CHECKSUM_SWAP(Result);
+
+  return ChecksumFold64((ULONGLONG)Result + Seed);
+}
+
 ULONG ChecksumCompute(
   PVOID Data,
   UINT Count,
@@ -38,68 +221,76 @@ ULONG ChecksumCompute(
  *     Checksum of buffer
  */
 {
-  register ULONG Sum = Seed;
+  return ChecksumPartial(NULL, Data, Count, Seed);
+}
 
-  while (Count > 1)
+ULONG ChecksumCopy(
+  PVOID Destination,
+  PVOID Source,
+  UINT Count,
+  ULONG Seed)
+/*
+ * FUNCTION: Copies a buffer and calculates its checksum in the same pass
+ * ARGUMENTS:
+ *     Destination = Pointer to destination buffer
+ *     Source      = Pointer to buffer with data
+ *     Count       = Number of bytes to copy
+ *     Seed        = Previously calculated checksum (if any)
+ * RETURNS:
+ *     Checksum of buffer
+ */
+{
+  /* Both buffers have to be read and written with aligned words */
+  if (((ULONG_PTR)Destination ^ (ULONG_PTR)Source) & 3)
     {
-      Sum += *(PUSHORT)Data;
-      Count -= 2;
-      Data = (PVOID)((ULONG_PTR) Data + 2);
+      RtlCopyMemory(Destination, Source, Count);
+      return ChecksumPartial(NULL, Destination, Count, Seed);
     }
 
-  /* Add left-over byte, if any */
-  if (Count > 0)
-    {
-      Sum += *(PUCHAR)Data;
-    }
+  return ChecksumPartial(Destination, Source, Count, Seed);
+}
 
-  return Sum;
+ULONG ChecksumAddBlock(
+  ULONG Sum,
+  ULONG BlockSum,
+  UINT Offset)
+/*
+ * FUNCTION: Adds the checksum of a block to the checksum of the data before it
+ * ARGUMENTS:
+ *     Sum      = Checksum of the data before the block
+ *     BlockSum = Checksum of the block
+ *     Offset   = Offset of the block in the checksummed data
+ * RETURNS:
+ *     Checksum of the data up to the end of the block
+ */
+{
+  BlockSum = ChecksumFold(BlockSum);
+
+  /* A block starting at an odd offset was summed with its bytes swapped */
+  if (Offset & 1)
+    BlockSum = CHECKSUM_SWAP(BlockSum);
+
+  return ChecksumFold64((ULONGLONG)Sum + BlockSum);
 }
 
-ULONG
-UDPv4ChecksumCalculate(
+ULONG IPv4PseudoHeaderChecksum(
   PIPv4_HEADER IPHeader,
-  PUCHAR PacketBuffer,
-  ULONG DataLength)
+  UCHAR Protocol,
+  USHORT Length)
+/*
+ * FUNCTION: Calculates the checksum of a TCP or UDP pseudo-header
+ * ARGUMENTS:
+ *     IPHeader = Pointer to IPv4 header of the datagram
+ *     Protocol = Transport protocol number
+ *     Length   = Length of the transport header and data
+ * RETURNS:
+ *     Checksum of the pseudo-header, to be used as seed
+ */
 {
-  ULONG Sum = 0;
-  USHORT TmpSum;
-  ULONG i;
-  BOOLEAN Pad;
-
-  /* Pad the data if needed */
-  Pad = (DataLength & 1);
-  if (Pad)
-      DataLength++;
-
-  /* Add from the UDP header and data */
-  for (i = 0; i < DataLength; i += 2)
-  {
-       TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
-                ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i+1] & 0x00FF));
-       Sum += TmpSum;
-  }
-
-  /* Add the source address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->SrcAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the destination address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->DstAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the proto number and length */
-  Sum += IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
-
-  /* Fold the checksum and return the one's complement */
-  return ~ChecksumFold(Sum);
-}
+  ULONGLONG Sum;
 
+  Sum = (ULONGLONG)IPHeader->SrcAddr + IPHeader->DstAddr +
+        WH2N((USHORT)Protocol) + WH2N(Length);
+
+  return ChecksumFold64(Sum);
+}
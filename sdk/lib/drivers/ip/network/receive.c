@@ -229,6 +229,23 @@ ReassembleDatagram(
   Data = (PVOID)((ULONG_PTR)IPPacket->Header + IPDR->HeaderSize);
   IPPacket->Data = Data;
 
+  /* An unfragmented datagram is checksummed while it is copied, so that
+     the transport protocol doesn't have to read it once more */
+  if (IPDR->FragmentListHead.Flink == IPDR->FragmentListHead.Blink) {
+    Fragment = CONTAINING_RECORD(IPDR->FragmentListHead.Flink, IP_FRAGMENT, ListEntry);
+
+    if (Fragment->Offset == 0 && Fragment->Size == IPDR->DataSize) {
+      CopyPacketToBufferChecksum(Data,
+                                 Fragment->Packet,
+                                 Fragment->PacketOffset,
+                                 Fragment->Size,
+                                 &IPPacket->DataChecksum);
+
+      IPPacket->Flags |= IP_PACKET_FLAG_DATA_CHECKSUM | Fragment->Flags;
+      return TRUE;
+    }
+  }
+
   /* Copy data from all fragments into buffer */
   CurrentEntry = IPDR->FragmentListHead.Flink;
   while (CurrentEntry != &IPDR->FragmentListHead) {
@@ -434,6 +451,8 @@ VOID ProcessFragment(
     Fragment->ReturnPacket = IPPacket->ReturnPacket;
     Fragment->PacketOffset = IPPacket->Position + IPPacket->HeaderSize;
     Fragment->Offset = FragFirst;
+    Fragment->Flags = IPPacket->Flags & (IP_PACKET_FLAG_CHECKSUM_VALID |
+                                         IP_PACKET_FLAG_CHECKSUM_INVALID);
 
     /* Disassociate the NDIS packet so it isn't freed upon return from IPReceive() */
     IPPacket->NdisPacket = NULL;
@@ -562,6 +581,7 @@ VOID IPv4Receive(PIP_INTERFACE IF, PIP_PACKET IPPacket)
 {
     UCHAR FirstByte;
     ULONG BytesCopied;
+    NDIS_TCP_IP_CHECKSUM_PACKET_INFO ChecksumInfo;
     
     TI_DbgPrint(DEBUG_IP, ("Received IPv4 datagram.\n"));
     
@@ -611,8 +631,36 @@ VOID IPv4Receive(PIP_INTERFACE IF, PIP_PACKET IPPacket)
         return;
     }
 
-    /* Checksum IPv4 header */
-    if (!IPv4CorrectChecksum(IPPacket->Header, IPPacket->HeaderSize)) {
+    /* Find out which checksums the adapter verified for us */
+    ChecksumInfo.Value = 0;
+    if (IF->ChecksumOffload & (IP_OFFLOAD_IP_RECEIVE | IP_OFFLOAD_UDP_RECEIVE))
+    {
+        ChecksumInfo.Value = PtrToUlong(NDIS_PER_PACKET_INFO_FROM_PACKET(IPPacket->NdisPacket,
+                                                                         TcpIpChecksumPacketInfo));
+    }
+
+    if (!(IF->ChecksumOffload & IP_OFFLOAD_IP_RECEIVE))
+    {
+        ChecksumInfo.Receive.NdisPacketIpChecksumFailed = 0;
+        ChecksumInfo.Receive.NdisPacketIpChecksumSucceeded = 0;
+    }
+
+    if (!(IF->ChecksumOffload & IP_OFFLOAD_UDP_RECEIVE))
+    {
+        ChecksumInfo.Receive.NdisPacketUdpChecksumFailed = 0;
+        ChecksumInfo.Receive.NdisPacketUdpChecksumSucceeded = 0;
+    }
+
+    /* The UDP verdict is checked once the datagram is reassembled */
+    if (ChecksumInfo.Receive.NdisPacketUdpChecksumFailed)
+        IPPacket->Flags |= IP_PACKET_FLAG_CHECKSUM_INVALID;
+    else if (ChecksumInfo.Receive.NdisPacketUdpChecksumSucceeded)
+        IPPacket->Flags |= IP_PACKET_FLAG_CHECKSUM_VALID;
+
+    /* Checksum IPv4 header, unless the adapter did it already */
+    if (ChecksumInfo.Receive.NdisPacketIpChecksumFailed ||
+        (!ChecksumInfo.Receive.NdisPacketIpChecksumSucceeded &&
+         !IPv4CorrectChecksum(IPPacket->Header, IPPacket->HeaderSize))) {
         TI_DbgPrint(MIN_TRACE, ("Datagram received with bad checksum. Checksum field (0x%X)\n",
 	      WN2H(((PIPv4_HEADER)IPPacket->Header)->Checksum)));
         /* Discard packet */
@@ -112,11 +112,15 @@ BOOLEAN PrepareNextFragment(
 
         /* FIXME: Handle options */
 
-        /* Calculate checksum of IP header */
+        /* Calculate checksum of IP header, unless the adapter does it */
         Header->Checksum = 0;
-        Header->Checksum = (USHORT)IPv4Checksum(Header, IFC->HeaderSize, 0);
+        if (!IFC->ChecksumInfo.Transmit.NdisPacketIpChecksum)
+            Header->Checksum = (USHORT)IPv4Checksum(Header, IFC->HeaderSize, 0);
 	TI_DbgPrint(MID_TRACE,("IP Check: %x\n", Header->Checksum));
 
+        NDIS_PER_PACKET_INFO_FROM_PACKET(IFC->NdisPacket, TcpIpChecksumPacketInfo) =
+            UlongToPtr(IFC->ChecksumInfo.Value);
+
         /* Update pointers */
         IFC->DatagramData = (PVOID)((ULONG_PTR)IFC->DatagramData + DataSize);
         IFC->Position  += DataSize;
@@ -190,6 +194,20 @@ NTSTATUS SendFragments(
     IFC->Data         = (PVOID)((ULONG_PTR)IFC->Header + IPPacket->HeaderSize);
     KeInitializeEvent(&IFC->Event, NotificationEvent, FALSE);
 
+    /* Tell the adapter which checksums it has to compute */
+    IFC->ChecksumInfo.Value = 0;
+    if ((NCE->Interface->ChecksumOffload & IP_OFFLOAD_IP_TRANSMIT) &&
+        IPPacket->HeaderSize == sizeof(IPv4_HEADER))
+    {
+        IFC->ChecksumInfo.Transmit.NdisPacketChecksumV4 = 1;
+        IFC->ChecksumInfo.Transmit.NdisPacketIpChecksum = 1;
+    }
+    if (IPPacket->Flags & IP_PACKET_FLAG_UDP_OFFLOAD)
+    {
+        IFC->ChecksumInfo.Transmit.NdisPacketChecksumV4 = 1;
+        IFC->ChecksumInfo.Transmit.NdisPacketUdpChecksum = 1;
+    }
+
     TI_DbgPrint(MID_TRACE,("Copying header from %x to %x (%d)\n",
 			   IPPacket->Header, IFC->Header,
 			   IPPacket->HeaderSize));
@@ -21,7 +21,8 @@ NTSTATUS AddUDPHeaderIPv4(
     USHORT LocalPort,
     PIP_PACKET IPPacket,
     PVOID Data,
-    UINT DataLength)
+    UINT DataLength,
+    PIP_INTERFACE Interface)
 /*
  * FUNCTION: Adds an IPv4 and UDP header to an IP packet
  * ARGUMENTS:
@@ -29,12 +30,14 @@ NTSTATUS AddUDPHeaderIPv4(
  *     LocalAddress = Pointer to our local address
  *     LocalPort    = The port we send this datagram from
  *     IPPacket     = Pointer to IP packet
+ *     Interface    = Pointer to the interface the datagram is sent on
  * RETURNS:
  *     Status of operation
  */
 {
     PUDP_HEADER UDPHeader;
     NTSTATUS Status;
+    ULONG Sum;
 
     TI_DbgPrint(MID_TRACE, ("Packet: %x NdisPacket %x\n",
 			    IPPacket, IPPacket->NdisPacket));
@@ -59,12 +62,29 @@ NTSTATUS AddUDPHeaderIPv4(
 			    IPPacket->Header, IPPacket->Data,
 			    (PCHAR)IPPacket->Data - (PCHAR)IPPacket->Header));
 
-    RtlCopyMemory(IPPacket->Data, Data, DataLength);
+    Sum = IPv4PseudoHeaderChecksum((PIPv4_HEADER)IPPacket->Header,
+                                   IPPROTO_UDP,
+                                   (USHORT)(DataLength + sizeof(UDP_HEADER)));
 
-    UDPHeader->Checksum = UDPv4ChecksumCalculate((PIPv4_HEADER)IPPacket->Header,
-                                                 (PUCHAR)UDPHeader,
-                                                 DataLength + sizeof(UDP_HEADER));
-    UDPHeader->Checksum = WH2N(UDPHeader->Checksum);
+    if ((Interface->ChecksumOffload & IP_OFFLOAD_UDP_TRANSMIT) &&
+        IPPacket->TotalSize <= Interface->MTU)
+    {
+        /* The adapter completes the checksum from the pseudo-header sum */
+        RtlCopyMemory(IPPacket->Data, Data, DataLength);
+        UDPHeader->Checksum = (USHORT)ChecksumFold(Sum);
+        IPPacket->Flags |= IP_PACKET_FLAG_UDP_OFFLOAD;
+    }
+    else
+    {
+        /* Checksum the data while we copy it */
+        Sum = ChecksumCopy(IPPacket->Data, Data, DataLength, Sum);
+        Sum = ChecksumCompute(UDPHeader, sizeof(UDP_HEADER), Sum);
+        UDPHeader->Checksum = (USHORT)~ChecksumFold(Sum);
+
+        /* A zero checksum means that there is none */
+        if (UDPHeader->Checksum == 0)
+            UDPHeader->Checksum = 0xFFFF;
+    }
 
     TI_DbgPrint(MID_TRACE, ("Packet: %d ip %d udp %d payload\n",
 			    (PCHAR)UDPHeader - (PCHAR)IPPacket->Header,
@@ -83,7 +103,8 @@ NTSTATUS BuildUDPPacket(
     PIP_ADDRESS LocalAddress,
     USHORT LocalPort,
     PCHAR DataBuffer,
-    UINT DataLen )
+    UINT DataLen,
+    PIP_INTERFACE Interface )
 /*
  * FUNCTION: Builds an UDP packet
  * ARGUMENTS:
@@ -91,6 +112,7 @@ NTSTATUS BuildUDPPacket(
  *     LocalAddress = Pointer to our local address
  *     LocalPort    = The port we send this datagram from
  *     IPPacket     = Address of pointer to IP packet
+ *     Interface    = Pointer to the interface the packet is sent on
  * RETURNS:
  *     Status of operation
  */
@@ -122,7 +144,8 @@ NTSTATUS BuildUDPPacket(
     switch (RemoteAddress->Type) {
         case IP_ADDRESS_V4:
             Status = AddUDPHeaderIPv4(AddrFile, RemoteAddress, RemotePort,
-                                      LocalAddress, LocalPort, Packet, DataBuffer, DataLen);
+                                      LocalAddress, LocalPort, Packet, DataBuffer, DataLen,
+                                      Interface);
             break;
         case IP_ADDRESS_V6:
             /* FIXME: Support IPv6 */
@@ -221,7 +244,8 @@ NTSTATUS UDPSendDatagram(
 							 &LocalAddress,
 							 AddrFile->Port,
 							 BufferData,
-							 DataSize );
+							 DataSize,
+							 NCE->Interface );
 
     UnlockObject(AddrFile, OldIrql);
 
@@ -255,6 +279,7 @@ VOID UDPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
   PUDP_HEADER UDPHeader;
   PIP_ADDRESS DstAddress, SrcAddress;
   UINT DataSize, i;
+  ULONG Sum;
 
   TI_DbgPrint(MAX_TRACE, ("Called.\n"));
 
@@ -279,16 +304,6 @@ VOID UDPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
 
   UDPHeader = (PUDP_HEADER)IPPacket->Data;
 
-  /* Calculate and validate UDP checksum */
-  i = UDPv4ChecksumCalculate(IPv4Header,
-                             (PUCHAR)UDPHeader,
-                             WH2N(UDPHeader->Length));
-  if (i != DH2N(0x0000FFFF) && UDPHeader->Checksum != 0)
-  {
-      TI_DbgPrint(MIN_TRACE, ("Bad checksum on packet received.\n"));
-      return;
-  }
-
   /* Sanity checks */
   i = WH2N(UDPHeader->Length);
   if ((i < sizeof(UDP_HEADER)) || (i > IPPacket->TotalSize - IPPacket->Position)) {
@@ -297,6 +312,31 @@ VOID UDPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
     return;
   }
 
+  /* Validate UDP checksum, unless the adapter did it already */
+  if (UDPHeader->Checksum != 0 && !(IPPacket->Flags & IP_PACKET_FLAG_CHECKSUM_VALID))
+  {
+      if (IPPacket->Flags & IP_PACKET_FLAG_CHECKSUM_INVALID)
+      {
+          TI_DbgPrint(MIN_TRACE, ("Bad checksum on packet received.\n"));
+          return;
+      }
+
+      Sum = IPv4PseudoHeaderChecksum(IPv4Header, IPPROTO_UDP, (USHORT)i);
+
+      /* Reuse the checksum computed while the datagram was reassembled */
+      if ((IPPacket->Flags & IP_PACKET_FLAG_DATA_CHECKSUM) &&
+          i == IPPacket->TotalSize - IPPacket->HeaderSize)
+          Sum = ChecksumAddBlock(Sum, IPPacket->DataChecksum, 0);
+      else
+          Sum = ChecksumCompute(UDPHeader, i, Sum);
+
+      if (ChecksumFold(Sum) != 0xFFFF)
+      {
+          TI_DbgPrint(MIN_TRACE, ("Bad checksum on packet received.\n"));
+          return;
+      }
+  }
+
   DataSize = i - sizeof(UDP_HEADER);
 
   /* Go to UDP data area */
@@ -51,65 +51,94 @@ CalcVolumeSerialNumber(VOID)
     return Serial;
 }
 
-/***** Wipe function for FAT12, FAT16 and FAT32 formats *****/
-NTSTATUS
-FatWipeSectors(
+/*
+ * The format routines write the FAT copies, the root directory and the wiped
+ * data area with large writes from a single page-aligned, zero-filled buffer.
+ * Apart from the first one, each write starts on a FAT_WRITE_CHUNK_SIZE
+ * boundary of the volume.
+ */
+#define FAT_WRITE_CHUNK_SIZE    (4 * 1024 * 1024)
+
+/* Put the header of each copy that starts in the chunk, or zero it again */
+static VOID
+FatPutCopyHeaders(
+    IN PUCHAR Buffer,
+    IN ULONGLONG Offset,
+    IN ULONG Length,
+    IN ULONGLONG CopyStart,
+    IN ULONGLONG CopyBytes,
+    IN ULONG CopyCount,
+    IN PUCHAR Header OPTIONAL,
+    IN ULONG HeaderLength)
+{
+    ULONG Copy;
+
+    for (Copy = 0; Copy < CopyCount; Copy++, CopyStart += CopyBytes)
+    {
+        if (CopyStart < Offset || CopyStart >= Offset + Length)
+            continue;
+
+        if (Header != NULL)
+            RtlCopyMemory(Buffer + (ULONG)(CopyStart - Offset), Header, HeaderLength);
+        else
+            RtlZeroMemory(Buffer + (ULONG)(CopyStart - Offset), HeaderLength);
+    }
+}
+
+static NTSTATUS
+FatWriteRegion(
     IN HANDLE FileHandle,
-    IN ULONG TotalSectors,
-    IN ULONG SectorsPerCluster,
+    IN ULONG StartSector,
+    IN ULONG SectorCount,
     IN ULONG BytesPerSector,
+    IN ULONG CopySectors,
+    IN ULONG CopyCount,
+    IN PUCHAR CopyHeader OPTIONAL,
+    IN ULONG CopyHeaderLength,
     IN OUT PFORMAT_CONTEXT Context)
 {
     IO_STATUS_BLOCK IoStatusBlock;
-    PUCHAR Buffer;
+    PUCHAR Buffer = NULL;
+    SIZE_T BufferSize;
     LARGE_INTEGER FileOffset;
-    ULONGLONG Sector;
+    ULONGLONG RegionStart, Offset, End, CopyBytes;
     ULONG Length;
-    NTSTATUS Status;
-
-    Length = SectorsPerCluster * BytesPerSector;
-
-    /* Allocate buffer for the cluster */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     HEAP_ZERO_MEMORY,
-                                     Length);
-    if (Buffer == NULL)
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (SectorCount == 0)
+        return STATUS_SUCCESS;
+
+    RegionStart = (ULONGLONG)StartSector * BytesPerSector;
+    Offset = RegionStart;
+    End = Offset + (ULONGLONG)SectorCount * BytesPerSector;
+    CopyBytes = (ULONGLONG)CopySectors * BytesPerSector;
+
+    /* Fresh virtual memory is page-aligned and already zero-filled */
+    BufferSize = (End - Offset < FAT_WRITE_CHUNK_SIZE) ? (SIZE_T)(End - Offset)
+                                                      : FAT_WRITE_CHUNK_SIZE;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(),
+                                     (PVOID*)&Buffer,
+                                     0,
+                                     &BufferSize,
+                                     MEM_COMMIT,
+                                     PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
         return STATUS_INSUFFICIENT_RESOURCES;
 
-    /* Wipe all clusters */
-    Sector = 0;
-    while (Sector + SectorsPerCluster < TotalSectors)
+    while (Offset < End)
     {
-        FileOffset.QuadPart = Sector * BytesPerSector;
+        /* Write up to the next chunk boundary */
+        Length = FAT_WRITE_CHUNK_SIZE - (ULONG)(Offset & (FAT_WRITE_CHUNK_SIZE - 1));
+        if (Length > End - Offset)
+            Length = (ULONG)(End - Offset);
 
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Length,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
+        if (CopyHeader != NULL)
         {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
+            FatPutCopyHeaders(Buffer, Offset, Length, RegionStart, CopyBytes,
+                              CopyCount, CopyHeader, CopyHeaderLength);
         }
 
-        UpdateProgress(Context, SectorsPerCluster);
-
-        Sector += SectorsPerCluster;
-    }
-
-    /* Wipe the trailing space behind the last cluster */
-    if (Sector < TotalSectors)
-    {
-        DPRINT("Remaining sectors %lu\n", TotalSectors - Sector);
-
-        FileOffset.QuadPart = Sector * BytesPerSector;
-        Length = (TotalSectors - Sector) * BytesPerSector;
-
+        FileOffset.QuadPart = Offset;
         Status = NtWriteFile(FileHandle,
                              NULL,
                              NULL,
@@ -125,13 +154,70 @@ FatWipeSectors(
             goto done;
         }
 
-        UpdateProgress(Context, TotalSectors - Sector);
+        if (CopyHeader != NULL)
+        {
+            FatPutCopyHeaders(Buffer, Offset, Length, RegionStart, CopyBytes,
+                              CopyCount, NULL, CopyHeaderLength);
+        }
+
+        UpdateProgress(Context, Length / BytesPerSector);
+
+        Offset += Length;
     }
 
 done:
     /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
+    BufferSize = 0;
+    NtFreeVirtualMemory(NtCurrentProcess(), (PVOID*)&Buffer, &BufferSize, MEM_RELEASE);
     return Status;
 }
 
+/***** Wipe function for FAT12, FAT16 and FAT32 formats *****/
+NTSTATUS
+FatWipeSectors(
+    IN HANDLE FileHandle,
+    IN ULONG StartSector,
+    IN ULONG SectorCount,
+    IN ULONG BytesPerSector,
+    IN OUT PFORMAT_CONTEXT Context)
+{
+    return FatWriteRegion(FileHandle,
+                          StartSector,
+                          SectorCount,
+                          BytesPerSector,
+                          0,
+                          0,
+                          NULL,
+                          0,
+                          Context);
+}
+
+/*
+ * Write all the copies of the FAT in one pass. They follow each other on the
+ * volume, and are empty except for the first entries given in Header.
+ */
+NTSTATUS
+FatWriteFatCopies(
+    IN HANDLE FileHandle,
+    IN ULONG FirstFatSector,
+    IN ULONG FatSectors,
+    IN ULONG FatCount,
+    IN ULONG BytesPerSector,
+    IN PUCHAR Header,
+    IN ULONG HeaderLength,
+    IN OUT PFORMAT_CONTEXT Context)
+{
+    ASSERT(HeaderLength <= BytesPerSector);
+
+    return FatWriteRegion(FileHandle,
+                          FirstFatSector,
+                          FatSectors * FatCount,
+                          BytesPerSector,
+                          FatSectors,
+                          FatCount,
+                          Header,
+                          HeaderLength,
+                          Context);
+}
+
 /* EOF */
@@ -17,11 +17,22 @@ ULONG CalcVolumeSerialNumber(VOID);
 NTSTATUS
 FatWipeSectors(
     IN HANDLE FileHandle,
-    IN ULONG TotalSectors,
-    IN ULONG SectorsPerCluster,
+    IN ULONG StartSector,
+    IN ULONG SectorCount,
     IN ULONG BytesPerSector,
     IN OUT PFORMAT_CONTEXT Context);
 
+NTSTATUS
+FatWriteFatCopies(
+    IN HANDLE FileHandle,
+    IN ULONG FirstFatSector,
+    IN ULONG FatSectors,
+    IN ULONG FatCount,
+    IN ULONG BytesPerSector,
+    IN PUCHAR Header,
+    IN ULONG HeaderLength,
+    IN OUT PFORMAT_CONTEXT Context);
+
 #endif /* _VFATCOMMON_H_ */
 
 /* EOF */
@@ -73,89 +73,23 @@ done:
 
 static NTSTATUS
 Fat12WriteFAT(IN HANDLE FileHandle,
-              IN ULONG SectorOffset,
               IN PFAT16_BOOT_SECTOR BootSector,
               IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
-    ULONG i;
-    ULONG Size;
-    ULONG Sectors;
-
-    /* Allocate buffer */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     32 * 1024);
-    if (Buffer == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, 32 * 1024);
-
-    /* FAT cluster 0 & 1*/
-    Buffer[0] = 0xf8; /* Media type */
-    Buffer[1] = 0xff;
-    Buffer[2] = 0xff;
-
-    /* Write first sector of the FAT */
-    FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors) * BootSector->BytesPerSector;
-    Status = NtWriteFile(FileHandle,
-                         NULL,
-                         NULL,
-                         NULL,
-                         &IoStatusBlock,
-                         Buffer,
-                         BootSector->BytesPerSector,
-                         &FileOffset,
-                         NULL);
-    if (!NT_SUCCESS(Status))
+    UCHAR Header[3] =
     {
-        DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-        goto done;
-    }
-
-    UpdateProgress(Context, 1);
-
-    /* Zero the begin of the buffer */
-    RtlZeroMemory(Buffer, 3);
-
-    /* Zero the rest of the FAT */
-    Sectors = 32 * 1024 / BootSector->BytesPerSector;
-    for (i = 1; i < (ULONG)BootSector->FATSectors; i += Sectors)
-    {
-        /* Zero some sectors of the FAT */
-        FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors + i) * BootSector->BytesPerSector;
-        if (((ULONG)BootSector->FATSectors - i) <= Sectors)
-        {
-            Sectors = (ULONG)BootSector->FATSectors - i;
-        }
-
-        Size = Sectors * BootSector->BytesPerSector;
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Size,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
-        }
-
-        UpdateProgress(Context, Sectors);
-    }
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+        0xf8, 0xff, 0xff /* FAT cluster 0 & 1: Media type */
+    };
+
+    /* Write all the FAT copies at once */
+    return FatWriteFatCopies(FileHandle,
+                             BootSector->ReservedSectors,
+                             (ULONG)BootSector->FATSectors,
+                             BootSector->FATCount,
+                             BootSector->BytesPerSector,
+                             Header,
+                             sizeof(Header),
+                             Context);
 }
 
 
@@ -164,15 +98,8 @@ Fat12WriteRootDirectory(IN HANDLE FileHandle,
                         IN PFAT16_BOOT_SECTOR BootSector,
                         IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status = STATUS_SUCCESS;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
     ULONG FirstRootDirSector;
     ULONG RootDirSectors;
-    ULONG Sectors;
-    ULONG Size;
-    ULONG i;
 
     DPRINT("BootSector->ReservedSectors = %hu\n", BootSector->ReservedSectors);
     DPRINT("BootSector->FATSectors = %hu\n", BootSector->FATSectors);
@@ -187,51 +114,12 @@ Fat12WriteRootDirectory(IN HANDLE FileHandle,
     DPRINT("RootDirSectors = %lu\n", RootDirSectors);
     DPRINT("FirstRootDirSector = %lu\n", FirstRootDirSector);
 
-    /* Allocate buffer for the cluster */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     32 * 1024);
-    if (Buffer == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, 32 * 1024);
-
-    Sectors = 32 * 1024 / BootSector->BytesPerSector;
-    for (i = 0; i < RootDirSectors; i += Sectors)
-    {
-        /* Zero some sectors of the root directory */
-        FileOffset.QuadPart = (FirstRootDirSector + i) * BootSector->BytesPerSector;
-
-        if ((RootDirSectors - i) <= Sectors)
-        {
-            Sectors = RootDirSectors - i;
-        }
-
-        Size = Sectors * BootSector->BytesPerSector;
-
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Size,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
-        }
-
-        UpdateProgress(Context, Sectors);
-    }
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+    /* Zero the root directory */
+    return FatWipeSectors(FileHandle,
+                          FirstRootDirSector,
+                          RootDirSectors,
+                          (ULONG)BootSector->BytesPerSector,
+                          Context);
 }
 
 
@@ -330,8 +218,8 @@ Fat12Format(IN HANDLE FileHandle,
         Context->TotalSectorCount += SectorCount;
 
         Status = FatWipeSectors(FileHandle,
+                                0,
                                 SectorCount,
-                                (ULONG)BootSector.SectorsPerCluster,
                                 (ULONG)BootSector.BytesPerSector,
                                 Context);
         if (!NT_SUCCESS(Status))
@@ -350,9 +238,8 @@ Fat12Format(IN HANDLE FileHandle,
         return Status;
     }
 
-    /* Write first FAT copy */
+    /* Write the FAT copies */
     Status = Fat12WriteFAT(FileHandle,
-                           0,
                            &BootSector,
                            Context);
     if (!NT_SUCCESS(Status))
@@ -361,17 +248,6 @@ Fat12Format(IN HANDLE FileHandle,
         return Status;
     }
 
-    /* Write second FAT copy */
-    Status = Fat12WriteFAT(FileHandle,
-                           (ULONG)BootSector.FATSectors,
-                           &BootSector,
-                           Context);
-    if (!NT_SUCCESS(Status))
-    {
-        DPRINT("Fat12WriteFAT() failed with status 0x%.08x.\n", Status);
-        return Status;
-    }
-
     Status = Fat12WriteRootDirectory(FileHandle,
                                      &BootSector,
                                      Context);
@@ -73,91 +73,24 @@ done:
 
 static NTSTATUS
 Fat16WriteFAT(IN HANDLE FileHandle,
-              IN ULONG SectorOffset,
               IN PFAT16_BOOT_SECTOR BootSector,
               IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
-    ULONG i;
-    ULONG Sectors;
-
-    /* Allocate buffer */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     32 * 1024);
-    if (Buffer == NULL)
-      return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, 32 * 1024);
-
-    /* FAT cluster 0 */
-    Buffer[0] = 0xf8; /* Media type */
-    Buffer[1] = 0xff;
-
-    /* FAT cluster 1 */
-    Buffer[2] = 0xff; /* Clean shutdown, no disk read/write errors, end-of-cluster (EOC) mark */
-    Buffer[3] = 0xff;
-
-    /* Write first sector of the FAT */
-    FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors) * BootSector->BytesPerSector;
-    Status = NtWriteFile(FileHandle,
-                         NULL,
-                         NULL,
-                         NULL,
-                         &IoStatusBlock,
-                         Buffer,
-                         BootSector->BytesPerSector,
-                         &FileOffset,
-                         NULL);
-    if (!NT_SUCCESS(Status))
+    UCHAR Header[4] =
     {
-        DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-        goto done;
-    }
-
-    UpdateProgress(Context, 1);
-
-    /* Zero the begin of the buffer */
-    RtlZeroMemory(Buffer, 4);
-
-    /* Zero the rest of the FAT */
-    Sectors = 32 * 1024 / BootSector->BytesPerSector;
-    for (i = 1; i < (ULONG)BootSector->FATSectors; i += Sectors)
-    {
-        /* Zero some sectors of the FAT */
-        FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors + i) * BootSector->BytesPerSector;
-
-        if (((ULONG)BootSector->FATSectors - i) <= Sectors)
-        {
-            Sectors = (ULONG)BootSector->FATSectors - i;
-        }
-
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Sectors * BootSector->BytesPerSector,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
-        }
-
-        UpdateProgress(Context, Sectors);
-    }
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+        0xf8, 0xff, /* FAT cluster 0: Media type */
+        0xff, 0xff  /* FAT cluster 1: Clean shutdown, no disk read/write errors, end-of-cluster (EOC) mark */
+    };
+
+    /* Write all the FAT copies at once */
+    return FatWriteFatCopies(FileHandle,
+                             BootSector->ReservedSectors,
+                             (ULONG)BootSector->FATSectors,
+                             BootSector->FATCount,
+                             BootSector->BytesPerSector,
+                             Header,
+                             sizeof(Header),
+                             Context);
 }
 
 
@@ -166,14 +99,8 @@ Fat16WriteRootDirectory(IN HANDLE FileHandle,
                         IN PFAT16_BOOT_SECTOR BootSector,
                         IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status = STATUS_SUCCESS;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
     ULONG FirstRootDirSector;
     ULONG RootDirSectors;
-    ULONG Sectors;
-    ULONG i;
 
     DPRINT("BootSector->ReservedSectors = %hu\n", BootSector->ReservedSectors);
     DPRINT("BootSector->FATSectors = %hu\n", BootSector->FATSectors);
@@ -188,49 +115,12 @@ Fat16WriteRootDirectory(IN HANDLE FileHandle,
     DPRINT("RootDirSectors = %lu\n", RootDirSectors);
     DPRINT("FirstRootDirSector = %lu\n", FirstRootDirSector);
 
-    /* Allocate buffer for the cluster */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     32 * 1024);
-    if (Buffer == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, 32 * 1024);
-
-    Sectors = 32 * 1024 / BootSector->BytesPerSector;
-    for (i = 0; i < RootDirSectors; i += Sectors)
-    {
-        /* Zero some sectors of the root directory */
-        FileOffset.QuadPart = (FirstRootDirSector + i) * BootSector->BytesPerSector;
-
-        if ((RootDirSectors - i) <= Sectors)
-        {
-            Sectors = RootDirSectors - i;
-        }
-
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Sectors * BootSector->BytesPerSector,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
-        }
-
-        UpdateProgress(Context, Sectors);
-    }
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+    /* Zero the root directory */
+    return FatWipeSectors(FileHandle,
+                          FirstRootDirSector,
+                          RootDirSectors,
+                          (ULONG)BootSector->BytesPerSector,
+                          Context);
 }
 
 
@@ -338,8 +228,8 @@ Fat16Format(IN HANDLE FileHandle,
         Context->TotalSectorCount += SectorCount;
 
         Status = FatWipeSectors(FileHandle,
+                                0,
                                 SectorCount,
-                                (ULONG)BootSector.SectorsPerCluster,
                                 (ULONG)BootSector.BytesPerSector,
                                 Context);
         if (!NT_SUCCESS(Status))
@@ -358,9 +248,8 @@ Fat16Format(IN HANDLE FileHandle,
         return Status;
     }
 
-    /* Write first FAT copy */
+    /* Write the FAT copies */
     Status = Fat16WriteFAT(FileHandle,
-                           0,
                            &BootSector,
                            Context);
     if (!NT_SUCCESS(Status))
@@ -369,17 +258,6 @@ Fat16Format(IN HANDLE FileHandle,
         return Status;
     }
 
-    /* Write second FAT copy */
-    Status = Fat16WriteFAT(FileHandle,
-                           (ULONG)BootSector.FATSectors,
-                           &BootSector,
-                           Context);
-    if (!NT_SUCCESS(Status))
-    {
-       DPRINT("Fat16WriteFAT() failed with status 0x%.08x.\n", Status);
-        return Status;
-    }
-
     Status = Fat16WriteRootDirectory(FileHandle,
                                      &BootSector,
                                      Context);
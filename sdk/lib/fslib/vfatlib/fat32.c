@@ -221,101 +221,25 @@ done:
 
 static NTSTATUS
 Fat32WriteFAT(IN HANDLE FileHandle,
-              IN ULONG SectorOffset,
               IN PFAT32_BOOT_SECTOR BootSector,
               IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
-    ULONG i;
-    ULONG Sectors;
-
-    /* Allocate buffer */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     64 * 1024);
-    if (Buffer == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, 64 * 1024);
-
-    /* FAT cluster 0 */
-    Buffer[0] = 0xf8; /* Media type */
-    Buffer[1] = 0xff;
-    Buffer[2] = 0xff;
-    Buffer[3] = 0x0f;
-
-    /* FAT cluster 1 */
-    Buffer[4] = 0xff; /* Clean shutdown, no disk read/write errors, end-of-cluster (EOC) mark */
-    Buffer[5] = 0xff;
-    Buffer[6] = 0xff;
-    Buffer[7] = 0x0f;
-
-    /* FAT cluster 2 */
-    Buffer[8] = 0xff; /* End of root directory */
-    Buffer[9] = 0xff;
-    Buffer[10] = 0xff;
-    Buffer[11] = 0x0f;
-
-    /* Write first sector of the FAT */
-    FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors) * BootSector->BytesPerSector;
-    Status = NtWriteFile(FileHandle,
-                         NULL,
-                         NULL,
-                         NULL,
-                         &IoStatusBlock,
-                         Buffer,
-                         BootSector->BytesPerSector,
-                         &FileOffset,
-                         NULL);
-    if (!NT_SUCCESS(Status))
+    UCHAR Header[12] =
     {
-        DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-        goto done;
-    }
-
-    UpdateProgress(Context, 1);
-
-    /* Zero the begin of the buffer */
-    RtlZeroMemory(Buffer, 12);
-
-    /* Zero the rest of the FAT */
-    Sectors = 64 * 1024 / BootSector->BytesPerSector;
-    for (i = 1; i < BootSector->FATSectors32; i += Sectors)
-    {
-        /* Zero some sectors of the FAT */
-        FileOffset.QuadPart = (SectorOffset + BootSector->ReservedSectors + i) * BootSector->BytesPerSector;
-
-        if ((BootSector->FATSectors32 - i) <= Sectors)
-        {
-            Sectors = BootSector->FATSectors32 - i;
-        }
-
-        Status = NtWriteFile(FileHandle,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &IoStatusBlock,
-                             Buffer,
-                             Sectors * BootSector->BytesPerSector,
-                             &FileOffset,
-                             NULL);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-            goto done;
-        }
-
-        UpdateProgress(Context, Sectors);
-    }
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+        0xf8, 0xff, 0xff, 0x0f, /* FAT cluster 0: Media type */
+        0xff, 0xff, 0xff, 0x0f, /* FAT cluster 1: Clean shutdown, no disk read/write errors, end-of-cluster (EOC) mark */
+        0xff, 0xff, 0xff, 0x0f  /* FAT cluster 2: End of root directory */
+    };
+
+    /* Write all the FAT copies at once */
+    return FatWriteFatCopies(FileHandle,
+                             BootSector->ReservedSectors,
+                             BootSector->FATSectors32,
+                             BootSector->FATCount,
+                             BootSector->BytesPerSector,
+                             Header,
+                             sizeof(Header),
+                             Context);
 }
 
 
@@ -324,22 +248,8 @@ Fat32WriteRootDirectory(IN HANDLE FileHandle,
                         IN PFAT32_BOOT_SECTOR BootSector,
                         IN OUT PFORMAT_CONTEXT Context)
 {
-    IO_STATUS_BLOCK IoStatusBlock;
-    NTSTATUS Status;
-    PUCHAR Buffer;
-    LARGE_INTEGER FileOffset;
-    ULONGLONG FirstDataSector;
-    ULONGLONG FirstRootDirSector;
-
-    /* Allocate buffer for the cluster */
-    Buffer = (PUCHAR)RtlAllocateHeap(RtlGetProcessHeap(),
-                                     0,
-                                     BootSector->SectorsPerCluster * BootSector->BytesPerSector);
-    if (Buffer == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
-
-    /* Zero the buffer */
-    RtlZeroMemory(Buffer, BootSector->SectorsPerCluster * BootSector->BytesPerSector);
+    ULONG FirstDataSector;
+    ULONG FirstRootDirSector;
 
     DPRINT("BootSector->ReservedSectors = %lu\n", BootSector->ReservedSectors);
     DPRINT("BootSector->FATSectors32 = %lu\n", BootSector->FATSectors32);
@@ -353,32 +263,15 @@ Fat32WriteRootDirectory(IN HANDLE FileHandle,
     DPRINT("FirstDataSector = %lu\n", FirstDataSector);
 
     FirstRootDirSector = ((BootSector->RootCluster - 2) * BootSector->SectorsPerCluster) + FirstDataSector;
-    FileOffset.QuadPart = FirstRootDirSector * BootSector->BytesPerSector;
 
     DPRINT("FirstRootDirSector = %lu\n", FirstRootDirSector);
-    DPRINT("FileOffset = %lu\n", FileOffset.QuadPart);
-
-    Status = NtWriteFile(FileHandle,
-                         NULL,
-                         NULL,
-                         NULL,
-                         &IoStatusBlock,
-                         Buffer,
-                         BootSector->SectorsPerCluster * BootSector->BytesPerSector,
-                         &FileOffset,
-                         NULL);
-    if (!NT_SUCCESS(Status))
-    {
-        DPRINT("NtWriteFile() failed (Status %lx)\n", Status);
-        goto done;
-    }
 
-    UpdateProgress(Context, (ULONG)BootSector->SectorsPerCluster);
-
-done:
-    /* Free the buffer */
-    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
-    return Status;
+    /* Zero the root directory cluster */
+    return FatWipeSectors(FileHandle,
+                          FirstRootDirSector,
+                          (ULONG)BootSector->SectorsPerCluster,
+                          (ULONG)BootSector->BytesPerSector,
+                          Context);
 }
 
 
@@ -498,8 +391,8 @@ Fat32Format(IN HANDLE FileHandle,
         Context->TotalSectorCount += BootSector.SectorsHuge;
 
         Status = FatWipeSectors(FileHandle,
+                                0,
                                 BootSector.SectorsHuge,
-                                (ULONG)BootSector.SectorsPerCluster,
                                 (ULONG)BootSector.BytesPerSector,
                                 Context);
         if (!NT_SUCCESS(Status))
@@ -527,25 +420,13 @@ Fat32Format(IN HANDLE FileHandle,
         return Status;
     }
 
-    /* Write first FAT copy */
-    Status = Fat32WriteFAT(FileHandle,
-                           0,
-                           &BootSector,
-                           Context);
-    if (!NT_SUCCESS(Status))
-    {
-      DPRINT("Fat32WriteFAT() failed with status 0x%.08x\n", Status);
-      return Status;
-    }
-
-    /* Write second FAT copy */
+    /* Write the FAT copies */
     Status = Fat32WriteFAT(FileHandle,
-                           BootSector.FATSectors32,
                            &BootSector,
                            Context);
     if (!NT_SUCCESS(Status))
     {
-        DPRINT("Fat32WriteFAT() failed with status 0x%.08x.\n", Status);
+        DPRINT("Fat32WriteFAT() failed with status 0x%.08x\n", Status);
         return Status;
     }
 
@@ -45,6 +45,42 @@ ULONG FsCheckFlags;
 PVOID FsCheckMemQueue;
 ULONG FsCheckTotalFiles;
 
+/*
+ * A plain file can be formatted too, as a disk image. It is handled like an
+ * unpartitioned fixed disk with 512-byte sectors.
+ */
+static NTSTATUS
+VfatGetImageFileGeometry(IN HANDLE FileHandle,
+                         OUT PDISK_GEOMETRY DiskGeometry,
+                         OUT PPARTITION_INFORMATION PartitionInfo)
+{
+    FILE_STANDARD_INFORMATION StandardInfo;
+    IO_STATUS_BLOCK Iosb;
+    NTSTATUS Status;
+
+    Status = NtQueryInformationFile(FileHandle,
+                                    &Iosb,
+                                    &StandardInfo,
+                                    sizeof(StandardInfo),
+                                    FileStandardInformation);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    if (StandardInfo.Directory || StandardInfo.EndOfFile.QuadPart < 512)
+        return STATUS_INVALID_DEVICE_REQUEST;
+
+    DiskGeometry->MediaType = FixedMedia;
+    DiskGeometry->BytesPerSector = 512;
+    DiskGeometry->SectorsPerTrack = 63;
+    DiskGeometry->TracksPerCylinder = 255;
+    DiskGeometry->Cylinders.QuadPart = StandardInfo.EndOfFile.QuadPart / (512 * 63 * 255);
+
+    RtlZeroMemory(PartitionInfo, sizeof(*PartitionInfo));
+    PartitionInfo->PartitionLength.QuadPart = StandardInfo.EndOfFile.QuadPart & ~511ULL;
+
+    return STATUS_SUCCESS;
+}
+
 BOOLEAN
 NTAPI
 VfatFormat(
@@ -63,6 +99,7 @@ VfatFormat(
     PARTITION_INFORMATION PartitionInfo;
     FORMAT_CONTEXT Context;
     NTSTATUS Status, LockStatus;
+    BOOLEAN IsImageFile = FALSE;
 
     DPRINT("VfatFormat(DriveRoot '%wZ')\n", DriveRoot);
 
@@ -107,11 +144,23 @@ VfatFormat(
     if (!NT_SUCCESS(Status))
     {
         DPRINT("IOCTL_DISK_GET_DRIVE_GEOMETRY failed with status 0x%08x\n", Status);
-        NtClose(FileHandle);
-        return FALSE;
+
+        /* This may be an image file rather than a disk */
+        if (!NT_SUCCESS(VfatGetImageFileGeometry(FileHandle, &DiskGeometry, &PartitionInfo)))
+        {
+            NtClose(FileHandle);
+            return FALSE;
+        }
+
+        IsImageFile = TRUE;
     }
 
-    if (DiskGeometry.MediaType == FixedMedia)
+    if (IsImageFile)
+    {
+        DPRINT("Formatting an image file of %I64d bytes\n",
+               PartitionInfo.PartitionLength.QuadPart);
+    }
+    else if (DiskGeometry.MediaType == FixedMedia)
     {
         DPRINT("Cylinders %I64d\n", DiskGeometry.Cylinders.QuadPart);
         DPRINT("TracksPerCylinder %ld\n", DiskGeometry.TracksPerCylinder);
@@ -223,19 +272,22 @@ VfatFormat(
         Callback(PROGRESS, 0, (PVOID)&Context.Percent);
     }
 
-    LockStatus = NtFsControlFile(FileHandle,
-                                 NULL,
-                                 NULL,
-                                 NULL,
-                                 &Iosb,
-                                 FSCTL_LOCK_VOLUME,
-                                 NULL,
-                                 0,
-                                 NULL,
-                                 0);
-    if (!NT_SUCCESS(LockStatus))
+    if (!IsImageFile)
     {
-        DPRINT1("WARNING: Failed to lock volume for formatting! Format may fail! (Status: 0x%x)\n", LockStatus);
+        LockStatus = NtFsControlFile(FileHandle,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     &Iosb,
+                                     FSCTL_LOCK_VOLUME,
+                                     NULL,
+                                     0,
+                                     NULL,
+                                     0);
+        if (!NT_SUCCESS(LockStatus))
+        {
+            DPRINT1("WARNING: Failed to lock volume for formatting! Format may fail! (Status: 0x%x)\n", LockStatus);
+        }
     }
 
     if (PartitionInfo.PartitionType == PARTITION_FAT_12)
@@ -279,35 +331,38 @@ VfatFormat(
         Status = STATUS_INVALID_PARAMETER;
     }
 
-    /* Attempt to dismount formatted volume */
-    LockStatus = NtFsControlFile(FileHandle,
-                                 NULL,
-                                 NULL,
-                                 NULL,
-                                 &Iosb,
-                                 FSCTL_DISMOUNT_VOLUME,
-                                 NULL,
-                                 0,
-                                 NULL,
-                                 0);
-    if (!NT_SUCCESS(LockStatus))
+    if (!IsImageFile)
     {
-        DPRINT1("Failed to umount volume (Status: 0x%x)\n", LockStatus);
-    }
+        /* Attempt to dismount formatted volume */
+        LockStatus = NtFsControlFile(FileHandle,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     &Iosb,
+                                     FSCTL_DISMOUNT_VOLUME,
+                                     NULL,
+                                     0,
+                                     NULL,
+                                     0);
+        if (!NT_SUCCESS(LockStatus))
+        {
+            DPRINT1("Failed to umount volume (Status: 0x%x)\n", LockStatus);
+        }
 
-    LockStatus = NtFsControlFile(FileHandle,
-                                 NULL,
-                                 NULL,
-                                 NULL,
-                                 &Iosb,
-                                 FSCTL_UNLOCK_VOLUME,
-                                 NULL,
-                                 0,
-                                 NULL,
-                                 0);
-    if (!NT_SUCCESS(LockStatus))
-    {
-        DPRINT1("Failed to unlock volume (Status: 0x%x)\n", LockStatus);
+        LockStatus = NtFsControlFile(FileHandle,
+                                     NULL,
+                                     NULL,
+                                     NULL,
+                                     &Iosb,
+                                     FSCTL_UNLOCK_VOLUME,
+                                     NULL,
+                                     0,
+                                     NULL,
+                                     0);
+        if (!NT_SUCCESS(LockStatus))
+        {
+            DPRINT1("Failed to unlock volume (Status: 0x%x)\n", LockStatus);
+        }
     }
 
     NtClose(FileHandle);
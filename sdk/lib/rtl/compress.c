@@ -20,6 +20,24 @@
 #define COMPRESSION_FORMAT_MASK  0x00FF
 #define COMPRESSION_ENGINE_MASK  0xFF00
 
+/* LZNT1 compression state, kept in the caller supplied workspace */
+#define LZNT1_HASH_BITS          12
+#define LZNT1_HASH_SIZE          (1 << LZNT1_HASH_BITS)
+#define LZNT1_NIL                0xFFFF
+#define LZNT1_MIN_MATCH          3
+
+typedef struct _LZNT1_WORKSPACE
+{
+    USHORT Head[LZNT1_HASH_SIZE];
+    USHORT Prev[0x1000];
+} LZNT1_WORKSPACE, *PLZNT1_WORKSPACE;
+
+C_ASSERT(sizeof(LZNT1_WORKSPACE) <= 0x8010);
+
+/* number of hash chain entries probed per position, the maximum
+ * engine additionally uses lazy matching */
+#define LZNT1_CHAIN_STANDARD     8
+#define LZNT1_CHAIN_MAXIMUM      4096
 
 
 
@@ -216,28 +234,200 @@ out:
 }
 
 
+/* number of displacement bits for a backwards reference at position pos
+ * of the chunk, must match what lznt1_decompress_chunk computes */
+static inline ULONG lznt1_displacement_bits(ULONG pos)
+{
+    ULONG displacement_bits;
+
+    for (displacement_bits = 12; displacement_bits > 4; displacement_bits--)
+        if ((1 << (displacement_bits - 1)) < pos) break;
+
+    return displacement_bits;
+}
+
+static inline ULONG lznt1_hash(const UCHAR *src)
+{
+    return ((src[0] << 16 | src[1] << 8 | src[2]) * 2654435761U) >> (32 - LZNT1_HASH_BITS);
+}
+
+static inline void lznt1_insert(PLZNT1_WORKSPACE ws, const UCHAR *src, ULONG pos, ULONG src_size)
+{
+    ULONG hash;
+
+    if (pos + LZNT1_MIN_MATCH > src_size)
+        return;
+
+    hash = lznt1_hash(src + pos);
+    ws->Prev[pos] = ws->Head[hash];
+    ws->Head[hash] = (USHORT)pos;
+}
+
+/* find the longest match for position pos, returns 0 if there is none */
+static ULONG lznt1_find_match(PLZNT1_WORKSPACE ws, const UCHAR *src, ULONG pos, ULONG src_size,
+                              ULONG max_chain, ULONG *displacement)
+{
+    ULONG displacement_bits, max_displacement, max_length;
+    ULONG best_length = 0, length, cand;
+
+    if (pos + LZNT1_MIN_MATCH > src_size)
+        return 0;
+
+    displacement_bits = lznt1_displacement_bits(pos);
+    max_displacement  = 1 << displacement_bits;
+    max_length        = min((1 << (16 - displacement_bits)) + 2, src_size - pos);
+
+    for (cand = ws->Head[lznt1_hash(src + pos)]; cand != LZNT1_NIL && max_chain--; cand = ws->Prev[cand])
+    {
+        /* chains are ordered by decreasing position */
+        if (pos - cand > max_displacement)
+            break;
+
+        /* quick reject on the byte that would extend the current best match */
+        if (src[cand + best_length] != src[pos + best_length] || src[cand] != src[pos])
+            continue;
+
+        /* the reference may overlap the current position, which the
+         * decompressor handles by copying byte by byte */
+        for (length = 1; length < max_length; length++)
+            if (src[cand + length] != src[pos + length]) break;
+
+        if (length > best_length)
+        {
+            best_length = length;
+            *displacement = pos - cand;
+            if (length == max_length) break;
+        }
+    }
+
+    return (best_length >= LZNT1_MIN_MATCH) ? best_length : 0;
+}
+
+/* compress a single LZNT1 chunk, returns 0 if the result does not fit in dst_size */
+static ULONG lznt1_compress_chunk(UCHAR *dst, ULONG dst_size, const UCHAR *src, ULONG src_size,
+                                  PLZNT1_WORKSPACE ws, BOOLEAN maximum)
+{
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
+    ULONG max_chain = maximum ? LZNT1_CHAIN_MAXIMUM : LZNT1_CHAIN_STANDARD;
+    ULONG pos = 0, inserted = 0, bit;
+    ULONG length, displacement = 0, next_length = 0, next_displacement = 0;
+    ULONG length_bits;
+    BOOLEAN have_next = FALSE;
+    UCHAR *flags;
+
+    RtlFillMemory(ws->Head, sizeof(ws->Head), 0xFF);
+
+    while (pos < src_size)
+    {
+        /* reserve the flags byte for the following 8 entities */
+        if (dst_cur >= dst_end)
+            return 0;
+        flags = dst_cur++;
+        *flags = 0;
+
+        for (bit = 0; bit < 8 && pos < src_size; bit++)
+        {
+            if (have_next)
+            {
+                /* match found by the lazy evaluation of the previous entity */
+                length = next_length;
+                displacement = next_displacement;
+                have_next = FALSE;
+            }
+            else
+            {
+                length = lznt1_find_match(ws, src, pos, src_size, max_chain, &displacement);
+                lznt1_insert(ws, src, inserted++, src_size);
+            }
+
+            /* lazy evaluation: emit a literal if the next position has a longer match */
+            if (maximum && length && pos + 1 < src_size)
+            {
+                next_length = lznt1_find_match(ws, src, pos + 1, src_size, max_chain, &next_displacement);
+                lznt1_insert(ws, src, inserted++, src_size);
+                if (next_length > length)
+                {
+                    length = 0;
+                    have_next = TRUE;
+                }
+            }
+
+            if (length)
+            {
+                /* backwards reference */
+                if (dst_cur + sizeof(WORD) > dst_end)
+                    return 0;
+                length_bits = 16 - lznt1_displacement_bits(pos);
+                *(WORD *)dst_cur = (WORD)(((displacement - 1) << length_bits) | (length - LZNT1_MIN_MATCH));
+                dst_cur += sizeof(WORD);
+                *flags |= 1 << bit;
+
+                pos += length;
+                while (inserted < pos)
+                    lznt1_insert(ws, src, inserted++, src_size);
+            }
+            else
+            {
+                /* uncompressed data */
+                if (dst_cur >= dst_end)
+                    return 0;
+                *dst_cur++ = src[pos++];
+            }
+        }
+    }
+
+    return dst_cur - dst;
+}
+
 static NTSTATUS
 RtlpCompressBufferLZNT1(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
-                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace)
+                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace,
+                        USHORT engine)
 {
         UCHAR *src_cur = src, *src_end = src + src_size;
         UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
-        ULONG block_size;
+        ULONG block_size, compressed_size;
+
+        if (engine != COMPRESSION_ENGINE_STANDARD && engine != COMPRESSION_ENGINE_MAXIMUM)
+            return STATUS_NOT_SUPPORTED;
 
         while (src_cur < src_end)
         {
             /* determine size of current chunk */
             block_size = min(0x1000, src_end - src_cur);
-            if (dst_cur + sizeof(WORD) + block_size > dst_end)
+            if (dst_cur + sizeof(WORD) > dst_end)
                 return STATUS_BUFFER_TOO_SMALL;
 
-            /* write (uncompressed) chunk header */
-            *(WORD *)dst_cur = 0x3000 | (block_size - 1);
-            dst_cur += sizeof(WORD);
+            /* try to compress the chunk, it is only kept if it became smaller */
+            compressed_size = 0;
+            if (workspace)
+            {
+                compressed_size = lznt1_compress_chunk(dst_cur + sizeof(WORD),
+                                                       min(block_size - 1, dst_end - dst_cur - sizeof(WORD)),
+                                                       src_cur, block_size, (PLZNT1_WORKSPACE)workspace,
+                                                       engine == COMPRESSION_ENGINE_MAXIMUM);
+            }
+
+            if (compressed_size)
+            {
+                /* write compressed chunk header */
+                *(WORD *)dst_cur = 0xB000 | (compressed_size - 1);
+                dst_cur += sizeof(WORD) + compressed_size;
+            }
+            else
+            {
+                if (dst_cur + sizeof(WORD) + block_size > dst_end)
+                    return STATUS_BUFFER_TOO_SMALL;
+
+                /* write (uncompressed) chunk header */
+                *(WORD *)dst_cur = 0x3000 | (block_size - 1);
+                dst_cur += sizeof(WORD);
+
+                /* write chunk content */
+                memcpy(dst_cur, src_cur, block_size);
+                dst_cur += block_size;
+            }
 
-            /* write chunk content */
-            memcpy(dst_cur, src_cur, block_size);
-            dst_cur += block_size;
             src_cur += block_size;
         }
 
@@ -261,7 +451,7 @@ RtlpWorkSpaceSizeLZNT1(USHORT Engine,
    }
    else if (Engine == COMPRESSION_ENGINE_MAXIMUM)
    {
-      *BufferAndWorkSpaceSize = 0x10;
+      *BufferAndWorkSpaceSize = 0x8010;
       *FragmentWorkSpaceSize = 0x1000;
       return(STATUS_SUCCESS);
    }
@@ -284,7 +474,7 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                   IN PVOID WorkSpace)
 {
    USHORT Format = CompressionFormatAndEngine & COMPRESSION_FORMAT_MASK;
-   /* USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK; */
+   USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK;
 
    if ((Format == COMPRESSION_FORMAT_NONE) ||
          (Format == COMPRESSION_FORMAT_DEFAULT))
@@ -297,7 +487,8 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                                      CompressedBufferSize,
                                      UncompressedChunkSize,
                                      FinalCompressedSize,
-                                     WorkSpace));
+                                     WorkSpace,
+                                     Engine));
 
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
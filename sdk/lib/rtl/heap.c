@@ -2017,6 +2017,24 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 
     Index = AllocationSize >> HEAP_ENTRY_SHIFT;
 
+    /* Small blocks without extra stuff are served by the front end, if enabled */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH &&
+        !(EntryFlags & HEAP_ENTRY_EXTRA_PRESENT) &&
+        Index <= HEAP_LFH_MAX_UNITS)
+    {
+        InUseEntry = RtlpLfhAllocate(Heap, Flags, Size, AllocationSize, EntryFlags);
+        if (InUseEntry)
+        {
+            /* Zero memory if that was requested */
+            if (Flags & HEAP_ZERO_MEMORY)
+                RtlZeroMemory(InUseEntry + 1, Size);
+
+            return InUseEntry + 1;
+        }
+
+        /* Fall back to the back end */
+    }
+
     /* Acquire the lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2206,6 +2224,7 @@ BOOLEAN NTAPI RtlFreeHeap(
     USHORT TagIndex = 0;
     SIZE_T BlockSize;
     PHEAP_VIRTUAL_ALLOC_ENTRY VirtualEntry;
+    PHEAP_LFH_SUBSEGMENT SubSegment = NULL;
     BOOLEAN Locked = FALSE;
     NTSTATUS Status;
 
@@ -2226,10 +2245,14 @@ BOOLEAN NTAPI RtlFreeHeap(
     /* Protect with SEH in case the pointer is not valid */
     _SEH2_TRY
     {
+        /* Front end blocks are checked against their subsegment */
+        if ((HeapEntry->Flags & HEAP_ENTRY_BUSY) && RtlpIsLfhBlock(HeapEntry))
+            SubSegment = RtlpLfhGetSubSegment(Heap, HeapEntry);
+
         /* Check this entry, fail if it's invalid */
         if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY) ||
             (((ULONG_PTR)Ptr & 0x7) != 0) ||
-            (HeapEntry->SegmentOffset >= HEAP_SEGMENTS))
+            (!SubSegment && HeapEntry->SegmentOffset >= HEAP_SEGMENTS))
         {
             /* This is an invalid block */
             DPRINT1("HEAP: Trying to free an invalid address %p!\n", Ptr);
@@ -2246,6 +2269,13 @@ BOOLEAN NTAPI RtlFreeHeap(
     }
     _SEH2_END;
 
+    /* Front end blocks go back to their subsegment without locking the heap */
+    if (SubSegment)
+    {
+        RtlpLfhFree(SubSegment, HeapEntry);
+        return TRUE;
+    }
+
     /* Lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2637,6 +2667,7 @@ RtlReAllocateHeap(HANDLE HeapPtr,
     PVOID DecommitBase;
     SIZE_T RemainderBytes, ExtraSize;
     PHEAP_VIRTUAL_ALLOC_ENTRY VirtualAllocBlock;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
     EXCEPTION_RECORD ExceptionRecord;
     UCHAR SegmentOffset;
 
@@ -2698,6 +2729,24 @@ RtlReAllocateHeap(HANDLE HeapPtr,
         return Ptr;
     }
 
+    /* Front end blocks never get resized by the back end */
+    if (RtlpIsLfhBlock(InUseEntry))
+    {
+        SubSegment = RtlpLfhGetSubSegment(Heap, InUseEntry);
+
+        /* The front end does its own locking */
+        if (HeapLocked)
+            RtlLeaveHeapLock(Heap->LockVariable);
+
+        if (!SubSegment)
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+            return Ptr;
+        }
+
+        return RtlpLfhReAllocate(Heap, Flags, SubSegment, InUseEntry, Size, AllocationSize);
+    }
+
     if (InUseEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC)
     {
         /* This is a virtually allocated block. Get its size */
@@ -3174,7 +3223,7 @@ RtlSizeHeap(
     }
     else
     {
-        /* Calculate it */
+        /* Calculate it. Front end blocks keep Size and UnusedBytes the same way */
         EntrySize = (HeapEntry->Size << HEAP_ENTRY_SHIFT) - HeapEntry->UnusedBytes;
     }
 
@@ -3235,6 +3284,13 @@ RtlpValidateHeapEntry(
     if ((ULONG_PTR)HeapEntry & (HEAP_ENTRY_SIZE - 1)) goto invalid_entry;
     if (!(HeapEntry->Flags & HEAP_ENTRY_BUSY)) goto invalid_entry;
 
+    /* Front end blocks live inside a busy back end block */
+    if (RtlpIsLfhBlock(HeapEntry))
+    {
+        if (!RtlpLfhGetSubSegment(Heap, HeapEntry)) goto invalid_entry;
+        return TRUE;
+    }
+
     BigAllocation = HeapEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC;
     Segment = Heap->Segments[HeapEntry->SegmentOffset];
 
@@ -3999,13 +4055,18 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
         }
 
         /* Check for a special magic value for enabling LFH */
-        if (*(PULONG)HeapInformation != 2)
+        if (*(PULONG)HeapInformation != HEAP_FRONT_END_LFH)
         {
             return STATUS_UNSUCCESSFUL;
         }
 
-        DPRINT1("RtlSetHeapInformation() needs to enable LFH\n");
-        return STATUS_SUCCESS;
+        /* There is no default heap to apply this to */
+        if (!HeapHandle)
+        {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        return RtlpLfhEnable((PHEAP)HeapHandle);
     }
 
     return STATUS_SUCCESS;
@@ -4053,10 +4114,104 @@ RtlMultipleAllocateHeap(IN PVOID HeapHandle,
                         IN ULONG Count,
                         OUT PVOID *Array)
 {
-    ULONG Index;
+    PHEAP Heap = (PHEAP)HeapHandle;
+    ULONG Index = 0;
     EXCEPTION_RECORD ExceptionRecord;
+    PHEAP_ENTRY Chunk, InUseEntry;
+    SIZE_T AllocationSize, Units, ChunkCount, i;
+    UCHAR LastFlags;
+    ULONG HeapFlags;
+
+    if (Count < 2)
+        goto SingleBlocks;
+
+    HeapFlags = Flags | Heap->ForceFlags;
 
-    for (Index = 0; Index < Count; ++Index)
+    AllocationSize = ((Size ? Size : 1) + Heap->AlignRound) & Heap->AlignMask;
+    Units = AllocationSize >> HEAP_ENTRY_SHIFT;
+
+    /* Batches are carved out of one back end block, so leave everything
+       which needs per-block bookkeeping to the single block path */
+    if (Size >= 0x80000000 ||
+        RtlpHeapIsSpecial(HeapFlags) ||
+        (HeapFlags & HEAP_EXTRA_FLAGS_MASK) ||
+        Heap->PseudoTagEntries ||
+        (Heap->ForceFlags & HEAP_GENERATE_EXCEPTIONS) ||
+        (Heap->Flags & (HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED)) ||
+        (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH && Units <= HEAP_LFH_MAX_UNITS) ||
+        Units * 2 > Heap->VirtualMemoryThreshold)
+    {
+        goto SingleBlocks;
+    }
+
+    while (Count - Index >= 2)
+    {
+        ChunkCount = min(Count - Index, Heap->VirtualMemoryThreshold / Units);
+
+        if (!(HeapFlags & HEAP_NO_SERIALIZE))
+            RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+        /* Get a single block large enough for the whole batch */
+        Chunk = RtlAllocateHeap(Heap,
+                                (HeapFlags & ~(HEAP_ZERO_MEMORY | HEAP_GENERATE_EXCEPTIONS)) | HEAP_NO_SERIALIZE,
+                                ChunkCount * AllocationSize - sizeof(HEAP_ENTRY));
+        if (!Chunk)
+        {
+            if (!(HeapFlags & HEAP_NO_SERIALIZE))
+                RtlLeaveHeapLock(Heap->LockVariable);
+
+            /* Let the single block path sort it out */
+            break;
+        }
+
+        /* Split it into ChunkCount busy entries. The last one keeps the slack
+           the back end may have added, and the last entry flag */
+        Chunk = (PHEAP_ENTRY)Chunk - 1;
+        LastFlags = Chunk->Flags;
+        InUseEntry = Chunk + (ChunkCount - 1) * Units;
+        InUseEntry->Size = (USHORT)(Chunk->Size - (ChunkCount - 1) * Units);
+
+        for (i = 0; i < ChunkCount; i++)
+        {
+            InUseEntry = Chunk + i * Units;
+
+            if (i)
+            {
+                InUseEntry->PreviousSize = (USHORT)Units;
+                InUseEntry->SegmentOffset = Chunk->SegmentOffset;
+            }
+
+            if (i != ChunkCount - 1)
+                InUseEntry->Size = (USHORT)Units;
+
+            InUseEntry->Flags = LastFlags & ~HEAP_ENTRY_LAST_ENTRY;
+            InUseEntry->SmallTagIndex = 0;
+            InUseEntry->UnusedBytes = (UCHAR)((InUseEntry->Size << HEAP_ENTRY_SHIFT) - Size);
+        }
+
+        /* The last entry is now the neighbour of whatever follows the chunk */
+        if (LastFlags & HEAP_ENTRY_LAST_ENTRY)
+            InUseEntry->Flags |= HEAP_ENTRY_LAST_ENTRY;
+        else
+            (InUseEntry + InUseEntry->Size)->PreviousSize = InUseEntry->Size;
+
+        if (!(HeapFlags & HEAP_NO_SERIALIZE))
+            RtlLeaveHeapLock(Heap->LockVariable);
+
+        /* Hand the entries out */
+        for (i = 0; i < ChunkCount; i++)
+        {
+            InUseEntry = Chunk + i * Units;
+
+            if (HeapFlags & HEAP_ZERO_MEMORY)
+                RtlZeroMemory(InUseEntry + 1, Size);
+
+            Array[Index++] = InUseEntry + 1;
+        }
+    }
+
+SingleBlocks:
+    for (; Index < Count; ++Index)
     {
         Array[Index] = RtlAllocateHeap(HeapHandle, Flags, Size);
         if (Array[Index] == NULL)
@@ -4088,30 +4243,54 @@ RtlMultipleFreeHeap(IN PVOID HeapHandle,
                     IN ULONG Count,
                     OUT PVOID *Array)
 {
+    PHEAP Heap = (PHEAP)HeapHandle;
     ULONG Index;
+    BOOLEAN HeapLocked = FALSE;
 
-    for (Index = 0; Index < Count; ++Index)
+    /* Free the whole batch under a single lock acquisition. Every block
+       still gets coalesced with its already freed neighbours */
+    if (Count > 1 &&
+        !(Flags & HEAP_NO_SERIALIZE) &&
+        !RtlpHeapIsSpecial(Flags | Heap->ForceFlags) &&
+        !(Heap->ForceFlags & HEAP_NO_SERIALIZE))
     {
-        if (Array[Index] == NULL)
-            continue;
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+        HeapLocked = TRUE;
+        Flags |= HEAP_NO_SERIALIZE;
+    }
 
-        _SEH2_TRY
+    _SEH2_TRY
+    {
+        for (Index = 0; Index < Count; ++Index)
         {
-            if (!RtlFreeHeap(HeapHandle, Flags, Array[Index]))
+            if (Array[Index] == NULL)
+                continue;
+
+            _SEH2_TRY
+            {
+                if (!RtlFreeHeap(HeapHandle, Flags, Array[Index]))
+                {
+                    /* ERROR_INVALID_PARAMETER */
+                    RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+                    break;
+                }
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
             {
                 /* ERROR_INVALID_PARAMETER */
                 RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
                 break;
             }
+            _SEH2_END;
         }
-        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
-        {
-            /* ERROR_INVALID_PARAMETER */
-            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
-            break;
-        }
-        _SEH2_END;
     }
+    _SEH2_FINALLY
+    {
+        /* A bad array still faults the caller, but not with the lock held */
+        if (HeapLocked)
+            RtlLeaveHeapLock(Heap->LockVariable);
+    }
+    _SEH2_END;
 
     return Index;
 }
@@ -55,6 +55,19 @@
 /* Segment flags */
 #define HEAP_USER_ALLOCATED    0x1
 
+/* Front end heap types */
+#define HEAP_FRONT_END_NONE    0
+#define HEAP_FRONT_END_LFH     2
+
+/* Low fragmentation front end definitions */
+#define HEAP_LFH_BLOCK              0xFF /* Never a valid SegmentOffset */
+#define HEAP_LFH_BUCKETS            128
+#define HEAP_LFH_MAX_UNITS          2048
+#define HEAP_LFH_MAX_AFFINITY       16
+#define HEAP_LFH_SUBSEGMENT_SIZE    0x10000
+#define HEAP_LFH_MIN_BLOCKS         8
+#define HEAP_LFH_SIGNATURE          0x4846464C /* 'LFFH' */
+
 /* A handy inline to distinguis normal heap, special "debug heap" and special "page heap" */
 FORCEINLINE BOOLEAN
 RtlpHeapIsSpecial(ULONG Flags)
@@ -318,6 +331,31 @@ typedef struct _HEAP_VIRTUAL_ALLOC_ENTRY
     HEAP_ENTRY BusyBlock;
 } HEAP_VIRTUAL_ALLOC_ENTRY, *PHEAP_VIRTUAL_ALLOC_ENTRY;
 
+typedef struct _HEAP_LFH_SUBSEGMENT
+{
+    SLIST_HEADER FreeBlocks;
+    struct _HEAP_LFH_SUBSEGMENT *Next;
+    PHEAP Heap;
+    ULONG Signature;
+    USHORT BlockCount;
+    USHORT BucketIndex;
+} HEAP_LFH_SUBSEGMENT, *PHEAP_LFH_SUBSEGMENT;
+
+#define HEAP_LFH_SUBSEGMENT_HEADER_SIZE ALIGN_UP_BY(sizeof(HEAP_LFH_SUBSEGMENT), sizeof(HEAP_ENTRY))
+
+typedef struct _HEAP_LFH_BUCKET
+{
+    PHEAP_LFH_SUBSEGMENT volatile ActiveSubSegment;
+    PHEAP_LFH_SUBSEGMENT SubSegments;
+} HEAP_LFH_BUCKET, *PHEAP_LFH_BUCKET;
+
+typedef struct _HEAP_LFH
+{
+    LONG NextAffinity;
+    ULONG AffinitySlots;
+    HEAP_LFH_BUCKET Buckets[ANYSIZE_ARRAY]; /* AffinitySlots * HEAP_LFH_BUCKETS */
+} HEAP_LFH, *PHEAP_LFH;
+
 /* Global variables */
 extern RTL_CRITICAL_SECTION RtlpProcessHeapsListLock;
 extern BOOLEAN RtlpPageHeapEnabled;
@@ -464,6 +502,40 @@ RtlpPageHeapSize(HANDLE HeapPtr,
                  ULONG Flags,
                  PVOID Ptr);
 
+/* heaplfh.c */
+PHEAP_ENTRY NTAPI
+RtlpLfhAllocate(PHEAP Heap,
+                ULONG Flags,
+                SIZE_T Size,
+                SIZE_T AllocationSize,
+                UCHAR EntryFlags);
+
+VOID NTAPI
+RtlpLfhFree(PHEAP_LFH_SUBSEGMENT SubSegment,
+            PHEAP_ENTRY HeapEntry);
+
+PVOID NTAPI
+RtlpLfhReAllocate(PHEAP Heap,
+                  ULONG Flags,
+                  PHEAP_LFH_SUBSEGMENT SubSegment,
+                  PHEAP_ENTRY InUseEntry,
+                  SIZE_T Size,
+                  SIZE_T AllocationSize);
+
+PHEAP_LFH_SUBSEGMENT NTAPI
+RtlpLfhGetSubSegment(PHEAP Heap,
+                     PHEAP_ENTRY HeapEntry);
+
+NTSTATUS NTAPI
+RtlpLfhEnable(PHEAP Heap);
+
+/* A handy inline to check whether a block belongs to the front end */
+FORCEINLINE BOOLEAN
+RtlpIsLfhBlock(PHEAP_ENTRY HeapEntry)
+{
+    return (HeapEntry->LFHFlags == HEAP_LFH_BLOCK);
+}
+
 VOID
 NTAPI
 RtlpAddHeapToProcessList(PHEAP Heap);
@@ -0,0 +1,363 @@
+/*
+ * COPYRIGHT:       See COPYING in the top level directory
+ * PROJECT:         ReactOS system libraries
+ * FILE:            lib/rtl/heaplfh.c
+ * PURPOSE:         RTL Heap low fragmentation front end
+ */
+
+/* Useful references:
+   http://illmatics.com/Understanding_the_LFH.pdf
+*/
+
+/* INCLUDES *****************************************************************/
+
+#include <rtl.h>
+#include <heap.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* Front end design:
+ *
+ * Small blocks are carved out of subsegments, which are ordinary busy blocks
+ * of the back end heap. Every subsegment holds blocks of a single size
+ * (bucket) and keeps its free blocks in an interlocked SList, so allocating
+ * from and freeing to an existing subsegment never takes the heap lock.
+ *
+ * Each thread is given a virtual affinity slot, and every slot has its own
+ * active subsegment per bucket, so threads on different processors do not
+ * contend on the same SList. The heap lock is only taken to switch the
+ * active subsegment of a slot, or to get a new subsegment from the back end.
+ *
+ * Subsegments are never given back to the back end before the heap is
+ * destroyed, which is what makes the lock free paths safe: a stale active
+ * subsegment pointer still points to a valid subsegment of the same size.
+ *
+ * Front end blocks are marked with HEAP_LFH_BLOCK in the LFHFlags field
+ * (which overlaps SegmentOffset), their PreviousSize holds the index of the
+ * block in its subsegment and SmallTagIndex holds the bucket index. Size and
+ * UnusedBytes have the same meaning as for back end blocks.
+ */
+
+/* FUNCTIONS *****************************************************************/
+
+static
+USHORT
+RtlpLfhBucketUnits(ULONG Bucket)
+{
+    ULONG Group;
+
+    /* The first 32 buckets have a granularity of one heap entry */
+    if (Bucket < 32)
+        return (USHORT)(Bucket + 1);
+
+    /* Every following group of 16 buckets doubles the granularity */
+    Group = (Bucket - 32) / 16;
+    return (USHORT)((((Bucket - 32) % 16) + 17) << (Group + 1));
+}
+
+static
+ULONG
+RtlpLfhBucketFromUnits(SIZE_T Units)
+{
+    ULONG HighBit;
+
+    if (Units <= 32)
+        return (ULONG)Units - 1;
+
+    /* Units - 1 is in [2^HighBit, 2^(HighBit + 1)[, with HighBit >= 5 */
+    _BitScanReverse(&HighBit, (ULONG)(Units - 1));
+    return 32 + (HighBit - 5) * 16 + ((ULONG)(Units - 1) >> (HighBit - 4)) - 16;
+}
+
+static
+PHEAP_LFH_BUCKET
+RtlpLfhGetBucket(PHEAP_LFH Lfh, ULONG Bucket)
+{
+    PTEB Teb = NtCurrentTeb();
+    ULONG Affinity;
+
+    /* Give this thread a virtual affinity on its first front end allocation */
+    Affinity = Teb->HeapVirtualAffinity;
+    if (!Affinity)
+    {
+        Affinity = (ULONG)InterlockedIncrement(&Lfh->NextAffinity);
+        Teb->HeapVirtualAffinity = Affinity;
+    }
+
+    return &Lfh->Buckets[(Affinity % Lfh->AffinitySlots) * HEAP_LFH_BUCKETS + Bucket];
+}
+
+PHEAP_LFH_SUBSEGMENT
+NTAPI
+RtlpLfhGetSubSegment(PHEAP Heap,
+                     PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_ENTRY FirstBlock;
+    USHORT BlockUnits;
+
+    if (HeapEntry->LFHFlags != HEAP_LFH_BLOCK ||
+        HeapEntry->SmallTagIndex >= HEAP_LFH_BUCKETS)
+    {
+        return NULL;
+    }
+
+    BlockUnits = RtlpLfhBucketUnits(HeapEntry->SmallTagIndex);
+    FirstBlock = HeapEntry - (SIZE_T)HeapEntry->PreviousSize * BlockUnits;
+    SubSegment = (PHEAP_LFH_SUBSEGMENT)((PUCHAR)FirstBlock - HEAP_LFH_SUBSEGMENT_HEADER_SIZE);
+
+    /* Make sure this really is one of our blocks */
+    if (SubSegment->Signature != HEAP_LFH_SIGNATURE ||
+        SubSegment->Heap != Heap ||
+        SubSegment->BucketIndex != HeapEntry->SmallTagIndex ||
+        HeapEntry->PreviousSize >= SubSegment->BlockCount)
+    {
+        return NULL;
+    }
+
+    return SubSegment;
+}
+
+static
+PHEAP_LFH_SUBSEGMENT
+RtlpLfhCreateSubSegment(PHEAP Heap,
+                        ULONG Bucket)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_ENTRY Block;
+    USHORT BlockUnits;
+    ULONG BlockCount, Index;
+
+    /* Size the subsegment so that it is never served by the front end itself */
+    BlockUnits = RtlpLfhBucketUnits(Bucket);
+    BlockCount = HEAP_LFH_SUBSEGMENT_SIZE / ((SIZE_T)BlockUnits << HEAP_ENTRY_SHIFT);
+    BlockCount = max(BlockCount, HEAP_LFH_MIN_BLOCKS);
+
+    /* The caller owns the heap lock */
+    SubSegment = RtlAllocateHeap(Heap,
+                                 HEAP_NO_SERIALIZE,
+                                 HEAP_LFH_SUBSEGMENT_HEADER_SIZE +
+                                 ((SIZE_T)BlockCount * BlockUnits << HEAP_ENTRY_SHIFT));
+    if (!SubSegment)
+        return NULL;
+
+    RtlInitializeSListHead(&SubSegment->FreeBlocks);
+    SubSegment->Next = NULL;
+    SubSegment->Heap = Heap;
+    SubSegment->Signature = HEAP_LFH_SIGNATURE;
+    SubSegment->BlockCount = (USHORT)BlockCount;
+    SubSegment->BucketIndex = (USHORT)Bucket;
+
+    /* Push the blocks in reverse order, so that they are handed out in address order */
+    for (Index = BlockCount; Index-- > 0;)
+    {
+        Block = (PHEAP_ENTRY)((PUCHAR)SubSegment + HEAP_LFH_SUBSEGMENT_HEADER_SIZE) +
+                (SIZE_T)Index * BlockUnits;
+
+        Block->Size = BlockUnits;
+        Block->Flags = 0;
+        Block->SmallTagIndex = (UCHAR)Bucket;
+        Block->PreviousSize = (USHORT)Index;
+        Block->LFHFlags = HEAP_LFH_BLOCK;
+        Block->UnusedBytes = 0;
+
+        RtlInterlockedPushEntrySList(&SubSegment->FreeBlocks, (PSLIST_ENTRY)(Block + 1));
+    }
+
+    return SubSegment;
+}
+
+static
+PSLIST_ENTRY
+RtlpLfhRefillBucket(PHEAP Heap,
+                    ULONG Flags,
+                    PHEAP_LFH_BUCKET LfhBucket,
+                    ULONG Bucket)
+{
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PSLIST_ENTRY Entry = NULL;
+
+    if (!(Flags & HEAP_NO_SERIALIZE))
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    /* Look for a subsegment of this slot which got blocks freed back to it */
+    for (SubSegment = LfhBucket->SubSegments; SubSegment; SubSegment = SubSegment->Next)
+    {
+        Entry = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+        if (Entry)
+            break;
+    }
+
+    /* All of them are full, get a new one from the back end */
+    if (!Entry)
+    {
+        SubSegment = RtlpLfhCreateSubSegment(Heap, Bucket);
+        if (SubSegment)
+        {
+            Entry = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+            SubSegment->Next = LfhBucket->SubSegments;
+            LfhBucket->SubSegments = SubSegment;
+        }
+    }
+
+    if (SubSegment)
+        LfhBucket->ActiveSubSegment = SubSegment;
+
+    if (!(Flags & HEAP_NO_SERIALIZE))
+        RtlLeaveHeapLock(Heap->LockVariable);
+
+    return Entry;
+}
+
+PHEAP_ENTRY
+NTAPI
+RtlpLfhAllocate(PHEAP Heap,
+                ULONG Flags,
+                SIZE_T Size,
+                SIZE_T AllocationSize,
+                UCHAR EntryFlags)
+{
+    PHEAP_LFH Lfh = Heap->FrontEndHeap;
+    PHEAP_LFH_SUBSEGMENT SubSegment;
+    PHEAP_LFH_BUCKET LfhBucket;
+    PHEAP_ENTRY InUseEntry;
+    PSLIST_ENTRY Entry = NULL;
+    ULONG Bucket;
+
+    Bucket = RtlpLfhBucketFromUnits(AllocationSize >> HEAP_ENTRY_SHIFT);
+    LfhBucket = RtlpLfhGetBucket(Lfh, Bucket);
+
+    /* Fast path: take a block from the active subsegment without locking */
+    SubSegment = LfhBucket->ActiveSubSegment;
+    if (SubSegment)
+        Entry = RtlInterlockedPopEntrySList(&SubSegment->FreeBlocks);
+
+    if (!Entry)
+    {
+        Entry = RtlpLfhRefillBucket(Heap, Flags, LfhBucket, Bucket);
+        if (!Entry)
+            return NULL;
+    }
+
+    InUseEntry = (PHEAP_ENTRY)Entry - 1;
+    ASSERT(InUseEntry->LFHFlags == HEAP_LFH_BLOCK);
+    ASSERT(!(InUseEntry->Flags & HEAP_ENTRY_BUSY));
+
+    InUseEntry->Size = (USHORT)(AllocationSize >> HEAP_ENTRY_SHIFT);
+    InUseEntry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+    InUseEntry->Flags = EntryFlags;
+
+    return InUseEntry;
+}
+
+VOID
+NTAPI
+RtlpLfhFree(PHEAP_LFH_SUBSEGMENT SubSegment,
+            PHEAP_ENTRY HeapEntry)
+{
+    /* Mark it free so that double frees are caught, and hand it back */
+    HeapEntry->Flags = 0;
+    HeapEntry->Size = RtlpLfhBucketUnits(SubSegment->BucketIndex);
+    RtlInterlockedPushEntrySList(&SubSegment->FreeBlocks, (PSLIST_ENTRY)(HeapEntry + 1));
+}
+
+PVOID
+NTAPI
+RtlpLfhReAllocate(PHEAP Heap,
+                  ULONG Flags,
+                  PHEAP_LFH_SUBSEGMENT SubSegment,
+                  PHEAP_ENTRY InUseEntry,
+                  SIZE_T Size,
+                  SIZE_T AllocationSize)
+{
+    SIZE_T OldSize;
+    PVOID NewBaseAddress;
+
+    OldSize = ((SIZE_T)InUseEntry->Size << HEAP_ENTRY_SHIFT) - InUseEntry->UnusedBytes;
+
+    /* Stay in the same block if the new size still fits in it */
+    if (!(Flags & HEAP_EXTRA_FLAGS_MASK) &&
+        !Heap->PseudoTagEntries &&
+        (AllocationSize >> HEAP_ENTRY_SHIFT) <= RtlpLfhBucketUnits(SubSegment->BucketIndex))
+    {
+        InUseEntry->Size = (USHORT)(AllocationSize >> HEAP_ENTRY_SHIFT);
+        InUseEntry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+
+        if (Size > OldSize && (Flags & HEAP_ZERO_MEMORY))
+            RtlZeroMemory((PCHAR)(InUseEntry + 1) + OldSize, Size - OldSize);
+
+        return InUseEntry + 1;
+    }
+
+    if (Flags & HEAP_REALLOC_IN_PLACE_ONLY)
+    {
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+        return NULL;
+    }
+
+    /* Move it to a larger block, from the front end or the back end */
+    NewBaseAddress = RtlAllocateHeap(Heap, Flags & ~HEAP_ZERO_MEMORY, Size);
+    if (!NewBaseAddress)
+        return NULL;
+
+    RtlMoveMemory(NewBaseAddress, InUseEntry + 1, min(OldSize, Size));
+
+    if (Size > OldSize && (Flags & HEAP_ZERO_MEMORY))
+        RtlZeroMemory((PCHAR)NewBaseAddress + OldSize, Size - OldSize);
+
+    RtlpLfhFree(SubSegment, InUseEntry);
+
+    return NewBaseAddress;
+}
+
+NTSTATUS
+NTAPI
+RtlpLfhEnable(PHEAP Heap)
+{
+    PHEAP_LFH Lfh;
+    ULONG AffinitySlots;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    /* Only unserialized-free, non debug heaps get a front end, like on Windows */
+    if (RtlpGetMode() != UserMode ||
+        (Heap->Flags & (HEAP_NO_SERIALIZE |
+                        HEAP_TAIL_CHECKING_ENABLED |
+                        HEAP_FREE_CHECKING_ENABLED)) ||
+        RtlpHeapIsSpecial(Heap->Flags | Heap->ForceFlags))
+    {
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    if (Heap->FrontEndHeapType != HEAP_FRONT_END_LFH)
+    {
+        /* One slot per processor */
+        AffinitySlots = max(NtCurrentPeb()->NumberOfProcessors, 1);
+        AffinitySlots = min(AffinitySlots, HEAP_LFH_MAX_AFFINITY);
+
+        Lfh = RtlAllocateHeap(Heap,
+                              HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY,
+                              FIELD_OFFSET(HEAP_LFH, Buckets[AffinitySlots * HEAP_LFH_BUCKETS]));
+        if (Lfh)
+        {
+            Lfh->AffinitySlots = AffinitySlots;
+
+            /* Publish the front end only once it is fully set up */
+            Heap->FrontEndHeap = Lfh;
+            MemoryBarrier();
+            Heap->FrontEndHeapType = HEAP_FRONT_END_LFH;
+        }
+        else
+        {
+            Status = STATUS_NO_MEMORY;
+        }
+    }
+
+    RtlLeaveHeapLock(Heap->LockVariable);
+
+    return Status;
+}
+
+/* EOF */
@@ -0,0 +1,235 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CCompressionPool class implementation
+ */
+#include "CCompressionPool.h"
+#include "raw.h"
+#include "mszip.h"
+
+#if !defined(CAB_READ_ONLY)
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Default constructor
+ */
+CCompressionPool::CCompressionPool()
+{
+    CodecId  = -1;
+    Stopping = false;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Default destructor
+ */
+CCompressionPool::~CCompressionPool()
+{
+    Stop();
+
+    for (PCOMPRESSION_JOB Job : FreeJobs)
+        delete Job;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Starts the worker threads, each with its own codec instance
+ *
+ * @param CodecId
+ * Codec identifier to compress the blocks with
+ *
+ * @param ThreadCount
+ * Number of worker threads
+ *
+ * @return
+ * Status of operation
+ */
+ULONG CCompressionPool::Start(LONG CodecId, ULONG ThreadCount)
+{
+    CCABCodec* Codec;
+    ULONG i;
+
+    Stop();
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        switch (CodecId)
+        {
+            case CAB_CODEC_RAW:
+                Codec = new CRawCodec();
+                break;
+
+            case CAB_CODEC_MSZIP:
+                Codec = new CMSZipCodec();
+                break;
+
+            default:
+                Stop();
+                return CAB_STATUS_UNSUPPCOMP;
+        }
+
+        Codecs.push_back(Codec);
+    }
+
+    this->CodecId = CodecId;
+    Stopping = false;
+
+    for (CCABCodec* WorkerCodec : Codecs)
+        Workers.push_back(std::thread(&CCompressionPool::WorkerThread, this, WorkerCodec));
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Stops the worker threads. All submitted jobs must have been waited for.
+ */
+void CCompressionPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Stopping = true;
+    }
+    WorkAvailable.notify_all();
+
+    for (std::thread& Worker : Workers)
+        Worker.join();
+    Workers.clear();
+
+    for (CCABCodec* Codec : Codecs)
+        delete Codec;
+    Codecs.clear();
+
+    ASSERT(WorkQueue.empty());
+
+    CodecId = -1;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Returns whether the workers are running with the given codec
+ */
+bool CCompressionPool::IsRunning(LONG CodecId)
+{
+    return !Workers.empty() && this->CodecId == CodecId;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Queues a copy of a data block for compression
+ *
+ * @param Buffer
+ * Pointer to buffer with the uncompressed data
+ *
+ * @param Length
+ * Number of bytes in the buffer, at most CAB_BLOCKSIZE
+ *
+ * @return
+ * The queued job, to be passed to Wait() and Release()
+ */
+PCOMPRESSION_JOB CCompressionPool::Submit(void* Buffer, ULONG Length)
+{
+    PCOMPRESSION_JOB Job = NULL;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        if (!FreeJobs.empty())
+        {
+            Job = FreeJobs.back();
+            FreeJobs.pop_back();
+        }
+    }
+
+    if (!Job)
+        Job = new COMPRESSION_JOB;
+
+    memcpy(Job->InputBuffer, Buffer, Length);
+    Job->InputLength  = Length;
+    Job->OutputLength = 0;
+    Job->Status       = CS_SUCCESS;
+    Job->Done         = false;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        WorkQueue.push_back(Job);
+    }
+    WorkAvailable.notify_one();
+
+    return Job;
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Waits until a job has been compressed
+ */
+void CCompressionPool::Wait(PCOMPRESSION_JOB Job)
+{
+    std::unique_lock<std::mutex> Guard(Lock);
+    JobDone.wait(Guard, [Job] { return Job->Done; });
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Returns a completed job to the free list
+ */
+void CCompressionPool::Release(PCOMPRESSION_JOB Job)
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+    FreeJobs.push_back(Job);
+}
+
+/**
+ * @name CCompressionPool class
+ * @implemented
+ *
+ * Worker thread body, compresses queued jobs in any order
+ */
+void CCompressionPool::WorkerThread(CCABCodec* Codec)
+{
+    PCOMPRESSION_JOB Job;
+    ULONG Status;
+    ULONG OutputLength;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> Guard(Lock);
+            WorkAvailable.wait(Guard, [this] { return Stopping || !WorkQueue.empty(); });
+            if (Stopping)
+                return;
+            Job = WorkQueue.front();
+            WorkQueue.pop_front();
+        }
+
+        Status = Codec->Compress(Job->OutputBuffer,
+                                 Job->InputBuffer,
+                                 Job->InputLength,
+                                 &OutputLength);
+
+        {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Job->Status       = Status;
+            Job->OutputLength = OutputLength;
+            Job->Done         = true;
+        }
+        JobDone.notify_all();
+    }
+}
+
+#endif /* CAB_READ_ONLY */
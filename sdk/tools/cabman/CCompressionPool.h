@@ -0,0 +1,55 @@
+/*
+ * PROJECT:     ReactOS cabinet manager
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     CCompressionPool class declaration
+ */
+
+#pragma once
+
+#include "cabinet.h"
+
+#ifndef CAB_READ_ONLY
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct _COMPRESSION_JOB
+{
+    unsigned char InputBuffer[CAB_BLOCKSIZE + 12];
+    unsigned char OutputBuffer[CAB_BLOCKSIZE + 12];
+    ULONG InputLength;
+    ULONG OutputLength;
+    ULONG Status;           // CS_xxx status returned by the codec
+    bool Done;
+} COMPRESSION_JOB, *PCOMPRESSION_JOB;
+
+class CCompressionPool
+{
+public:
+    /* Default constructor */
+    CCompressionPool();
+    /* Default destructor */
+    virtual ~CCompressionPool();
+    ULONG Start(LONG CodecId, ULONG ThreadCount);
+    void Stop();
+    bool IsRunning(LONG CodecId);
+    PCOMPRESSION_JOB Submit(void* Buffer, ULONG Length);
+    void Wait(PCOMPRESSION_JOB Job);
+    void Release(PCOMPRESSION_JOB Job);
+private:
+    void WorkerThread(CCABCodec* Codec);
+    std::vector<std::thread> Workers;
+    std::vector<CCABCodec*> Codecs;        // One codec (and z_stream) per worker
+    std::deque<PCOMPRESSION_JOB> WorkQueue;
+    std::vector<PCOMPRESSION_JOB> FreeJobs;
+    std::mutex Lock;
+    std::condition_variable WorkAvailable;
+    std::condition_variable JobDone;
+    LONG CodecId;
+    bool Stopping;
+};
+
+#endif /* CAB_READ_ONLY */
@@ -25,6 +25,7 @@
 #endif
 #include "cabinet.h"
 #include "CCFDATAStorage.h"
+#include "CCompressionPool.h"
 #include "raw.h"
 #include "mszip.h"
 
@@ -93,6 +94,9 @@ CCabinet::CCabinet()
     BlockIsSplit = false;
     ScratchFile  = NULL;
 
+    CompressionThreads = 1;
+    CompressionPool    = NULL;
+
     FolderUncompSize = 0;
     BytesLeftInBlock = 0;
     ReuseBlock       = false;
@@ -114,6 +118,14 @@ CCabinet::~CCabinet()
 
     if (CodecSelected)
         delete Codec;
+
+#ifndef CAB_READ_ONLY
+    if (CompressionPool)
+    {
+        DiscardDataBlocks();
+        delete CompressionPool;
+    }
+#endif /* CAB_READ_ONLY */
 }
 
 bool CCabinet::IsSeparator(char Char)
@@ -1333,7 +1345,9 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             while (CreateNewDisk)
             {
                 DPRINT(MAX_TRACE, ("Creating new disk.\n"));
-                CommitDisk(true);
+                Status = CommitDisk(true);
+                if (Status != CAB_STATUS_SUCCESS)
+                    return Status;
                 CloseDisk();
                 NewDisk();
 
@@ -1370,7 +1384,9 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             if (CreateNewDisk)
             {
                 DPRINT(MID_TRACE, ("Creating new disk 2.\n"));
-                CommitDisk(true);
+                Status = CommitDisk(true);
+                if (Status != CAB_STATUS_SUCCESS)
+                    return Status;
                 CloseDisk();
                 NewDisk();
                 CreateNewDisk = false;
@@ -1384,9 +1400,7 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             }
         } while (CreateNewDisk);
     }
-    CommitDisk(MoreDisks);
-
-    return CAB_STATUS_SUCCESS;
+    return CommitDisk(MoreDisks);
 }
 
 
@@ -1401,6 +1415,11 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
 {
     ULONG Status;
 
+    /* Sizes of the queued blocks are needed for the headers */
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     OnCabinetName(CurrentDiskNumber, CabinetName);
 
     /* Create file, fail if it already exists */
@@ -1483,6 +1502,9 @@ ULONG CCabinet::CloseCabinet()
 {
     ULONG Status;
 
+    if (CompressionPool)
+        DiscardDataBlocks();
+
     DestroyFileNodes();
 
     DestroyFolderNodes();
@@ -1708,9 +1730,10 @@ bool CCabinet::CreateSimpleCabinet()
         goto cleanup;
     }
 
+    bRet = true;
+
 cleanup:
     CloseCabinet();
-    bRet = true;
 
 cleanup2:
     DestroySearchCriteria();
@@ -1727,6 +1750,20 @@ void CCabinet::SetMaxDiskSize(ULONG Size)
     MaxDiskSize = Size;
 }
 
+
+void CCabinet::SetCompressionThreads(ULONG Count)
+/*
+ * FUNCTION: Sets the number of threads used to compress data blocks
+ * ARGUMENTS:
+ *     Count = Number of threads, 0 to use one per processor
+ */
+{
+    if (Count == 0)
+        Count = std::thread::hardware_concurrency();
+
+    CompressionThreads = (Count > 0) ? Count : 1;
+}
+
 #endif /* CAB_READ_ONLY */
 
 
@@ -2759,6 +2796,16 @@ ULONG CCabinet::WriteDataBlock()
     ULONG BytesWritten;
     PCFDATA_NODE DataNode;
 
+    /* Blocks can only be compressed ahead when no disk size limit
+       decides where they are split */
+    if (CompressionThreads > 1 && MaxDiskSize == 0)
+        return QueueDataBlock();
+
+    /* Keep the scratch file in order if we switch back to the serial path */
+    Status = FlushDataBlocks();
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
     if (!BlockIsSplit)
     {
         Status = Codec->Compress(OutputBuffer,
@@ -2835,6 +2882,153 @@ ULONG CCabinet::WriteDataBlock()
     return CAB_STATUS_SUCCESS;
 }
 
+
+ULONG CCabinet::QueueDataBlock()
+/*
+ * FUNCTION: Queues the current data block for compression on the worker threads
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     The block is written to the scratch file by WritePendingDataBlock,
+ *     in the same order the blocks were queued in
+ */
+{
+    PENDING_DATA_BLOCK Pending;
+    ULONG Status;
+
+    if (!CompressionPool)
+    {
+        CompressionPool = new CCompressionPool;
+        if (!CompressionPool)
+        {
+            DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+            return CAB_STATUS_NOMEMORY;
+        }
+    }
+
+    if (!CompressionPool->IsRunning(CodecId))
+    {
+        Status = FlushDataBlocks();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+
+        Status = CompressionPool->Start(CodecId, CompressionThreads);
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    Pending.DataNode = NewDataNode(CurrentFolderNode);
+    if (!Pending.DataNode)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    Pending.FolderNode = CurrentFolderNode;
+    Pending.Job = CompressionPool->Submit(InputBuffer, CurrentIBufferSize);
+
+    Pending.DataNode->Data.UncompSize = (USHORT)CurrentIBufferSize;
+    Pending.DataNode->Data.Checksum   = 0;
+
+    DiskSize += sizeof(CFDATA);
+
+    CurrentFolderNode->Folder.DataBlockCount++;
+
+    LastBlockStart += CurrentIBufferSize;
+
+    CurrentIBufferSize = 0;
+    CurrentIBuffer     = InputBuffer;
+
+    PendingBlocks.push_back(Pending);
+
+    /* Bound the amount of queued data, keeping every worker busy */
+    if (PendingBlocks.size() > 2 * CompressionThreads)
+        return WritePendingDataBlock();
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::WritePendingDataBlock()
+/*
+ * FUNCTION: Waits for the oldest queued data block and writes it to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    PENDING_DATA_BLOCK Pending = PendingBlocks.front();
+    ULONG BytesWritten;
+    ULONG Status;
+
+    PendingBlocks.pop_front();
+
+    CompressionPool->Wait(Pending.Job);
+
+    if (Pending.Job->Status != CS_SUCCESS)
+    {
+        DPRINT(MIN_TRACE, ("Compression failed (%u).\n", (UINT)Pending.Job->Status));
+        CompressionPool->Release(Pending.Job);
+        return CAB_STATUS_FAILURE;
+    }
+
+    DPRINT(MAX_TRACE, ("Block compressed. UncompSize (%u)  CompSize (%u).\n",
+        (UINT)Pending.Job->InputLength, (UINT)Pending.Job->OutputLength));
+
+    Pending.DataNode->Data.CompSize = (USHORT)Pending.Job->OutputLength;
+    Pending.DataNode->ScratchFilePosition = ScratchFile->Position();
+
+    Status = ScratchFile->WriteBlock(&Pending.DataNode->Data,
+        Pending.Job->OutputBuffer, &BytesWritten);
+
+    CompressionPool->Release(Pending.Job);
+
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    DiskSize += BytesWritten;
+
+    Pending.FolderNode->TotalFolderSize += (BytesWritten + sizeof(CFDATA));
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::FlushDataBlocks()
+/*
+ * FUNCTION: Writes all queued data blocks to the scratch file
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+
+    while (!PendingBlocks.empty())
+    {
+        Status = WritePendingDataBlock();
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+void CCabinet::DiscardDataBlocks()
+/*
+ * FUNCTION: Waits for all queued data blocks without writing them
+ *           and stops the worker threads
+ */
+{
+    for (PENDING_DATA_BLOCK& Pending : PendingBlocks)
+    {
+        CompressionPool->Wait(Pending.Job);
+        CompressionPool->Release(Pending.Job);
+    }
+    PendingBlocks.clear();
+
+    CompressionPool->Stop();
+}
+
 #if !defined(_WIN32)
 
 void CCabinet::ConvertDateAndTime(time_t* Time,
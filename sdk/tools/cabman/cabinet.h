@@ -223,6 +223,13 @@ typedef struct _CFFOLDER_NODE
     CFFOLDER        Folder = { 0 };
 } CFFOLDER_NODE, *PCFFOLDER_NODE;
 
+typedef struct _PENDING_DATA_BLOCK
+{
+    struct _COMPRESSION_JOB *Job = nullptr;     // Block queued for compression
+    PCFDATA_NODE        DataNode = nullptr;
+    PCFFOLDER_NODE      FolderNode = nullptr;   // Folder the block belongs to
+} PENDING_DATA_BLOCK, *PPENDING_DATA_BLOCK;
+
 typedef struct _CFFILE_NODE
 {
     CFFILE              File = { 0 };
@@ -377,6 +384,8 @@ public:
     ULONG AddFile(const std::string& FileName, const std::string& TargetFolder);
     /* Sets the maximum size of the current disk */
     void SetMaxDiskSize(ULONG Size);
+    /* Sets the number of threads used to compress data blocks */
+    void SetCompressionThreads(ULONG Count);
 #endif /* CAB_READ_ONLY */
 
     /* Default event handlers */
@@ -422,6 +431,10 @@ private:
     ULONG WriteFileEntries();
     ULONG CommitDataBlocks(PCFFOLDER_NODE FolderNode);
     ULONG WriteDataBlock();
+    ULONG QueueDataBlock();
+    ULONG WritePendingDataBlock();
+    ULONG FlushDataBlocks();
+    void DiscardDataBlocks();
     ULONG GetAttributesOnFile(PCFFILE_NODE File);
     ULONG SetAttributesOnFile(char* FileName, USHORT FileAttributes);
     ULONG GetFileTimes(FILE* FileHandle, PCFFILE_NODE File);
@@ -484,6 +497,10 @@ private:
     ULONG TotalBytesLeft;
     bool BlockIsSplit;                  // true if current data block is split
     ULONG NextFolderNumber;     // Zero based folder number
+
+    ULONG CompressionThreads;   // Number of compression threads, 1 if serial
+    class CCompressionPool *CompressionPool;
+    std::list<PENDING_DATA_BLOCK> PendingBlocks;    // Blocks being compressed, in folder order
 #endif /* CAB_READ_ONLY */
 };
 
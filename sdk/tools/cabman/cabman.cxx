@@ -192,8 +192,8 @@ void CCABManager::Usage()
 {
     printf("ReactOS Cabinet Manager\n\n");
     printf("CABMAN [-D | -E] [-A] [-L dir] cabinet [filename ...]\n");
-    printf("CABMAN [-M mode] -C dirfile [-I] [-RC file] [-P dir]\n");
-    printf("CABMAN [-M mode] -S cabinet filename [-F folder] [filename] [...]\n");
+    printf("CABMAN [-M mode] [-J n] -C dirfile [-I] [-RC file] [-P dir]\n");
+    printf("CABMAN [-M mode] [-J n] -S cabinet filename [-F folder] [filename] [...]\n");
     printf("  cabinet   Cabinet file.\n");
     printf("  filename  Name of the file to add to or extract from the cabinet.\n");
     printf("            Wild cards and multiple filenames\n");
@@ -208,6 +208,8 @@ void CCABManager::Usage()
     printf("  -E        Extract files from cabinet.\n");
     printf("  -F        Put the files from the next 'filename' filter in the cab in folder\filename.\n");
     printf("  -I        Don't create the cabinet, only the .inf file.\n");
+    printf("  -J n      Compress data blocks on n threads\n");
+    printf("            (0 uses one thread per processor, default is 1).\n");
     printf("  -L dir    Location to place extracted or generated files\n");
     printf("            (default is current directory).\n");
     printf("  -M mode   Specify the compression method to use:\n");
@@ -267,6 +269,12 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                 case 'F':
                     if (argv[i][2] == 0)
                     {
+                        if (i + 1 >= argc)
+                        {
+                            Usage();
+                            return false;
+                        }
+
                         i++;
                         NextFolder = argv[i];
                     }
@@ -281,10 +289,34 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                     InfFileOnly = true;
                     break;
 
+                case 'j':
+                case 'J':
+                    if (argv[i][2] == 0)
+                    {
+                        if (i + 1 >= argc)
+                        {
+                            Usage();
+                            return false;
+                        }
+
+                        i++;
+                        SetCompressionThreads(strtoul(&argv[i][0], NULL, 10));
+                    }
+                    else
+                        SetCompressionThreads(strtoul(&argv[i][2], NULL, 10));
+
+                    break;
+
                 case 'l':
                 case 'L':
                     if (argv[i][2] == 0)
                     {
+                        if (i + 1 >= argc)
+                        {
+                            Usage();
+                            return false;
+                        }
+
                         i++;
                         SetDestinationPath(&argv[i][0]);
                     }
@@ -298,6 +330,12 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                     // Set the compression codec (only affects compression, not decompression)
                     if(argv[i][2] == 0)
                     {
+                        if (i + 1 >= argc)
+                        {
+                            Usage();
+                            return false;
+                        }
+
                         i++;
 
                         if( !SetCompressionCodec(&argv[i][0]) )
@@ -322,6 +360,12 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                         case 'C': /* File to put in cabinet reserved area */
                             if (argv[i][3] == 0)
                             {
+                                if (i + 1 >= argc)
+                                {
+                                    Usage();
+                                    return false;
+                                }
+
                                 i++;
                                 if (!SetCabinetReservedFile(&argv[i][0]))
                                 {
@@ -353,6 +397,12 @@ bool CCABManager::ParseCmdline(int argc, char* argv[])
                 case 'P':
                     if (argv[i][2] == 0)
                     {
+                        if (i + 1 >= argc)
+                        {
+                            Usage();
+                            return false;
+                        }
+
                         i++;
                         SetFileRelativePath(&argv[i][0]);
                     }
@@ -925,7 +925,7 @@ ULONG CDFParser::PerformNewCommand()
                 if (Status != CAB_STATUS_SUCCESS)
                 {
                     DPRINT(MIN_TRACE, ("Cannot write disk (%u).\n", (UINT)Status));
-                    return CAB_STATUS_SUCCESS;
+                    return Status;
                 }
                 DiskCreated = false;
             }
@@ -934,7 +934,7 @@ ULONG CDFParser::PerformNewCommand()
             if (Status != CAB_STATUS_SUCCESS)
             {
                 DPRINT(MIN_TRACE, ("Cannot create disk (%u).\n", (UINT)Status));
-                return CAB_STATUS_SUCCESS;
+                return Status;
             }
             DiskCreated = true;
             SetupNewDisk();
@@ -949,7 +949,7 @@ ULONG CDFParser::PerformNewCommand()
                 if (Status != CAB_STATUS_SUCCESS)
                 {
                     DPRINT(MIN_TRACE, ("Cannot write disk (%u).\n", (UINT)Status));
-                    return CAB_STATUS_SUCCESS;
+                    return Status;
                 }
                 DiskCreated = false;
             }
@@ -958,7 +958,7 @@ ULONG CDFParser::PerformNewCommand()
             if (Status != CAB_STATUS_SUCCESS)
             {
                 DPRINT(MIN_TRACE, ("Cannot create cabinet (%u).\n", (UINT)Status));
-                return CAB_STATUS_SUCCESS;
+                return Status;
             }
             DiskCreated = true;
             SetupNewDisk();
@@ -34,7 +34,9 @@ public:
                              PULONG OutputLength) override;
 private:
     int Status;
-    z_stream ZStream; /* Zlib stream */
+    z_stream ZStream;       /* Zlib stream used for decompression */
+    z_stream DeflateStream; /* Zlib stream reused for every compressed block */
+    bool DeflateInitialized;
 };
 
 /* EOF */
@@ -23,8 +23,9 @@
  * rop codes and all depths. The drawback is that it will be relatively slow.
  * The other extreme is to write (generate) a separate Blt routine for each
  * rop code/depth combination. This will result in a extremely large amount
- * of code. So, we opt for something in between: named rops get their own
- * routine, unnamed rops are handled by a generic routine.
+ * of code. So, we opt for something in between: named rops and a short list
+ * of unnamed rops which are used a lot in practice get their own routine, all
+ * other rops are handled by a generic routine.
  * Basically, what happens is that generic code which looks like:
  *
  * for (...)
@@ -114,6 +115,23 @@
 #define ROPCODE_PATPAINT    0xfb
 #define ROPCODE_WHITENESS   0xff
 
+/* Unnamed rops with a dedicated routine, see FindRopInfo */
+#define ROPCODE_DPON        0x05
+#define ROPCODE_DPNA        0x0a
+#define ROPCODE_DSNA        0x22
+#define ROPCODE_PDNA        0x50
+#define ROPCODE_DPAN        0x5f
+#define ROPCODE_DPSAX       0x6a
+#define ROPCODE_DPSXX       0x96
+#define ROPCODE_DPA         0xa0
+#define ROPCODE_PDXN        0xa5
+#define ROPCODE_DPNO        0xaf
+#define ROPCODE_PSDPXAX     0xb8
+#define ROPCODE_DSPDXAX     0xe2
+#define ROPCODE_DPSAO       0xea
+#define ROPCODE_PDNO        0xf5
+#define ROPCODE_DPO         0xfa
+
 #define ROPCODE_GENERIC     256 /* Special case */
 
 typedef struct _ROPINFO
@@ -154,6 +172,27 @@ FindRopInfo(unsigned RopCode)
         { ROPCODE_PATCOPY,     "PATCOPY",    "P",            0, 0, 1 },
         { ROPCODE_PATPAINT,    "PATPAINT",   "D | (~S) | P", 1, 1, 1 },
         { ROPCODE_WHITENESS,   "WHITENESS",  "0xffffffff",   0, 0, 0 },
+
+        /* Unnamed rops which show up most often in blit profiles: the
+         * pattern/destination combinations used for brush highlighting and
+         * selection inversion, and the monochrome mask blits used to draw
+         * transparent glyphs and themed control parts */
+        { ROPCODE_DPON,        "DPon",       "~(D | P)",     1, 0, 1 },
+        { ROPCODE_DPNA,        "DPna",       "D & (~P)",     1, 0, 1 },
+        { ROPCODE_DSNA,        "DSna",       "D & (~S)",     1, 1, 0 },
+        { ROPCODE_PDNA,        "PDna",       "(~D) & P",     1, 0, 1 },
+        { ROPCODE_DPAN,        "DPan",       "~(D & P)",     1, 0, 1 },
+        { ROPCODE_DPSAX,       "DPSax",      "D ^ (P & S)",  1, 1, 1 },
+        { ROPCODE_DPSXX,       "DPSxx",      "D ^ P ^ S",    1, 1, 1 },
+        { ROPCODE_DPA,         "DPa",        "D & P",        1, 0, 1 },
+        { ROPCODE_PDXN,        "PDxn",       "~(D ^ P)",     1, 0, 1 },
+        { ROPCODE_DPNO,        "DPno",       "D | (~P)",     1, 0, 1 },
+        { ROPCODE_PSDPXAX,     "PSDPxax",    "(((D ^ P) & S) ^ P)", 1, 1, 1 },
+        { ROPCODE_DSPDXAX,     "DSPDxax",    "(((D ^ P) & S) ^ D)", 1, 1, 1 },
+        { ROPCODE_DPSAO,       "DPSao",      "D | (P & S)",  1, 1, 1 },
+        { ROPCODE_PDNO,        "PDno",       "(~D) | P",     1, 0, 1 },
+        { ROPCODE_DPO,         "DPo",        "D | P",        1, 0, 1 },
+
         { ROPCODE_GENERIC,     NULL,         NULL,           1, 1, 1 }
     };
     unsigned Index;
@@ -894,7 +933,9 @@ CreatePrimitive(FILE *Out, unsigned Bpp, PROPINFO RopInfo)
                 }
             }
             if (ROPCODE_PATINVERT == RopInfo->RopCode ||
-                    ROPCODE_MERGECOPY == RopInfo->RopCode)
+                    ROPCODE_MERGECOPY == RopInfo->RopCode ||
+                    ROPCODE_DPNA == RopInfo->RopCode ||
+                    ROPCODE_DPO == RopInfo->RopCode)
             {
                 Output(Out, "if (0 == Pattern)\n");
                 Output(Out, "{\n");
@@ -906,6 +947,13 @@ CreatePrimitive(FILE *Out, unsigned Bpp, PROPINFO RopInfo)
                 Output(Out, "return;\n");
                 Output(Out, "}\n");
             }
+            else if (ROPCODE_DPA == RopInfo->RopCode)
+            {
+                Output(Out, "if ((~0) == Pattern)\n");
+                Output(Out, "{\n");
+                Output(Out, "return;\n");
+                Output(Out, "}\n");
+            }
             else if (ROPCODE_PATPAINT == RopInfo->RopCode)
             {
                 Output(Out, "if ((~0) == Pattern)\n");
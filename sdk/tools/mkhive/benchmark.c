@@ -0,0 +1,212 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Subkey index benchmark on a generated hive
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "mkhive.h"
+
+#define BENCH_NAME_LENGTH   38
+
+/* FUNCTIONS ****************************************************************/
+
+static ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed;
+}
+
+/* Build a CLSID-like name, which is what large registry keys usually hold */
+static VOID
+MakeKeyName(PWCHAR Name, ULONG Index, BOOL Missing)
+{
+    CHAR Buffer[BENCH_NAME_LENGTH + 1];
+    ULONG Seed = Index * 2654435761U + 1;
+    ULONG i;
+
+    snprintf(Buffer, sizeof(Buffer), "{%08X-%04X-%04X-%04X-%08X%04X}",
+             (UINT)NextRandom(&Seed),
+             (UINT)(NextRandom(&Seed) >> 16),
+             (UINT)(NextRandom(&Seed) >> 16),
+             Missing ? 0xFFFFU : 0x8000U,
+             (UINT)Index,
+             (UINT)(NextRandom(&Seed) >> 16));
+
+    /* We can't use swprintf here because of -fshort-wchar */
+    for (i = 0; i <= BENCH_NAME_LENGTH; i++)
+        Name[i] = (WCHAR)Buffer[i];
+}
+
+static double
+ElapsedMs(clock_t Start)
+{
+    return (double)(clock() - Start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static BOOL
+BenchmarkParent(
+    IN PCMHIVE CmHive,
+    IN ULONG HiveVersion,
+    IN PCWSTR ParentName,
+    IN PCSTR Description,
+    IN ULONG Count)
+{
+    HKEY ParentKey, Key;
+    WCHAR Name[BENCH_NAME_LENGTH + 1];
+    ULONG OldVersion, i, Found;
+    clock_t Start;
+    double Create, Open, Miss, Delete;
+
+    /* The hive version selects the kind of leaves CmpAddSubKey creates */
+    OldVersion = CmHive->Hive.Version;
+    CmHive->Hive.Version = HiveVersion;
+
+    if (RegCreateKeyW(NULL, ParentName, &ParentKey) != ERROR_SUCCESS)
+    {
+        CmHive->Hive.Version = OldVersion;
+        return FALSE;
+    }
+
+    Start = clock();
+    for (i = 0; i < Count; i++)
+    {
+        MakeKeyName(Name, i, FALSE);
+        if (RegCreateKeyW(ParentKey, Name, &Key) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "Could not create subkey %lu\n", (unsigned long)i);
+            RegCloseKey(ParentKey);
+            CmHive->Hive.Version = OldVersion;
+            return FALSE;
+        }
+        RegCloseKey(Key);
+    }
+    Create = ElapsedMs(Start);
+    CmHive->Hive.Version = OldVersion;
+
+    Found = 0;
+    Start = clock();
+    for (i = 0; i < Count; i++)
+    {
+        MakeKeyName(Name, i, FALSE);
+        if (RegOpenKeyW(ParentKey, Name, &Key) == ERROR_SUCCESS)
+        {
+            Found++;
+            RegCloseKey(Key);
+        }
+    }
+    Open = ElapsedMs(Start);
+
+    if (Found != Count)
+    {
+        fprintf(stderr, "Only %lu of %lu subkeys were found\n",
+                (unsigned long)Found, (unsigned long)Count);
+        RegCloseKey(ParentKey);
+        return FALSE;
+    }
+
+    Found = 0;
+    Start = clock();
+    for (i = 0; i < Count; i++)
+    {
+        MakeKeyName(Name, i, TRUE);
+        if (RegOpenKeyW(ParentKey, Name, &Key) == ERROR_SUCCESS)
+        {
+            Found++;
+            RegCloseKey(Key);
+        }
+    }
+    Miss = ElapsedMs(Start);
+
+    if (Found != 0)
+    {
+        fprintf(stderr, "%lu missing subkeys were found\n", (unsigned long)Found);
+        RegCloseKey(ParentKey);
+        return FALSE;
+    }
+
+    Found = 0;
+    Start = clock();
+    for (i = 0; i < Count; i++)
+    {
+        MakeKeyName(Name, i, FALSE);
+        if (RegDeleteKeyW(ParentKey, Name) == ERROR_SUCCESS)
+            Found++;
+    }
+    Delete = ElapsedMs(Start);
+
+    RegCloseKey(ParentKey);
+
+    if (Found != Count)
+    {
+        fprintf(stderr, "Only %lu of %lu subkeys were deleted\n",
+                (unsigned long)Found, (unsigned long)Count);
+        return FALSE;
+    }
+
+    printf("  %s: create %.1f ms, open %.1f ms (%.0f ns/key), "
+           "miss %.1f ms (%.0f ns/key), delete %.1f ms\n",
+           Description, Create,
+           Open, Open * 1e6 / Count,
+           Miss, Miss * 1e6 / Count,
+           Delete);
+    return TRUE;
+}
+
+static BOOL
+BenchmarkLeafType(
+    IN ULONG HiveVersion,
+    IN PCSTR Description,
+    IN ULONG Count)
+{
+    PCMHIVE CmHive = NULL;
+    BOOL Success;
+    ULONG i;
+
+    /* Start each run from a fresh registry so that they don't influence each other */
+    RegInitializeRegistry("SOFTWARE");
+
+    for (i = 0; i < MAX_NUMBER_OF_REGISTRY_HIVES; i++)
+    {
+        if (strcmp(RegistryHives[i].HiveName, "SOFTWARE") == 0)
+            CmHive = RegistryHives[i].CmHive;
+    }
+    ASSERT(CmHive);
+
+    Success = BenchmarkParent(CmHive, HiveVersion,
+                              L"Registry\\Machine\\SOFTWARE\\Benchmark",
+                              Description, Count);
+
+    RegShutdownRegistry();
+    return Success;
+}
+
+/*
+ * Creates Count subkeys under a single key of an in-memory SOFTWARE hive,
+ * then looks up each of them and as many names that don't exist, and finally
+ * deletes them. This is done with index leaves, fast leaves and hash leaves,
+ * which depend on the hive version.
+ */
+INT
+RunIndexBenchmark(
+    IN ULONG Count)
+{
+    printf("Subkey index benchmark with %lu subkeys\n", (unsigned long)Count);
+
+    if (!BenchmarkLeafType(HSYS_MINOR - 1, "index leaves (li)", Count) ||
+        !BenchmarkLeafType(HSYS_MINOR, "fast leaves (lf) ", Count) ||
+        !BenchmarkLeafType(HSYS_WHISTLER, "hash leaves (lh) ", Count))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* EOF */
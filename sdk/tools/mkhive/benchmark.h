@@ -0,0 +1,13 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Subkey index benchmark on a generated hive
+ */
+
+#pragma once
+
+INT
+RunIndexBenchmark(
+    IN ULONG Count);
+
+/* EOF */
@@ -0,0 +1,194 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Incremental hive generation support
+ */
+
+/*
+ * In incremental mode, mkhive keeps a stamp file next to the hives it creates.
+ * It records a hash of the mkhive binary, the options that affect the output,
+ * and for each INF file (in command line order) a hash of its contents and
+ * the set of hives its DelReg/AddReg sections touched.
+ *
+ * A hive only has to be re-emitted if one of the INF files that modify it
+ * has changed, in its previous or in its current version. If none of the INF
+ * files changed, nothing needs to be parsed at all. Any other difference
+ * (tool, options, list of files, missing stamp) rebuilds everything.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <string.h>
+#include <stdio.h>
+
+#include "mkhive.h"
+
+#define HIVE_STAMP_VERSION  1
+#define HIVE_STAMP_LINE     4096
+
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ULL
+#define FNV_PRIME           0x00000100000001b3ULL
+
+/* FUNCTIONS ****************************************************************/
+
+BOOL
+HashFileContents(
+    IN PCSTR FileName,
+    OUT ULONGLONG *Hash)
+{
+    FILE *File;
+    UCHAR Buffer[16384];
+    size_t Length, i;
+    ULONGLONG Value = FNV_OFFSET_BASIS;
+
+    File = fopen(FileName, "rb");
+    if (File == NULL)
+        return FALSE;
+
+    while ((Length = fread(Buffer, 1, sizeof(Buffer), File)) != 0)
+    {
+        for (i = 0; i < Length; i++)
+        {
+            Value ^= Buffer[i];
+            Value *= FNV_PRIME;
+        }
+    }
+
+    if (ferror(File))
+    {
+        fclose(File);
+        return FALSE;
+    }
+
+    fclose(File);
+    *Hash = Value;
+    return TRUE;
+}
+
+static BOOL
+ReadStampLine(FILE *File, PCHAR Line)
+{
+    size_t Length;
+
+    if (!fgets(Line, HIVE_STAMP_LINE, File))
+        return FALSE;
+
+    /* Strip the line terminator */
+    Length = strlen(Line);
+    while (Length > 0 && (Line[Length - 1] == '\n' || Line[Length - 1] == '\r'))
+        Line[--Length] = 0;
+
+    return TRUE;
+}
+
+/*
+ * Returns the mask of the hives that need to be re-emitted according to the
+ * previous stamp, and flags the INF files whose contents changed. The hives
+ * modified by the new versions of the changed files have to be added by the
+ * caller once they have been imported.
+ */
+ULONG
+CompareHiveStamp(
+    IN PCSTR StampFile,
+    IN ULONGLONG ToolHash,
+    IN BOOL UpperCaseFileName,
+    IN OUT PINF_INPUT Inputs,
+    IN ULONG Count)
+{
+    FILE *File;
+    CHAR Line[HIVE_STAMP_LINE];
+    UINT Version, ToolHigh, ToolLow, UpperCase, StampCount;
+    UINT HashHigh, HashLow, HiveMask;
+    ULONGLONG Hash;
+    ULONG DirtyMask = 0;
+    ULONG i;
+    int Offset;
+
+    for (i = 0; i < Count; i++)
+        Inputs[i].Changed = TRUE;
+
+    /* Without a way to identify the tool, never trust an old stamp */
+    if (ToolHash == 0)
+        return HIVE_MASK_ALL;
+
+    File = fopen(StampFile, "r");
+    if (File == NULL)
+        return HIVE_MASK_ALL;
+
+    if (!ReadStampLine(File, Line) ||
+        sscanf(Line, "mkhive %u %8x%8x %u %u",
+               &Version, &ToolHigh, &ToolLow, &UpperCase, &StampCount) != 5 ||
+        Version != HIVE_STAMP_VERSION ||
+        (((ULONGLONG)ToolHigh << 32) | ToolLow) != ToolHash ||
+        UpperCase != (UINT)(UpperCaseFileName != FALSE) ||
+        StampCount != Count)
+    {
+        fclose(File);
+        return HIVE_MASK_ALL;
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        if (!ReadStampLine(File, Line) ||
+            sscanf(Line, "%8x%8x %x %n", &HashHigh, &HashLow, &HiveMask, &Offset) != 3 ||
+            strcmp(Line + Offset, Inputs[i].FileName) != 0)
+        {
+            /* The list of INF files changed, their order matters */
+            fclose(File);
+            for (i = 0; i < Count; i++)
+                Inputs[i].Changed = TRUE;
+            return HIVE_MASK_ALL;
+        }
+
+        Hash = ((ULONGLONG)HashHigh << 32) | HashLow;
+        if (Hash == Inputs[i].ContentHash)
+            Inputs[i].Changed = FALSE;
+        else
+            DirtyMask |= HiveMask;
+    }
+
+    fclose(File);
+    return DirtyMask;
+}
+
+BOOL
+WriteHiveStamp(
+    IN PCSTR StampFile,
+    IN ULONGLONG ToolHash,
+    IN BOOL UpperCaseFileName,
+    IN PINF_INPUT Inputs,
+    IN ULONG Count)
+{
+    FILE *File;
+    ULONG i;
+    BOOL Success;
+
+    File = fopen(StampFile, "w");
+    if (File == NULL)
+        return FALSE;
+
+    fprintf(File, "mkhive %u %08x%08x %u %u\n",
+            HIVE_STAMP_VERSION,
+            (UINT)(ToolHash >> 32), (UINT)ToolHash,
+            (UINT)(UpperCaseFileName != FALSE),
+            (UINT)Count);
+
+    for (i = 0; i < Count; i++)
+    {
+        fprintf(File, "%08x%08x %x %s\n",
+                (UINT)(Inputs[i].ContentHash >> 32), (UINT)Inputs[i].ContentHash,
+                (UINT)Inputs[i].HiveMask,
+                Inputs[i].FileName);
+    }
+
+    Success = !ferror(File);
+    if (fclose(File) != 0)
+        Success = FALSE;
+
+    if (!Success)
+        remove(StampFile);
+
+    return Success;
+}
+
+/* EOF */
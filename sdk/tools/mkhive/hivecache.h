@@ -0,0 +1,32 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Incremental hive generation support
+ */
+
+#pragma once
+
+#define HIVE_MASK_ALL ((1 << MAX_NUMBER_OF_REGISTRY_HIVES) - 1)
+
+BOOL
+HashFileContents(
+    IN PCSTR FileName,
+    OUT ULONGLONG *Hash);
+
+ULONG
+CompareHiveStamp(
+    IN PCSTR StampFile,
+    IN ULONGLONG ToolHash,
+    IN BOOL UpperCaseFileName,
+    IN OUT PINF_INPUT Inputs,
+    IN ULONG Count);
+
+BOOL
+WriteHiveStamp(
+    IN PCSTR StampFile,
+    IN ULONGLONG ToolHash,
+    IN BOOL UpperCaseFileName,
+    IN PINF_INPUT Inputs,
+    IN ULONG Count);
+
+/* EOF */
@@ -54,12 +54,16 @@
 
 void usage(void)
 {
-    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] -d:<dstdir> <inffiles>\n\n"
+    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] [-i] [-j:n] -d:<dstdir> <inffiles>\n"
+           "       mkhive -b:n\n\n"
            "  -h:hiveN  - Comma-separated list of hives to create. Possible values are:\n"
            "              SETUPREG, SYSTEM, SOFTWARE, DEFAULT, SAM, SECURITY, BCD.\n"
            "  -u        - Generate file names in uppercase (default: lowercase) (TEMPORARY FLAG!).\n"
+           "  -i        - Incremental mode: only re-create the hives whose INF files changed.\n"
+           "  -j:n      - Parse the INF files on n threads (0: one per processor, default: 1).\n"
            "  -d:dstdir - The binary hive files are created in this directory.\n"
            "  inffiles  - List of INF files with full path.\n"
+           "  -b:n      - Benchmark the subkey indexes on a key with n subkeys, and exit.\n"
            "  -?        - Displays this help screen.\n");
 }
 
@@ -91,17 +95,100 @@ void convert_path(char *dst, char *src)
     dst[i] = 0;
 }
 
+static void
+GetHiveFileName(
+    OUT PSTR FileName,
+    IN PCSTR DestPath,
+    IN UINT Index,
+    IN BOOL UpperCaseFileName)
+{
+    PSTR ptr;
+
+    strcpy(FileName, DestPath);
+    strcat(FileName, DIR_SEPARATOR_STRING);
+
+    ptr = FileName + strlen(FileName);
+
+    strcat(FileName, RegistryHives[Index].HiveName);
+
+    /* Exception for the special setup registry hive */
+    // if (strcmp(RegistryHives[Index].HiveName, "SETUPREG") == 0)
+    if (Index == 0)
+        strcat(FileName, ".HIV");
+
+    /* Adjust file name case if needed */
+    if (UpperCaseFileName)
+    {
+        for (; *ptr; ++ptr)
+            *ptr = toupper(*ptr);
+    }
+    else
+    {
+        for (; *ptr; ++ptr)
+            *ptr = tolower(*ptr);
+    }
+}
+
+static ULONG
+GetSelectedHives(
+    IN PCSTR HiveList)
+{
+    ULONG HiveMask = 0;
+    UINT i;
+
+    for (i = 0; i < MAX_NUMBER_OF_REGISTRY_HIVES; ++i)
+    {
+        /* Skip this registry hive if it's not in the list */
+        if (!strstr(HiveList, RegistryHives[i].HiveName))
+            continue;
+
+        HiveMask |= (1 << i);
+
+        /* If we happen to deal with the special setup registry hive, stop there */
+        if (i == 0)
+            break;
+    }
+
+    return HiveMask;
+}
+
+/* Each list of hives gets its own stamp, as several runs share the output directory */
+static void
+GetStampFileName(
+    OUT PSTR FileName,
+    IN PCSTR DestPath,
+    IN PCSTR HiveList)
+{
+    PSTR ptr;
+
+    strcpy(FileName, DestPath);
+    strcat(FileName, DIR_SEPARATOR_STRING "mkhive_");
+
+    ptr = FileName + strlen(FileName);
+    for (; *HiveList && ptr < FileName + PATH_MAX - sizeof(".stamp"); ++HiveList)
+        *ptr++ = (*HiveList == ',') ? '_' : tolower(*HiveList);
+    strcpy(ptr, ".stamp");
+}
+
 int main(int argc, char *argv[])
 {
     INT ret;
     INT i;
-    PSTR ptr;
+    ULONG j, Count;
     BOOL UpperCaseFileName = FALSE;
+    BOOL Incremental = FALSE;
+    ULONG ThreadCount = 1;
     PCSTR HiveList = NULL;
     CHAR DestPath[PATH_MAX] = "";
     CHAR FileName[PATH_MAX];
-
-    if (argc < 4)
+    CHAR StampFile[PATH_MAX];
+    PINF_INPUT Inputs;
+    ULONGLONG ToolHash = 0;
+    ULONG SelectedHives, DirtyHives;
+    BOOL AnyChanged;
+    FILE *File;
+
+    if (argc < 2)
     {
         usage();
         return -1;
@@ -122,6 +209,20 @@ int main(int argc, char *argv[])
         {
             UpperCaseFileName = TRUE;
         }
+        else if (argv[i][1] == 'i' && argv[i][2] == 0)
+        {
+            Incremental = TRUE;
+        }
+        else if (argv[i][1] == 'b' && (argv[i][2] == ':' || argv[i][2] == '='))
+        {
+            return RunIndexBenchmark(strtoul(argv[i] + 3, NULL, 10));
+        }
+        else if (argv[i][1] == 'j' && (argv[i][2] == ':' || argv[i][2] == '='))
+        {
+            ThreadCount = strtoul(argv[i] + 3, NULL, 10);
+            if (ThreadCount == 0)
+                ThreadCount = GetWorkPoolThreadCount();
+        }
         else
         if (argv[i][1] == 'h' && (argv[i][2] == ':' || argv[i][2] == '='))
         {
@@ -155,57 +256,114 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    /* Now we should have the list of INF files */
+    Count = argc - i;
+    Inputs = calloc(Count, sizeof(INF_INPUT));
+    if (!Inputs)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return -1;
+    }
+    for (j = 0; j < Count; ++j)
+    {
+        Inputs[j].FileName = malloc(strlen(argv[i + j]) + 1);
+        if (!Inputs[j].FileName)
+        {
+            fprintf(stderr, "Out of memory.\n");
+            return -1;
+        }
+        convert_path(Inputs[j].FileName, argv[i + j]);
+        Inputs[j].Changed = TRUE;
+    }
+
+    SelectedHives = GetSelectedHives(HiveList);
+    DirtyHives = SelectedHives;
+
+    if (Incremental)
+    {
+        GetStampFileName(StampFile, DestPath, HiveList);
+
+        /* A different mkhive may produce different hives from the same files */
+        if (!HashFileContents(argv[0], &ToolHash))
+            ToolHash = 0;
+
+        for (j = 0; j < Count; ++j)
+        {
+            if (!HashFileContents(Inputs[j].FileName, &Inputs[j].ContentHash))
+                Inputs[j].ContentHash = 0;
+        }
+
+        DirtyHives = CompareHiveStamp(StampFile, ToolHash, UpperCaseFileName,
+                                      Inputs, Count) & SelectedHives;
+
+        /* Hives which went missing have to be re-created as well */
+        for (i = 0; i < MAX_NUMBER_OF_REGISTRY_HIVES; ++i)
+        {
+            if (!(SelectedHives & (1 << i)) || (DirtyHives & (1 << i)))
+                continue;
+
+            GetHiveFileName(FileName, DestPath, i, UpperCaseFileName);
+            File = fopen(FileName, "rb");
+            if (File)
+                fclose(File);
+            else
+                DirtyHives |= (1 << i);
+        }
+
+        AnyChanged = FALSE;
+        for (j = 0; j < Count; ++j)
+            AnyChanged |= Inputs[j].Changed;
+
+        if (!AnyChanged && !DirtyHives)
+        {
+            printf("  Hives are up to date.\n");
+            ret = 0;
+            goto Cleanup;
+        }
+
+        /* The stamp is no longer valid while the hives are being re-created */
+        remove(StampFile);
+    }
+
     /* Initialize the registry */
     RegInitializeRegistry(HiveList);
 
     /* Default to failure */
     ret = -1;
 
-    /* Now we should have the list of INF files: parse it */
-    for (; i < argc; ++i)
+    /* Parse the INF files and import them */
+    if (!ImportRegistryFiles(Inputs, Count, ThreadCount))
+        goto Quit;
+
+    /* Changed files may now modify other hives than before */
+    for (j = 0; j < Count; ++j)
     {
-        convert_path(FileName, argv[i]);
-        if (!ImportRegistryFile(FileName))
-            goto Quit;
+        if (Inputs[j].Changed)
+            DirtyHives |= Inputs[j].HiveMask & SelectedHives;
     }
 
     for (i = 0; i < MAX_NUMBER_OF_REGISTRY_HIVES; ++i)
     {
         /* Skip this registry hive if it's not in the list */
-        if (!strstr(HiveList, RegistryHives[i].HiveName))
+        if (!(SelectedHives & (1 << i)))
             continue;
 
-        strcpy(FileName, DestPath);
-        strcat(FileName, DIR_SEPARATOR_STRING);
-
-        ptr = FileName + strlen(FileName);
-
-        strcat(FileName, RegistryHives[i].HiveName);
-
-        /* Exception for the special setup registry hive */
-        // if (strcmp(RegistryHives[i].HiveName, "SETUPREG") == 0)
-        if (i == 0)
-            strcat(FileName, ".HIV");
+        GetHiveFileName(FileName, DestPath, i, UpperCaseFileName);
 
-        /* Adjust file name case if needed */
-        if (UpperCaseFileName)
+        if (!(DirtyHives & (1 << i)))
         {
-            for (; *ptr; ++ptr)
-                *ptr = toupper(*ptr);
-        }
-        else
-        {
-            for (; *ptr; ++ptr)
-                *ptr = tolower(*ptr);
+            printf("  Binary hive is up to date: %s\n", FileName);
+            continue;
         }
 
         if (!ExportBinaryHive(FileName, RegistryHives[i].CmHive))
             goto Quit;
+    }
 
-        /* If we happen to deal with the special setup registry hive, stop there */
-        // if (strcmp(RegistryHives[i].HiveName, "SETUPREG") == 0)
-        if (i == 0)
-            break;
+    if (Incremental &&
+        !WriteHiveStamp(StampFile, ToolHash, UpperCaseFileName, Inputs, Count))
+    {
+        printf("  Warning: could not write %s\n", StampFile);
     }
 
     /* Success */
@@ -215,6 +373,11 @@ Quit:
     /* Shut down the registry */
     RegShutdownRegistry();
 
+Cleanup:
+    for (j = 0; j < Count; ++j)
+        free(Inputs[j].FileName);
+    free(Inputs);
+
     if (ret == 0)
         printf("  Done.\n");
 
@@ -123,6 +123,9 @@ RegOpenKeyW(
 #include "cmi.h"
 #include "registry.h"
 #include "binhive.h"
+#include "hivecache.h"
+#include "workpool.h"
+#include "benchmark.h"
 
 #define OBJ_NAME_PATH_SEPARATOR           ((WCHAR)L'\\')
 
@@ -395,7 +395,7 @@ do_reg_operation(
  * Called once for each AddReg and DelReg entry in a given section.
  */
 static BOOL
-registry_callback(HINF hInf, PCWSTR Section, BOOL Delete)
+registry_callback(HINF hInf, PCWSTR Section, BOOL Delete, PULONG HiveMask)
 {
     WCHAR Buffer[MAX_INF_STRING_LENGTH];
     PWCHAR ValuePtr;
@@ -461,6 +461,9 @@ registry_callback(HINF hInf, PCWSTR Section, BOOL Delete)
             }
         }
 
+        /* Remember which hives this INF file modifies */
+        *HiveMask |= RegGetKeyHiveMask(KeyHandle);
+
         /* Get value name */
         if (InfHostGetStringField(Context, 3, Buffer, sizeof(Buffer)/sizeof(WCHAR), NULL) == 0)
         {
@@ -487,35 +490,76 @@ registry_callback(HINF hInf, PCWSTR Section, BOOL Delete)
 }
 
 
-BOOL
-ImportRegistryFile(PCHAR FileName)
+static BOOL
+ImportRegistryInf(HINF hInf, PULONG HiveMask)
 {
-    HINF hInf;
-    ULONG ErrorLine;
-
-    /* Load inf file from install media. */
-    if (InfHostOpenFile(&hInf, FileName, 0, &ErrorLine) != 0)
-    {
-        DPRINT1("InfHostOpenFile(%s) failed\n", FileName);
-        return FALSE;
-    }
-
-    if (!registry_callback(hInf, (PWCHAR)DelReg, TRUE))
+    if (!registry_callback(hInf, (PWCHAR)DelReg, TRUE, HiveMask))
     {
         DPRINT1("registry_callback() for DelReg failed\n");
-        InfHostCloseFile(hInf);
         return FALSE;
     }
 
-    if (!registry_callback(hInf, (PWCHAR)AddReg, FALSE))
+    if (!registry_callback(hInf, (PWCHAR)AddReg, FALSE, HiveMask))
     {
         DPRINT1("registry_callback() for AddReg failed\n");
-        InfHostCloseFile(hInf);
         return FALSE;
     }
 
-    InfHostCloseFile(hInf);
     return TRUE;
 }
 
+static void
+LoadRegistryInf(void *Context, unsigned int Index)
+{
+    PINF_INPUT Input = (PINF_INPUT)Context + Index;
+    ULONG ErrorLine;
+
+    if (InfHostOpenFile(&Input->InfHandle, Input->FileName, 0, &ErrorLine) != 0)
+        Input->InfHandle = NULL;
+}
+
+/*
+ * Parse all the INF files on up to ThreadCount threads, then apply their
+ * DelReg and AddReg sections in command line order, so that the resulting
+ * hives are the same as when importing the files one by one.
+ */
+BOOL
+ImportRegistryFiles(PINF_INPUT Inputs, ULONG Count, ULONG ThreadCount)
+{
+    BOOL Success = TRUE;
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        Inputs[i].InfHandle = NULL;
+        Inputs[i].HiveMask = 0;
+    }
+
+    RunWorkPool(ThreadCount, Count, LoadRegistryInf, Inputs);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Success)
+        {
+            if (Inputs[i].InfHandle == NULL)
+            {
+                DPRINT1("InfHostOpenFile(%s) failed\n", Inputs[i].FileName);
+                Success = FALSE;
+            }
+            else
+            {
+                Success = ImportRegistryInf(Inputs[i].InfHandle, &Inputs[i].HiveMask);
+            }
+        }
+
+        if (Inputs[i].InfHandle != NULL)
+        {
+            InfHostCloseFile(Inputs[i].InfHandle);
+            Inputs[i].InfHandle = NULL;
+        }
+    }
+
+    return Success;
+}
+
 /* EOF */
@@ -26,7 +26,19 @@
 
 #pragma once
 
+typedef struct _INF_INPUT
+{
+    PCHAR FileName;
+    ULONGLONG ContentHash;  /* Hash of the file contents, see hivecache.c */
+    ULONG HiveMask;         /* Hives modified by the file, one bit per RegistryHives[] entry */
+    BOOL Changed;           /* Contents differ from the previous incremental run */
+    HINF InfHandle;
+} INF_INPUT, *PINF_INPUT;
+
 BOOL
-ImportRegistryFile(PCHAR Filename);
+ImportRegistryFiles(
+    IN OUT PINF_INPUT Inputs,
+    IN ULONG Count,
+    IN ULONG ThreadCount);
 
 /* EOF */
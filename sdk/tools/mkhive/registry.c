@@ -1130,6 +1130,24 @@ CreateSymLink(
     return TRUE;
 }
 
+ULONG
+RegGetKeyHiveMask(
+    IN HKEY hKey)
+{
+    PMEMKEY Key = HKEY_TO_MEMKEY(hKey);
+    ULONG HiveMask = 0;
+    UINT i;
+
+    /* SETUPREG and SYSTEM share the same hive, report both of them */
+    for (i = 0; i < _countof(RegistryHives); ++i)
+    {
+        if (RegistryHives[i].CmHive == Key->RegistryHive)
+            HiveMask |= (1 << i);
+    }
+
+    return HiveMask;
+}
+
 VOID
 RegInitializeRegistry(
     IN PCSTR HiveList)
@@ -53,4 +53,8 @@ RegInitializeRegistry(
 VOID
 RegShutdownRegistry(VOID);
 
+ULONG
+RegGetKeyHiveMask(
+    IN HKEY hKey);
+
 /* EOF */
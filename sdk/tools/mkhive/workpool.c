@@ -0,0 +1,177 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Minimal host thread pool for independent work items
+ */
+
+/*
+ * This file only includes host headers, so that the native thread API of the
+ * build machine does not clash with the NT types used by the rest of mkhive.
+ */
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "workpool.h"
+
+#define MAX_WORK_THREADS 64
+
+typedef struct _WORK_POOL
+{
+#ifdef _WIN32
+    CRITICAL_SECTION Lock;
+#else
+    pthread_mutex_t Lock;
+#endif
+    unsigned int NextItem;
+    unsigned int ItemCount;
+    PWORK_ROUTINE Routine;
+    void *Context;
+} WORK_POOL, *PWORK_POOL;
+
+/* FUNCTIONS ****************************************************************/
+
+static int
+GetNextItem(PWORK_POOL Pool, unsigned int *Index)
+{
+    int Found;
+
+#ifdef _WIN32
+    EnterCriticalSection(&Pool->Lock);
+#else
+    pthread_mutex_lock(&Pool->Lock);
+#endif
+
+    Found = (Pool->NextItem < Pool->ItemCount);
+    if (Found)
+        *Index = Pool->NextItem++;
+
+#ifdef _WIN32
+    LeaveCriticalSection(&Pool->Lock);
+#else
+    pthread_mutex_unlock(&Pool->Lock);
+#endif
+
+    return Found;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+#else
+static void *
+#endif
+WorkerThread(void *Parameter)
+{
+    PWORK_POOL Pool = (PWORK_POOL)Parameter;
+    unsigned int Index;
+
+    while (GetNextItem(Pool, &Index))
+        Pool->Routine(Pool->Context, Index);
+
+    return 0;
+}
+
+unsigned int
+GetWorkPoolThreadCount(void)
+{
+    long Count;
+
+#ifdef _WIN32
+    SYSTEM_INFO SystemInfo;
+
+    GetSystemInfo(&SystemInfo);
+    Count = (long)SystemInfo.dwNumberOfProcessors;
+#else
+    Count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    if (Count < 1)
+        return 1;
+    if (Count > MAX_WORK_THREADS)
+        return MAX_WORK_THREADS;
+    return (unsigned int)Count;
+}
+
+/*
+ * Call Routine for every index in [0, ItemCount) using up to ThreadCount
+ * threads. Items are handed out in increasing order, but may complete in any
+ * order. Falls back to the calling thread if no worker could be started.
+ */
+void
+RunWorkPool(
+    unsigned int ThreadCount,
+    unsigned int ItemCount,
+    PWORK_ROUTINE Routine,
+    void *Context)
+{
+    WORK_POOL Pool;
+#ifdef _WIN32
+    HANDLE Threads[MAX_WORK_THREADS];
+#else
+    pthread_t Threads[MAX_WORK_THREADS];
+#endif
+    unsigned int Started, i;
+
+    if (ThreadCount > MAX_WORK_THREADS)
+        ThreadCount = MAX_WORK_THREADS;
+    if (ThreadCount > ItemCount)
+        ThreadCount = ItemCount;
+
+    Pool.NextItem = 0;
+    Pool.ItemCount = ItemCount;
+    Pool.Routine = Routine;
+    Pool.Context = Context;
+
+    if (ThreadCount <= 1)
+    {
+        for (i = 0; i < ItemCount; i++)
+            Routine(Context, i);
+        return;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&Pool.Lock);
+#else
+    pthread_mutex_init(&Pool.Lock, NULL);
+#endif
+
+    /* The calling thread is one of the workers */
+    for (Started = 0; Started < ThreadCount - 1; Started++)
+    {
+#ifdef _WIN32
+        Threads[Started] = CreateThread(NULL, 0, WorkerThread, &Pool, 0, NULL);
+        if (Threads[Started] == NULL)
+            break;
+#else
+        if (pthread_create(&Threads[Started], NULL, WorkerThread, &Pool) != 0)
+            break;
+#endif
+    }
+
+    /* This also covers the case where no thread could be started */
+    WorkerThread(&Pool);
+
+    for (i = 0; i < Started; i++)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+#else
+        pthread_join(Threads[i], NULL);
+#endif
+    }
+
+#ifdef _WIN32
+    DeleteCriticalSection(&Pool.Lock);
+#else
+    pthread_mutex_destroy(&Pool.Lock);
+#endif
+}
+
+/* EOF */
@@ -0,0 +1,21 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Minimal host thread pool for independent work items
+ */
+
+#pragma once
+
+typedef void (*PWORK_ROUTINE)(void *Context, unsigned int Index);
+
+unsigned int
+GetWorkPoolThreadCount(void);
+
+void
+RunWorkPool(
+    unsigned int ThreadCount,
+    unsigned int ItemCount,
+    PWORK_ROUTINE Routine,
+    void *Context);
+
+/* EOF */
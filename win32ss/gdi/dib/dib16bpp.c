@@ -136,12 +136,17 @@ DIB_16BPP_VLine(SURFOBJ *SurfObj, LONG x, LONG y1, LONG y2, ULONG c)
 #endif
 }
 
+/* Pixels translated per XLATEOBJ_vXlateRow call when the destination
+   is narrower than a ULONG */
+#define XLATE_ROW_CHUNK 64
+
 BOOLEAN
 DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 {
-  LONG     i, j, sx, sy, xColor, f1;
+  LONG     i, j, k, sx, sy, xColor, f1, cChunk;
   PBYTE    SourceBits, DestBits, SourceLine, DestLine;
   PBYTE    SourceBits_4BPP, SourceLine_4BPP;
+  ULONG    aulRow[XLATE_ROW_CHUNK];
   DestBits = (PBYTE)BltInfo->DestSurface->pvScan0 + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta) + 2 * BltInfo->DestRect.left;
 
   switch(BltInfo->SourceSurface->iBitmapFormat)
@@ -212,12 +217,16 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i += cChunk)
       {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, *SourceBits);
-        SourceBits += 1;
-        DestBits += 2;
+        cChunk = min(BltInfo->DestRect.right - i, XLATE_ROW_CHUNK);
+        for (k = 0; k < cChunk; k++)
+          aulRow[k] = SourceBits[k];
+        XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, aulRow, aulRow, cChunk);
+        for (k = 0; k < cChunk; k++)
+          ((WORD *)DestBits)[k] = (WORD)aulRow[k];
+        SourceBits += cChunk;
+        DestBits += 2 * cChunk;
       }
 
       SourceLine += BltInfo->SourceSurface->lDelta;
@@ -345,16 +354,19 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i += cChunk)
       {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) + (*(SourceBits));
-
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, xColor);
-
-        SourceBits += 3;
-        DestBits += 2;
+        cChunk = min(BltInfo->DestRect.right - i, XLATE_ROW_CHUNK);
+        for (k = 0; k < cChunk; k++)
+        {
+          aulRow[k] = (*(SourceBits + 2) << 0x10) +
+            (*(SourceBits + 1) << 0x08) + (*(SourceBits));
+          SourceBits += 3;
+        }
+        XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, aulRow, aulRow, cChunk);
+        for (k = 0; k < cChunk; k++)
+          ((WORD *)DestBits)[k] = (WORD)aulRow[k];
+        DestBits += 2 * cChunk;
       }
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -373,13 +385,14 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
+      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i += cChunk)
       {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest,
-          *((PDWORD) SourceBits));
-        SourceBits += 4;
-        DestBits += 2;
+        cChunk = min(BltInfo->DestRect.right - i, XLATE_ROW_CHUNK);
+        XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, aulRow, (PULONG)SourceBits, cChunk);
+        for (k = 0; k < cChunk; k++)
+          ((WORD *)DestBits)[k] = (WORD)aulRow[k];
+        SourceBits += 4 * cChunk;
+        DestBits += 2 * cChunk;
       }
 
       SourceLine += BltInfo->SourceSurface->lDelta;
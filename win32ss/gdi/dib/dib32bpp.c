@@ -120,13 +120,14 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
+      /* Widen the indices in place, then translate the whole row */
+      Dest32 = (PDWORD)DestBits;
       for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
       {
-        xColor = *SourceBits;
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 1;
-        DestBits += 4;
+        *Dest32++ = *SourceBits++;
       }
+      XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits,
+                         BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -142,13 +143,14 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
+      Dest32 = (PDWORD)DestBits;
       for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
       {
-        xColor = *((PWORD) SourceBits);
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
+        *Dest32++ = *((PWORD) SourceBits);
         SourceBits += 2;
-        DestBits += 4;
       }
+      XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits,
+                         BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -166,15 +168,16 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
+      Dest32 = (PDWORD)DestBits;
       for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
       {
-        xColor = (*(SourceBits + 2) << 0x10) +
+        *Dest32++ = (*(SourceBits + 2) << 0x10) +
           (*(SourceBits + 1) << 0x08) +
           (*(SourceBits));
-        *((PDWORD)DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
         SourceBits += 3;
-        DestBits += 4;
       }
+      XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)DestBits,
+                         BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -211,6 +214,18 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         }
       }
     }
+    else if (BltInfo->SourceSurface->pvScan0 != BltInfo->DestSurface->pvScan0)
+    {
+      /* Different surfaces never overlap, translate a row at a time */
+      SourceBits = (PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 4 * BltInfo->SourcePoint.x;
+      for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
+      {
+        XLATEOBJ_vXlateRow(BltInfo->XlateSourceToDest, (PULONG)DestBits, (PULONG)SourceBits,
+                           BltInfo->DestRect.right - BltInfo->DestRect.left);
+        SourceBits += BltInfo->SourceSurface->lDelta;
+        DestBits += BltInfo->DestSurface->lDelta;
+      }
+    }
     else
     {
       if (BltInfo->DestRect.top < BltInfo->SourcePoint.y)
@@ -341,6 +356,99 @@ Clamp8(ULONG val)
   return (val > 255) ? 255 : (UCHAR)val;
 }
 
+/*
+ * Row kernels for the unstretched 32bpp -> 32bpp blend with a trivial xlate.
+ * Two channels are processed at once, each in a 16 bit lane of a ULONG:
+ * 0x00FF00FF holds the first and third byte of a pixel, the second and
+ * fourth byte are shifted down first. The results are bit-exact with the
+ * per-pixel code below.
+ */
+#define LANE_MASK 0x00FF00FF
+
+/* Exact (v / 255) per lane, for lanes up to 255 * 255 */
+#define LANE_DIV255(v) \
+  ((((v) + 0x00010001 + (((v) >> 8) & LANE_MASK)) >> 8) & LANE_MASK)
+
+/* Per lane Clamp8(a + b), for lanes up to 255 */
+static __inline ULONG
+LaneAddSat(ULONG a, ULONG b)
+{
+  ULONG Sum = a + b;
+  ULONG Over = Sum & 0x01000100;
+
+  return (Sum | (Over - (Over >> 8))) & LANE_MASK;
+}
+
+static __inline ULONG
+BlendPixel(ULONG Dst, ULONG Src, UCHAR ConstAlpha, BOOLEAN PerPixelAlpha)
+{
+  ULONG SrcLo = Src & LANE_MASK, SrcHi = (Src >> 8) & LANE_MASK;
+  ULONG DstLo, DstHi, InvAlpha;
+
+  if (ConstAlpha != 255)
+  {
+    SrcLo = LANE_DIV255(SrcLo * ConstAlpha);
+    SrcHi = LANE_DIV255(SrcHi * ConstAlpha);
+  }
+
+  /* The (scaled) source alpha is the upper lane of SrcHi */
+  InvAlpha = 255 - (PerPixelAlpha ? (SrcHi >> 16) : ConstAlpha);
+
+  /* Opaque source: the destination does not contribute */
+  if (!InvAlpha)
+    return SrcLo | (SrcHi << 8);
+
+  DstLo = Dst & LANE_MASK;
+  DstHi = (Dst >> 8) & LANE_MASK;
+  if (InvAlpha != 255)
+  {
+    DstLo = LANE_DIV255(DstLo * InvAlpha);
+    DstHi = LANE_DIV255(DstHi * InvAlpha);
+  }
+
+  return LaneAddSat(DstLo, SrcLo) | (LaneAddSat(DstHi, SrcHi) << 8);
+}
+
+/* Premultiplied per-pixel alpha, no constant alpha: the common case for
+   themed and layered UI elements */
+static VOID
+DIB_32BPP_BlendRowPerPixel(PULONG Dst, PULONG Src, LONG Count, UCHAR ConstAlpha)
+{
+  ULONG Pixel;
+
+  while (Count--)
+  {
+    Pixel = *Src++;
+
+    /* Fully transparent source pixels leave the destination alone */
+    if (Pixel)
+      *Dst = BlendPixel(*Dst, Pixel, 255, TRUE);
+    Dst++;
+  }
+}
+
+static VOID
+DIB_32BPP_BlendRowPerPixelConst(PULONG Dst, PULONG Src, LONG Count, UCHAR ConstAlpha)
+{
+  while (Count--)
+  {
+    *Dst = BlendPixel(*Dst, *Src++, ConstAlpha, TRUE);
+    Dst++;
+  }
+}
+
+static VOID
+DIB_32BPP_BlendRowConst(PULONG Dst, PULONG Src, LONG Count, UCHAR ConstAlpha)
+{
+  while (Count--)
+  {
+    *Dst = BlendPixel(*Dst, *Src++, ConstAlpha, FALSE);
+    Dst++;
+  }
+}
+
+typedef VOID (*PFN_DIB_32BPP_BlendRow)(PULONG, PULONG, LONG, UCHAR);
+
 BOOLEAN
 DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
@@ -379,6 +487,38 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     return FALSE;
   }
 
+  /* Unstretched blits from a 32bpp surface with the same layout go through
+     a row kernel picked once for the whole blit */
+  if (Source->iBitmapFormat == BMF_32BPP &&
+      (ColorTranslation == NULL || (ColorTranslation->flXlate & XO_TRIVIAL)) &&
+      DestRect->right - DestRect->left == SourceRect->right - SourceRect->left &&
+      DestRect->bottom - DestRect->top == SourceRect->bottom - SourceRect->top)
+  {
+    PFN_DIB_32BPP_BlendRow pfnBlendRow;
+    PULONG Src;
+
+    if (!(BlendFunc.AlphaFormat & AC_SRC_ALPHA))
+      pfnBlendRow = DIB_32BPP_BlendRowConst;
+    else if (BlendFunc.SourceConstantAlpha == 255)
+      pfnBlendRow = DIB_32BPP_BlendRowPerPixel;
+    else
+      pfnBlendRow = DIB_32BPP_BlendRowPerPixelConst;
+
+    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
+      (DestRect->left << 2));
+    Src = (PULONG)((ULONG_PTR)Source->pvScan0 + (SourceRect->top * Source->lDelta) +
+      (SourceRect->left << 2));
+
+    for (Rows = DestRect->bottom - DestRect->top; Rows > 0; Rows--)
+    {
+      pfnBlendRow(Dst, Src, DestRect->right - DestRect->left, BlendFunc.SourceConstantAlpha);
+      Dst = (PULONG)((ULONG_PTR)Dst + Dest->lDelta);
+      Src = (PULONG)((ULONG_PTR)Src + Source->lDelta);
+    }
+
+    return TRUE;
+  }
+
   Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
     (DestRect->left << 2));
   SrcBpp = BitsPerFormat(Source->iBitmapFormat);
@@ -117,6 +117,7 @@ typedef struct _SHARED_MEM {
   ULONG         BufferSize;
   BOOL          IsMapping;
   LONG          RefCount;
+  HANDLE        FileHandle;     /* Font file to map on first use, if Buffer is NULL */
 } SHARED_MEM, *PSHARED_MEM;
 
 typedef struct _SHARED_FACE_CACHE {
@@ -125,12 +126,25 @@ typedef struct _SHARED_FACE_CACHE {
     UNICODE_STRING FullName;
 } SHARED_FACE_CACHE, *PSHARED_FACE_CACHE;
 
+/* The size-independent metrics used to rule out fonts when matching */
+typedef struct _FONT_MATCH_INFO {
+  BOOL  Valid;
+  BYTE  CharSet;
+  BYTE  PitchAndFamily;
+  ULONG FamilyHash;
+  ULONG FaceHash;
+  WCHAR FamilyName[LF_FACESIZE];
+  WCHAR FaceName[LF_FACESIZE];
+} FONT_MATCH_INFO, *PFONT_MATCH_INFO;
+
 typedef struct _SHARED_FACE {
-  FT_Face       Face;
+  FT_Face       Face;           /* NULL until opened, see SharedFace_GetFace */
+  FT_Long       FaceIndex;
   LONG          RefCount;
   PSHARED_MEM   Memory;
   SHARED_FACE_CACHE EnglishUS;
   SHARED_FACE_CACHE UserLanguage;
+  LIST_ENTRY    GlyphCacheListHead;
 } SHARED_FACE, *PSHARED_FACE;
 
 typedef struct _FONTGDI {
@@ -153,6 +167,7 @@ typedef struct _FONTGDI {
   BYTE          OriginalItalic;
   LONG          OriginalWeight;
   BYTE          CharSet;
+  FONT_MATCH_INFO MatchInfo;
 
   /* Precomputed font metrics (supplements FreeType metrics) */
   LONG          tmHeight;
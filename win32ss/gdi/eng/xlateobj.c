@@ -19,9 +19,18 @@ EXLATEOBJ_iXlateTrivial(
     _In_ PEXLATEOBJ pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_ROW)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateRowTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels);
+
 /** Globals *******************************************************************/
 
-EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial};
+EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateRowTrivial};
 
 static ULONG giUniqueXlate = 0;
 
@@ -351,6 +360,177 @@ EXLATEOBJ_iXlateBitfieldsToPal(PEXLATEOBJ pexlo, ULONG iColor)
 }
 
 
+/** Row xlate functions *******************************************************/
+
+/*
+ * Each row function translates a whole run of pixels, so the per-pixel cost
+ * is a direct (and usually inlined) call instead of an indirect one.
+ */
+#define DEFINE_XLATE_ROW(name)                                      \
+_Function_class_(FN_XLATE_ROW)                                      \
+static                                                              \
+VOID                                                                \
+FASTCALL                                                            \
+EXLATEOBJ_vXlateRow##name(                                          \
+    _In_ PEXLATEOBJ pexlo,                                          \
+    _Out_writes_(cPixels) PULONG pulDst,                            \
+    _In_reads_(cPixels) const ULONG *pulSrc,                        \
+    _In_ ULONG cPixels)                                             \
+{                                                                   \
+    while (cPixels--)                                               \
+        *pulDst++ = EXLATEOBJ_iXlate##name(pexlo, *pulSrc++);       \
+}
+
+_Function_class_(FN_XLATE_ROW)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateRowTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    if (pulDst != pulSrc)
+        RtlCopyMemory(pulDst, pulSrc, cPixels * sizeof(ULONG));
+}
+
+/* Indexed sources: a plain table gather */
+_Function_class_(FN_XLATE_ROW)
+static
+VOID
+FASTCALL
+EXLATEOBJ_vXlateRowTable(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    const ULONG *pulXlate = pexlo->xlo.pulXlate;
+    ULONG cEntries = pexlo->xlo.cEntries;
+    ULONG iColor;
+
+    while (cPixels--)
+    {
+        iColor = *pulSrc++;
+        *pulDst++ = (iColor < cEntries) ? pulXlate[iColor] : 0;
+    }
+}
+
+_Function_class_(FN_XLATE_ROW)
+static
+VOID
+FASTCALL
+EXLATEOBJ_vXlateRowShiftAndMask(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    ULONG ulRedMask = pexlo->ulRedMask, ulRedShift = pexlo->ulRedShift;
+    ULONG ulGreenMask = pexlo->ulGreenMask, ulGreenShift = pexlo->ulGreenShift;
+    ULONG ulBlueMask = pexlo->ulBlueMask, ulBlueShift = pexlo->ulBlueShift;
+    ULONG iColor;
+
+    while (cPixels--)
+    {
+        iColor = *pulSrc++;
+        *pulDst++ = (_rotl(iColor, ulRedShift) & ulRedMask) |
+                    (_rotl(iColor, ulGreenShift) & ulGreenMask) |
+                    (_rotl(iColor, ulBlueShift) & ulBlueMask);
+    }
+}
+
+/* Nearest palette entry lookups are slow, but rows tend to repeat colors */
+#define DEFINE_XLATE_ROW_CACHED(name)                               \
+_Function_class_(FN_XLATE_ROW)                                      \
+static                                                              \
+VOID                                                                \
+FASTCALL                                                            \
+EXLATEOBJ_vXlateRow##name(                                          \
+    _In_ PEXLATEOBJ pexlo,                                          \
+    _Out_writes_(cPixels) PULONG pulDst,                            \
+    _In_reads_(cPixels) const ULONG *pulSrc,                        \
+    _In_ ULONG cPixels)                                             \
+{                                                                   \
+    ULONG iLastColor = 0, iLastIndex = 0, iColor;                   \
+    BOOLEAN bCached = FALSE;                                        \
+                                                                    \
+    while (cPixels--)                                               \
+    {                                                               \
+        iColor = *pulSrc++;                                         \
+        if (!bCached || iColor != iLastColor)                       \
+        {                                                           \
+            iLastColor = iColor;                                    \
+            iLastIndex = EXLATEOBJ_iXlate##name(pexlo, iColor);     \
+            bCached = TRUE;                                         \
+        }                                                           \
+        *pulDst++ = iLastIndex;                                     \
+    }                                                               \
+}
+
+DEFINE_XLATE_ROW(ToMono)
+DEFINE_XLATE_ROW(RGBtoBGR)
+DEFINE_XLATE_ROW(RGBto555)
+DEFINE_XLATE_ROW(BGRto555)
+DEFINE_XLATE_ROW(RGBto565)
+DEFINE_XLATE_ROW(BGRto565)
+DEFINE_XLATE_ROW(555toRGB)
+DEFINE_XLATE_ROW(555toBGR)
+DEFINE_XLATE_ROW(555to565)
+DEFINE_XLATE_ROW(565to555)
+DEFINE_XLATE_ROW(565toRGB)
+DEFINE_XLATE_ROW(565toBGR)
+DEFINE_XLATE_ROW_CACHED(RGBtoPal)
+DEFINE_XLATE_ROW_CACHED(555toPal)
+DEFINE_XLATE_ROW_CACHED(565toPal)
+DEFINE_XLATE_ROW_CACHED(BitfieldsToPal)
+
+static const struct
+{
+    PFN_XLATE pfnXlate;
+    PFN_XLATE_ROW pfnXlateRow;
+} gaXlateRowFunctions[] =
+{
+    { EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateRowTrivial },
+    { EXLATEOBJ_iXlateToMono, EXLATEOBJ_vXlateRowToMono },
+    { EXLATEOBJ_iXlateTable, EXLATEOBJ_vXlateRowTable },
+    { EXLATEOBJ_iXlateRGBtoBGR, EXLATEOBJ_vXlateRowRGBtoBGR },
+    { EXLATEOBJ_iXlateRGBto555, EXLATEOBJ_vXlateRowRGBto555 },
+    { EXLATEOBJ_iXlateBGRto555, EXLATEOBJ_vXlateRowBGRto555 },
+    { EXLATEOBJ_iXlateRGBto565, EXLATEOBJ_vXlateRowRGBto565 },
+    { EXLATEOBJ_iXlateBGRto565, EXLATEOBJ_vXlateRowBGRto565 },
+    { EXLATEOBJ_iXlateRGBtoPal, EXLATEOBJ_vXlateRowRGBtoPal },
+    { EXLATEOBJ_iXlate555toRGB, EXLATEOBJ_vXlateRow555toRGB },
+    { EXLATEOBJ_iXlate555toBGR, EXLATEOBJ_vXlateRow555toBGR },
+    { EXLATEOBJ_iXlate555to565, EXLATEOBJ_vXlateRow555to565 },
+    { EXLATEOBJ_iXlate555toPal, EXLATEOBJ_vXlateRow555toPal },
+    { EXLATEOBJ_iXlate565to555, EXLATEOBJ_vXlateRow565to555 },
+    { EXLATEOBJ_iXlate565toRGB, EXLATEOBJ_vXlateRow565toRGB },
+    { EXLATEOBJ_iXlate565toBGR, EXLATEOBJ_vXlateRow565toBGR },
+    { EXLATEOBJ_iXlate565toPal, EXLATEOBJ_vXlateRow565toPal },
+    { EXLATEOBJ_iXlateShiftAndMask, EXLATEOBJ_vXlateRowShiftAndMask },
+    { EXLATEOBJ_iXlateBitfieldsToPal, EXLATEOBJ_vXlateRowBitfieldsToPal },
+};
+
+static
+PFN_XLATE_ROW
+EXLATEOBJ_pfnXlateRowFromXlate(
+    _In_ PFN_XLATE pfnXlate)
+{
+    ULONG i;
+
+    for (i = 0; i < _countof(gaXlateRowFunctions); i++)
+    {
+        if (gaXlateRowFunctions[i].pfnXlate == pfnXlate)
+            return gaXlateRowFunctions[i].pfnXlateRow;
+    }
+
+    /* Every iXlate function must have a row counterpart */
+    ASSERT(FALSE);
+    return EXLATEOBJ_vXlateRowTrivial;
+}
+
+
 /** Private Functions *********************************************************/
 
 VOID
@@ -374,6 +554,7 @@ EXLATEOBJ_vInitialize(
     pexlo->xlo.flXlate = 0;
     pexlo->xlo.pulXlate = pexlo->aulXlate;
     pexlo->pfnXlate = EXLATEOBJ_iXlateTrivial;
+    pexlo->pfnXlateRow = EXLATEOBJ_vXlateRowTrivial;
     pexlo->hColorTransform = NULL;
     pexlo->ppalSrc = ppalSrc;
     pexlo->ppalDst = ppalDst;
@@ -604,6 +785,8 @@ EXLATEOBJ_vInitialize(
         pexlo->xlo.flXlate = XO_TRIVIAL;
     else
         pexlo->xlo.flXlate &= ~XO_TRIVIAL;
+
+    pexlo->pfnXlateRow = EXLATEOBJ_pfnXlateRowFromXlate(pexlo->pfnXlate);
 }
 
 VOID
@@ -16,11 +16,21 @@ ULONG
     _In_ struct _EXLATEOBJ *pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_ROW)
+typedef
+VOID
+(FASTCALL *PFN_XLATE_ROW)(
+    _In_ struct _EXLATEOBJ *pexlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels);
+
 typedef struct _EXLATEOBJ
 {
     XLATEOBJ xlo;
 
     PFN_XLATE pfnXlate;
+    PFN_XLATE_ROW pfnXlateRow;
 
     PPALETTE ppalSrc;
     PPALETTE ppalDst;
@@ -54,6 +64,22 @@ XLATEOBJ_pfnXlate(
     return ((PEXLATEOBJ)pxlo)->pfnXlate;
 }
 
+/* Translates a run of pixels with a single indirect call. pulDst may be
+   equal to pulSrc, but must not overlap it otherwise. */
+FORCEINLINE
+VOID
+XLATEOBJ_vXlateRow(
+    _In_opt_ XLATEOBJ *pxlo,
+    _Out_writes_(cPixels) PULONG pulDst,
+    _In_reads_(cPixels) const ULONG *pulSrc,
+    _In_ ULONG cPixels)
+{
+    if (pxlo)
+        ((PEXLATEOBJ)pxlo)->pfnXlateRow((PEXLATEOBJ)pxlo, pulDst, pulSrc, cPixels);
+    else if (pulDst != pulSrc)
+        RtlCopyMemory(pulDst, pulSrc, cPixels * sizeof(ULONG));
+}
+
 VOID
 NTAPI
 EXLATEOBJ_vInitialize(
@@ -8,6 +8,10 @@ typedef struct _FONT_ENTRY
     UNICODE_STRING FaceName;
     UNICODE_STRING StyleName;
     BYTE NotEnum;
+    /* Global fonts only, see IntIndexGlobalFont */
+    LIST_ENTRY FamilyEntry;     /* In the family name bucket, or the unindexed fonts */
+    LIST_ENTRY FaceEntry;       /* In the face name bucket, if the names differ */
+    ULONG Order;                /* Position in the global font list */
 } FONT_ENTRY, *PFONT_ENTRY;
 
 typedef struct _FONT_ENTRY_MEM
@@ -25,7 +29,11 @@ typedef struct _FONT_ENTRY_COLL_MEM
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;   /* In g_FontCacheListHead, most recently used first */
+    LIST_ENTRY HashEntry;   /* In the g_FontCacheHashTable bucket */
+    LIST_ENTRY FaceEntry;   /* In the GlyphCacheListHead of the shared face */
+    ULONG Hash;
+    SIZE_T Size;
     int GlyphIndex;
     FT_Face Face;
     FT_BitmapGlyph BitmapGlyph;
@@ -36,6 +44,16 @@ typedef struct _FONT_CACHE_ENTRY
     MATRIX mxWorldToDevice;
 } FONT_CACHE_ENTRY, *PFONT_CACHE_ENTRY;
 
+typedef struct _FONT_MATCH_CACHE_ENTRY
+{
+    LIST_ENTRY ListEntry;   /* In g_FontMatchListHead, most recently used first */
+    LIST_ENTRY HashEntry;   /* In the g_FontMatchHashTable bucket */
+    ULONG Hash;
+    LOGFONTW LogFont;       /* Substituted, with the unused part of the face name zeroed */
+    FONTOBJ *FontObj;       /* NULL if the entry is unused */
+    ULONG Penalty;
+} FONT_MATCH_CACHE_ENTRY, *PFONT_MATCH_CACHE_ENTRY;
+
 
 /*
  * FONTSUBST_... --- constants for font substitutes
@@ -55,6 +73,67 @@ typedef struct FONTSUBST_ENTRY
 } FONTSUBST_ENTRY, *PFONTSUBST_ENTRY;
 
 
+/*
+ * FONT_META_... --- records of the font metadata cache (fontcache.c)
+ *
+ * The cache file is a FONT_META_HEADER followed by one FONT_META_FILE per
+ * font file. Each of them holds the file path, then one FONT_META_FACE per
+ * font entry that the file produced, in loading order, with its face and
+ * style names. Every record starts on an 8-byte boundary.
+ */
+#define FONT_META_MAGIC     0x4D544E46  /* 'FNTM' */
+#define FONT_META_VERSION   1
+
+typedef struct _FONT_META_HEADER
+{
+    ULONG Magic;
+    ULONG Version;
+    ULONG LanguageID;       /* The match info names are localized */
+    ULONG FileCount;
+    ULONG TotalSize;
+    ULONG Reserved;
+} FONT_META_HEADER, *PFONT_META_HEADER;
+
+typedef struct _FONT_META_FILE
+{
+    ULONG Size;             /* Including the path and the faces */
+    USHORT PathLength;      /* In bytes */
+    USHORT FaceCount;
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER LastWriteTime;
+    /* WCHAR Path[] and the FONT_META_FACE records follow */
+} FONT_META_FILE, *PFONT_META_FILE;
+
+typedef struct _FONT_META_FACE
+{
+    ULONG Size;             /* Including the names */
+    LONG FaceIndex;
+    LONG Weight;
+    BYTE CharSet;
+    BYTE Italic;
+    USHORT FaceNameLength;  /* In bytes */
+    USHORT StyleNameLength; /* In bytes */
+    USHORT Reserved;
+    FONT_MATCH_INFO MatchInfo;
+    /* WCHAR FaceName[] and StyleName[] follow */
+} FONT_META_FACE, *PFONT_META_FACE;
+
+#define FONT_META_ALIGN(Size)       ALIGN_UP_BY(Size, 8)
+#define FONT_META_FILE_PATH(File)   ((PWCHAR)((File) + 1))
+#define FONT_META_FIRST_FACE(File) \
+    ((PFONT_META_FACE)((PBYTE)((File) + 1) + FONT_META_ALIGN((File)->PathLength)))
+#define FONT_META_NEXT_FACE(Face)   ((PFONT_META_FACE)((PBYTE)(Face) + (Face)->Size))
+#define FONT_META_FACE_NAME(Face)   ((PWCHAR)((Face) + 1))
+#define FONT_META_STYLE_NAME(Face) \
+    ((PWCHAR)((PBYTE)((Face) + 1) + (Face)->FaceNameLength))
+
+VOID FASTCALL IntLoadFontMetaCache(VOID);
+PFONT_META_FILE FASTCALL IntLookupFontMetaCache(PCUNICODE_STRING PathName,
+                                                PFILE_NETWORK_OPEN_INFORMATION FileInfo);
+VOID FASTCALL IntAddFontMetaCache(PFONT_META_FILE File);
+VOID FASTCALL IntSaveFontMetaCache(VOID);
+
+
 typedef struct GDI_LOAD_FONT
 {
     PUNICODE_STRING     pFileName;
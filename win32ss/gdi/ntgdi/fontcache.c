@@ -0,0 +1,375 @@
+/*
+ * PROJECT:     ReactOS win32 kernel mode subsystem
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Persistent cache of the metadata of the system fonts
+ */
+
+/*
+ * Loading a font file used to mean mapping it and parsing it with FreeType,
+ * for every installed font at every boot. The names, charsets and match
+ * information of the fonts loaded from the registry are kept in a file
+ * instead, keyed by path, size and last write time. The fonts found there
+ * are added without being opened; their FreeType faces are created when they
+ * are first used.
+ *
+ * The cache is only used while IntLoadFontsInRegistry runs, so it needs no
+ * locking.
+ */
+
+/** Includes ******************************************************************/
+
+#include <win32k.h>
+
+#include FT_GLYPH_H
+
+#include "font.h"
+
+#define NDEBUG
+#include <debug.h>
+
+#define FONT_META_MAX_SIZE  (16 * 1024 * 1024)
+
+typedef struct _FONT_META_NODE
+{
+    LIST_ENTRY ListEntry;
+    ULONG Hash;
+    BOOLEAN Used;       /* Still describes a loaded font file */
+    BOOLEAN Owned;      /* Allocated, not a part of g_FontMetaBuffer */
+    PFONT_META_FILE File;
+} FONT_META_NODE, *PFONT_META_NODE;
+
+static UNICODE_STRING g_FontMetaPath =
+    RTL_CONSTANT_STRING(L"\\SystemRoot\\System32\\FNTCACHE.DAT");
+
+static PVOID g_FontMetaBuffer;
+static LIST_ENTRY g_FontMetaList;
+static BOOLEAN g_FontMetaDirty;
+
+/** Internal ******************************************************************/
+
+static ULONG
+IntFontMetaHash(PCWCH Path, USHORT Length)
+{
+    ULONG Hash = 0;
+    USHORT i;
+
+    for (i = 0; i < Length / sizeof(WCHAR); i++)
+        Hash = Hash * 31 + RtlUpcaseUnicodeChar(Path[i]);
+
+    return Hash;
+}
+
+static BOOL
+IntAddFontMetaNode(PFONT_META_FILE File, BOOLEAN Owned)
+{
+    PFONT_META_NODE Node;
+
+    Node = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_META_NODE), TAG_FONT);
+    if (!Node)
+        return FALSE;
+
+    Node->Hash = IntFontMetaHash(FONT_META_FILE_PATH(File), File->PathLength);
+    Node->Used = Owned;
+    Node->Owned = Owned;
+    Node->File = File;
+    InsertTailList(&g_FontMetaList, &Node->ListEntry);
+    return TRUE;
+}
+
+static VOID
+IntFreeFontMetaCache(VOID)
+{
+    PFONT_META_NODE Node;
+
+    while (!IsListEmpty(&g_FontMetaList))
+    {
+        Node = CONTAINING_RECORD(RemoveHeadList(&g_FontMetaList), FONT_META_NODE, ListEntry);
+        if (Node->Owned)
+            ExFreePoolWithTag(Node->File, TAG_FONT);
+        ExFreePoolWithTag(Node, TAG_FONT);
+    }
+
+    if (g_FontMetaBuffer)
+    {
+        ExFreePoolWithTag(g_FontMetaBuffer, TAG_FONT);
+        g_FontMetaBuffer = NULL;
+    }
+}
+
+/* Checks that a file record and its faces lie within Size bytes */
+static BOOL
+IntIsFontMetaFileValid(PFONT_META_FILE File, ULONG Size)
+{
+    PFONT_META_FACE Face;
+    ULONG Offset;
+    USHORT i;
+
+    if (Size < sizeof(FONT_META_FILE) ||
+        File->Size < sizeof(FONT_META_FILE) ||
+        File->Size > Size ||
+        File->Size != FONT_META_ALIGN(File->Size) ||
+        File->PathLength == 0 ||
+        (File->PathLength & 1) ||
+        File->FaceCount == 0)
+    {
+        return FALSE;
+    }
+
+    Offset = sizeof(FONT_META_FILE) + FONT_META_ALIGN(File->PathLength);
+    for (i = 0; i < File->FaceCount; i++)
+    {
+        if (Offset > File->Size || File->Size - Offset < sizeof(FONT_META_FACE))
+            return FALSE;
+
+        Face = (PFONT_META_FACE)((PBYTE)File + Offset);
+        if (Face->Size != FONT_META_ALIGN(Face->Size) ||
+            Face->Size > File->Size - Offset ||
+            Face->FaceNameLength == 0 ||
+            ((Face->FaceNameLength | Face->StyleNameLength) & 1) ||
+            sizeof(FONT_META_FACE) + (ULONG)Face->FaceNameLength +
+                Face->StyleNameLength > Face->Size)
+        {
+            return FALSE;
+        }
+
+        Offset += Face->Size;
+    }
+
+    return (Offset == File->Size);
+}
+
+static BOOL
+IntParseFontMetaCache(PVOID Buffer, ULONG Size)
+{
+    PFONT_META_HEADER Header = Buffer;
+    PFONT_META_FILE File;
+    ULONG Offset, i;
+
+    if (Size < sizeof(FONT_META_HEADER) ||
+        Header->Magic != FONT_META_MAGIC ||
+        Header->Version != FONT_META_VERSION ||
+        Header->LanguageID != gusLanguageID ||
+        Header->TotalSize != Size)
+    {
+        return FALSE;
+    }
+
+    Offset = sizeof(FONT_META_HEADER);
+    for (i = 0; i < Header->FileCount; i++)
+    {
+        File = (PFONT_META_FILE)((PBYTE)Buffer + Offset);
+        if (!IntIsFontMetaFileValid(File, Size - Offset) ||
+            !IntAddFontMetaNode(File, FALSE))
+        {
+            return FALSE;
+        }
+        Offset += File->Size;
+    }
+
+    return (Offset == Size);
+}
+
+/** Functions *****************************************************************/
+
+VOID FASTCALL
+IntLoadFontMetaCache(VOID)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    FILE_STANDARD_INFORMATION StandardInfo;
+    IO_STATUS_BLOCK Iosb;
+    LARGE_INTEGER ByteOffset;
+    HANDLE FileHandle;
+    NTSTATUS Status;
+    ULONG Size;
+
+    InitializeListHead(&g_FontMetaList);
+    g_FontMetaBuffer = NULL;
+    g_FontMetaDirty = TRUE;
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontMetaPath,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE, NULL, NULL);
+    Status = ZwOpenFile(&FileHandle,
+                        FILE_GENERIC_READ | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &Iosb,
+                        FILE_SHARE_READ,
+                        FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("No font cache (Status 0x%lx)\n", Status);
+        return;
+    }
+
+    Status = ZwQueryInformationFile(FileHandle, &Iosb, &StandardInfo,
+                                    sizeof(StandardInfo), FileStandardInformation);
+    if (!NT_SUCCESS(Status) ||
+        StandardInfo.EndOfFile.QuadPart < sizeof(FONT_META_HEADER) ||
+        StandardInfo.EndOfFile.QuadPart > FONT_META_MAX_SIZE)
+    {
+        ZwClose(FileHandle);
+        return;
+    }
+
+    Size = StandardInfo.EndOfFile.LowPart;
+    g_FontMetaBuffer = ExAllocatePoolWithTag(PagedPool, Size, TAG_FONT);
+    if (!g_FontMetaBuffer)
+    {
+        ZwClose(FileHandle);
+        return;
+    }
+
+    ByteOffset.QuadPart = 0;
+    Status = ZwReadFile(FileHandle, NULL, NULL, NULL, &Iosb,
+                        g_FontMetaBuffer, Size, &ByteOffset, NULL);
+    ZwClose(FileHandle);
+
+    if (!NT_SUCCESS(Status) || Iosb.Information != Size ||
+        !IntParseFontMetaCache(g_FontMetaBuffer, Size))
+    {
+        DPRINT1("Discarding the font cache (Status 0x%lx)\n", Status);
+        IntFreeFontMetaCache();
+        return;
+    }
+
+    g_FontMetaDirty = FALSE;
+}
+
+/*
+ * Returns the cached metadata of a font file, if it didn't change since it
+ * was cached. The returned record stays valid until IntSaveFontMetaCache.
+ */
+PFONT_META_FILE FASTCALL
+IntLookupFontMetaCache(PCUNICODE_STRING PathName,
+                       PFILE_NETWORK_OPEN_INFORMATION FileInfo)
+{
+    PLIST_ENTRY Entry;
+    PFONT_META_NODE Node;
+    UNICODE_STRING CachedPath;
+    ULONG Hash;
+
+    Hash = IntFontMetaHash(PathName->Buffer, PathName->Length);
+
+    for (Entry = g_FontMetaList.Flink; Entry != &g_FontMetaList; Entry = Entry->Flink)
+    {
+        Node = CONTAINING_RECORD(Entry, FONT_META_NODE, ListEntry);
+        if (Node->Hash != Hash || Node->File->PathLength != PathName->Length)
+            continue;
+
+        CachedPath.Buffer = FONT_META_FILE_PATH(Node->File);
+        CachedPath.Length = CachedPath.MaximumLength = Node->File->PathLength;
+        if (!RtlEqualUnicodeString(&CachedPath, PathName, TRUE))
+            continue;
+
+        /* A file that changed is left unused, and will be dropped */
+        if (Node->File->FileSize.QuadPart != FileInfo->EndOfFile.QuadPart ||
+            Node->File->LastWriteTime.QuadPart != FileInfo->LastWriteTime.QuadPart)
+        {
+            return NULL;
+        }
+
+        Node->Used = TRUE;
+        return Node->File;
+    }
+
+    return NULL;
+}
+
+/* Takes ownership of a record built for a font file that was just loaded */
+VOID FASTCALL
+IntAddFontMetaCache(PFONT_META_FILE File)
+{
+    ASSERT(IntIsFontMetaFileValid(File, File->Size));
+
+    if (!IntAddFontMetaNode(File, TRUE))
+    {
+        ExFreePoolWithTag(File, TAG_FONT);
+        return;
+    }
+
+    g_FontMetaDirty = TRUE;
+}
+
+/* Rewrites the cache file if the set of fonts changed, and frees the cache */
+VOID FASTCALL
+IntSaveFontMetaCache(VOID)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK Iosb;
+    FONT_META_HEADER Header;
+    PLIST_ENTRY Entry;
+    PFONT_META_NODE Node;
+    HANDLE FileHandle;
+    NTSTATUS Status;
+
+    RtlZeroMemory(&Header, sizeof(Header));
+    Header.Magic = FONT_META_MAGIC;
+    Header.Version = FONT_META_VERSION;
+    Header.LanguageID = gusLanguageID;
+    Header.TotalSize = sizeof(Header);
+
+    for (Entry = g_FontMetaList.Flink; Entry != &g_FontMetaList; Entry = Entry->Flink)
+    {
+        Node = CONTAINING_RECORD(Entry, FONT_META_NODE, ListEntry);
+        if (!Node->Used)
+        {
+            /* The file is gone or changed */
+            g_FontMetaDirty = TRUE;
+            continue;
+        }
+
+        Header.FileCount++;
+        Header.TotalSize += Node->File->Size;
+    }
+
+    if (!g_FontMetaDirty || Header.TotalSize > FONT_META_MAX_SIZE)
+    {
+        IntFreeFontMetaCache();
+        return;
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontMetaPath,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE, NULL, NULL);
+    Status = ZwCreateFile(&FileHandle,
+                          FILE_GENERIC_WRITE | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &Iosb,
+                          NULL,
+                          FILE_ATTRIBUTE_NORMAL,
+                          0,
+                          FILE_OVERWRITE_IF,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Could not write the font cache (Status 0x%lx)\n", Status);
+        IntFreeFontMetaCache();
+        return;
+    }
+
+    /* A partial write leaves a TotalSize mismatch, which discards the file */
+    Status = ZwWriteFile(FileHandle, NULL, NULL, NULL, &Iosb,
+                         &Header, sizeof(Header), NULL, NULL);
+
+    for (Entry = g_FontMetaList.Flink;
+         NT_SUCCESS(Status) && Entry != &g_FontMetaList;
+         Entry = Entry->Flink)
+    {
+        Node = CONTAINING_RECORD(Entry, FONT_META_NODE, ListEntry);
+        if (Node->Used)
+        {
+            Status = ZwWriteFile(FileHandle, NULL, NULL, NULL, &Iosb,
+                                 Node->File, Node->File->Size, NULL, NULL);
+        }
+    }
+
+    if (!NT_SUCCESS(Status))
+        DPRINT1("Could not write the font cache (Status 0x%lx)\n", Status);
+    else
+        DPRINT("Font cache written: %lu files, %lu bytes\n", Header.FileCount, Header.TotalSize);
+
+    ZwClose(FileHandle);
+    IntFreeFontMetaCache();
+}
+
+/* EOF */
@@ -88,10 +88,52 @@ static BOOL             g_RenderingEnabled = TRUE;
 #define ASSERT_FREETYPE_LOCK_NOT_HELD() \
     ASSERT(g_FreeTypeLock->Owner != KeGetCurrentThread())
 
-#define MAX_FONT_CACHE 256
+/*
+ * Rendered glyphs are looked up through a hash of their face, glyph index,
+ * height and render mode; the transform is only compared. Each shared face
+ * also chains its own glyphs so that they can be dropped with the face.
+ * The cache is bounded by the memory its bitmaps use, not by a number of
+ * entries, and the least recently used glyphs are evicted first.
+ */
+#define FONT_CACHE_HASH_SIZE 1024
+#define MAX_FONT_CACHE_SIZE (2 * 1024 * 1024)
 
 static LIST_ENTRY g_FontCacheListHead;
+static LIST_ENTRY g_FontCacheHashTable[FONT_CACHE_HASH_SIZE];
 static UINT g_FontCacheNumEntries;
+static SIZE_T g_FontCacheSize;
+static ULONG g_FontCacheHits;
+static ULONG g_FontCacheMisses;
+
+/*
+ * The global font that matched a substituted LOGFONT best is remembered, so
+ * that realizing the same LOGFONT again doesn't go through all the fonts.
+ * Protected by the global font lock, flushed when the global fonts change.
+ */
+#define FONT_MATCH_CACHE_SIZE 64
+#define FONT_MATCH_HASH_SIZE 16
+
+static LIST_ENTRY g_FontMatchListHead;
+static LIST_ENTRY g_FontMatchHashTable[FONT_MATCH_HASH_SIZE];
+static FONT_MATCH_CACHE_ENTRY g_FontMatchCache[FONT_MATCH_CACHE_SIZE];
+
+static VOID IntFlushFontMatchCache(VOID);
+
+/*
+ * The global fonts are indexed by the hash of their family and face names,
+ * which are what the face name of a LOGFONT is compared to. The fonts whose
+ * match info could not be read when they were added are kept apart. Global
+ * fonts are never removed, so the index only grows with the font list.
+ */
+#define FONT_NAME_HASH_SIZE 256
+
+static LIST_ENTRY g_FontFamilyHashTable[FONT_NAME_HASH_SIZE];
+static LIST_ENTRY g_FontFaceHashTable[FONT_NAME_HASH_SIZE];
+static LIST_ENTRY g_FontUnindexedListHead;
+static ULONG g_FontCount;
+
+static VOID IntQueryFontMatchInfo(PFONTGDI FontGDI);
+static VOID IntIndexGlobalFont(PFONT_ENTRY Entry);
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -210,21 +252,32 @@ SharedFaceCache_Init(PSHARED_FACE_CACHE Cache)
     RtlInitUnicodeString(&Cache->FullName, NULL);
 }
 
+/* Face can be NULL, for a face that is opened on first use */
 static PSHARED_FACE
-SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
+SharedFace_Create(FT_Face Face, FT_Long FaceIndex, PSHARED_MEM Memory)
 {
     PSHARED_FACE Ptr;
     Ptr = ExAllocatePoolWithTag(PagedPool, sizeof(SHARED_FACE), TAG_FONT);
     if (Ptr)
     {
         Ptr->Face = Face;
+        Ptr->FaceIndex = FaceIndex;
         Ptr->RefCount = 1;
         Ptr->Memory = Memory;
         SharedFaceCache_Init(&Ptr->EnglishUS);
         SharedFaceCache_Init(&Ptr->UserLanguage);
+        InitializeListHead(&Ptr->GlyphCacheListHead);
+
+        if (Face)
+        {
+            /* Let the glyph cache find the shared face of a FreeType face */
+            Face->generic.data = Ptr;
+            Face->generic.finalizer = NULL;
+        }
 
         SharedMem_AddRef(Memory);
-        DPRINT("Creating SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
+        DPRINT("Creating SharedFace for %s\n",
+               (Face && Face->family_name) ? Face->family_name : "<NULL>");
     }
     return Ptr;
 }
@@ -240,11 +293,126 @@ SharedMem_Create(PBYTE Buffer, ULONG BufferSize, BOOL IsMapping)
         Ptr->BufferSize = BufferSize;
         Ptr->RefCount = 1;
         Ptr->IsMapping = IsMapping;
+        Ptr->FileHandle = NULL;
         DPRINT("Creating SharedMem for %p (%i, %p)\n", Buffer, IsMapping, Ptr);
     }
     return Ptr;
 }
 
+static NTSTATUS
+IntMapFontFile(HANDLE FileHandle, PVOID *Buffer, SIZE_T *ViewSize)
+{
+    NTSTATUS Status;
+    PVOID SectionObject;
+    LARGE_INTEGER SectionSize;
+    PFILE_OBJECT FileObject;
+
+    Status = ObReferenceObjectByHandle(FileHandle, FILE_READ_DATA, NULL,
+                                       KernelMode, (PVOID*)&FileObject, NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("ObReferenceObjectByHandle failed.\n");
+        return Status;
+    }
+
+    SectionSize.QuadPart = 0LL;
+    Status = MmCreateSection(&SectionObject,
+                             STANDARD_RIGHTS_REQUIRED | SECTION_QUERY | SECTION_MAP_READ,
+                             NULL, &SectionSize, PAGE_READONLY,
+                             SEC_COMMIT, FileHandle, FileObject);
+    if (NT_SUCCESS(Status))
+    {
+        *Buffer = NULL;
+        *ViewSize = 0;
+        Status = MmMapViewInSystemSpace(SectionObject, Buffer, ViewSize);
+        ObDereferenceObject(SectionObject);
+    }
+
+    ObDereferenceObject(FileObject);
+    return Status;
+}
+
+/*
+ * Creates the shared memory of a font file that is only mapped when one of
+ * its faces is first used. It takes over FileHandle, which must not allow
+ * writers so that the file stays as it was when its metadata got cached.
+ */
+static PSHARED_MEM
+SharedMem_CreateFromFile(HANDLE FileHandle)
+{
+    PSHARED_MEM Ptr = SharedMem_Create(NULL, 0, TRUE);
+    if (Ptr)
+        Ptr->FileHandle = FileHandle;
+    return Ptr;
+}
+
+static BOOL
+SharedMem_Map(PSHARED_MEM Ptr)
+{
+    NTSTATUS Status;
+    PVOID Buffer;
+    SIZE_T ViewSize;
+
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    if (Ptr->Buffer)
+        return TRUE;
+
+    Status = IntMapFontFile(Ptr->FileHandle, &Buffer, &ViewSize);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Could not map font file (Status 0x%lx)\n", Status);
+        return FALSE;
+    }
+
+    Ptr->Buffer = Buffer;
+    Ptr->BufferSize = ViewSize;
+    ZwClose(Ptr->FileHandle);
+    Ptr->FileHandle = NULL;
+    return TRUE;
+}
+
+/* Returns the FreeType face, opening it if needed; the lock may be held or not */
+static FT_Face
+SharedFace_GetFace(PSHARED_FACE Ptr)
+{
+    FT_Error Error;
+    FT_Face Face;
+    BOOL DoLock;
+
+    if (Ptr->Face)
+        return Ptr->Face;
+
+    DoLock = (g_FreeTypeLock->Owner != KeGetCurrentThread());
+    if (DoLock)
+        IntLockFreeType();
+
+    if (!Ptr->Face && SharedMem_Map(Ptr->Memory))
+    {
+        Error = FT_New_Memory_Face(g_FreeTypeLibrary,
+                                   Ptr->Memory->Buffer,
+                                   Ptr->Memory->BufferSize,
+                                   Ptr->FaceIndex,
+                                   &Face);
+        if (!Error)
+        {
+            Face->generic.data = Ptr;
+            Face->generic.finalizer = NULL;
+            Ptr->Face = Face;
+            DPRINT("Opened SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
+        }
+        else
+        {
+            DPRINT1("Error reading font (error code: %d)\n", Error);
+        }
+    }
+
+    if (DoLock)
+        IntUnLockFreeType();
+
+    return Ptr->Face;
+}
+
 static void
 SharedFace_AddRef(PSHARED_FACE Ptr)
 {
@@ -260,30 +428,27 @@ RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
+    RemoveEntryList(&Entry->HashEntry);
+    RemoveEntryList(&Entry->FaceEntry);
+    ASSERT(g_FontCacheSize >= Entry->Size);
+    g_FontCacheSize -= Entry->Size;
     ExFreePoolWithTag(Entry, TAG_FONT);
     g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
 }
 
 static void
-RemoveCacheEntries(FT_Face Face)
+RemoveCacheEntries(PSHARED_FACE SharedFace)
 {
-    PLIST_ENTRY CurrentEntry, NextEntry;
     PFONT_CACHE_ENTRY FontEntry;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
-         CurrentEntry = NextEntry)
+    while (!IsListEmpty(&SharedFace->GlyphCacheListHead))
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        NextEntry = CurrentEntry->Flink;
-
-        if (FontEntry->Face == Face)
-        {
-            RemoveCachedEntry(FontEntry);
-        }
+        FontEntry = CONTAINING_RECORD(SharedFace->GlyphCacheListHead.Flink,
+                                      FONT_CACHE_ENTRY, FaceEntry);
+        ASSERT(FontEntry->Face == SharedFace->Face);
+        RemoveCachedEntry(FontEntry);
     }
 }
 
@@ -299,7 +464,13 @@ static void SharedMem_Release(PSHARED_MEM Ptr)
     if (Ptr->RefCount == 0)
     {
         DPRINT("Releasing SharedMem for %p (%i, %p)\n", Ptr->Buffer, Ptr->IsMapping, Ptr);
-        if (Ptr->IsMapping)
+        if (!Ptr->Buffer)
+        {
+            /* Never mapped */
+            if (Ptr->FileHandle)
+                ZwClose(Ptr->FileHandle);
+        }
+        else if (Ptr->IsMapping)
             MmUnmapViewInSystemSpace(Ptr->Buffer);
         else
             ExFreePoolWithTag(Ptr->Buffer, TAG_FONT);
@@ -326,9 +497,13 @@ SharedFace_Release(PSHARED_FACE Ptr)
     --Ptr->RefCount;
     if (Ptr->RefCount == 0)
     {
-        DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
-        RemoveCacheEntries(Ptr->Face);
-        FT_Done_Face(Ptr->Face);
+        DPRINT("Releasing SharedFace for %s\n",
+               (Ptr->Face && Ptr->Face->family_name) ? Ptr->Face->family_name : "<NULL>");
+        if (Ptr->Face)
+        {
+            RemoveCacheEntries(Ptr);
+            FT_Done_Face(Ptr->Face);
+        }
         SharedMem_Release(Ptr->Memory);
         SharedFaceCache_Release(&Ptr->EnglishUS);
         SharedFaceCache_Release(&Ptr->UserLanguage);
@@ -660,10 +835,30 @@ BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    ULONG i;
 
     InitializeListHead(&g_FontListHead);
     InitializeListHead(&g_FontCacheListHead);
+    for (i = 0; i < FONT_CACHE_HASH_SIZE; i++)
+        InitializeListHead(&g_FontCacheHashTable[i]);
     g_FontCacheNumEntries = 0;
+    g_FontCacheSize = 0;
+    InitializeListHead(&g_FontMatchListHead);
+    for (i = 0; i < FONT_MATCH_HASH_SIZE; i++)
+        InitializeListHead(&g_FontMatchHashTable[i]);
+    for (i = 0; i < FONT_MATCH_CACHE_SIZE; i++)
+    {
+        g_FontMatchCache[i].FontObj = NULL;
+        InitializeListHead(&g_FontMatchCache[i].HashEntry);
+        InsertTailList(&g_FontMatchListHead, &g_FontMatchCache[i].ListEntry);
+    }
+    for (i = 0; i < FONT_NAME_HASH_SIZE; i++)
+    {
+        InitializeListHead(&g_FontFamilyHashTable[i]);
+        InitializeListHead(&g_FontFaceHashTable[i]);
+    }
+    InitializeListHead(&g_FontUnindexedListHead);
+    g_FontCount = 0;
     /* Fast Mutexes must be allocated from non paged pool */
     g_FontListLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FontListLock == NULL)
@@ -1046,6 +1241,33 @@ IntLoadSystemFonts(VOID)
 static FT_Error
 IntRequestFontSize(PDC dc, PFONTGDI FontGDI, LONG lfWidth, LONG lfHeight);
 
+/*
+ * Returns the FreeType face of a font, opening it and computing its default
+ * metrics if the font was added from the metadata cache and not used yet.
+ */
+static FT_Face
+IntGetFontFace(PFONTGDI FontGDI)
+{
+    FT_Face Face = FontGDI->SharedFace->Face;
+    BOOL DoLock;
+
+    if (Face && FontGDI->Magic == FONTGDI_MAGIC)
+        return Face;
+
+    DoLock = (g_FreeTypeLock->Owner != KeGetCurrentThread());
+    if (DoLock)
+        IntLockFreeType();
+
+    Face = SharedFace_GetFace(FontGDI->SharedFace);
+    if (Face && FontGDI->Magic != FONTGDI_MAGIC)
+        IntRequestFontSize(NULL, FontGDI, 0, 0);
+
+    if (DoLock)
+        IntUnLockFreeType();
+
+    return Face;
+}
+
 /* NOTE: If nIndex < 0 then return the number of charsets. */
 UINT FASTCALL IntGetCharSet(INT nIndex, FT_ULong CodePageRange1)
 {
@@ -1110,7 +1332,10 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
                     &Face);
 
         if (!Error)
-            SharedFace = SharedFace_Create(Face, pLoadFont->Memory);
+        {
+            SharedFace = SharedFace_Create(Face, ((FontIndex != -1) ? FontIndex : 0),
+                                           pLoadFont->Memory);
+        }
 
         IntUnLockFreeType();
 
@@ -1343,9 +1568,13 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
     }
     else
     {
-        /* global font */
+        /* global font, its match info is needed to index it */
+        IntQueryFontMatchInfo(FontGDI);
+
         IntLockGlobalFonts();
         InsertTailList(&g_FontListHead, &Entry->ListEntry);
+        IntIndexGlobalFont(Entry);
+        IntFlushFontMatchCache();
         IntUnLockGlobalFonts();
     }
 
@@ -1446,6 +1675,234 @@ NameFromCharSet(BYTE CharSet)
     }
 }
 
+/*
+ * Adds the global fonts of a file as they were recorded in the metadata
+ * cache, without opening them. Returns the number of faces, or 0 with
+ * FileHandle left to the caller.
+ */
+static INT FASTCALL
+IntGdiLoadFontsFromCache(PUNICODE_STRING pFileName, PFONT_META_FILE File, HANDLE FileHandle)
+{
+    LIST_ENTRY ListHead;
+    PLIST_ENTRY ListEntry;
+    PFONT_ENTRY Entry, OtherEntry;
+    PFONT_META_FACE MetaFace;
+    PSHARED_MEM Memory;
+    PSHARED_FACE SharedFace;
+    FONTGDI *FontGDI;
+    UNICODE_STRING Name;
+    NTSTATUS Status;
+    INT FaceCount = 0;
+    USHORT i;
+
+    Memory = SharedMem_CreateFromFile(FileHandle);
+    if (!Memory)
+        return 0;
+
+    InitializeListHead(&ListHead);
+
+    for (i = 0, MetaFace = FONT_META_FIRST_FACE(File);
+         i < File->FaceCount;
+         i++, MetaFace = FONT_META_NEXT_FACE(MetaFace))
+    {
+        /* The charsets of a face share it */
+        SharedFace = NULL;
+        for (ListEntry = ListHead.Flink; ListEntry != &ListHead; ListEntry = ListEntry->Flink)
+        {
+            OtherEntry = CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry);
+            if (OtherEntry->Font->SharedFace->FaceIndex == MetaFace->FaceIndex)
+            {
+                SharedFace = OtherEntry->Font->SharedFace;
+                break;
+            }
+        }
+
+        IntLockFreeType();
+        if (SharedFace)
+        {
+            SharedFace_AddRef(SharedFace);
+        }
+        else
+        {
+            SharedFace = SharedFace_Create(NULL, MetaFace->FaceIndex, Memory);
+            if (SharedFace)
+                ++FaceCount;
+        }
+        IntUnLockFreeType();
+
+        if (!SharedFace)
+            break;
+
+        Entry = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_ENTRY), TAG_FONT);
+        FontGDI = EngAllocMem(FL_ZERO_MEMORY, sizeof(FONTGDI), GDITAG_RFONT);
+        if (FontGDI)
+        {
+            FontGDI->Filename = ExAllocatePoolWithTag(PagedPool,
+                                                      pFileName->Length + sizeof(UNICODE_NULL),
+                                                      GDITAG_PFF);
+        }
+        if (!Entry || !FontGDI || !FontGDI->Filename)
+        {
+            if (FontGDI && FontGDI->Filename)
+                ExFreePoolWithTag(FontGDI->Filename, GDITAG_PFF);
+            if (FontGDI)
+                EngFreeMem(FontGDI);
+            if (Entry)
+                ExFreePoolWithTag(Entry, TAG_FONT);
+            SharedFace_Release(SharedFace);
+            break;
+        }
+
+        RtlCopyMemory(FontGDI->Filename, pFileName->Buffer, pFileName->Length);
+        FontGDI->Filename[pFileName->Length / sizeof(WCHAR)] = UNICODE_NULL;
+
+        FontGDI->SharedFace = SharedFace;
+        FontGDI->CharSet = MetaFace->CharSet;
+        FontGDI->OriginalItalic = MetaFace->Italic;
+        FontGDI->RequestItalic = FALSE;
+        FontGDI->OriginalWeight = MetaFace->Weight;
+        FontGDI->RequestWeight = FW_NORMAL;
+        FontGDI->MatchInfo = MetaFace->MatchInfo;
+        FontGDI->MatchInfo.FamilyName[LF_FACESIZE - 1] = UNICODE_NULL;
+        FontGDI->MatchInfo.FaceName[LF_FACESIZE - 1] = UNICODE_NULL;
+
+        Entry->Font = FontGDI;
+        Entry->NotEnum = FALSE;
+        RtlInitUnicodeString(&Entry->FaceName, NULL);
+        RtlInitUnicodeString(&Entry->StyleName, NULL);
+
+        Name.Buffer = FONT_META_FACE_NAME(MetaFace);
+        Name.Length = MetaFace->FaceNameLength;
+        Name.MaximumLength = Name.Length + sizeof(UNICODE_NULL);
+        Status = DuplicateUnicodeString(&Name, &Entry->FaceName);
+        if (NT_SUCCESS(Status) && MetaFace->StyleNameLength)
+        {
+            Name.Buffer = FONT_META_STYLE_NAME(MetaFace);
+            Name.Length = MetaFace->StyleNameLength;
+            Name.MaximumLength = Name.Length + sizeof(UNICODE_NULL);
+            Status = DuplicateUnicodeString(&Name, &Entry->StyleName);
+        }
+        if (!NT_SUCCESS(Status))
+        {
+            CleanupFontEntry(Entry);
+            break;
+        }
+
+        InsertTailList(&ListHead, &Entry->ListEntry);
+    }
+
+    if (i < File->FaceCount)
+    {
+        /* The caller keeps the file handle */
+        Memory->FileHandle = NULL;
+
+        while (!IsListEmpty(&ListHead))
+        {
+            ListEntry = RemoveHeadList(&ListHead);
+            CleanupFontEntry(CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry));
+        }
+        FaceCount = 0;
+    }
+    else
+    {
+        IntLockGlobalFonts();
+        while (!IsListEmpty(&ListHead))
+        {
+            ListEntry = RemoveHeadList(&ListHead);
+            InsertTailList(&g_FontListHead, ListEntry);
+            IntIndexGlobalFont(CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry));
+        }
+        IntFlushFontMatchCache();
+        IntUnLockGlobalFonts();
+    }
+
+    /* Release our copy */
+    IntLockFreeType();
+    SharedMem_Release(Memory);
+    IntUnLockFreeType();
+
+    return FaceCount;
+}
+
+/*
+ * Records the global fonts that a file added after PrevEntry, for
+ * IntGdiLoadFontsFromCache to add them again at the next boot.
+ */
+static PFONT_META_FILE FASTCALL
+IntCreateFontMetaFile(PUNICODE_STRING pFileName,
+                      PFILE_NETWORK_OPEN_INFORMATION FileInfo,
+                      PLIST_ENTRY PrevEntry)
+{
+    PLIST_ENTRY ListEntry;
+    PFONT_ENTRY Entry;
+    PFONTGDI FontGDI;
+    PFONT_META_FILE File;
+    PFONT_META_FACE MetaFace;
+    ULONG Size, FaceCount = 0;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    Size = sizeof(FONT_META_FILE) + FONT_META_ALIGN(pFileName->Length);
+    for (ListEntry = PrevEntry->Flink; ListEntry != &g_FontListHead; ListEntry = ListEntry->Flink)
+    {
+        Entry = CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry);
+        FontGDI = Entry->Font;
+
+        if (!FontGDI->MatchInfo.Valid)
+            IntQueryFontMatchInfo(FontGDI);
+
+        /* Such a font could not be added from the cache as it is */
+        if (!FontGDI->MatchInfo.Valid || Entry->FaceName.Length == 0 || Entry->NotEnum)
+            return NULL;
+
+        Size += FONT_META_ALIGN(sizeof(FONT_META_FACE) +
+                                Entry->FaceName.Length + Entry->StyleName.Length);
+        ++FaceCount;
+    }
+
+    if (FaceCount == 0 || FaceCount > USHORT_MAX || pFileName->Length == 0)
+        return NULL;
+
+    File = ExAllocatePoolWithTag(PagedPool, Size, TAG_FONT);
+    if (!File)
+        return NULL;
+
+    RtlZeroMemory(File, Size);
+    File->Size = Size;
+    File->PathLength = pFileName->Length;
+    File->FaceCount = (USHORT)FaceCount;
+    File->FileSize = FileInfo->EndOfFile;
+    File->LastWriteTime = FileInfo->LastWriteTime;
+    RtlCopyMemory(FONT_META_FILE_PATH(File), pFileName->Buffer, pFileName->Length);
+
+    MetaFace = FONT_META_FIRST_FACE(File);
+    for (ListEntry = PrevEntry->Flink; ListEntry != &g_FontListHead; ListEntry = ListEntry->Flink)
+    {
+        Entry = CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry);
+        FontGDI = Entry->Font;
+
+        MetaFace->Size = FONT_META_ALIGN(sizeof(FONT_META_FACE) +
+                                         Entry->FaceName.Length + Entry->StyleName.Length);
+        MetaFace->FaceIndex = FontGDI->SharedFace->FaceIndex;
+        MetaFace->Weight = FontGDI->OriginalWeight;
+        MetaFace->CharSet = FontGDI->CharSet;
+        MetaFace->Italic = FontGDI->OriginalItalic;
+        MetaFace->FaceNameLength = Entry->FaceName.Length;
+        MetaFace->StyleNameLength = Entry->StyleName.Length;
+        MetaFace->MatchInfo = FontGDI->MatchInfo;
+        RtlCopyMemory(FONT_META_FACE_NAME(MetaFace), Entry->FaceName.Buffer, Entry->FaceName.Length);
+        if (Entry->StyleName.Length)
+        {
+            RtlCopyMemory(FONT_META_STYLE_NAME(MetaFace), Entry->StyleName.Buffer,
+                          Entry->StyleName.Length);
+        }
+
+        MetaFace = FONT_META_NEXT_FACE(MetaFace);
+    }
+
+    return File;
+}
+
 /*
  * IntGdiAddFontResource
  *
@@ -1460,16 +1917,16 @@ IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
     HANDLE FileHandle;
     PVOID Buffer = NULL;
     IO_STATUS_BLOCK Iosb;
-    PVOID SectionObject;
     SIZE_T ViewSize = 0, Length;
-    LARGE_INTEGER SectionSize;
     OBJECT_ATTRIBUTES ObjectAttributes;
     GDI_LOAD_FONT LoadFont;
     INT FontCount;
     HANDLE KeyHandle;
     UNICODE_STRING PathName;
     LPWSTR pszBuffer;
-    PFILE_OBJECT FileObject;
+    FILE_NETWORK_OPEN_INFORMATION FileInfo;
+    PFONT_META_FILE MetaFile = NULL;
+    PLIST_ENTRY PrevEntry = NULL;
     static const UNICODE_STRING TrueTypePostfix = RTL_CONSTANT_STRING(L" (TrueType)");
     static const UNICODE_STRING DosPathPrefix = RTL_CONSTANT_STRING(L"\\??\\");
 
@@ -1509,37 +1966,39 @@ IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
         return 0;
     }
 
-    Status = ObReferenceObjectByHandle(FileHandle, FILE_READ_DATA, NULL,
-                                       KernelMode, (PVOID*)&FileObject, NULL);
-    if (!NT_SUCCESS(Status))
+    /* The metadata cache can't give what the registry needs */
+    if ((dwFlags & (AFRX_META_CACHE | AFRX_WRITE_REGISTRY)) == AFRX_META_CACHE)
     {
-        DPRINT1("ObReferenceObjectByHandle failed.\n");
-        ZwClose(FileHandle);
-        RtlFreeUnicodeString(&PathName);
-        return 0;
+        Status = ZwQueryInformationFile(FileHandle, &Iosb, &FileInfo, sizeof(FileInfo),
+                                        FileNetworkOpenInformation);
+        if (NT_SUCCESS(Status))
+        {
+            MetaFile = IntLookupFontMetaCache(&PathName, &FileInfo);
+            if (MetaFile)
+            {
+                /* Add the fonts without reading the file, it stays open until they are used */
+                FontCount = IntGdiLoadFontsFromCache(&PathName, MetaFile, FileHandle);
+                if (FontCount > 0)
+                {
+                    RtlFreeUnicodeString(&PathName);
+                    return FontCount;
+                }
+            }
+            else
+            {
+                /* Remember where the fonts of this file start, to cache them */
+                IntLockGlobalFonts();
+                PrevEntry = g_FontListHead.Blink;
+                IntUnLockGlobalFonts();
+            }
+        }
     }
 
-    SectionSize.QuadPart = 0LL;
-    Status = MmCreateSection(&SectionObject,
-                             STANDARD_RIGHTS_REQUIRED | SECTION_QUERY | SECTION_MAP_READ,
-                             NULL, &SectionSize, PAGE_READONLY,
-                             SEC_COMMIT, FileHandle, FileObject);
-    if (!NT_SUCCESS(Status))
-    {
-        DPRINT1("Could not map file: %wZ\n", &PathName);
-        ZwClose(FileHandle);
-        ObDereferenceObject(FileObject);
-        RtlFreeUnicodeString(&PathName);
-        return 0;
-    }
+    Status = IntMapFontFile(FileHandle, &Buffer, &ViewSize);
     ZwClose(FileHandle);
-
-    Status = MmMapViewInSystemSpace(SectionObject, &Buffer, &ViewSize);
     if (!NT_SUCCESS(Status))
     {
         DPRINT1("Could not map file: %wZ\n", &PathName);
-        ObDereferenceObject(SectionObject);
-        ObDereferenceObject(FileObject);
         RtlFreeUnicodeString(&PathName);
         return 0;
     }
@@ -1558,9 +2017,15 @@ IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
     SharedMem_Release(LoadFont.Memory);
     IntUnLockFreeType();
 
-    ObDereferenceObject(SectionObject);
+    if (FontCount > 0 && PrevEntry)
+    {
+        IntLockGlobalFonts();
+        MetaFile = IntCreateFontMetaFile(&PathName, &FileInfo, PrevEntry);
+        IntUnLockGlobalFonts();
 
-    ObDereferenceObject(FileObject);
+        if (MetaFile)
+            IntAddFontMetaCache(MetaFile);
+    }
 
     /* Save the loaded font name into the registry */
     if (FontCount > 0 && (dwFlags & AFRX_WRITE_REGISTRY))
@@ -1716,6 +2181,9 @@ IntLoadFontsInRegistry(VOID)
         return FALSE;
     }
 
+    /* The cached metadata spares reading the fonts that didn't change */
+    IntLoadFontMetaCache();
+
     /* for each value */
     for (i = 0; i < KeyFullInfo.Values; ++i)
     {
@@ -1789,13 +2257,13 @@ IntLoadFontsInRegistry(VOID)
         /* Load font(s) without writing registry */
         if (PathIsRelativeW(pchPath))
         {
-            dwFlags = 0;
+            dwFlags = AFRX_META_CACHE;
             Status = RtlStringCbPrintfW(szPath, sizeof(szPath),
                                         L"\\SystemRoot\\Fonts\\%s", pchPath);
         }
         else
         {
-            dwFlags = AFRX_ALTERNATIVE_PATH | AFRX_DOS_DEVICE_PATH;
+            dwFlags = AFRX_ALTERNATIVE_PATH | AFRX_DOS_DEVICE_PATH | AFRX_META_CACHE;
             Status = RtlStringCbCopyW(szPath, sizeof(szPath), pchPath);
         }
 
@@ -1809,6 +2277,9 @@ IntLoadFontsInRegistry(VOID)
         RtlFreeUnicodeString(&FontTitleW);
     }
 
+    /* Keep the metadata of the fonts that were loaded for the next boot */
+    IntSaveFontMetaCache();
+
     /* close now */
     ZwClose(KeyHandle);
 
@@ -1871,7 +2342,7 @@ IntGdiAddFontMemResource(PVOID Buffer, DWORD dwSize, PDWORD pNumAdded)
     return Ret;
 }
 
-// FIXME: Add RemoveFontResource
+// FIXME: Add RemoveFontResource (for global fonts, it has to unlink them from the name index and call IntFlushFontMatchCache)
 
 VOID FASTCALL
 IntGdiCleanupMemEntry(PFONT_ENTRY_MEM Head)
@@ -2135,7 +2606,7 @@ FillTM(TEXTMETRICW *TM, PFONTGDI FontGDI,
 {
     FT_Fixed XScale, YScale;
     int Ascent, Descent;
-    FT_Face Face = FontGDI->SharedFace->Face;
+    FT_Face Face = IntGetFontFace(FontGDI);
 
     ASSERT_FREETYPE_LOCK_HELD();
 
@@ -2444,7 +2915,7 @@ IntGetOutlineTextMetrics(PFONTGDI FontGDI,
     FONT_NAMES FontNames;
     PSHARED_FACE SharedFace = FontGDI->SharedFace;
     PSHARED_FACE_CACHE Cache;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
 
     if (PRIMARYLANGID(gusLanguageID) == LANG_ENGLISH)
     {
@@ -2461,6 +2932,10 @@ IntGetOutlineTextMetrics(PFONTGDI FontGDI,
         return Cache->OutlineRequiredSize;
     }
 
+    Face = IntGetFontFace(FontGDI);
+    if (!Face)
+        return 0;   /* failure */
+
     IntInitFontNames(&FontNames, SharedFace);
     Cache->OutlineRequiredSize = FontNames.OtmSize;
 
@@ -2644,7 +3119,7 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
     NTSTATUS Status = STATUS_NOT_FOUND;
     ANSI_STRING AnsiName;
     PSHARED_FACE_CACHE Cache;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
 
     RtlFreeUnicodeString(pNameW);
 
@@ -2668,6 +3143,10 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
         return DuplicateUnicodeString(&Cache->FullName, pNameW);
     }
 
+    Face = SharedFace_GetFace(SharedFace);
+    if (!Face)
+        return Status;
+
     BestIndex = -1;
     BestScore = 0;
 
@@ -2811,11 +3290,16 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     DWORD fs0;
     NTSTATUS status;
     PSHARED_FACE SharedFace = FontGDI->SharedFace;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
     UNICODE_STRING NameW;
 
     RtlInitUnicodeString(&NameW, NULL);
     RtlZeroMemory(Info, sizeof(FONTFAMILYINFO));
+    Face = IntGetFontFace(FontGDI);
+    if (!Face)
+    {
+        return;
+    }
     Size = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
     Otm = ExAllocatePoolWithTag(PagedPool, Size, GDITAG_TEXT);
     if (!Otm)
@@ -3004,6 +3488,18 @@ GetFontFamilyInfoForList(const LOGFONTW *LogFont,
             continue;   /* charset mismatch */
         }
 
+        if (LogFont->lfFaceName[0] != UNICODE_NULL && FontGDI->MatchInfo.Valid)
+        {
+            /* rule out the other families without opening the font */
+            if (_wcsnicmp(LogFont->lfFaceName, FontGDI->MatchInfo.FamilyName,
+                          RTL_NUMBER_OF(LogFont->lfFaceName) - 1) != 0 &&
+                _wcsnicmp(LogFont->lfFaceName, FontGDI->MatchInfo.FaceName,
+                          RTL_NUMBER_OF(LogFont->lfFaceName) - 1) != 0)
+            {
+                continue;
+            }
+        }
+
         /* get one info entry */
         FontFamilyFillInfo(&InfoEntry, NULL, NULL, FontGDI);
 
@@ -3130,6 +3626,22 @@ SameScaleMatrix(
             FLOATOBJ_Equal(&pmx1->efM22, &pmx2->efM22));
 }
 
+static ULONG
+FontCacheHash(
+    FT_Face Face,
+    INT GlyphIndex,
+    INT Height,
+    FT_Render_Mode RenderMode)
+{
+    ULONG Hash;
+
+    Hash = (ULONG)((ULONG_PTR)Face >> 4);
+    Hash = Hash * 31 + (ULONG)GlyphIndex;
+    Hash = Hash * 31 + (ULONG)Height;
+    Hash = Hash * 31 + (ULONG)RenderMode;
+    return Hash ^ (Hash >> 16);
+}
+
 FT_BitmapGlyph APIENTRY
 ftGdiGlyphCacheGet(
     FT_Face Face,
@@ -3138,17 +3650,22 @@ ftGdiGlyphCacheGet(
     FT_Render_Mode RenderMode,
     PMATRIX pmx)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, BucketHead;
     PFONT_CACHE_ENTRY FontEntry;
+    ULONG Hash;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    Hash = FontCacheHash(Face, GlyphIndex, Height, RenderMode);
+    BucketHead = &g_FontCacheHashTable[Hash % FONT_CACHE_HASH_SIZE];
+
+    for (CurrentEntry = BucketHead->Flink;
+         CurrentEntry != BucketHead;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        if ((FontEntry->Face == Face) &&
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
+        if ((FontEntry->Hash == Hash) &&
+            (FontEntry->Face == Face) &&
             (FontEntry->GlyphIndex == GlyphIndex) &&
             (FontEntry->Height == Height) &&
             (FontEntry->RenderMode == RenderMode) &&
@@ -3156,13 +3673,17 @@ ftGdiGlyphCacheGet(
             break;
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == BucketHead)
     {
+        g_FontCacheMisses++;
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
+    g_FontCacheHits++;
+
+    /* Keep the most recently used glyphs away from eviction */
+    RemoveEntryList(&FontEntry->ListEntry);
+    InsertHeadList(&g_FontCacheListHead, &FontEntry->ListEntry);
     return FontEntry->BitmapGlyph;
 }
 
@@ -3219,11 +3740,13 @@ ftGdiGlyphCacheSet(
 {
     FT_Glyph GlyphCopy;
     INT error;
-    PFONT_CACHE_ENTRY NewEntry;
+    PFONT_CACHE_ENTRY NewEntry, OldEntry;
+    PSHARED_FACE SharedFace = Face->generic.data;
     FT_Bitmap AlignedBitmap;
     FT_BitmapGlyph BitmapGlyph;
 
     ASSERT_FREETYPE_LOCK_HELD();
+    ASSERT(SharedFace != NULL && SharedFace->Face == Face);
 
     error = FT_Get_Glyph(GlyphSlot, &GlyphCopy);
     if (error)
@@ -3268,12 +3791,31 @@ ftGdiGlyphCacheSet(
     NewEntry->Height = Height;
     NewEntry->RenderMode = RenderMode;
     NewEntry->mxWorldToDevice = *pmx;
+    NewEntry->Hash = FontCacheHash(Face, GlyphIndex, Height, RenderMode);
+    NewEntry->Size = sizeof(FONT_CACHE_ENTRY) +
+                     (SIZE_T)abs(BitmapGlyph->bitmap.pitch) * BitmapGlyph->bitmap.rows;
+
+    /*
+     * Make room first, so that the new glyph is never the one evicted. The
+     * most recently used glyph stays too, as the caller might still hold it.
+     */
+    while (g_FontCacheListHead.Blink != g_FontCacheListHead.Flink &&
+           g_FontCacheSize + NewEntry->Size > MAX_FONT_CACHE_SIZE)
+    {
+        OldEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
+        RemoveCachedEntry(OldEntry);
+    }
 
     InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
+    InsertHeadList(&g_FontCacheHashTable[NewEntry->Hash % FONT_CACHE_HASH_SIZE], &NewEntry->HashEntry);
+    InsertTailList(&SharedFace->GlyphCacheListHead, &NewEntry->FaceEntry);
+    g_FontCacheSize += NewEntry->Size;
+    g_FontCacheNumEntries++;
+
+    if ((g_FontCacheMisses & 0xFFF) == 0)
     {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
+        DPRINT("Glyph cache: %u entries, %Iu bytes, %lu hits, %lu misses\n",
+               g_FontCacheNumEntries, g_FontCacheSize, g_FontCacheHits, g_FontCacheMisses);
     }
 
     return BitmapGlyph;
@@ -3482,7 +4024,7 @@ IntRequestFontSize(PDC dc, PFONTGDI FontGDI, LONG lfWidth, LONG lfHeight)
 {
     FT_Error error;
     FT_Size_RequestRec  req;
-    FT_Face face = FontGDI->SharedFace->Face;
+    FT_Face face;
     TT_OS2 *pOS2;
     TT_HoriHeader *pHori;
     FT_WinFNT_HeaderRec WinFNT;
@@ -3506,6 +4048,10 @@ IntRequestFontSize(PDC dc, PFONTGDI FontGDI, LONG lfWidth, LONG lfHeight)
         lfHeight = -2;
 
     ASSERT_FREETYPE_LOCK_HELD();
+    face = SharedFace_GetFace(FontGDI->SharedFace);
+    if (!face)
+        return FT_Err_Invalid_Face_Handle;
+
     pOS2 = (TT_OS2 *)FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
     pHori = (TT_HoriHeader *)FT_Get_Sfnt_Table(face, FT_SFNT_HHEA);
 
@@ -3609,7 +4155,15 @@ TextIntUpdateSize(PDC dc,
     if (bDoLock)
         IntLockFreeType();
 
-    face = FontGDI->SharedFace->Face;
+    face = IntGetFontFace(FontGDI);
+    if (!face)
+    {
+        /* The font file could not be opened again */
+        if (bDoLock)
+            IntUnLockFreeType();
+        return FALSE;
+    }
+
     if (face->charmap == NULL)
     {
         DPRINT("WARNING: No charmap selected!\n");
@@ -3786,7 +4340,12 @@ ftGdiGetGlyphOutline(
         return GDI_ERROR;
     }
     FontGDI = ObjToGDI(TextObj->Font, FONT);
-    ft_face = FontGDI->SharedFace->Face;
+    ft_face = IntGetFontFace(FontGDI);
+    if (!ft_face)
+    {
+        TEXTOBJ_UnlockText(TextObj);
+        return GDI_ERROR;
+    }
 
     plf = &TextObj->logfont.elfEnumLogfontEx.elfLogFont;
     aveWidth = FT_IS_SCALABLE(ft_face) ? abs(plf->lfWidth) : 0;
@@ -4241,12 +4800,15 @@ TextIntGetTextExtentPoint(PDC dc,
 
     FontGDI = ObjToGDI(TextObj->Font, FONT);
 
-    face = FontGDI->SharedFace->Face;
     if (NULL != Fit)
     {
         *Fit = 0;
     }
 
+    face = IntGetFontFace(FontGDI);
+    if (!face)
+        return FALSE;
+
     IntLockFreeType();
 
     TextIntUpdateSize(dc, TextObj, FontGDI, FALSE);
@@ -4386,8 +4948,10 @@ ftGdiGetTextCharsetInfo(
         return Ret;
     }
     FontGdi = ObjToGDI(TextObj->Font, FONT);
-    Face = FontGdi->SharedFace->Face;
+    Face = IntGetFontFace(FontGdi);
     TEXTOBJ_UnlockText(TextObj);
+    if (!Face)
+        return Ret;
 
     memset(&fs, 0, sizeof(FONTSIGNATURE));
     IntLockFreeType();
@@ -4475,7 +5039,10 @@ ftGetFontUnicodeRanges(PFONTGDI Font, PGLYPHSET glyphset)
 {
     DWORD size = 0;
     DWORD num_ranges = 0;
-    FT_Face face = Font->SharedFace->Face;
+    FT_Face face = IntGetFontFace(Font);
+
+    if (!face)
+        return 0;
 
     if (face->charmap->encoding == FT_ENCODING_UNICODE)
     {
@@ -4574,12 +5141,19 @@ ftGdiGetTextMetricsW(
         plf = &TextObj->logfont.elfEnumLogfontEx.elfLogFont;
         FontGDI = ObjToGDI(TextObj->Font, FONT);
 
-        Face = FontGDI->SharedFace->Face;
-
-        IntLockFreeType();
-        Error = IntRequestFontSize(dc, FontGDI, plf->lfWidth, plf->lfHeight);
-        FtSetCoordinateTransform(Face, DC_pmxWorldToDevice(dc));
-        IntUnLockFreeType();
+        Face = IntGetFontFace(FontGDI);
+        if (!Face)
+        {
+            /* The font file could not be opened again */
+            Error = FT_Err_Invalid_Face_Handle;
+        }
+        else
+        {
+            IntLockFreeType();
+            Error = IntRequestFontSize(dc, FontGDI, plf->lfWidth, plf->lfHeight);
+            FtSetCoordinateTransform(Face, DC_pmxWorldToDevice(dc));
+            IntUnLockFreeType();
+        }
 
         if (0 != Error)
         {
@@ -4588,7 +5162,6 @@ ftGdiGetTextMetricsW(
         }
         else
         {
-            FT_Face Face = FontGDI->SharedFace->Face;
             Status = STATUS_SUCCESS;
 
             IntLockFreeType();
@@ -4643,7 +5216,10 @@ ftGdiGetFontData(
     DWORD Size)
 {
     DWORD Result = GDI_ERROR;
-    FT_Face Face = FontGdi->SharedFace->Face;
+    FT_Face Face = IntGetFontFace(FontGdi);
+
+    if (!Face)
+        return Result;
 
     IntLockFreeType();
 
@@ -5022,70 +5598,497 @@ GetFontPenalty(const LOGFONTW *               LogFont,
 
 #undef GOT_PENALTY
 
-static __inline VOID
-FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
-                     const LOGFONTW *LogFont,
-                     const PLIST_ENTRY Head)
+static ULONG
+IntFontNameHash(const WCHAR *Name)
 {
-    ULONG Penalty;
-    PLIST_ENTRY Entry;
-    PFONT_ENTRY CurrentEntry;
-    FONTGDI *FontGDI;
-    OUTLINETEXTMETRICW *Otm = NULL;
-    UINT OtmSize, OldOtmSize = 0;
-    FT_Face Face;
+    ULONG Hash = 0;
+    ULONG i;
+
+    /* Fold the case like _wcsicmp does, so that equal names hash equally */
+    for (i = 0; i < LF_FACESIZE - 1 && Name[i] != UNICODE_NULL; i++)
+        Hash = Hash * 31 + towlower(Name[i]);
+
+    return Hash;
+}
+
+static VOID
+IntInitFontMatchInfo(PFONT_MATCH_INFO Info, const OUTLINETEXTMETRICW *Otm)
+{
+    const WCHAR *Name;
+
+    Info->CharSet = Otm->otmTextMetrics.tmCharSet;
+    Info->PitchAndFamily = Otm->otmTextMetrics.tmPitchAndFamily;
+
+    /* Longer names can't match a LOGFONT anyway */
+    Name = (const WCHAR *)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName);
+    RtlStringCchCopyW(Info->FamilyName, _countof(Info->FamilyName), Name);
+    Info->FamilyHash = IntFontNameHash(Info->FamilyName);
+
+    Name = (const WCHAR *)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFaceName);
+    RtlStringCchCopyW(Info->FaceName, _countof(Info->FaceName), Name);
+    Info->FaceHash = IntFontNameHash(Info->FaceName);
+
+    Info->Valid = TRUE;
+}
+
+/* Reads the match info of a font from its metrics, it stays invalid on failure */
+static VOID
+IntQueryFontMatchInfo(PFONTGDI FontGDI)
+{
+    OUTLINETEXTMETRICW *Otm;
+    ULONG OtmSize;
+
+    OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
+    Otm = (OtmSize ? ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT) : NULL);
+    if (!Otm)
+        return;
+
+    if (IntGetOutlineTextMetrics(FontGDI, OtmSize, Otm))
+        IntInitFontMatchInfo(&FontGDI->MatchInfo, Otm);
 
+    ExFreePoolWithTag(Otm, GDITAG_TEXT);
+}
+
+static VOID
+IntIndexGlobalFont(PFONT_ENTRY Entry)
+{
+    PFONT_MATCH_INFO Info = &Entry->Font->MatchInfo;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    Entry->Order = g_FontCount++;
+    InitializeListHead(&Entry->FaceEntry);
+
+    if (!Info->Valid)
+    {
+        InsertTailList(&g_FontUnindexedListHead, &Entry->FamilyEntry);
+        return;
+    }
+
+    InsertTailList(&g_FontFamilyHashTable[Info->FamilyHash % FONT_NAME_HASH_SIZE],
+                   &Entry->FamilyEntry);
+
+    /* A font whose names are the same is only found through its family */
+    if (Info->FaceHash != Info->FamilyHash || _wcsicmp(Info->FaceName, Info->FamilyName) != 0)
+    {
+        InsertTailList(&g_FontFaceHashTable[Info->FaceHash % FONT_NAME_HASH_SIZE],
+                       &Entry->FaceEntry);
+    }
+}
+
+static __inline BOOL
+IntFontNameMatches(const WCHAR *Name, ULONG Hash, const LOGFONTW *LogFont, ULONG NameHash)
+{
+    return Hash == NameHash && _wcsicmp(LogFont->lfFaceName, Name) == 0;
+}
+
+/* What GetFontPenalty charges a font for the face name of a LOGFONT it doesn't have */
+#define FONT_NAME_MISMATCH_PENALTY  10000
+
+/*
+ * Returns the part of GetFontPenalty that doesn't depend on the requested
+ * size nor on the last realization of the font. The full penalty can only
+ * be greater or equal.
+ */
+static ULONG
+IntFontMatchLowerBound(const FONT_MATCH_INFO *Info, const LOGFONTW *LogFont, ULONG NameHash)
+{
+    ULONG Penalty = 0;
+    BYTE Byte;
+    const BYTE UserCharSet = CharSetFromLangID(gusLanguageID);
+
+    Byte = LogFont->lfCharSet;
+    if (Byte != Info->CharSet)
+    {
+        if (Byte != DEFAULT_CHARSET && Byte != ANSI_CHARSET)
+        {
+            Penalty += 65000;
+        }
+        else if (UserCharSet != Info->CharSet)
+        {
+            Penalty += 100;
+            if (ANSI_CHARSET != Info->CharSet)
+                Penalty += 100;
+        }
+    }
+
+    switch (LogFont->lfOutPrecision)
+    {
+        case OUT_DEFAULT_PRECIS:
+            break;
+        case OUT_DEVICE_PRECIS:
+            if (!(Info->PitchAndFamily & TMPF_DEVICE) ||
+                !(Info->PitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE)))
+            {
+                Penalty += 19000;
+            }
+            break;
+        default:
+            if (Info->PitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE))
+                Penalty += 19000;
+            break;
+    }
+
+    Byte = (LogFont->lfPitchAndFamily & 0x0F);
+    if (Byte == FIXED_PITCH && (Info->PitchAndFamily & _TMPF_VARIABLE_PITCH))
+        Penalty += 15000;
+    if ((Byte == DEFAULT_PITCH || Byte == VARIABLE_PITCH) &&
+        !(Info->PitchAndFamily & _TMPF_VARIABLE_PITCH))
+    {
+        Penalty += 350;
+        if (Byte == DEFAULT_PITCH)
+            Penalty += 1;
+    }
+
+    if (LogFont->lfFaceName[0] != UNICODE_NULL &&
+        !IntFontNameMatches(Info->FamilyName, Info->FamilyHash, LogFont, NameHash) &&
+        !IntFontNameMatches(Info->FaceName, Info->FaceHash, LogFont, NameHash))
+    {
+        Penalty += FONT_NAME_MISMATCH_PENALTY;
+    }
+
+    Byte = (LogFont->lfPitchAndFamily & 0xF0);
+    if (Byte != FF_DONTCARE && Byte != (Info->PitchAndFamily & 0xF0))
+        Penalty += 9000;
+    if ((Info->PitchAndFamily & 0xF0) == FF_DONTCARE)
+        Penalty += 8000;
+
+    switch (LogFont->lfPitchAndFamily & 0xF0)
+    {
+        case FF_ROMAN: case FF_MODERN: case FF_SWISS:
+            switch (Info->PitchAndFamily & 0xF0)
+            {
+                case FF_DECORATIVE: case FF_SCRIPT:
+                    Penalty += 50;
+                    break;
+            }
+            break;
+        case FF_DECORATIVE: case FF_SCRIPT:
+            switch (Info->PitchAndFamily & 0xF0)
+            {
+                case FF_ROMAN: case FF_MODERN: case FF_SWISS:
+                    Penalty += 50;
+                    break;
+            }
+            break;
+    }
+
+    if (LogFont->lfOutPrecision == OUT_TT_PRECIS && !(Info->PitchAndFamily & TMPF_TRUETYPE))
+        Penalty += 4;
+
+    if (!(Info->PitchAndFamily & TMPF_DEVICE))
+        Penalty += 2;
+
+    return Penalty;
+}
+
+/*
+ * The fonts that can't beat the best match so far are ruled out from their
+ * match info, without getting their metrics at the requested size. To get a
+ * good match early, the fonts with the lowest bound are tried first. Between
+ * fonts with the same penalty, the first one in the list still wins.
+ */
+typedef struct _FONT_MATCH_SEARCH
+{
+    const LOGFONTW *LogFont;
+    ULONG NameHash;
+    ULONG MinBound;
+    FONTOBJ **FontObj;
+    ULONG *MatchPenalty;
+    LONG BestIndex;
+    OUTLINETEXTMETRICW *Otm;
+    UINT OtmSize;
+} FONT_MATCH_SEARCH, *PFONT_MATCH_SEARCH;
+
+/* The bounds of the fonts are computed first, then the fonts of the lowest
+ * bound and those without match info are tried, and finally the others */
+#define FONT_MATCH_PASS_BOUND   0
+#define FONT_MATCH_PASS_BEST    1
+#define FONT_MATCH_PASS_OTHERS  2
+#define FONT_MATCH_PASSES       3
+
+static VOID
+IntInitFontMatchSearch(PFONT_MATCH_SEARCH Search, FONTOBJ **FontObj, ULONG *MatchPenalty,
+                       const LOGFONTW *LogFont)
+{
     ASSERT(FontObj);
     ASSERT(MatchPenalty);
     ASSERT(LogFont);
-    ASSERT(Head);
+
+    Search->LogFont = LogFont;
+    Search->NameHash = IntFontNameHash(LogFont->lfFaceName);
+    Search->MinBound = MAXULONG;
+    Search->FontObj = FontObj;
+    Search->MatchPenalty = MatchPenalty;
+    Search->BestIndex = -1;
 
     /* Start with a pretty big buffer */
-    OldOtmSize = 0x200;
-    Otm = ExAllocatePoolWithTag(PagedPool, OldOtmSize, GDITAG_TEXT);
+    Search->Otm = ExAllocatePoolWithTag(PagedPool, 0x200, GDITAG_TEXT);
+    Search->OtmSize = (Search->Otm ? 0x200 : 0);
+}
 
-    /* get the FontObj of lowest penalty */
-    for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
+static VOID
+IntCleanupFontMatchSearch(PFONT_MATCH_SEARCH Search)
+{
+    if (Search->Otm)
+        ExFreePoolWithTag(Search->Otm, GDITAG_TEXT);
+}
+
+static __inline BOOL
+IntFontMatchPassNeeded(PFONT_MATCH_SEARCH Search, ULONG Pass)
+{
+    /* Without any match info yet, every font was tried once */
+    return Pass != FONT_MATCH_PASS_OTHERS || Search->MinBound != MAXULONG;
+}
+
+static VOID
+IntTryFontMatch(PFONT_MATCH_SEARCH Search, PFONT_ENTRY Entry, ULONG Index, ULONG Pass)
+{
+    FONTGDI *FontGDI = Entry->Font;
+    ULONG Penalty, Bound;
+    UINT OtmSize;
+    FT_Face Face;
+
+    ASSERT(FontGDI);
+
+    if (FontGDI->MatchInfo.Valid)
     {
-        CurrentEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, ListEntry);
+        Bound = IntFontMatchLowerBound(&FontGDI->MatchInfo, Search->LogFont, Search->NameHash);
+        if (Pass == FONT_MATCH_PASS_BOUND)
+        {
+            Search->MinBound = min(Search->MinBound, Bound);
+            return;
+        }
 
-        FontGDI = CurrentEntry->Font;
-        ASSERT(FontGDI);
-        Face = FontGDI->SharedFace->Face;
+        if ((Pass == FONT_MATCH_PASS_BEST) != (Bound == Search->MinBound))
+            return;
 
-        /* get text metrics */
-        OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
-        if (OtmSize > OldOtmSize)
+        if (*Search->MatchPenalty != 0xFFFFFFFF &&
+            (Bound > *Search->MatchPenalty ||
+             (Bound == *Search->MatchPenalty && (LONG)Index > Search->BestIndex)))
         {
-            if (Otm)
-                ExFreePoolWithTag(Otm, GDITAG_TEXT);
-            Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+            return;
         }
+    }
+    else if (Pass != FONT_MATCH_PASS_BEST)
+    {
+        return;
+    }
+
+    /* Only now open the fonts that were added from the metadata cache */
+    Face = IntGetFontFace(FontGDI);
+    if (!Face)
+        return;
+
+    /* get text metrics */
+    OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
+    if (OtmSize > Search->OtmSize)
+    {
+        if (Search->Otm)
+            ExFreePoolWithTag(Search->Otm, GDITAG_TEXT);
+        Search->Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+        Search->OtmSize = (Search->Otm ? OtmSize : 0);
+    }
+
+    /* update FontObj if lowest penalty */
+    if (Search->Otm)
+    {
+        IntLockFreeType();
+        IntRequestFontSize(NULL, FontGDI, Search->LogFont->lfWidth, Search->LogFont->lfHeight);
+        IntUnLockFreeType();
+
+        OtmSize = IntGetOutlineTextMetrics(FontGDI, Search->OtmSize, Search->Otm);
+        if (!OtmSize)
+            return;
+
+        if (!FontGDI->MatchInfo.Valid)
+            IntInitFontMatchInfo(&FontGDI->MatchInfo, Search->Otm);
 
-        /* update FontObj if lowest penalty */
-        if (Otm)
+        Penalty = GetFontPenalty(Search->LogFont, Search->Otm, Face->style_name);
+        if (*Search->MatchPenalty == 0xFFFFFFFF || Penalty < *Search->MatchPenalty ||
+            (Penalty == *Search->MatchPenalty && (LONG)Index < Search->BestIndex))
         {
-            IntLockFreeType();
-            IntRequestFontSize(NULL, FontGDI, LogFont->lfWidth, LogFont->lfHeight);
-            IntUnLockFreeType();
+            *Search->FontObj = GDIToObj(FontGDI, FONT);
+            *Search->MatchPenalty = Penalty;
+            Search->BestIndex = (LONG)Index;
+        }
+    }
+}
 
-            OtmSize = IntGetOutlineTextMetrics(FontGDI, OtmSize, Otm);
-            if (!OtmSize)
-                continue;
+static __inline VOID
+FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
+                     const LOGFONTW *LogFont,
+                     const PLIST_ENTRY Head)
+{
+    FONT_MATCH_SEARCH Search;
+    PLIST_ENTRY Entry;
+    ULONG Index, Pass;
+
+    ASSERT(Head);
+
+    IntInitFontMatchSearch(&Search, FontObj, MatchPenalty, LogFont);
+
+    /* get the FontObj of lowest penalty */
+    for (Pass = 0; Pass < FONT_MATCH_PASSES && IntFontMatchPassNeeded(&Search, Pass); Pass++)
+    {
+        for (Entry = Head->Flink, Index = 0; Entry != Head; Entry = Entry->Flink, Index++)
+        {
+            IntTryFontMatch(&Search, CONTAINING_RECORD(Entry, FONT_ENTRY, ListEntry), Index, Pass);
+        }
+    }
+
+    IntCleanupFontMatchSearch(&Search);
+}
+
+/*
+ * With a face name, the global fonts of that name are first found through
+ * the name index, along with the unindexed ones. Any other font is charged
+ * the name mismatch, so the list only has to be gone through when none of
+ * them matched better than that. The order of the fonts in the list breaks
+ * the ties, as in FindBestFontFromList.
+ */
+static VOID
+FindBestGlobalFont(FONTOBJ **FontObj, ULONG *MatchPenalty, const LOGFONTW *LogFont)
+{
+    FONT_MATCH_SEARCH Search;
+    FONTOBJ *OldFontObj = *FontObj;
+    ULONG OldMatchPenalty = *MatchPenalty;
+    PLIST_ENTRY Head, Entry;
+    PFONT_ENTRY FontEntry;
+    PFONT_MATCH_INFO Info;
+    ULONG Pass;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    if (LogFont->lfFaceName[0] != UNICODE_NULL)
+    {
+        IntInitFontMatchSearch(&Search, FontObj, MatchPenalty, LogFont);
+
+        for (Pass = 0; Pass < FONT_MATCH_PASSES && IntFontMatchPassNeeded(&Search, Pass); Pass++)
+        {
+            Head = &g_FontFamilyHashTable[Search.NameHash % FONT_NAME_HASH_SIZE];
+            for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
+            {
+                FontEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, FamilyEntry);
+                Info = &FontEntry->Font->MatchInfo;
+                if (IntFontNameMatches(Info->FamilyName, Info->FamilyHash, LogFont, Search.NameHash))
+                    IntTryFontMatch(&Search, FontEntry, FontEntry->Order, Pass);
+            }
 
-            OldOtmSize = OtmSize;
+            Head = &g_FontFaceHashTable[Search.NameHash % FONT_NAME_HASH_SIZE];
+            for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
+            {
+                FontEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, FaceEntry);
+                Info = &FontEntry->Font->MatchInfo;
+                if (IntFontNameMatches(Info->FaceName, Info->FaceHash, LogFont, Search.NameHash))
+                    IntTryFontMatch(&Search, FontEntry, FontEntry->Order, Pass);
+            }
 
-            Penalty = GetFontPenalty(LogFont, Otm, Face->style_name);
-            if (*MatchPenalty == 0xFFFFFFFF || Penalty < *MatchPenalty)
+            for (Entry = g_FontUnindexedListHead.Flink;
+                 Entry != &g_FontUnindexedListHead;
+                 Entry = Entry->Flink)
             {
-                *FontObj = GDIToObj(FontGDI, FONT);
-                *MatchPenalty = Penalty;
+                FontEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, FamilyEntry);
+                IntTryFontMatch(&Search, FontEntry, FontEntry->Order, Pass);
             }
         }
+
+        IntCleanupFontMatchSearch(&Search);
+
+        if (*MatchPenalty != 0xFFFFFFFF && *MatchPenalty < FONT_NAME_MISMATCH_PENALTY)
+            return;
+
+        /* Start again, for the ties to be broken the same way */
+        *FontObj = OldFontObj;
+        *MatchPenalty = OldMatchPenalty;
     }
 
-    if (Otm)
-        ExFreePoolWithTag(Otm, GDITAG_TEXT);
+    FindBestFontFromList(FontObj, MatchPenalty, LogFont, &g_FontListHead);
+}
+
+static VOID
+IntMakeFontMatchKey(LOGFONTW *Key, const LOGFONTW *LogFont, PULONG Hash)
+{
+    const BYTE *pb = (const BYTE *)Key;
+    SIZE_T Length, i;
+    ULONG Value = 0;
+
+    *Key = *LogFont;
+    for (Length = 0; Length < LF_FACESIZE && Key->lfFaceName[Length]; Length++)
+        ;
+    RtlZeroMemory(&Key->lfFaceName[Length], (LF_FACESIZE - Length) * sizeof(WCHAR));
+
+    for (i = 0; i < sizeof(*Key); i++)
+        Value = Value * 31 + pb[i];
+
+    *Hash = Value;
+}
+
+static BOOL
+IntLookupFontMatch(const LOGFONTW *LogFont, FONTOBJ **FontObj, PULONG MatchPenalty)
+{
+    PLIST_ENTRY BucketHead, Entry;
+    PFONT_MATCH_CACHE_ENTRY CacheEntry;
+    LOGFONTW Key;
+    ULONG Hash;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    IntMakeFontMatchKey(&Key, LogFont, &Hash);
+    BucketHead = &g_FontMatchHashTable[Hash % FONT_MATCH_HASH_SIZE];
+
+    for (Entry = BucketHead->Flink; Entry != BucketHead; Entry = Entry->Flink)
+    {
+        CacheEntry = CONTAINING_RECORD(Entry, FONT_MATCH_CACHE_ENTRY, HashEntry);
+        if (CacheEntry->Hash == Hash &&
+            RtlEqualMemory(&CacheEntry->LogFont, &Key, sizeof(Key)))
+        {
+            RemoveEntryList(&CacheEntry->ListEntry);
+            InsertHeadList(&g_FontMatchListHead, &CacheEntry->ListEntry);
+            *FontObj = CacheEntry->FontObj;
+            *MatchPenalty = CacheEntry->Penalty;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static VOID
+IntCacheFontMatch(const LOGFONTW *LogFont, FONTOBJ *FontObj, ULONG MatchPenalty)
+{
+    PFONT_MATCH_CACHE_ENTRY CacheEntry;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+    ASSERT(FontObj != NULL);
+
+    /* Reuse the least recently used entry */
+    CacheEntry = CONTAINING_RECORD(g_FontMatchListHead.Blink, FONT_MATCH_CACHE_ENTRY, ListEntry);
+    RemoveEntryList(&CacheEntry->HashEntry);
+
+    IntMakeFontMatchKey(&CacheEntry->LogFont, LogFont, &CacheEntry->Hash);
+    CacheEntry->FontObj = FontObj;
+    CacheEntry->Penalty = MatchPenalty;
+
+    InsertHeadList(&g_FontMatchHashTable[CacheEntry->Hash % FONT_MATCH_HASH_SIZE],
+                   &CacheEntry->HashEntry);
+    RemoveEntryList(&CacheEntry->ListEntry);
+    InsertHeadList(&g_FontMatchListHead, &CacheEntry->ListEntry);
+}
+
+static VOID
+IntFlushFontMatchCache(VOID)
+{
+    ULONG i;
+
+    ASSERT_GLOBALFONTS_LOCK_HELD();
+
+    for (i = 0; i < FONT_MATCH_CACHE_SIZE; i++)
+    {
+        g_FontMatchCache[i].FontObj = NULL;
+        RemoveEntryList(&g_FontMatchCache[i].HashEntry);
+        InitializeListHead(&g_FontMatchCache[i].HashEntry);
+    }
 }
 
 static
@@ -5095,7 +6098,10 @@ IntFontType(PFONTGDI Font)
 {
     PS_FontInfoRec psfInfo;
     FT_ULong tmp_size = 0;
-    FT_Face Face = Font->SharedFace->Face;
+    FT_Face Face = IntGetFontFace(Font);
+
+    if (!Face)
+        return;
 
     ASSERT_FREETYPE_LOCK_NOT_HELD();
     IntLockFreeType();
@@ -5179,7 +6185,8 @@ TextIntRealizeFont(HFONT FontHandle, PTEXTOBJ pTextObj)
     NTSTATUS Status = STATUS_SUCCESS;
     PTEXTOBJ TextObj;
     PPROCESSINFO Win32Process;
-    ULONG MatchPenalty;
+    ULONG MatchPenalty, GlobalPenalty;
+    FONTOBJ *GlobalFont;
     LOGFONTW *pLogFont;
     LOGFONTW SubstitutedLogFont;
 
@@ -5221,12 +6228,24 @@ TextIntRealizeFont(HFONT FontHandle, PTEXTOBJ pTextObj)
                          &Win32Process->PrivateFontListHead);
     IntUnLockProcessPrivateFonts(Win32Process);
 
-    /* Search system fonts */
+    /* Search system fonts, unless this LOGFONT was already realized */
     IntLockGlobalFonts();
-    FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
-                         &g_FontListHead);
+    if (!IntLookupFontMatch(&SubstitutedLogFont, &GlobalFont, &GlobalPenalty))
+    {
+        GlobalFont = NULL;
+        GlobalPenalty = 0xFFFFFFFF;
+        FindBestGlobalFont(&GlobalFont, &GlobalPenalty, &SubstitutedLogFont);
+        if (GlobalFont)
+            IntCacheFontMatch(&SubstitutedLogFont, GlobalFont, GlobalPenalty);
+    }
     IntUnLockGlobalFonts();
 
+    if (GlobalFont && (MatchPenalty == 0xFFFFFFFF || GlobalPenalty < MatchPenalty))
+    {
+        TextObj->Font = GlobalFont;
+        MatchPenalty = GlobalPenalty;
+    }
+
     if (NULL == TextObj->Font)
     {
         DPRINT1("Request font %S not found, no fonts loaded at all\n",
@@ -5635,11 +6654,16 @@ BOOL
 FASTCALL
 ftGdiRealizationInfo(PFONTGDI Font, PREALIZATION_INFO Info)
 {
-    if (FT_HAS_FIXED_SIZES(Font->SharedFace->Face))
+    FT_Face Face = IntGetFontFace(Font);
+
+    if (!Face)
+        return FALSE;
+
+    if (FT_HAS_FIXED_SIZES(Face))
         Info->iTechnology = RI_TECH_BITMAP;
     else
     {
-        if (FT_IS_SCALABLE(Font->SharedFace->Face))
+        if (FT_IS_SCALABLE(Face))
             Info->iTechnology = RI_TECH_SCALABLE;
         else
             Info->iTechnology = RI_TECH_FIXED;
@@ -5658,9 +6682,9 @@ ftGdiGetKerningPairs( PFONTGDI Font,
 {
     DWORD Count = 0;
     INT i = 0;
-    FT_Face face = Font->SharedFace->Face;
+    FT_Face face = IntGetFontFace(Font);
 
-    if (FT_HAS_KERNING(face) && face->charmap->encoding == FT_ENCODING_UNICODE)
+    if (face && FT_HAS_KERNING(face) && face->charmap->encoding == FT_ENCODING_UNICODE)
     {
         FT_UInt previous_index = 0, glyph_index = 0;
         FT_ULong char_code, char_previous;
@@ -6026,7 +7050,13 @@ IntExtTextOutW(
     ASSERT(FontGDI);
 
     IntLockFreeType();
-    face = FontGDI->SharedFace->Face;
+    face = IntGetFontFace(FontGDI);
+    if (!face)
+    {
+        IntUnLockFreeType();
+        bResult = FALSE;
+        goto Cleanup;
+    }
 
     plf = &TextObj->logfont.elfEnumLogfontEx.elfLogFont;
     EmuBold = EMUBOLD_NEEDED(FontGDI->OriginalWeight, plf->lfWeight);
@@ -6870,7 +7900,19 @@ NtGdiGetCharABCWidthsW(
 
     FontGDI = ObjToGDI(TextObj->Font, FONT);
 
-    face = FontGDI->SharedFace->Face;
+    face = IntGetFontFace(FontGDI);
+    if (!face)
+    {
+        TEXTOBJ_UnlockText(TextObj);
+        ExFreePoolWithTag(SafeBuff, GDITAG_TEXT);
+
+        if(Safepwch)
+            ExFreePoolWithTag(Safepwch , GDITAG_TEXT);
+
+        EngSetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
     if (face->charmap == NULL)
     {
         for (i = 0; i < (UINT)face->num_charmaps; i++)
@@ -7060,7 +8102,19 @@ NtGdiGetCharWidthW(
 
     FontGDI = ObjToGDI(TextObj->Font, FONT);
 
-    face = FontGDI->SharedFace->Face;
+    face = IntGetFontFace(FontGDI);
+    if (!face)
+    {
+        TEXTOBJ_UnlockText(TextObj);
+
+        if(Safepwc)
+            ExFreePoolWithTag(Safepwc, GDITAG_TEXT);
+
+        ExFreePoolWithTag(SafeBuff, GDITAG_TEXT);
+        EngSetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
     if (face->charmap == NULL)
     {
         for (i = 0; i < (UINT)face->num_charmaps; i++)
@@ -7194,11 +8248,17 @@ NtGdiGetGlyphIndicesW(
     FontGDI = ObjToGDI(TextObj->Font, FONT);
     TEXTOBJ_UnlockText(TextObj);
 
+    Face = IntGetFontFace(FontGDI);
+    if (!Face)
+    {
+        DPRINT1("!Face\n");
+        return GDI_ERROR;
+    }
+
     if (cwc == 0)
     {
         if (!UnSafepwc && !UnSafepgi)
         {
-            Face = FontGDI->SharedFace->Face;
             return Face->num_glyphs;
         }
         else
@@ -7222,7 +8282,6 @@ NtGdiGetGlyphIndicesW(
     }
     else
     {
-        Face = FontGDI->SharedFace->Face;
         if (FT_IS_SFNT(Face))
         {
             IntLockFreeType();
@@ -7284,7 +8343,7 @@ NtGdiGetGlyphIndicesW(
     IntLockFreeType();
     for (i = 0; i < cwc; i++)
     {
-        Buffer[i] = get_glyph_index(FontGDI->SharedFace->Face, Safepwc[i]);
+        Buffer[i] = get_glyph_index(Face, Safepwc[i]);
         if (Buffer[i] == 0)
         {
             Buffer[i] = DefChar;
@@ -537,6 +537,17 @@ IntGetClassWndProc(PCLS Class, BOOL Ansi)
   return (gcpd ? gcpd : Ret);
 }
 
+//
+// Whether IntGetClassWndProc might have to create a call procedure handle,
+// which cannot be done under a shared lock.
+//
+static BOOL FASTCALL
+IntClassWndProcNeedsCallProc(PCLS Class, BOOL Ansi)
+{
+  return !(Class->CSF_flags & CSF_SERVERSIDEPROC) &&
+         Ansi != !!(Class->CSF_flags & CSF_ANSIPROC);
+}
+
 
 static
 WNDPROC FASTCALL
@@ -2761,21 +2772,40 @@ NtUserGetClassInfo(
 
     TRACE("GetClassInfo(%wZ, %p)\n", &SafeClassName, hInstance);
 
-    /* NOTE: Need exclusive lock because getting the wndproc might require the
-             creation of a call procedure handle */
-    UserEnterExclusive();
+    /* Most lookups only read the class, try them under a shared lock first */
+    UserEnterShared();
 
     ppi = GetW32ProcessInfo();
-    if (!(ppi->W32PF_flags & W32PF_CLASSESREGISTERED))
+    if (ppi->W32PF_flags & W32PF_CLASSESREGISTERED)
     {
-        UserRegisterSystemClasses();
+        ClassAtom = IntGetClassAtom(&SafeClassName,
+                                    hInstance,
+                                    ppi,
+                                    &Class,
+                                    NULL);
+    }
+
+    /* NOTE: Need exclusive lock to register the system classes, or because
+             getting the wndproc might require the creation of a call
+             procedure handle */
+    if (!(ppi->W32PF_flags & W32PF_CLASSESREGISTERED) ||
+        (ClassAtom != (RTL_ATOM)0 && IntClassWndProcNeedsCallProc(Class, bAnsi)))
+    {
+        UserLeave();
+        UserEnterExclusive();
+
+        if (!(ppi->W32PF_flags & W32PF_CLASSESREGISTERED))
+        {
+            UserRegisterSystemClasses();
+        }
+
+        ClassAtom = IntGetClassAtom(&SafeClassName,
+                                    hInstance,
+                                    ppi,
+                                    &Class,
+                                    NULL);
     }
 
-    ClassAtom = IntGetClassAtom(&SafeClassName,
-                                hInstance,
-                                ppi,
-                                &Class,
-                                NULL);
     if (ClassAtom != (RTL_ATOM)0)
     {
         ClassAtom = Class->atomNVClassName;
@@ -2897,7 +2927,7 @@ NtUserGetWOWClass(
         return FALSE;
     }
 
-    UserEnterExclusive();
+    UserEnterShared();
 
     pi = GetW32ProcessInfo();
 
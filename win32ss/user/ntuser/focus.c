@@ -567,14 +567,16 @@ BOOL FASTCALL
 FindRemoveEventMsg(PTHREADINFO pti, DWORD Event, DWORD EventLast)
 {
    PUSER_MESSAGE Message;
-   PLIST_ENTRY Entry;
+   PLIST_ENTRY Entry, ListHead;
    BOOL Ret = FALSE;
 
-   Entry = pti->PostedMessagesListHead.Flink;
-   while (Entry != &pti->PostedMessagesListHead)
+   // Only the QS_EVENT messages carry an event.
+   ListHead = &pti->PostedMessagesClassHead[QSRosEvent];
+   Entry = ListHead->Flink;
+   while (Entry != ListHead)
    {
       // Scan posted queue messages to see if we received async messages.
-      Message = CONTAINING_RECORD(Entry, USER_MESSAGE, ListEntry);
+      Message = CONTAINING_RECORD(Entry, USER_MESSAGE, ClassEntry);
       Entry = Entry->Flink;
 
       if (Message->dwQEvent == EventLast)
@@ -491,6 +491,14 @@ InitThreadCallback(PETHREAD Thread)
     {
         InitializeListHead(&ptiCurrent->aphkStart[i]);
     }
+    for (i = 0; i < POSTED_WINDOW_BUCKETS; i++)
+    {
+        InitializeListHead(&ptiCurrent->PostedMessagesWindowHead[i]);
+    }
+    for (i = 0; i < QSIDCOUNTS; i++)
+    {
+        InitializeListHead(&ptiCurrent->PostedMessagesClassHead[i]);
+    }
     ptiCurrent->ptiSibling = ptiCurrent->ppi->ptiList;
     ptiCurrent->ppi->ptiList = ptiCurrent;
     ptiCurrent->ppi->cThreads++;
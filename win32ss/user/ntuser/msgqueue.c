@@ -727,6 +727,19 @@ co_MsqInsertMouseMessage(MSG* Msg, DWORD flags, ULONG_PTR dwExtraInfo, BOOL Hook
    }
 }
 
+/* User handles are ((index << 1) + FIRST_USER_HANDLE) | (generation << 16) */
+#define MsqPostedWindowBucket(hWnd) \
+   ((ULONG)((ULONG_PTR)(hWnd) >> 1) & (POSTED_WINDOW_BUCKETS - 1))
+
+static QS_ROS_TYPES FASTCALL
+MsqPostedClass(DWORD QS_Flags)
+{
+   if (QS_Flags & QS_EVENT) return QSRosEvent;
+   if (QS_Flags & QS_HOTKEY) return QSRosHotKey;
+   if (QS_Flags & QS_KEY) return QSRosKey;
+   return QSRosPostMessage;
+}
+
 PUSER_MESSAGE FASTCALL
 MsqCreateMessage(LPMSG Msg)
 {
@@ -754,6 +767,16 @@ MsqDestroyMessage(PUSER_MESSAGE Message)
       return;
    }
    RemoveEntryList(&Message->ListEntry);
+   if (Message->WindowEntry.Flink)
+   {
+      /* Posted message, drop it from the indexes too */
+      QS_ROS_TYPES Class = MsqPostedClass(Message->QS_Flags);
+
+      RemoveEntryList(&Message->WindowEntry);
+      RemoveEntryList(&Message->ClassEntry);
+      if (IsListEmpty(&Message->pti->PostedMessagesClassHead[Class]))
+         Message->pti->fsPostedClassBits[Class] = 0;
+   }
    Message->pti = NULL;
    ExFreeToPagedLookasideList(pgMessageLookasideList, Message);
    PostMsgCount--;
@@ -807,11 +830,12 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
    pti = Window->head.pti;
 
    /* remove the posted messages for this window */
-   CurrentEntry = pti->PostedMessagesListHead.Flink;
-   ListHead = &pti->PostedMessagesListHead;
+   ListHead = &pti->PostedMessagesWindowHead[MsqPostedWindowBucket(Window->head.h)];
+   CurrentEntry = ListHead->Flink;
    while (CurrentEntry != ListHead)
    {
-      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, ListEntry);
+      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, WindowEntry);
+      CurrentEntry = CurrentEntry->Flink;
 
       if (PostedMessage->Msg.hwnd == Window->head.h)
       {
@@ -822,11 +846,6 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
          }
          ClearMsgBitsMask(pti, PostedMessage->QS_Flags);
          MsqDestroyMessage(PostedMessage);
-         CurrentEntry = pti->PostedMessagesListHead.Flink;
-      }
-      else
-      {
-         CurrentEntry = CurrentEntry->Flink;
       }
    }
 
@@ -1358,16 +1377,24 @@ MsqPostMessage(PTHREADINFO pti,
 
    MessageQueue = pti->MessageQueue;
 
+   if (Msg->message == WM_HOTKEY) MessageBits |= QS_HOTKEY; // Justin Case, just set it.
+
    if (!HardwareMessage)
    {
+       QS_ROS_TYPES Class = MsqPostedClass(MessageBits);
+
        InsertTailList(&pti->PostedMessagesListHead, &Message->ListEntry);
+       InsertTailList(&pti->PostedMessagesWindowHead[MsqPostedWindowBucket(Msg->hwnd)],
+                      &Message->WindowEntry);
+       InsertTailList(&pti->PostedMessagesClassHead[Class], &Message->ClassEntry);
+       pti->fsPostedClassBits[Class] |= MessageBits;
+       Message->Sequence = pti->PostedSequence++;
    }
    else
    {
        InsertTailList(&MessageQueue->HardwareMessagesListHead, &Message->ListEntry);
    }
 
-   if (Msg->message == WM_HOTKEY) MessageBits |= QS_HOTKEY; // Justin Case, just set it.
    Message->dwQEvent = dwQEvent;
    Message->ExtraInfo = ExtraInfo;
    Message->QS_Flags = MessageBits;
@@ -2103,6 +2130,16 @@ co_MsqPeekHardwareMessage(IN PTHREADINFO pti,
    return Ret;
 }
 
+/* Without message range, only the QS bits filter, even for a posted WM_NULL */
+static __inline BOOL
+MsqIsPostedFilterMatch(PUSER_MESSAGE Message, UINT MsgFilterLow, UINT MsgFilterHigh, UINT QSflags)
+{
+   if (MsgFilterLow == 0 && MsgFilterHigh == 0)
+      return !!(Message->QS_Flags & QSflags);
+
+   return MsgFilterLow <= Message->Msg.message && MsgFilterHigh >= Message->Msg.message;
+}
+
 BOOLEAN APIENTRY
 MsqPeekMessage(IN PTHREADINFO pti,
                   IN BOOLEAN Remove,
@@ -2114,50 +2151,87 @@ MsqPeekMessage(IN PTHREADINFO pti,
                   OUT DWORD *dwQEvent,
                   OUT PMSG Message)
 {
-   PUSER_MESSAGE CurrentMessage;
-   PLIST_ENTRY ListHead;
+   PUSER_MESSAGE CurrentMessage, FoundMessage = NULL;
+   PLIST_ENTRY ListHead, Entry;
+   HWND hWnd;
    DWORD QS_Flags;
-   BOOL Ret = FALSE;
+   INT Class;
 
-   ListHead = pti->PostedMessagesListHead.Flink;
-
-   if (IsListEmpty(ListHead)) return FALSE;
+   if (IsListEmpty(&pti->PostedMessagesListHead)) return FALSE;
 
-   while(ListHead != &pti->PostedMessagesListHead)
-   {
-      CurrentMessage = CONTAINING_RECORD(ListHead, USER_MESSAGE, ListEntry);
-      ListHead = ListHead->Flink;
 /*
  MSDN:
  1: any window that belongs to the current thread, and any messages on the current thread's message queue whose hwnd value is NULL.
  2: retrieves only messages on the current thread's message queue whose hwnd value is NULL.
  3: handle to the window whose messages are to be retrieved.
  */
-      if ( ( !Window || // 1
-            ( Window == PWND_BOTTOM && CurrentMessage->Msg.hwnd == NULL ) || // 2
-            ( Window != PWND_BOTTOM && Window->head.h == CurrentMessage->Msg.hwnd ) ) && // 3
-            ( ( ( MsgFilterLow == 0 && MsgFilterHigh == 0 ) && CurrentMessage->QS_Flags & QSflags ) ||
-              ( MsgFilterLow <= CurrentMessage->Msg.message && MsgFilterHigh >= CurrentMessage->Msg.message ) ) )
+   if (Window) // 2, 3
+   {
+      /* Only look through the bucket of that hwnd, it keeps the posting order */
+      hWnd = (Window == PWND_BOTTOM) ? NULL : Window->head.h;
+      ListHead = &pti->PostedMessagesWindowHead[MsqPostedWindowBucket(hWnd)];
+      for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
       {
-         *Message   = CurrentMessage->Msg;
-         *ExtraInfo = CurrentMessage->ExtraInfo;
-         QS_Flags   = CurrentMessage->QS_Flags;
-         if (dwQEvent) *dwQEvent = CurrentMessage->dwQEvent;
+         CurrentMessage = CONTAINING_RECORD(Entry, USER_MESSAGE, WindowEntry);
+         if (CurrentMessage->Msg.hwnd == hWnd &&
+             MsqIsPostedFilterMatch(CurrentMessage, MsgFilterLow, MsgFilterHigh, QSflags))
+         {
+            FoundMessage = CurrentMessage;
+            break;
+         }
+      }
+   }
+   else if (MsgFilterLow == 0 && MsgFilterHigh == 0) // 1, by QS bits
+   {
+      /* Take the oldest first match of the classes that can match */
+      for (Class = 0; Class < QSIDCOUNTS; Class++)
+      {
+         if (!(pti->fsPostedClassBits[Class] & QSflags)) continue;
 
-         if (Remove)
+         ListHead = &pti->PostedMessagesClassHead[Class];
+         for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
          {
-             if (CurrentMessage->pti != NULL)
-             {
-                MsqDestroyMessage(CurrentMessage);
-             }
-             ClearMsgBitsMask(pti, QS_Flags);
+            CurrentMessage = CONTAINING_RECORD(Entry, USER_MESSAGE, ClassEntry);
+            if (MsqIsPostedFilterMatch(CurrentMessage, 0, 0, QSflags))
+            {
+               if (!FoundMessage || (LONG)(CurrentMessage->Sequence - FoundMessage->Sequence) < 0)
+                  FoundMessage = CurrentMessage;
+               break;
+            }
+         }
+      }
+   }
+   else // 1, by message range
+   {
+      ListHead = &pti->PostedMessagesListHead;
+      for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
+      {
+         CurrentMessage = CONTAINING_RECORD(Entry, USER_MESSAGE, ListEntry);
+         if (MsqIsPostedFilterMatch(CurrentMessage, MsgFilterLow, MsgFilterHigh, QSflags))
+         {
+            FoundMessage = CurrentMessage;
+            break;
          }
-         Ret = TRUE;
-         break;
       }
    }
 
-   return Ret;
+   if (!FoundMessage) return FALSE;
+
+   *Message   = FoundMessage->Msg;
+   *ExtraInfo = FoundMessage->ExtraInfo;
+   QS_Flags   = FoundMessage->QS_Flags;
+   if (dwQEvent) *dwQEvent = FoundMessage->dwQEvent;
+
+   if (Remove)
+   {
+       if (FoundMessage->pti != NULL)
+       {
+          MsqDestroyMessage(FoundMessage);
+       }
+       ClearMsgBitsMask(pti, QS_Flags);
+   }
+
+   return TRUE;
 }
 
 NTSTATUS FASTCALL
@@ -8,6 +8,9 @@
 typedef struct _USER_MESSAGE
 {
   LIST_ENTRY ListEntry;
+  LIST_ENTRY WindowEntry;   /* Posted messages only, in PostedMessagesWindowHead */
+  LIST_ENTRY ClassEntry;    /* Posted messages only, in PostedMessagesClassHead */
+  ULONG Sequence;           /* Posted messages only, from PostedSequence */
   MSG Msg;
   DWORD QS_Flags;
   LONG_PTR ExtraInfo;
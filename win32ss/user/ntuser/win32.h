@@ -35,6 +35,9 @@
 
 #define QSIDCOUNTS 7
 
+/* Number of hwnd buckets indexing the posted messages of a thread */
+#define POSTED_WINDOW_BUCKETS 16
+
 typedef enum _QS_ROS_TYPES
 {
     QSRosKey = 0,
@@ -147,6 +150,12 @@ typedef struct _THREADINFO
     // Accounting of queue bit sets, the rest are flags. QS_TIMER QS_PAINT counts are handled in thread information.
     DWORD nCntsQBits[QSIDCOUNTS]; // QS_KEY QS_MOUSEMOVE QS_MOUSEBUTTON QS_POSTMESSAGE QS_SENDMESSAGE QS_HOTKEY
 
+    /* Indexes of PostedMessagesListHead, see MsqPeekMessage */
+    LIST_ENTRY PostedMessagesWindowHead[POSTED_WINDOW_BUCKETS]; // By hwnd
+    LIST_ENTRY PostedMessagesClassHead[QSIDCOUNTS]; // By QS class (QS_ROS_TYPES)
+    DWORD fsPostedClassBits[QSIDCOUNTS]; // QS bits of the messages in each class
+    ULONG PostedSequence; // Posting order
+
     LIST_ENTRY WindowListHead;
     LIST_ENTRY W32CallbackListHead;
     SINGLE_LIST_ENTRY  ReferencesList;
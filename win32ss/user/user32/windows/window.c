@@ -960,7 +960,7 @@ HWND WINAPI
 GetAncestor(HWND hwnd, UINT gaFlags)
 {
     HWND Ret = NULL;
-    PWND Ancestor, Wnd;
+    PWND Ancestor, Wnd, Parent;
 
     Wnd = ValidateHwnd(hwnd);
     if (!Wnd)
@@ -976,13 +976,69 @@ GetAncestor(HWND hwnd, UINT gaFlags)
                     Ancestor = DesktopPtrToUser(Wnd->spwndParent);
                 break;
 
+            /*
+             * Same as win32k:UserGetAncestor. A window without parent is the
+             * desktop or the message-only root window, and win32k knows which.
+             */
+            case GA_ROOT:
+                if (Wnd->spwndParent == NULL)
+                {
+                    Wnd = NULL;
+                    break;
+                }
+
+                Ancestor = Wnd;
+                for (;;)
+                {
+                    Parent = DesktopPtrToUser(Ancestor->spwndParent);
+                    if (Parent == NULL)
+                    {
+                        /* Not on our desktop heap, call win32k */
+                        Wnd = NULL;
+                        break;
+                    }
+                    if (Parent->spwndParent == NULL)
+                        break;
+                    Ancestor = Parent;
+                }
+                break;
+
+            case GA_ROOTOWNER:
+                if (Wnd->spwndParent == NULL)
+                {
+                    Wnd = NULL;
+                    break;
+                }
+
+                Ancestor = Wnd;
+                for (;;)
+                {
+                    if (Ancestor->style & WS_POPUP)
+                        Parent = Ancestor->spwndOwner;
+                    else if (Ancestor->style & WS_CHILD)
+                        Parent = Ancestor->spwndParent;
+                    else
+                        Parent = NULL;
+
+                    if (Parent == NULL)
+                        break;
+                    Ancestor = DesktopPtrToUser(Parent);
+                    if (Ancestor == NULL)
+                    {
+                        /* Not on our desktop heap, call win32k */
+                        Wnd = NULL;
+                        break;
+                    }
+                }
+                break;
+
             default:
-                /* FIXME: Call win32k for now */
+                /* Let win32k handle the invalid flags */
                 Wnd = NULL;
                 break;
         }
 
-        if (Ancestor != NULL)
+        if (Wnd != NULL && Ancestor != NULL)
             Ret = UserHMGetHandle(Ancestor);
     }
     _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
@@ -1863,7 +1919,41 @@ GetWindowContextHelpId(HWND hwnd)
 int WINAPI
 InternalGetWindowText(HWND hWnd, LPWSTR lpString, int nMaxCount)
 {
-    INT Ret = NtUserInternalGetWindowText(hWnd, lpString, nMaxCount);
+    PWND Wnd;
+    PWSTR Buffer;
+    INT Ret;
+
+    /* The window text lives in the desktop heap, read it without calling win32k */
+    Wnd = ValidateHwnd(hWnd);
+    if (Wnd != NULL && (!lpString || nMaxCount > 1))
+    {
+        _SEH2_TRY
+        {
+            Ret = Wnd->strName.Length / sizeof(WCHAR);
+            Buffer = Wnd->strName.Buffer ? DesktopPtrToUser(Wnd->strName.Buffer) : NULL;
+            if (Ret != 0 && Buffer == NULL)
+            {
+                Ret = -1;
+            }
+            else if (lpString)
+            {
+                Ret = min(nMaxCount - 1, Ret);
+                RtlCopyMemory(lpString, Buffer, Ret * sizeof(WCHAR));
+                lpString[Ret] = UNICODE_NULL;
+            }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Ret = -1;
+        }
+        _SEH2_END;
+
+        if (Ret >= 0)
+            return Ret;
+    }
+
+    /* Fall back to win32k, which also sets the last error */
+    Ret = NtUserInternalGetWindowText(hWnd, lpString, nMaxCount);
     if (Ret == 0 && lpString)
         *lpString = L'\0';
     return Ret;